@@ -0,0 +1,374 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "atf-c++/bench.hpp"
+
+extern "C" {
+#include "atf-c/tc.h"
+}
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "atf-c++/detail/sanity.hpp"
+
+namespace impl = atf::bench;
+#define IMPL_NAME "atf::bench"
+
+// ------------------------------------------------------------------------
+// Auxiliary functions.
+// ------------------------------------------------------------------------
+
+namespace {
+
+// Where do_not_optimize stores the addresses of the values it is given
+// when the compiler does not support the barrier.
+const void* volatile address_sink;
+
+const impl::complexity all_complexities[] = {
+    impl::o_1,
+    impl::o_n,
+    impl::o_n_log_n,
+    impl::o_n_squared,
+};
+
+double
+complexity_value(const impl::complexity c, const long n)
+{
+    const double x = static_cast< double >(n);
+
+    switch (c) {
+    case impl::o_1: return 1.0;
+    case impl::o_n: return x;
+    case impl::o_n_log_n: return x > 1.0 ? x * std::log2(x) : 0.0;
+    case impl::o_n_squared: return x * x;
+    }
+    UNREACHABLE;
+    return 0.0;
+}
+
+std::string
+args_label(const impl::args_vector& args, const std::size_t first)
+{
+    std::string label;
+
+    for (std::size_t i = first; i < args.size(); i++) {
+        if (!label.empty())
+            label += "/";
+        label += args[i].first + "=" + std::to_string(args[i].second);
+    }
+    return label;
+}
+
+} // anonymous namespace
+
+void
+impl::detail::use_address(const void* address)
+{
+    address_sink = address;
+}
+
+// ------------------------------------------------------------------------
+// Complexity fitting.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief Finds the complexity that best explains some measurements.
+//!
+//! Each point is the size of the input of the measured code and the time
+//! it took.  Every complexity gets the coefficient that minimizes its
+//! squared error and the one whose root mean square error is the lowest
+//! wins, the lowest one in case of a tie.  The error is relative to the
+//! mean time so that fits of different code can be compared.
+//!
+impl::complexity_fit
+impl::fit_complexity(const complexity_points& points)
+{
+    PRE(points.size() >= 2);
+
+    double mean = 0.0;
+    for (const auto& point : points)
+        mean += point.second;
+    mean /= static_cast< double >(points.size());
+
+    complexity_fit best = { o_1, 0.0, -1.0 };
+    for (const complexity c : all_complexities) {
+        double sum_tf = 0.0, sum_ff = 0.0;
+        for (const auto& point : points) {
+            const double f = complexity_value(c, point.first);
+            sum_tf += point.second * f;
+            sum_ff += f * f;
+        }
+        if (sum_ff == 0.0)
+            continue;
+        const double coefficient = sum_tf / sum_ff;
+
+        double sum_sq = 0.0;
+        for (const auto& point : points) {
+            const double error = point.second -
+                coefficient * complexity_value(c, point.first);
+            sum_sq += error * error;
+        }
+        double rms = std::sqrt(sum_sq / static_cast< double >(points.size()));
+        if (mean > 0.0)
+            rms /= mean;
+
+        if (best.m_rms < 0.0 || rms < best.m_rms) {
+            best.m_complexity = c;
+            best.m_coefficient = coefficient;
+            best.m_rms = rms;
+        }
+    }
+    INV(best.m_rms >= 0.0);
+    return best;
+}
+
+std::string
+impl::complexity_name(const complexity c)
+{
+    switch (c) {
+    case o_1: return "O(1)";
+    case o_n: return "O(n)";
+    case o_n_log_n: return "O(n log n)";
+    case o_n_squared: return "O(n^2)";
+    }
+    UNREACHABLE;
+    return "";
+}
+
+bool
+impl::parse_complexity(const std::string& name, complexity& c)
+{
+    for (const complexity candidate : all_complexities) {
+        if (complexity_name(candidate) == name) {
+            c = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ------------------------------------------------------------------------
+// The "state" class.
+// ------------------------------------------------------------------------
+
+impl::state::state(const tc& owner, const args_vector& args) :
+    m_tc(owner),
+    m_args(args),
+    m_left(0),
+    m_done(false)
+{
+}
+
+long
+impl::state::arg(void)
+    const
+{
+    PRE(!m_args.empty());
+    return m_args[0].second;
+}
+
+long
+impl::state::arg(const std::string& name)
+    const
+{
+    for (const auto& arg : m_args) {
+        if (arg.first == name)
+            return arg.second;
+    }
+    atf::tests::tc::fail("Unknown benchmark parameter " + name);
+}
+
+//!
+//! \brief Ends the running batch and starts the next one, if any.
+//!
+bool
+impl::state::next_batch(void)
+{
+    std::size_t iterations;
+
+    if (m_done || !atf_tc_benchmark_batch(m_tc.get_c_tc(), &iterations)) {
+        m_done = true;
+        return false;
+    }
+    INV(iterations > 0);
+    m_left = iterations - 1;
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// The "tc" class.
+// ------------------------------------------------------------------------
+
+impl::tc::tc(const std::string& ident) :
+    atf::tests::tc(ident, false)
+{
+}
+
+impl::tc::~tc(void)
+{
+}
+
+void
+impl::tc::bench_head(void)
+{
+}
+
+void
+impl::tc::head(void)
+{
+    set_md_var("X-benchmark", "true");
+    bench_head();
+}
+
+//!
+//! \brief Sweeps the parameters, measuring the body for each combination.
+//!
+//! The first parameter varies the fastest, so the measurements for all of
+//! its values and the same values of the others are consecutive and their
+//! complexity is fitted as soon as they are done.
+//!
+void
+impl::tc::body(void)
+    const
+{
+    if (m_params.empty()) {
+        (void)run_point(args_vector());
+        return;
+    }
+
+    std::vector< std::size_t > pos(m_params.size(), 0);
+    complexity_points points;
+    bool more = true;
+    while (more) {
+        args_vector args;
+        for (std::size_t i = 0; i < m_params.size(); i++)
+            args.push_back(std::make_pair(m_params[i].first,
+                                          m_params[i].second[pos[i]]));
+        points.push_back(std::make_pair(args[0].second, run_point(args)));
+
+        std::size_t i = 0;
+        while (i < pos.size() && ++pos[i] == m_params[i].second.size()) {
+            pos[i] = 0;
+            i++;
+        }
+        more = i < pos.size();
+
+        if (pos[0] == 0) {
+            report_complexity(args, points);
+            points.clear();
+        }
+    }
+}
+
+//!
+//! \brief Measures the body for a combination of the parameters.
+//!
+//! \return The median time per iteration, in nanoseconds.
+//!
+double
+impl::tc::run_point(const args_vector& args)
+    const
+{
+    const std::string label = args_label(args, 0);
+    if (!label.empty())
+        atf_tc_benchmark_label(get_c_tc(), label.c_str());
+
+    state s(*this, args);
+    bench_body(s);
+    if (!s.m_done)
+        fail("Benchmark body did not complete its loop" +
+             (label.empty() ? "" : " for " + label));
+    return atf_tc_benchmark_median(get_c_tc());
+}
+
+//!
+//! \brief Fits and reports the complexity of the body over the first
+//! parameter.
+//!
+//! Fails the test case if the fitted complexity is worse than the one in
+//! the X-benchmark.complexity property, if any.
+//!
+void
+impl::tc::report_complexity(const args_vector& args,
+                            const complexity_points& points)
+    const
+{
+    if (points.size() < 3)
+        return;
+
+    std::string name = get_md_var("ident");
+    const std::string others = args_label(args, 1);
+    if (!others.empty())
+        name += "/" + others;
+
+    const complexity_fit fit = fit_complexity(points);
+
+    std::ostringstream record;
+    record << std::fixed << std::setprecision(3)
+           << "complexity: " << name << "\n"
+           << "big-o: " << complexity_name(fit.m_complexity) << "\n"
+           << "coefficient: " << fit.m_coefficient << "\n"
+           << "rms: " << fit.m_rms << "\n";
+    atf_tc_benchmark_report(get_c_tc(), record.str().c_str());
+
+    if (!has_md_var("X-benchmark.complexity"))
+        return;
+
+    const std::string value = get_md_var("X-benchmark.complexity");
+    complexity expected;
+    if (!parse_complexity(value, expected))
+        fail("Invalid value for the X-benchmark.complexity property: " +
+             value);
+    if (fit.m_complexity > expected)
+        fail_nonfatal("Measured " + complexity_name(fit.m_complexity) +
+                      " complexity for " + name + " but expected at most " +
+                      complexity_name(expected));
+}
+
+void
+impl::tc::add_range(const std::string& name, const long first,
+                    const long last, const long multiplier)
+{
+    PRE(first > 0);
+    PRE(last >= first);
+    PRE(multiplier >= 2);
+
+    std::vector< long > values;
+    for (long value = first; value < last; value *= multiplier)
+        values.push_back(value);
+    values.push_back(last);
+    add_values(name, values);
+}
+
+void
+impl::tc::add_values(const std::string& name,
+                     const std::vector< long >& values)
+{
+    PRE(!values.empty());
+
+    m_params.push_back(std::make_pair(name, values));
+}
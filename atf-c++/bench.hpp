@@ -0,0 +1,171 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if !defined(ATF_CXX_BENCH_HPP)
+#define ATF_CXX_BENCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <atf-c++/tests.hpp>
+
+namespace atf {
+namespace bench {
+
+namespace detail {
+
+void use_address(const void*);
+
+} // namespace detail
+
+// ------------------------------------------------------------------------
+// Compiler barriers.
+// ------------------------------------------------------------------------
+
+// Makes the compiler assume that the value is read by code that it cannot
+// see, so that it neither discards nor hoists the computation of the value
+// out of the measured loop.
+template< typename T >
+inline void
+do_not_optimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    detail::use_address(&value);
+#endif
+}
+
+// Makes the compiler assume that all of memory is read and written at this
+// point, so that pending stores happen before it.
+inline void
+clobber_memory(void)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// ------------------------------------------------------------------------
+// Complexity fitting.
+// ------------------------------------------------------------------------
+
+enum complexity {
+    o_1,
+    o_n,
+    o_n_log_n,
+    o_n_squared,
+};
+
+struct complexity_fit {
+    complexity m_complexity;
+    double m_coefficient;
+    double m_rms;
+};
+
+typedef std::vector< std::pair< long, double > > complexity_points;
+
+complexity_fit fit_complexity(const complexity_points&);
+std::string complexity_name(const complexity);
+bool parse_complexity(const std::string&, complexity&);
+
+// ------------------------------------------------------------------------
+// The "state" class.
+// ------------------------------------------------------------------------
+
+class tc;
+
+typedef std::vector< std::pair< std::string, long > > args_vector;
+
+class state {
+    // Non-copyable.
+    state(const state&);
+    state& operator=(const state&);
+
+    const tc& m_tc;
+    const args_vector m_args;
+    std::size_t m_left;
+    bool m_done;
+
+    state(const tc&, const args_vector&);
+    bool next_batch(void);
+
+    friend class tc;
+
+public:
+    long arg(void) const;
+    long arg(const std::string&) const;
+
+    // Tells whether the measured code must run once more.  Only returns
+    // false once all the batches of the measurement are done.
+    bool
+    keep_running(void)
+    {
+        if (m_left > 0) {
+            m_left--;
+            return true;
+        }
+        return next_batch();
+    }
+};
+
+// ------------------------------------------------------------------------
+// The "tc" class.
+// ------------------------------------------------------------------------
+
+class tc : public atf::tests::tc {
+    std::vector< std::pair< std::string, std::vector< long > > > m_params;
+
+    void head(void);
+    void body(void) const;
+
+    double run_point(const args_vector&) const;
+    void report_complexity(const args_vector&, const complexity_points&)
+        const;
+
+    friend class state;
+
+protected:
+    virtual void bench_head(void);
+    virtual void bench_body(state&) const = 0;
+
+    void add_range(const std::string&, const long, const long,
+                   const long = 8);
+    void add_values(const std::string&, const std::vector< long >&);
+
+public:
+    tc(const std::string&);
+    virtual ~tc(void);
+};
+
+} // namespace bench
+} // namespace atf
+
+#endif // !defined(ATF_CXX_BENCH_HPP)
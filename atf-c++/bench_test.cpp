@@ -0,0 +1,170 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "atf-c++/bench.hpp"
+
+#include <cmath>
+#include <string>
+
+#include <atf-c++.hpp>
+
+// Builds the measurements of code of the given complexity, with a small
+// deterministic error so that no fit is exact.
+static atf::bench::complexity_points
+make_points(double (*time)(const double))
+{
+    atf::bench::complexity_points points;
+    const long sizes[] = { 8, 64, 512, 4096, 32768 };
+    int i = 0;
+
+    for (const long n : sizes) {
+        const double error = (i++ % 2 == 0) ? 1.02 : 0.98;
+        points.push_back(std::make_pair(n, time(static_cast< double >(n)) *
+                                        error));
+    }
+    return points;
+}
+
+// ------------------------------------------------------------------------
+// Test cases for complexity fitting.
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE_WITHOUT_HEAD(fit_complexity__constant);
+ATF_TEST_CASE_BODY(fit_complexity__constant)
+{
+    const atf::bench::complexity_fit fit = atf::bench::fit_complexity(
+        make_points([](const double) { return 40.0; }));
+    ATF_REQUIRE_EQ("O(1)",
+                   atf::bench::complexity_name(fit.m_complexity));
+    ATF_REQUIRE(std::fabs(fit.m_coefficient - 40.0) < 1.0);
+    ATF_REQUIRE(fit.m_rms < 0.05);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(fit_complexity__linear);
+ATF_TEST_CASE_BODY(fit_complexity__linear)
+{
+    const atf::bench::complexity_fit fit = atf::bench::fit_complexity(
+        make_points([](const double n) { return 3.0 * n + 10.0; }));
+    ATF_REQUIRE_EQ("O(n)",
+                   atf::bench::complexity_name(fit.m_complexity));
+    ATF_REQUIRE(std::fabs(fit.m_coefficient - 3.0) < 0.1);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(fit_complexity__n_log_n);
+ATF_TEST_CASE_BODY(fit_complexity__n_log_n)
+{
+    const atf::bench::complexity_fit fit = atf::bench::fit_complexity(
+        make_points([](const double n) { return 2.0 * n * std::log2(n); }));
+    ATF_REQUIRE_EQ("O(n log n)",
+                   atf::bench::complexity_name(fit.m_complexity));
+    ATF_REQUIRE(std::fabs(fit.m_coefficient - 2.0) < 0.1);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(fit_complexity__squared);
+ATF_TEST_CASE_BODY(fit_complexity__squared)
+{
+    const atf::bench::complexity_fit fit = atf::bench::fit_complexity(
+        make_points([](const double n) { return 0.5 * n * n; }));
+    ATF_REQUIRE_EQ("O(n^2)",
+                   atf::bench::complexity_name(fit.m_complexity));
+    ATF_REQUIRE(std::fabs(fit.m_coefficient - 0.5) < 0.05);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(fit_complexity__small_sizes);
+ATF_TEST_CASE_BODY(fit_complexity__small_sizes)
+{
+    // n log n is 0 for n = 1, so it cannot explain these points.
+    atf::bench::complexity_points points;
+    points.push_back(std::make_pair(1L, 5.0));
+    points.push_back(std::make_pair(1L, 5.0));
+    const atf::bench::complexity_fit fit = atf::bench::fit_complexity(points);
+    ATF_REQUIRE_EQ("O(1)",
+                   atf::bench::complexity_name(fit.m_complexity));
+    ATF_REQUIRE_EQ(0.0, fit.m_rms);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(complexity_name);
+ATF_TEST_CASE_BODY(complexity_name)
+{
+    ATF_REQUIRE_EQ("O(1)", atf::bench::complexity_name(atf::bench::o_1));
+    ATF_REQUIRE_EQ("O(n)", atf::bench::complexity_name(atf::bench::o_n));
+    ATF_REQUIRE_EQ("O(n log n)",
+                   atf::bench::complexity_name(atf::bench::o_n_log_n));
+    ATF_REQUIRE_EQ("O(n^2)",
+                   atf::bench::complexity_name(atf::bench::o_n_squared));
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(parse_complexity);
+ATF_TEST_CASE_BODY(parse_complexity)
+{
+    atf::bench::complexity c = atf::bench::o_1;
+
+    ATF_REQUIRE(atf::bench::parse_complexity("O(n log n)", c));
+    ATF_REQUIRE_EQ("O(n log n)",
+                   atf::bench::complexity_name(c));
+    ATF_REQUIRE(atf::bench::parse_complexity("O(n^2)", c));
+    ATF_REQUIRE_EQ("O(n^2)",
+                   atf::bench::complexity_name(c));
+
+    ATF_REQUIRE(!atf::bench::parse_complexity("O(n^3)", c));
+    ATF_REQUIRE(!atf::bench::parse_complexity("n", c));
+    ATF_REQUIRE_EQ("O(n^2)",
+                   atf::bench::complexity_name(c));
+}
+
+// ------------------------------------------------------------------------
+// Test cases for the compiler barriers.
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE_WITHOUT_HEAD(barriers);
+ATF_TEST_CASE_BODY(barriers)
+{
+    int value = 42;
+    const std::string text = "some text";
+
+    atf::bench::do_not_optimize(value);
+    atf::bench::do_not_optimize(text);
+    atf::bench::do_not_optimize(value + 1);
+    atf::bench::clobber_memory();
+
+    ATF_REQUIRE_EQ(42, value);
+    ATF_REQUIRE_EQ("some text", text);
+}
+
+// ------------------------------------------------------------------------
+// Main.
+// ------------------------------------------------------------------------
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, fit_complexity__constant);
+    ATF_ADD_TEST_CASE(tcs, fit_complexity__linear);
+    ATF_ADD_TEST_CASE(tcs, fit_complexity__n_log_n);
+    ATF_ADD_TEST_CASE(tcs, fit_complexity__squared);
+    ATF_ADD_TEST_CASE(tcs, fit_complexity__small_sizes);
+    ATF_ADD_TEST_CASE(tcs, complexity_name);
+    ATF_ADD_TEST_CASE(tcs, parse_complexity);
+    ATF_ADD_TEST_CASE(tcs, barriers);
+}
@@ -26,18 +26,54 @@
 #if !defined(ATF_CXX_MACROS_HPP)
 #define ATF_CXX_MACROS_HPP
 
+extern "C" {
+#include <atf-c/tc.h>
+}
+
+#include <cerrno>
+#include <cstddef>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
 
+#include <atf-c++/bench.hpp>
 #include <atf-c++/tests.hpp>
 
 // Do not define inline methods for the test case classes.  Doing so
 // significantly increases the memory requirements of GNU G++ during
 // compilation.
 
+// Flags of the static meta-data record of a test case; see
+// ATF_ADD_TEST_CASE.
+#define ATFU_TC_MD_HEAD 1
+#define ATFU_TC_MD_CLEANUP 2
+#define ATFU_TC_MD_STATIC 4
+#define ATFU_TC_MD_LINE(line) ATFU_TC_MD_LINE2(line)
+#define ATFU_TC_MD_LINE2(line) #line
+
+// Defining ATF_CHECK_STATS before including this file enables the check
+// statistics regardless of the environment; see atf-c/macros.h.
+#if defined(ATF_CHECK_STATS)
+#   define ATFU_INIT_CHECK_STATS atf_tc_check_stats = true
+#else
+#   define ATFU_INIT_CHECK_STATS (void)0
+#endif
+
+// Declares the statistics of the check at the call site, which
+// ATFU_COUNT_CHECK updates if they are enabled.
+#define ATFU_CHECK_SITE \
+    static struct atf_tc_check_site atfu_site = \
+        { __FILE__, __LINE__, 0, 0, false, NULL }
+
+#define ATFU_COUNT_CHECK(passed) \
+    do { \
+        if (atf_tc_check_stats) \
+            atf_tc_count_check(&atfu_site, passed); \
+    } while (false)
+
 #define ATF_TEST_CASE_WITHOUT_HEAD(name) \
     namespace { \
+    enum { atfu_tc_md_ ## name = 0 }; \
     class atfu_tc_ ## name : public atf::tests::tc { \
         void body(void) const; \
     public: \
@@ -49,6 +85,7 @@
 
 #define ATF_TEST_CASE(name) \
     namespace { \
+    enum { atfu_tc_md_ ## name = ATFU_TC_MD_HEAD }; \
     class atfu_tc_ ## name : public atf::tests::tc { \
         void head(void); \
         void body(void) const; \
@@ -61,6 +98,7 @@
 
 #define ATF_TEST_CASE_WITH_CLEANUP(name) \
     namespace { \
+    enum { atfu_tc_md_ ## name = ATFU_TC_MD_HEAD | ATFU_TC_MD_CLEANUP }; \
     class atfu_tc_ ## name : public atf::tests::tc { \
         void head(void); \
         void body(void) const; \
@@ -72,6 +110,71 @@
     atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::tests::tc(#name, true) {} \
     }
 
+// A meta-data variable of the test cases defined by ATF_TEST_CASE_WITH_MD
+// and ATF_TEST_CASE_WITH_CLEANUP_MD; see atf-c/macros.h.
+#define ATF_MD(name, value) name "\0" value "\0"
+
+#define ATFU_TC_MD_VARS(name, md) \
+    static const struct { \
+        char m_tag[4]; \
+        char m_ident[sizeof(#name)]; \
+        char m_vars[sizeof(md)]; \
+    } atfu_md_vars_ ## name ATF_DEFS_ATTRIBUTE_TC_MD = { \
+        { 'a', 't', 'f', 'm' }, #name, md \
+    };
+
+// Like ATF_TEST_CASE and ATF_TEST_CASE_WITH_CLEANUP, but with a head that
+// only sets the md meta-data, a sequence of ATF_MD, so that the test case
+// can be listed without running the test program.
+#define ATF_TEST_CASE_WITH_MD(name, md) \
+    namespace { \
+    enum { atfu_tc_md_ ## name = ATFU_TC_MD_HEAD | ATFU_TC_MD_STATIC }; \
+    ATFU_TC_MD_VARS(name, md) \
+    class atfu_tc_ ## name : public atf::tests::tc { \
+        void head(void); \
+        void body(void) const; \
+    public: \
+        atfu_tc_ ## name(void); \
+    }; \
+    static atfu_tc_ ## name* atfu_tcptr_ ## name; \
+    atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::tests::tc(#name, false) {} \
+    void atfu_tc_ ## name::head(void) \
+        { set_md_vars(atfu_md_vars_ ## name.m_vars); } \
+    }
+
+#define ATF_TEST_CASE_WITH_CLEANUP_MD(name, md) \
+    namespace { \
+    enum { atfu_tc_md_ ## name = ATFU_TC_MD_HEAD | ATFU_TC_MD_CLEANUP | \
+                                 ATFU_TC_MD_STATIC }; \
+    ATFU_TC_MD_VARS(name, md) \
+    class atfu_tc_ ## name : public atf::tests::tc { \
+        void head(void); \
+        void body(void) const; \
+        void cleanup(void) const; \
+    public: \
+        atfu_tc_ ## name(void); \
+    }; \
+    static atfu_tc_ ## name* atfu_tcptr_ ## name; \
+    atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::tests::tc(#name, true) {} \
+    void atfu_tc_ ## name::head(void) \
+        { set_md_vars(atfu_md_vars_ ## name.m_vars); } \
+    }
+
+// Like ATF_TEST_CASE, but for benchmarks: the body measures the code that
+// runs while atf::bench::state::keep_running returns true.
+#define ATF_BENCHMARK_CASE(name) \
+    namespace { \
+    enum { atfu_tc_md_ ## name = ATFU_TC_MD_HEAD }; \
+    class atfu_tc_ ## name : public atf::bench::tc { \
+        void bench_head(void); \
+        void bench_body(atf::bench::state&) const; \
+    public: \
+        atfu_tc_ ## name(void); \
+    }; \
+    static atfu_tc_ ## name* atfu_tcptr_ ## name; \
+    atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::bench::tc(#name) {} \
+    }
+
 #define ATF_TEST_CASE_NAME(name) atfu_tc_ ## name
 #define ATF_TEST_CASE_USE(name) (atfu_tcptr_ ## name) = NULL
 
@@ -84,6 +187,15 @@
     atfu_tc_ ## name::body(void) \
         const
 
+#define ATF_BENCHMARK_CASE_HEAD(name) \
+    void \
+    atfu_tc_ ## name::bench_head(void)
+
+#define ATF_BENCHMARK_CASE_BODY(name, state) \
+    void \
+    atfu_tc_ ## name::bench_body(atf::bench::state& state) \
+        const
+
 #define ATF_TEST_CASE_CLEANUP(name) \
     void \
     atfu_tc_ ## name::cleanup(void) \
@@ -97,7 +209,10 @@
 
 #define ATF_REQUIRE(expression) \
     do { \
-        if (!(expression)) { \
+        ATFU_CHECK_SITE; \
+        const bool atfu_passed = (expression) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_passed); \
+        if (!atfu_passed) { \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ << ": " << #expression \
                     << " not met"; \
@@ -107,7 +222,10 @@
 
 #define ATF_REQUIRE_EQ(expected, actual) \
     do { \
-        if ((expected) != (actual)) { \
+        ATFU_CHECK_SITE; \
+        const bool atfu_passed = ((expected) != (actual)) ? false : true; \
+        ATFU_COUNT_CHECK(atfu_passed); \
+        if (!atfu_passed) { \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ << ": " \
                     << #expected << " != " << #actual \
@@ -124,7 +242,10 @@
 
 #define ATF_REQUIRE_MATCH(regexp, string) \
     do { \
-        if (!atf::tests::detail::match(regexp, string)) { \
+        ATFU_CHECK_SITE; \
+        const bool atfu_passed = atf::tests::detail::match(regexp, string); \
+        ATFU_COUNT_CHECK(atfu_passed); \
+        if (!atfu_passed) { \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ << ": '" << string << "' does not " \
                     << "match regexp '" << regexp << "'"; \
@@ -134,21 +255,26 @@
 
 #define ATF_REQUIRE_THROW(expected_exception, statement) \
     do { \
+        ATFU_CHECK_SITE; \
         try { \
             statement; \
+            ATFU_COUNT_CHECK(false); \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ \
                     << ": " #statement " did not throw " #expected_exception \
                        " as expected"; \
             atf::tests::tc::fail(atfu_ss.str()); \
         } catch (const expected_exception&) { \
+            ATFU_COUNT_CHECK(true); \
         } catch (const std::exception& atfu_e) { \
+            ATFU_COUNT_CHECK(false); \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ << ": " #statement " threw an " \
                        "unexpected error (not " #expected_exception "): " \
                     << atfu_e.what(); \
             atf::tests::tc::fail(atfu_ss.str()); \
         } catch (...) { \
+            ATFU_COUNT_CHECK(false); \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ << ": " #statement " threw an " \
                        "unexpected error (not " #expected_exception ")"; \
@@ -158,15 +284,20 @@
 
 #define ATF_REQUIRE_THROW_RE(expected_exception, regexp, statement) \
     do { \
+        ATFU_CHECK_SITE; \
         try { \
             statement; \
+            ATFU_COUNT_CHECK(false); \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ \
                     << ": " #statement " did not throw " #expected_exception \
                        " as expected"; \
             atf::tests::tc::fail(atfu_ss.str()); \
         } catch (const expected_exception& e) { \
-            if (!atf::tests::detail::match(regexp, e.what())) { \
+            const bool atfu_passed = \
+                atf::tests::detail::match(regexp, e.what()); \
+            ATFU_COUNT_CHECK(atfu_passed); \
+            if (!atfu_passed) { \
                 std::ostringstream atfu_ss; \
                 atfu_ss << "Line " << __LINE__ \
                         << ": " #statement " threw " #expected_exception "(" \
@@ -175,12 +306,14 @@
                 atf::tests::tc::fail(atfu_ss.str()); \
             } \
         } catch (const std::exception& atfu_e) { \
+            ATFU_COUNT_CHECK(false); \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ << ": " #statement " threw an " \
                         "unexpected error (not " #expected_exception "): " \
                     << atfu_e.what(); \
             atf::tests::tc::fail(atfu_ss.str()); \
         } catch (...) { \
+            ATFU_COUNT_CHECK(false); \
             std::ostringstream atfu_ss; \
             atfu_ss << "Line " << __LINE__ << ": " #statement " threw an " \
                         "unexpected error (not " #expected_exception ")"; \
@@ -189,12 +322,49 @@
     } while (false)
 
 #define ATF_CHECK_ERRNO(expected_errno, bool_expr) \
-    atf::tests::tc::check_errno(__FILE__, __LINE__, expected_errno, \
-                                #bool_expr, bool_expr)
+    do { \
+        ATFU_CHECK_SITE; \
+        const bool atfu_result = (bool_expr) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_result && errno == (expected_errno)); \
+        atf::tests::tc::check_errno(__FILE__, __LINE__, expected_errno, \
+                                    #bool_expr, atfu_result); \
+    } while (false)
 
 #define ATF_REQUIRE_ERRNO(expected_errno, bool_expr) \
-    atf::tests::tc::require_errno(__FILE__, __LINE__, expected_errno, \
-                                  #bool_expr, bool_expr)
+    do { \
+        ATFU_CHECK_SITE; \
+        const bool atfu_result = (bool_expr) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_result && errno == (expected_errno)); \
+        atf::tests::tc::require_errno(__FILE__, __LINE__, expected_errno, \
+                                      #bool_expr, atfu_result); \
+    } while (false)
+
+// Runs the statement and fails if it takes more wall or CPU time than the
+// budget, in milliseconds, scaled by the perf_scale configuration variable;
+// see atf-c/macros.h.
+#define ATFU_WITHIN(fail_func, cpu, budget_ms, ...) \
+    do { \
+        ATFU_CHECK_SITE; \
+        const double atfu_budget = atf_tc_within_budget(budget_ms); \
+        const double atfu_start = atf_tc_within_clock(cpu); \
+        { __VA_ARGS__; } \
+        const double atfu_elapsed = atf_tc_within_clock(cpu) - atfu_start; \
+        ATFU_COUNT_CHECK(atfu_elapsed <= atfu_budget); \
+        fail_func(__FILE__, __LINE__, cpu, #__VA_ARGS__, atfu_elapsed, \
+                  atfu_budget); \
+    } while (false)
+
+#define ATF_CHECK_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_check_within, false, budget_ms, __VA_ARGS__)
+
+#define ATF_REQUIRE_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_require_within, false, budget_ms, __VA_ARGS__)
+
+#define ATF_CHECK_CPU_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_check_within, true, budget_ms, __VA_ARGS__)
+
+#define ATF_REQUIRE_CPU_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_require_within, true, budget_ms, __VA_ARGS__)
 
 #define ATF_INIT_TEST_CASES(tcs) \
     namespace atf { \
@@ -209,6 +379,7 @@
     int \
     main(int argc, char** argv) \
     { \
+        ATFU_INIT_CHECK_STATS; \
         return atf::tests::run_tp(argc, argv, atfu_init_tcs); \
     } \
     \
@@ -216,8 +387,19 @@
     void \
     atfu_init_tcs(std::vector< atf::tests::tc * >& tcs)
 
+// Besides registering the test case, leaves a record describing it in the
+// atf_tc_md section of the binary; see ATF_TP_ADD_TC in atf-c/macros.h.
 #define ATF_ADD_TEST_CASE(tcs, tcname) \
     do { \
+        static const struct { \
+            char m_tag[4]; \
+            char m_flags; \
+            char m_line[sizeof(ATFU_TC_MD_LINE(__LINE__))]; \
+            char m_ident[sizeof(#tcname)]; \
+        } atfu_md ATF_DEFS_ATTRIBUTE_TC_MD = { \
+            { 'a', 't', 'f', '1' }, '0' + atfu_tc_md_ ## tcname, \
+            ATFU_TC_MD_LINE(__LINE__), #tcname \
+        }; \
         atfu_tcptr_ ## tcname = new atfu_tc_ ## tcname(); \
         (tcs).push_back(atfu_tcptr_ ## tcname); \
     } while (0);
@@ -93,6 +93,26 @@ atf_require_errno_semicolons(void)
     ATF_REQUIRE_ERRNO(2, 2 == 2);
 }
 
+void
+atf_within_inside_if(void)
+{
+    // Make sure that the bounded-time macros can be used inside an if
+    // statement that does not have braces and take statements with
+    // commas.
+    int a, b;
+
+    if (true)
+        ATF_CHECK_WITHIN(1, a = 1, b = 2);
+    else
+        ATF_REQUIRE_WITHIN(1, a = 1, b = 2);
+    if (true)
+        ATF_CHECK_CPU_WITHIN(1, a = 3, b = 4);
+    else
+        ATF_REQUIRE_CPU_WITHIN(1, a = 3, b = 4);
+    (void)a;
+    (void)b;
+}
+
 // Test case names should not be expanded during instatiation so that they
 // can have the exact same name as macros.
 #define TEST_MACRO_1 invalid + name
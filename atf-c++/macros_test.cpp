@@ -32,6 +32,7 @@ extern "C" {
 
 #include <cerrno>
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <stdexcept>
 
@@ -277,6 +278,75 @@ ATF_TEST_CASE_BODY(h_require_errno)
     create_ctl_file("after");
 }
 
+static void
+sleep_ms(const long ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000;
+    while (::nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        continue;
+}
+
+static void
+spin_ms(const long ms)
+{
+    struct timespec start, now;
+
+    ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    do {
+        ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000 +
+             (now.tv_nsec - start.tv_nsec) / 1000000 < ms);
+}
+
+ATF_TEST_CASE(h_check_within);
+ATF_TEST_CASE_HEAD(h_check_within)
+{
+    set_md_var("descr", "Helper test case");
+}
+ATF_TEST_CASE_BODY(h_check_within)
+{
+    create_ctl_file("before");
+
+    if (get_config_var("what") == "ok")
+        ATF_CHECK_WITHIN(10000, sleep_ms(1));
+    else if (get_config_var("what") == "fail")
+        ATF_CHECK_WITHIN(1, sleep_ms(50));
+    else if (get_config_var("what") == "cpu_sleep")
+        ATF_CHECK_CPU_WITHIN(20, sleep_ms(50));
+    else if (get_config_var("what") == "cpu_fail")
+        ATF_CHECK_CPU_WITHIN(1, spin_ms(50));
+    else
+        UNREACHABLE;
+
+    create_ctl_file("after");
+}
+
+ATF_TEST_CASE(h_require_within);
+ATF_TEST_CASE_HEAD(h_require_within)
+{
+    set_md_var("descr", "Helper test case");
+}
+ATF_TEST_CASE_BODY(h_require_within)
+{
+    create_ctl_file("before");
+
+    if (get_config_var("what") == "ok")
+        ATF_REQUIRE_WITHIN(10000, sleep_ms(1));
+    else if (get_config_var("what") == "fail")
+        ATF_REQUIRE_WITHIN(20, sleep_ms(50));
+    else if (get_config_var("what") == "cpu_ok")
+        ATF_REQUIRE_CPU_WITHIN(10000, spin_ms(1));
+    else if (get_config_var("what") == "cpu_fail")
+        ATF_REQUIRE_CPU_WITHIN(1, spin_ms(50));
+    else
+        UNREACHABLE;
+
+    create_ctl_file("after");
+}
+
 // ------------------------------------------------------------------------
 // Test cases for the macros.
 // ------------------------------------------------------------------------
@@ -751,6 +821,159 @@ ATF_TEST_CASE_BODY(require_errno)
     }
 }
 
+ATF_TEST_CASE(check_within);
+ATF_TEST_CASE_HEAD(check_within)
+{
+    set_md_var("descr", "Tests the ATF_CHECK_WITHIN and ATF_CHECK_CPU_WITHIN "
+               "macros");
+}
+ATF_TEST_CASE_BODY(check_within)
+{
+    struct test {
+        const char *what;
+        bool ok;
+        const char *msg;
+    } *t, tests[] = {
+        { "ok", true, NULL },
+        { "fail", false,
+          "sleep_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of wall time, more "
+          "than the 1\\.000 ms allowed" },
+        { "cpu_sleep", true, NULL },
+        { "cpu_fail", false,
+          "spin_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of CPU time, more "
+          "than the 1\\.000 ms allowed" },
+        { NULL, false, NULL }
+    };
+
+    const atf::fs::path before("before");
+    const atf::fs::path after("after");
+
+    for (t = &tests[0]; t->what != NULL; t++) {
+        atf::tests::vars_map config;
+        config["what"] = t->what;
+
+        ATF_TEST_CASE_USE(h_check_within);
+        run_h_tc< ATF_TEST_CASE_NAME(h_check_within) >(config);
+
+        ATF_REQUIRE(atf::fs::exists(before));
+        ATF_REQUIRE(atf::fs::exists(after));
+
+        if (t->ok) {
+            ATF_REQUIRE(atf::utils::grep_file("^passed", "result"));
+        } else {
+            ATF_REQUIRE(atf::utils::grep_file("^failed", "result"));
+
+            std::string exp_result = "macros_test.cpp:[0-9]+: " +
+                std::string(t->msg) + "$";
+            ATF_REQUIRE(atf::utils::grep_file(exp_result.c_str(), "stderr"));
+        }
+
+        atf::fs::remove(before);
+        atf::fs::remove(after);
+    }
+}
+
+ATF_TEST_CASE(require_within);
+ATF_TEST_CASE_HEAD(require_within)
+{
+    set_md_var("descr", "Tests the ATF_REQUIRE_WITHIN and "
+               "ATF_REQUIRE_CPU_WITHIN macros");
+}
+ATF_TEST_CASE_BODY(require_within)
+{
+    struct test {
+        const char *what;
+        const char *perf_scale;
+        bool ok;
+        const char *msg;
+    } *t, tests[] = {
+        { "ok", NULL, true, NULL },
+        { "fail", NULL, false,
+          "sleep_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of wall time, more "
+          "than the 20\\.000 ms allowed" },
+        { "fail", "10", true, NULL },
+        { "cpu_ok", NULL, true, NULL },
+        { "cpu_fail", NULL, false,
+          "spin_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of CPU time, more "
+          "than the 1\\.000 ms allowed" },
+        { NULL, NULL, false, NULL }
+    };
+
+    const atf::fs::path before("before");
+    const atf::fs::path after("after");
+
+    for (t = &tests[0]; t->what != NULL; t++) {
+        atf::tests::vars_map config;
+        config["what"] = t->what;
+        if (t->perf_scale != NULL)
+            config["perf_scale"] = t->perf_scale;
+
+        ATF_TEST_CASE_USE(h_require_within);
+        run_h_tc< ATF_TEST_CASE_NAME(h_require_within) >(config);
+
+        ATF_REQUIRE(atf::fs::exists(before));
+        if (t->ok) {
+            ATF_REQUIRE(atf::utils::grep_file("^passed", "result"));
+            ATF_REQUIRE(atf::fs::exists(after));
+        } else {
+            std::string exp_result = "^failed: .*macros_test.cpp:[0-9]+: " +
+                std::string(t->msg) + "$";
+            ATF_REQUIRE(atf::utils::grep_file(exp_result.c_str(), "result"));
+
+            ATF_REQUIRE(!atf::fs::exists(after));
+        }
+
+        atf::fs::remove(before);
+        if (t->ok)
+            atf::fs::remove(after);
+    }
+}
+
+ATF_TEST_CASE_WITH_MD(h_with_md,
+    ATF_MD("descr", "Helper test case with static meta-data")
+    ATF_MD("timeout", ""));
+ATF_TEST_CASE_BODY(h_with_md)
+{
+}
+
+ATF_TEST_CASE_WITH_CLEANUP_MD(h_with_cleanup_md,
+    ATF_MD("require.user", "root"));
+ATF_TEST_CASE_BODY(h_with_cleanup_md)
+{
+}
+ATF_TEST_CASE_CLEANUP(h_with_cleanup_md)
+{
+}
+
+ATF_TEST_CASE(with_md);
+ATF_TEST_CASE_HEAD(with_md)
+{
+    set_md_var("descr", "Tests that the heads defined by "
+               "ATF_TEST_CASE_WITH_MD and ATF_TEST_CASE_WITH_CLEANUP_MD set "
+               "the variables given with ATF_MD");
+}
+ATF_TEST_CASE_BODY(with_md)
+{
+    {
+        ATF_TEST_CASE_USE(h_with_md);
+        ATF_TEST_CASE_NAME(h_with_md) h;
+        h.init(atf::tests::vars_map());
+        ATF_REQUIRE_EQ("Helper test case with static meta-data",
+                       h.get_md_var("descr"));
+        ATF_REQUIRE_EQ("", h.get_md_var("timeout"));
+        ATF_REQUIRE(!h.has_md_var("has.cleanup"));
+    }
+
+    {
+        ATF_TEST_CASE_USE(h_with_cleanup_md);
+        ATF_TEST_CASE_NAME(h_with_cleanup_md) h;
+        h.init(atf::tests::vars_map());
+        ATF_REQUIRE_EQ("root", h.get_md_var("require.user"));
+        ATF_REQUIRE(!h.has_md_var("descr"));
+        ATF_REQUIRE_EQ("true", h.get_md_var("has.cleanup"));
+    }
+}
+
 // ------------------------------------------------------------------------
 // Tests cases for the header file.
 // ------------------------------------------------------------------------
@@ -796,6 +1019,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, fail);
     ATF_ADD_TEST_CASE(tcs, skip);
     ATF_ADD_TEST_CASE(tcs, check_errno);
+    ATF_ADD_TEST_CASE(tcs, check_within);
     ATF_ADD_TEST_CASE(tcs, require);
     ATF_ADD_TEST_CASE(tcs, require_eq);
     ATF_ADD_TEST_CASE(tcs, require_in);
@@ -804,6 +1028,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, require_throw);
     ATF_ADD_TEST_CASE(tcs, require_throw_re);
     ATF_ADD_TEST_CASE(tcs, require_errno);
+    ATF_ADD_TEST_CASE(tcs, require_within);
+    ATF_ADD_TEST_CASE(tcs, with_md);
 
     // Add the test cases for the header file.
     ATF_ADD_TEST_CASE(tcs, use);
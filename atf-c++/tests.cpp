@@ -49,9 +49,20 @@ extern "C" {
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 extern "C" {
+#include "atf-c/detail/bench.h"
+#include "atf-c/detail/durations.h"
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/listing_cache.h"
+#include "atf-c/detail/result_cache.h"
+#include "atf-c/detail/runner.h"
+#include "atf-c/detail/selection.h"
+#include "atf-c/detail/tc.h"
+#include "atf-c/detail/trace.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
 #include "atf-c/utils.h"
@@ -123,6 +134,7 @@ set_program_name(const char* argv0)
 {
     const std::string program_name = atf::fs::path(argv0).leaf_name();
     Program_Name = program_name;
+    atf_bench_set_program(argv0);
 }
 
 bool
@@ -180,6 +192,12 @@ public:
         INV(iter != cwraps.end());
         (*iter).second->cleanup();
     }
+
+    static const atf_tc_t*
+    c_tc(const impl::tc* tc)
+    {
+        return &tc->pimpl->m_tc;
+    }
 };
 
 impl::tc::tc(const std::string& ident, const bool has_cleanup) :
@@ -283,6 +301,19 @@ impl::tc::set_md_var(const std::string& var, const std::string& val)
         throw_atf_error(err);
 }
 
+void
+impl::tc::set_md_vars(const char* vars)
+{
+    while (*vars != '\0') {
+        const char* value = vars + std::strlen(vars) + 1;
+
+        atf_error_t err = atf_tc_set_md_var(&pimpl->m_tc, vars, "%s", value);
+        if (atf_is_error(err))
+            throw_atf_error(err);
+        vars = value + std::strlen(value) + 1;
+    }
+}
+
 void
 impl::tc::run(const std::string& resfile)
     const
@@ -319,6 +350,13 @@ impl::tc::require_prog(const std::string& prog)
     atf_tc_require_prog(prog.c_str());
 }
 
+const atf_tc_t*
+impl::tc::get_c_tc(void)
+    const
+{
+    return tc_impl::c_tc(this);
+}
+
 void
 impl::tc::pass(void)
 {
@@ -401,7 +439,38 @@ namespace {
 
 typedef std::vector< impl::tc * > tc_vector;
 
-enum tc_part { BODY, CLEANUP };
+enum tc_part { BODY, CLEANUP, ALL };
+
+// Owns the test case selection given by the -e, -g and -k options.
+class selection {
+    atf_selection_t m_selection;
+
+public:
+    selection(void) { atf_selection_init(&m_selection); }
+    ~selection(void) { atf_selection_fini(&m_selection); }
+
+    selection(const selection&) = delete;
+    selection& operator=(const selection&) = delete;
+
+    atf_selection_t* get(void) { return &m_selection; }
+    const atf_selection_t* get(void) const { return &m_selection; }
+
+    bool
+    empty(void)
+        const
+    {
+        return atf_selection_is_empty(&m_selection);
+    }
+
+    bool
+    matches(const impl::tc* tc)
+        const
+    {
+        // Do not query the meta-data: doing so would run the head.
+        return atf_selection_matches(
+            &m_selection, atf_tc_get_ident(impl::tc_impl::c_tc(tc)));
+    }
+};
 
 static void
 parse_vflag(const std::string& str, atf::tests::vars_map& vars)
@@ -421,6 +490,22 @@ parse_vflag(const std::string& str, atf::tests::vars_map& vars)
     }
 }
 
+static std::size_t
+parse_jflag(const std::string& str)
+{
+    long value;
+    try {
+        value = atf::text::to_type< long >(str);
+    } catch (const std::runtime_error&) {
+        throw usage_error("Invalid number of parallel jobs `%s'",
+                          str.c_str());
+    }
+    if (value < 1)
+        throw usage_error("Invalid number of parallel jobs `%s'",
+                          str.c_str());
+    return static_cast< std::size_t >(value);
+}
+
 static atf::fs::path
 handle_srcdir(const char* argv0, const std::string& srcdir_arg)
 {
@@ -453,13 +538,16 @@ init_tcs(void (*add_tcs)(tc_vector&), tc_vector& tcs,
     }
 }
 
-static int
-list_tcs(const tc_vector& tcs)
+static void
+format_tcs(const tc_vector& tcs, const selection& sel, std::ostream& os)
 {
-    detail::atf_tp_writer writer(std::cout);
+    detail::atf_tp_writer writer(os);
 
     for (tc_vector::const_iterator iter = tcs.begin();
          iter != tcs.end(); iter++) {
+        if (!sel.matches(*iter))
+            continue;
+
         const impl::vars_map vars = (*iter)->get_md_vars();
 
         {
@@ -477,30 +565,104 @@ list_tcs(const tc_vector& tcs)
 
         writer.end_tc();
     }
+}
 
-    return EXIT_SUCCESS;
+static void
+print_store_warning(const char* store, atf_error_t err)
+{
+    char buf[4096];
+
+    atf_error_format(err, buf, sizeof(buf));
+    atf_error_free(err);
+    std::cerr << Program_Name << ": WARNING: Cannot use the " << store
+              << ": " << buf << "\n";
 }
 
-static impl::tc*
-find_tc(tc_vector tcs, const std::string& name)
+// Prints the listing of the test cases, straight from the listing cache if
+// it is enabled and up to date, in which case the test cases are not even
+// created.
+static int
+list_tcs(const char* argv0, void (*add_tcs)(tc_vector&), tc_vector& tcs,
+         const atf::tests::vars_map& vars, const selection& sel)
 {
-    std::vector< std::string > ids;
-    for (tc_vector::iterator iter = tcs.begin();
-         iter != tcs.end(); iter++) {
-        impl::tc* tc = *iter;
+    atf_listing_cache_t cache;
+    atf_error_t err = atf_listing_cache_init(&cache, argv0);
+    if (atf_is_error(err))
+        print_store_warning("listing cache", err);
+
+    try {
+        for (const auto& var : vars)
+            atf_listing_cache_add_var(&cache, var.first.c_str(),
+                                      var.second.c_str());
+        // Keep the listings of different subsets of the test cases apart.
+        if (sel.get()->m_glob != NULL)
+            atf_listing_cache_add_var(&cache, "-g", sel.get()->m_glob);
+        if (sel.get()->m_has_regex)
+            atf_listing_cache_add_var(&cache, "-e", sel.get()->m_regex_str);
+        if (sel.get()->m_nshards > 0)
+            atf_listing_cache_add_var(&cache, "-k", sel.get()->m_shard_str);
+
+        atf_dynstr_t cached;
+        bool found;
+        err = atf_listing_cache_get(&cache, &cached, &found);
+        if (atf_is_error(err))
+            atf::throw_atf_error(err);
+
+        if (found) {
+            std::cout << atf_dynstr_cstring(&cached);
+            atf_dynstr_fini(&cached);
+        } else {
+            init_tcs(add_tcs, tcs, vars);
+
+            std::ostringstream listing;
+            format_tcs(tcs, sel, listing);
+
+            err = atf_listing_cache_put(&cache, listing.str().c_str());
+            if (atf_is_error(err))
+                print_store_warning("listing cache", err);
+
+            std::cout << listing.str();
+        }
+    } catch (...) {
+        atf_listing_cache_fini(&cache);
+        throw;
+    }
+    atf_listing_cache_fini(&cache);
 
-        if (tc->get_md_var("ident") == name)
-            return tc;
+    return EXIT_SUCCESS;
+}
+
+// Maps test case identifiers to their test cases.  The keys point to the
+// identifiers owned by the test cases themselves.
+typedef std::unordered_map< std::string_view, impl::tc* > tc_index;
+
+static tc_index
+index_tcs(const tc_vector& tcs)
+{
+    tc_index index;
+    index.reserve(tcs.size());
+    for (const auto& tc : tcs) {
+        // Do not query the meta-data: doing so would run the head.
+        index.emplace(atf_tc_get_ident(impl::tc_impl::c_tc(tc)), tc);
     }
-    throw usage_error("Unknown test case `%s'", name.c_str());
+    return index;
+}
+
+static impl::tc*
+find_tc(const tc_index& index, const std::string& name)
+{
+    const tc_index::const_iterator iter = index.find(name);
+    if (iter == index.end())
+        throw usage_error("Unknown test case `%s'", name.c_str());
+    return (*iter).second;
 }
 
 static std::pair< std::string, tc_part >
-process_tcarg(const std::string& tcarg)
+process_tcarg(const std::string& tcarg, const tc_part bare)
 {
     const std::string::size_type pos = tcarg.find(':');
     if (pos == std::string::npos) {
-        return std::make_pair(tcarg, BODY);
+        return std::make_pair(tcarg, bare);
     } else {
         const std::string tcname = tcarg.substr(0, pos);
 
@@ -509,28 +671,180 @@ process_tcarg(const std::string& tcarg)
             return std::make_pair(tcname, BODY);
         else if (partname == "cleanup")
             return std::make_pair(tcname, CLEANUP);
+        else if (partname == "all")
+            return std::make_pair(tcname, ALL);
         else {
             throw usage_error("Invalid test case part `%s'", partname.c_str());
         }
     }
 }
 
-static int
-run_tc(tc_vector& tcs, const std::string& tcarg, const atf::fs::path& resfile)
+static void
+print_runtime_warnings(void)
 {
-    const std::pair< std::string, tc_part > fields = process_tcarg(tcarg);
-
-    impl::tc* tc = find_tc(tcs, fields.first);
-
     if (!atf::env::has("__RUNNING_INSIDE_ATF_RUN") || atf::env::get(
         "__RUNNING_INSIDE_ATF_RUN") != "internal-yes-value")
     {
         std::cerr << Program_Name << ": WARNING: Running test cases outside "
             "of kyua(1) is unsupported\n";
-        std::cerr << Program_Name << ": WARNING: No isolation nor timeout "
-            "control is being applied; you may get unexpected failures; see "
-            "atf-test-case(4)\n";
+        std::cerr << Program_Name << ": WARNING: No isolation is being "
+            "applied; you may get unexpected failures; see atf-test-case(4)\n";
     }
+}
+
+static atf_runner_job_t
+make_job(const impl::tc* tc, const tc_part part)
+{
+    atf_runner_job_t job;
+
+    job.m_tc = impl::tc_impl::c_tc(tc);
+    switch (part) {
+    case BODY:
+        job.m_part = atf_runner_part_body;
+        break;
+    case CLEANUP:
+        job.m_part = atf_runner_part_cleanup;
+        break;
+    default:
+        UNREACHABLE;
+    }
+    return job;
+}
+
+// The 'all' part expands to the body followed by the cleanup routine, if
+// the test case has one.
+static void
+add_jobs(std::vector< atf_runner_job_t >& jobs, const impl::tc* tc,
+         const tc_part part)
+{
+    if (part == ALL) {
+        jobs.push_back(make_job(tc, BODY));
+        if (atf_tc_has_cleanup(impl::tc_impl::c_tc(tc)))
+            jobs.push_back(make_job(tc, CLEANUP));
+    } else
+        jobs.push_back(make_job(tc, part));
+}
+
+static int
+run_tcs(const char* argv0, const tc_vector& tcs, const tc_index& index,
+        const std::vector< std::string >& tcargs, const selection& sel,
+        const atf::fs::path& resdir, const std::size_t maxworkers)
+{
+    std::vector< atf_runner_job_t > jobs;
+
+    // Test cases given without a part, or all of them if none is given,
+    // run in full.
+    if (tcargs.empty()) {
+        for (const auto& tc : tcs)
+            if (sel.matches(tc))
+                add_jobs(jobs, tc, ALL);
+    } else {
+        for (const auto& tcarg : tcargs) {
+            const std::pair< std::string, tc_part > fields =
+                process_tcarg(tcarg, ALL);
+            const impl::tc* tc = find_tc(index, fields.first);
+            if (sel.matches(tc))
+                add_jobs(jobs, tc, fields.second);
+        }
+    }
+
+    print_runtime_warnings();
+
+    atf_durations_t durations;
+    atf_error_t err = atf_durations_init(&durations, argv0);
+    if (atf_is_error(err))
+        print_store_warning("duration history", err);
+
+    bool success;
+    err = atf_runner_run_batch(jobs.data(), jobs.size(), resdir.c_str(),
+                               maxworkers, &durations, &success);
+    atf_durations_fini(&durations);
+    if (atf_is_error(err))
+        atf::throw_atf_error(err);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+extern "C" {
+static const atf_tc_t*
+lookup_tc(const char* tcname, const void* data)
+{
+    const tc_index* index = static_cast< const tc_index* >(data);
+
+    const tc_index::const_iterator iter = index->find(tcname);
+    return iter == index->end() ? NULL : impl::tc_impl::c_tc((*iter).second);
+}
+}
+
+static int
+serve(const tc_index& index, const std::string& source)
+{
+    print_runtime_warnings();
+
+    atf_error_t err = atf_runner_serve(source.c_str(), lookup_tc, &index);
+    if (atf_is_error(err))
+        atf::throw_atf_error(err);
+    return EXIT_SUCCESS;
+}
+
+static int
+run_all(const impl::tc* tc, const atf::fs::path& resfile)
+{
+    int exitcode;
+    atf_error_t err = atf_runner_run_all(impl::tc_impl::c_tc(tc),
+                                         resfile.c_str(), &exitcode);
+    if (atf_is_error(err))
+        atf::throw_atf_error(err);
+    return exitcode;
+}
+
+// Executes the body of a test case, with its cleanup routine if requested,
+// unless the result cache knows its result already.  Returns false, without
+// running anything, if the cache is not enabled.
+static bool
+run_tc_cached(const char* argv0, const impl::tc* tc, const tc_part part,
+              const atf::fs::path& resfile,
+              const atf::tests::vars_map& vars, int& exitcode)
+{
+    if (part == CLEANUP)
+        return false;
+
+    atf_result_cache_t cache;
+    atf_error_t err = atf_result_cache_init(&cache, argv0);
+    if (atf_is_error(err)) {
+        print_store_warning("result cache", err);
+        return false;
+    }
+    if (!cache.m_enabled) {
+        atf_result_cache_fini(&cache);
+        return false;
+    }
+
+    for (const auto& var : vars)
+        atf_result_cache_add_var(&cache, var.first.c_str(),
+                                 var.second.c_str());
+
+    err = atf_runner_run_cached(&cache, impl::tc_impl::c_tc(tc), part == ALL,
+                                resfile.c_str(), &exitcode);
+    atf_result_cache_fini(&cache);
+    if (atf_is_error(err))
+        atf::throw_atf_error(err);
+    return true;
+}
+
+static int
+run_tc(const char* argv0, const tc_index& index, const std::string& tcarg,
+       const atf::fs::path& resfile, const atf::tests::vars_map& vars)
+{
+    const std::pair< std::string, tc_part > fields =
+        process_tcarg(tcarg, BODY);
+
+    impl::tc* tc = find_tc(index, fields.first);
+
+    print_runtime_warnings();
+
+    int exitcode;
+    if (run_tc_cached(argv0, tc, fields.second, resfile, vars, exitcode))
+        return exitcode;
 
     switch (fields.second) {
     case BODY:
@@ -539,6 +853,8 @@ run_tc(tc_vector& tcs, const std::string& tcarg, const atf::fs::path& resfile)
     case CLEANUP:
         tc->run_cleanup();
         break;
+    case ALL:
+        return run_all(tc, resfile);
     default:
         UNREACHABLE;
     }
@@ -550,24 +866,62 @@ safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
 {
     const char* argv0 = argv[0];
 
+    bool aflag = false;
+    std::size_t maxworkers = 0;
     bool lflag = false;
+    bool rflag = false;
     atf::fs::path resfile("/dev/stdout");
+    std::string server_arg;
     std::string srcdir_arg;
     atf::tests::vars_map vars;
+    selection sel;
 
     int ch;
     int old_opterr;
 
+    // Ends before the test cases are listed or run; left open on errors, as
+    // the process is about to exit anyway.
+    atf_trace_begin("startup", NULL);
+
     old_opterr = opterr;
     ::opterr = 0;
-    while ((ch = ::getopt(argc, argv, GETOPT_POSIX ":lr:s:v:")) != -1) {
+    while ((ch = ::getopt(argc, argv, GETOPT_POSIX ":ae:g:j:k:lr:S:s:v:")) != -1) {
         switch (ch) {
+        case 'a':
+            aflag = true;
+            break;
+
+        case 'e':
+            if (!atf_selection_set_regex(sel.get(), ::optarg))
+                throw usage_error("Invalid regular expression `%s'",
+                                  ::optarg);
+            break;
+
+        case 'g':
+            atf_selection_set_glob(sel.get(), ::optarg);
+            break;
+
+        case 'j':
+            maxworkers = parse_jflag(::optarg);
+            break;
+
+        case 'k':
+            if (!atf_selection_set_shard(sel.get(), ::optarg))
+                throw usage_error("Invalid shard `%s'; must be k/n with "
+                                  "1 <= k <= n", ::optarg);
+            break;
+
         case 'l':
             lflag = true;
             break;
 
         case 'r':
             resfile = atf::fs::path(::optarg);
+            rflag = true;
+            break;
+
+        case 'S':
+            server_arg = ::optarg;
             break;
 
         case 's':
@@ -597,24 +951,64 @@ safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
     ::optreset = 1;
 #endif
 
+    atf_trace_begin("handle_srcdir", NULL);
     vars["srcdir"] = handle_srcdir(argv0, srcdir_arg).str();
+    atf_trace_end();
 
     int errcode;
 
-    if (lflag) {
+    if (!server_arg.empty()) {
+        if (argc > 0)
+            throw usage_error("Cannot provide test case names with -S");
+        else if (aflag || maxworkers > 0 || lflag || rflag)
+            throw usage_error("Cannot provide -a, -j, -l nor -r with -S");
+        else if (!sel.empty())
+            throw usage_error("Cannot provide -e, -g nor -k with -S");
+    } else if (lflag) {
         if (argc > 0)
             throw usage_error("Cannot provide test case names with -l");
+        else if (aflag || maxworkers > 0)
+            throw usage_error("Cannot provide -a nor -j with -l");
+    } else if (aflag) {
+        if (argc > 0)
+            throw usage_error("Cannot provide test case names with -a");
     } else {
         if (argc == 0)
             throw usage_error("Must provide a test case name");
-        else if (argc > 1)
-            throw usage_error("Cannot provide more than one test case name");
-        INV(argc == 1);
     }
+
+    const bool batch = server_arg.empty() && !lflag &&
+        (aflag || argc > 1 || maxworkers > 0 || !sel.empty());
+    if (batch && !rflag) {
+        if (maxworkers > 0)
+            throw usage_error("Must provide a results directory with -r "
+                              "when using -j");
+        else
+            throw usage_error("Must provide a results directory with -r "
+                              "when running more than one test case");
+    }
+
     tc_vector tcs;
     try {
-        init_tcs(add_tcs, tcs, vars);
-        errcode = lflag ? list_tcs(tcs) : run_tc(tcs, argv[0], resfile);
+        if (lflag) {
+            atf_trace_end();  // The startup phase.
+            errcode = list_tcs(argv0, add_tcs, tcs, vars, sel);
+        } else {
+            atf_trace_begin("init_tcs", NULL);
+            init_tcs(add_tcs, tcs, vars);
+            const tc_index index = index_tcs(tcs);
+            atf_trace_end();
+            atf_trace_end();  // The startup phase.
+            if (!server_arg.empty())
+                errcode = serve(index, server_arg);
+            else if (batch)
+                errcode = run_tcs(argv0, tcs, index,
+                                  std::vector< std::string >(argv,
+                                                             argv + argc),
+                                  sel, resfile, maxworkers);
+            else
+                errcode = run_tc(argv0, index, argv[0], resfile, vars);
+        }
     } catch (...) {
         for (auto& tc: tcs) {
             delete tc;
@@ -32,6 +32,7 @@
 
 extern "C" {
 #include <atf-c/defs.h>
+#include <atf-c/tc.h>
 }
 
 namespace atf {
@@ -82,6 +83,12 @@ protected:
 
     void require_prog(const std::string&) const;
 
+    // For the test cases built on top of this class; see atf::bench::tc.
+    const atf_tc_t* get_c_tc(void) const;
+
+    // For the heads defined by ATF_TEST_CASE_WITH_MD; see macros.hpp.
+    void set_md_vars(const char*);
+
     friend struct tc_impl;
 
 public:
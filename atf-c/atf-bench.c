@@ -0,0 +1,276 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+
+/* Lists, compares and prunes the benchmark baselines that test programs
+ * keep when ATF_BENCH_BASELINE is set. */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/baseline.h"
+#include "atf-c/detail/bench.h"
+#include "atf-c/error.h"
+
+/* Defaults of the options of the compare subcommand. */
+#define DEFAULT_ALPHA 0.01
+#define DEFAULT_THRESHOLD 0.0
+
+static const char *progname = "atf-bench";
+
+static
+void
+print_error(const atf_error_t err)
+{
+    char buf[4096];
+
+    atf_error_format(err, buf, sizeof(buf));
+    fprintf(stderr, "%s: ERROR: %s\n", progname, buf);
+}
+
+static
+void
+usage(void)
+{
+    fprintf(stderr, "Usage: %s list baseline\n", progname);
+    fprintf(stderr, "       %s compare [-a alpha] [-t threshold] old new\n",
+            progname);
+    fprintf(stderr, "       %s remove baseline pattern...\n", progname);
+}
+
+static
+bool
+parse_double(const char *str, const double min, const double max,
+             double *value)
+{
+    char *end;
+
+    *value = strtod(str, &end);
+    return *str != '\0' && *end == '\0' && *value >= min && *value <= max;
+}
+
+static
+int
+list(int argc, char **argv)
+{
+    atf_error_t err;
+    atf_baseline_t b;
+    size_t i;
+
+    if (argc != 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    err = atf_baseline_init(&b, argv[1]);
+    if (atf_is_error(err)) {
+        print_error(err);
+        atf_error_free(err);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < b.m_nentries; i++) {
+        const atf_baseline_entry_t *e = &b.m_entries[i];
+
+        printf("%s %zu %.3f\n", e->m_key, e->m_nvalues,
+               atf_bench_stats_percentile(e->m_values, e->m_nvalues, 0.5));
+    }
+    atf_baseline_fini(&b);
+    return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** Compares the entries that two baselines share.
+ *
+ * Entries that only one of them has are listed but not compared.  Exits
+ * with 1 if any entry regressed.
+ */
+static
+int
+compare(int argc, char **argv)
+{
+    atf_error_t err;
+    atf_baseline_t before, after;
+    double alpha, threshold;
+    size_t i, j;
+    bool regressed;
+    int ch;
+
+    alpha = DEFAULT_ALPHA;
+    threshold = DEFAULT_THRESHOLD;
+    while ((ch = getopt(argc, argv, "a:t:")) != -1) {
+        switch (ch) {
+        case 'a':
+            if (!parse_double(optarg, 0.0, 1.0, &alpha)) {
+                fprintf(stderr, "%s: ERROR: Invalid significance level "
+                        "'%s'\n", progname, optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 't':
+            if (!parse_double(optarg, 0.0, HUGE_VAL, &threshold)) {
+                fprintf(stderr, "%s: ERROR: Invalid threshold '%s'\n",
+                        progname, optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        default:
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    err = atf_baseline_init(&before, argv[0]);
+    if (atf_is_error(err)) {
+        print_error(err);
+        atf_error_free(err);
+        return EXIT_FAILURE;
+    }
+    err = atf_baseline_init(&after, argv[1]);
+    if (atf_is_error(err)) {
+        print_error(err);
+        atf_error_free(err);
+        atf_baseline_fini(&before);
+        return EXIT_FAILURE;
+    }
+
+    /* Both baselines are sorted by key. */
+    regressed = false;
+    i = j = 0;
+    while (i < before.m_nentries || j < after.m_nentries) {
+        const atf_baseline_entry_t *o, *n;
+        atf_baseline_comparison_t c;
+        int cmp;
+
+        o = i < before.m_nentries ? &before.m_entries[i] : NULL;
+        n = j < after.m_nentries ? &after.m_entries[j] : NULL;
+        if (o == NULL)
+            cmp = 1;
+        else if (n == NULL)
+            cmp = -1;
+        else
+            cmp = strcmp(o->m_key, n->m_key);
+
+        if (cmp < 0) {
+            printf("%s: only in %s\n", o->m_key, argv[0]);
+            i++;
+        } else if (cmp > 0) {
+            printf("%s: only in %s\n", n->m_key, argv[1]);
+            j++;
+        } else {
+            atf_baseline_compare(&c, o->m_values, o->m_nvalues,
+                                 n->m_values, n->m_nvalues);
+            printf("%s: %.3f -> %.3f (%+.1f%%, p-value %.4f)", o->m_key,
+                   c.m_baseline_median, c.m_median, c.m_change,
+                   c.m_pvalue);
+            if (atf_baseline_regressed(&c, threshold, alpha)) {
+                printf(" REGRESSION");
+                regressed = true;
+            }
+            printf("\n");
+            i++;
+            j++;
+        }
+    }
+
+    atf_baseline_fini(&after);
+    atf_baseline_fini(&before);
+    if (fflush(stdout) != 0)
+        return EXIT_FAILURE;
+    return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static
+int
+remove_entries(int argc, char **argv)
+{
+    atf_error_t err;
+    atf_baseline_t b;
+    size_t removed;
+    int i;
+
+    if (argc < 3) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    err = atf_baseline_init(&b, argv[1]);
+    if (atf_is_error(err)) {
+        print_error(err);
+        atf_error_free(err);
+        return EXIT_FAILURE;
+    }
+
+    err = atf_no_error();
+    removed = 0;
+    for (i = 2; i < argc; i++)
+        removed += atf_baseline_remove(&b, argv[i]);
+    if (removed > 0)
+        err = atf_baseline_write(&b);
+    atf_baseline_fini(&b);
+    if (atf_is_error(err)) {
+        print_error(err);
+        atf_error_free(err);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int
+main(int argc, char **argv)
+{
+
+    if (argc > 0 && strrchr(argv[0], '/') != NULL)
+        progname = strrchr(argv[0], '/') + 1;
+    else if (argc > 0)
+        progname = argv[0];
+
+    if (argc < 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "list") == 0)
+        return list(argc - 1, argv + 1);
+    else if (strcmp(argv[1], "compare") == 0)
+        return compare(argc - 1, argv + 1);
+    else if (strcmp(argv[1], "remove") == 0)
+        return remove_entries(argc - 1, argv + 1);
+
+    usage();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,180 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+/* Lists the test cases of a test program from the records that
+ * ATF_TP_ADD_TC and ATF_ADD_TEST_CASE leave in its binary, falling back to
+ * running the test program with -l when the records are not enough. */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/list.h"
+#include "atf-c/detail/tc_md.h"
+#include "atf-c/error.h"
+
+static const char *progname = "atf-list";
+
+static
+void
+print_error(const atf_error_t err)
+{
+    char buf[4096];
+
+    atf_error_format(err, buf, sizeof(buf));
+    fprintf(stderr, "%s: ERROR: %s\n", progname, buf);
+}
+
+static
+void
+usage(void)
+{
+    fprintf(stderr, "Usage: %s [-n] test_program\n", progname);
+}
+
+/** Checks whether the records fully describe the test cases.
+ *
+ * Test cases with a head can set arbitrary meta-data at run time, which
+ * only the test program itself can report, unless they were defined with
+ * ATF_TC_WITH_MD or its friends and the records carry their meta-data.
+ */
+static
+bool
+is_static(const atf_list_t *records)
+{
+    atf_list_citer_t iter;
+
+    atf_list_for_each_c(iter, records) {
+        const atf_tc_md_record_t *record = atf_list_citer_data(iter);
+        if (record->m_has_head && record->m_static_md == NULL)
+            return false;
+    }
+    return true;
+}
+
+static
+void
+print_records(const atf_list_t *records)
+{
+    atf_list_citer_t iter;
+    bool first;
+
+    printf("Content-Type: application/X-atf-tp; version=\"1\"\n\n");
+
+    first = true;
+    atf_list_for_each_c(iter, records) {
+        const atf_tc_md_record_t *record = atf_list_citer_data(iter);
+
+        if (!first)
+            printf("\n");
+        first = false;
+
+        printf("ident: %s\n", record->m_ident);
+        if (record->m_has_cleanup)
+            printf("has.cleanup: true\n");
+        if (record->m_static_md != NULL) {
+            const char *var = record->m_static_md;
+
+            while (*var != '\0') {
+                const char *value = var + strlen(var) + 1;
+
+                printf("%s: %s\n", var, value);
+                var = value + strlen(value) + 1;
+            }
+        }
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    atf_error_t err;
+    atf_list_t records;
+    const char *program;
+    bool found, no_exec;
+    int ch;
+
+    if (argc > 0 && strrchr(argv[0], '/') != NULL)
+        progname = strrchr(argv[0], '/') + 1;
+    else if (argc > 0)
+        progname = argv[0];
+
+    no_exec = false;
+    while ((ch = getopt(argc, argv, "n")) != -1) {
+        switch (ch) {
+        case 'n':
+            no_exec = true;
+            break;
+
+        default:
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    program = argv[0];
+
+    err = atf_list_init(&records);
+    if (atf_is_error(err)) {
+        print_error(err);
+        atf_error_free(err);
+        return EXIT_FAILURE;
+    }
+
+    err = atf_tc_md_read(program, &records, &found);
+    if (atf_is_error(err)) {
+        print_error(err);
+        atf_error_free(err);
+        atf_list_fini(&records);
+        return EXIT_FAILURE;
+    }
+
+    if (found && atf_list_size(&records) > 0 && is_static(&records)) {
+        print_records(&records);
+        atf_list_fini(&records);
+        return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    atf_list_fini(&records);
+
+    if (no_exec) {
+        fprintf(stderr, "%s: ERROR: Cannot list the test cases of %s "
+                "without running it\n", progname, program);
+        return EXIT_FAILURE;
+    }
+
+    execl(program, program, "-l", (char *)NULL);
+    fprintf(stderr, "%s: ERROR: Cannot execute %s: %s\n", progname, program,
+            strerror(errno));
+    return EXIT_FAILURE;
+}
@@ -43,6 +43,7 @@
 #include "atf-c/detail/list.h"
 #include "atf-c/detail/process.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/trace.h"
 #include "atf-c/error.h"
 #include "atf-c/utils.h"
 
@@ -471,8 +472,10 @@ atf_check_exec_array(const char *const *argv, atf_check_result_t *r)
         goto out;
     }
 
+    atf_trace_begin("check_exec", argv[0]);
     err = fork_and_wait(argv, &r->pimpl->m_stdout, &r->pimpl->m_stderr,
                         &r->pimpl->m_status);
+    atf_trace_end();
     if (atf_is_error(err)) {
         atf_check_result_fini(r);
         goto out;
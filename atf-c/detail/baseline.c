@@ -0,0 +1,596 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/baseline.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/bench.h"
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+/* The first line of a baseline file, which identifies its format. */
+#define HEADER "Content-Type: application/X-atf-bench-baseline; version=\"1\""
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+int
+compare_doubles(const void *v1, const void *v2)
+{
+    const double d1 = *(const double *)v1, d2 = *(const double *)v2;
+
+    return d1 < d2 ? -1 : d1 > d2;
+}
+
+static
+int
+compare_keys(const void *v1, const void *v2)
+{
+    const atf_baseline_entry_t *e1 = v1, *e2 = v2;
+
+    return strcmp(e1->m_key, e2->m_key);
+}
+
+/* Orders the entries by key and, for the same key, by their position in
+ * the baseline file. */
+static
+int
+compare_entries(const void *v1, const void *v2)
+{
+    const atf_baseline_entry_t *e1 = v1, *e2 = v2;
+    int cmp;
+
+    cmp = compare_keys(e1, e2);
+    if (cmp != 0)
+        return cmp;
+    return e1->m_seq < e2->m_seq ? -1 : e1->m_seq > e2->m_seq;
+}
+
+/* Parses a "<key> <count> <value>..." line, without its newline.  Lines
+ * left incomplete by interrupted writers are rejected. */
+static
+atf_error_t
+parse_line(char *line, const size_t seq, atf_baseline_entry_t *e,
+           bool *valid)
+{
+    char *end;
+    unsigned long count;
+    size_t i;
+
+    *valid = false;
+
+    end = strchr(line, ' ');
+    if (end == NULL || end == line)
+        return atf_no_error();
+    *end = '\0';
+    e->m_key = line;
+    line = end + 1;
+
+    errno = 0;
+    count = strtoul(line, &end, 10);
+    if (errno != 0 || end == line || count == 0)
+        return atf_no_error();
+    line = end;
+
+    e->m_values = malloc(sizeof(double) * count);
+    if (e->m_values == NULL)
+        return atf_no_memory_error();
+    for (i = 0; i < count; i++) {
+        if (*line != ' ')
+            break;
+        e->m_values[i] = strtod(line + 1, &end);
+        if (errno != 0 || end == line + 1 || e->m_values[i] < 0.0)
+            break;
+        line = end;
+    }
+    if (i < count || *line != '\0') {
+        free(e->m_values);
+        return atf_no_error();
+    }
+
+    qsort(e->m_values, count, sizeof(double), compare_doubles);
+    e->m_nvalues = count;
+    e->m_seq = seq;
+    *valid = true;
+    return atf_no_error();
+}
+
+/* Reads the whole baseline file into b->m_buf and parses its lines in
+ * place.  A missing baseline is empty. */
+static
+atf_error_t
+load(atf_baseline_t *b)
+{
+    atf_error_t err;
+    struct stat sb;
+    char *line, *end;
+    size_t len, max, i;
+    bool valid;
+    FILE *f;
+
+    f = fopen(atf_fs_path_cstring(&b->m_file), "r");
+    if (f == NULL) {
+        if (errno == ENOENT)
+            return atf_no_error();
+        return atf_libc_error(errno, "Cannot open %s",
+                              atf_fs_path_cstring(&b->m_file));
+    }
+
+    err = atf_no_error();
+    if (fstat(fileno(f), &sb) == -1) {
+        err = atf_libc_error(errno, "Cannot get information of %s",
+                             atf_fs_path_cstring(&b->m_file));
+        goto out;
+    }
+
+    /* Every entry takes at least six bytes. */
+    len = (size_t)sb.st_size;
+    max = len / 6 + 1;
+    b->m_buf = malloc(len + 1);
+    b->m_entries = malloc(sizeof(*b->m_entries) * max);
+    if (b->m_buf == NULL || b->m_entries == NULL) {
+        err = atf_no_memory_error();
+        goto out;
+    }
+    len = fread(b->m_buf, 1, len, f);
+    b->m_buf[len] = '\0';
+
+    end = strchr(b->m_buf, '\n');
+    if (end == NULL || (size_t)(end - b->m_buf) != strlen(HEADER) ||
+        strncmp(b->m_buf, HEADER, strlen(HEADER)) != 0) {
+        err = atf_libc_error(EINVAL, "%s is not a version 1 benchmark "
+                             "baseline", atf_fs_path_cstring(&b->m_file));
+        goto out;
+    }
+
+    for (line = end + 1; *line != '\0'; line = end + 1) {
+        end = strchr(line, '\n');
+        if (end == NULL)
+            break;
+        *end = '\0';
+        if (*line == '\0' || b->m_nentries == max)
+            continue;
+        err = parse_line(line, b->m_nentries, &b->m_entries[b->m_nentries],
+                         &valid);
+        if (atf_is_error(err))
+            goto out;
+        if (valid)
+            b->m_nentries++;
+    }
+
+    /* Keep the latest entry of every key. */
+    qsort(b->m_entries, b->m_nentries, sizeof(*b->m_entries),
+          compare_entries);
+    len = 0;
+    for (i = 0; i < b->m_nentries; i++) {
+        if (i + 1 < b->m_nentries &&
+            compare_keys(&b->m_entries[i], &b->m_entries[i + 1]) == 0) {
+            free(b->m_entries[i].m_values);
+            continue;
+        }
+        b->m_entries[len++] = b->m_entries[i];
+    }
+    b->m_nentries = len;
+
+out:
+    if (atf_is_error(err)) {
+        for (i = 0; i < b->m_nentries; i++)
+            free(b->m_entries[i].m_values);
+        free(b->m_buf);
+        free(b->m_entries);
+        b->m_buf = NULL;
+        b->m_entries = NULL;
+        b->m_nentries = 0;
+    }
+    fclose(f);
+    return err;
+}
+
+static
+atf_error_t
+format_entry(atf_dynstr_t *line, const char *key, const double *values,
+             const size_t nvalues)
+{
+    atf_error_t err;
+    size_t i;
+
+    err = atf_dynstr_init_fmt(line, "%s %zu", key, nvalues);
+    if (atf_is_error(err))
+        return err;
+
+    for (i = 0; i < nvalues && !atf_is_error(err); i++)
+        err = atf_dynstr_append_fmt(line, " %.3f", values[i]);
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(line, "\n");
+    if (atf_is_error(err))
+        atf_dynstr_fini(line);
+    return err;
+}
+
+/* The entries of a baseline file as given to write_entries. */
+struct contents {
+    const atf_baseline_entry_t *m_entries;
+    size_t m_nentries;
+};
+
+static
+atf_error_t
+write_entries(FILE *f, void *data)
+{
+    const struct contents *c = data;
+    atf_error_t err;
+    size_t i;
+
+    fprintf(f, "%s\n\n", HEADER);
+    err = atf_no_error();
+    for (i = 0; i < c->m_nentries && !atf_is_error(err); i++) {
+        atf_dynstr_t line;
+
+        err = format_entry(&line, c->m_entries[i].m_key,
+                           c->m_entries[i].m_values,
+                           c->m_entries[i].m_nvalues);
+        if (!atf_is_error(err)) {
+            fprintf(f, "%s", atf_dynstr_cstring(&line));
+            atf_dynstr_fini(&line);
+        }
+    }
+    return err;
+}
+
+/* Writes a baseline file with the given entries.  If replace is false, an
+ * existing file is left untouched. */
+static
+atf_error_t
+publish(const atf_fs_path_t *file, const atf_baseline_entry_t *entries,
+        const size_t nentries, const bool replace)
+{
+    struct contents c;
+
+    c.m_entries = entries;
+    c.m_nentries = nentries;
+    return atf_fs_write_atomic(file, replace, write_entries, &c);
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_baseline" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+/** Loads the baseline stored in a file.
+ *
+ * A missing file holds an empty baseline; a file in a different format is
+ * an error.  Relative paths are resolved now because the test cases run in
+ * their own work directories.
+ */
+atf_error_t
+atf_baseline_init(atf_baseline_t *b, const char *file)
+{
+    atf_error_t err;
+    atf_fs_path_t path;
+
+    b->m_buf = NULL;
+    b->m_entries = NULL;
+    b->m_nentries = 0;
+
+    err = atf_fs_path_init_fmt(&path, "%s", file);
+    if (atf_is_error(err))
+        return err;
+    if (atf_fs_path_is_absolute(&path))
+        b->m_file = path;
+    else {
+        err = atf_fs_path_to_absolute(&path, &b->m_file);
+        atf_fs_path_fini(&path);
+        if (atf_is_error(err))
+            return err;
+    }
+
+    err = load(b);
+    if (atf_is_error(err))
+        atf_fs_path_fini(&b->m_file);
+    return err;
+}
+
+void
+atf_baseline_fini(atf_baseline_t *b)
+{
+    size_t i;
+
+    for (i = 0; i < b->m_nentries; i++)
+        free(b->m_entries[i].m_values);
+    free(b->m_entries);
+    free(b->m_buf);
+    atf_fs_path_fini(&b->m_file);
+}
+
+/*
+ * Getters.
+ */
+
+/** Looks up the entry of a key, or returns NULL if there is none. */
+const atf_baseline_entry_t *
+atf_baseline_get(const atf_baseline_t *b, const char *key)
+{
+    atf_baseline_entry_t e;
+
+    if (b->m_nentries == 0)
+        return NULL;
+
+    e.m_key = key;
+    return bsearch(&e, b->m_entries, b->m_nentries, sizeof(e),
+                   compare_keys);
+}
+
+/*
+ * Modifiers.
+ */
+
+/** Appends the samples of a benchmark record to the baseline file.
+ *
+ * The file is created if it does not exist yet.  The entries that the
+ * baseline held when it was loaded do not change; the new one is seen by
+ * the next load.  Keys cannot contain whitespace.
+ */
+atf_error_t
+atf_baseline_append(const atf_baseline_t *b, const char *key,
+                    const double *values, const size_t nvalues)
+{
+    atf_error_t err;
+    atf_dynstr_t line;
+    struct stat sb;
+    ssize_t ret;
+    int fd;
+
+    PRE(strpbrk(key, " \t\n") == NULL);
+    PRE(nvalues > 0);
+
+    if (stat(atf_fs_path_cstring(&b->m_file), &sb) == -1) {
+        if (errno != ENOENT)
+            return atf_libc_error(errno, "Cannot get information of %s",
+                                  atf_fs_path_cstring(&b->m_file));
+        err = publish(&b->m_file, NULL, 0, false);
+        if (atf_is_error(err))
+            return err;
+    }
+
+    err = format_entry(&line, key, values, nvalues);
+    if (atf_is_error(err))
+        return err;
+
+    fd = open(atf_fs_path_cstring(&b->m_file),
+              O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd == -1) {
+        err = atf_libc_error(errno, "Cannot open %s",
+                             atf_fs_path_cstring(&b->m_file));
+        goto out;
+    }
+
+    /* A single write keeps the lines of concurrent writers apart. */
+    ret = write(fd, atf_dynstr_cstring(&line), atf_dynstr_length(&line));
+    if (ret != (ssize_t)atf_dynstr_length(&line))
+        err = atf_libc_error(ret == -1 ? errno : EIO, "Cannot write %s",
+                             atf_fs_path_cstring(&b->m_file));
+    close(fd);
+
+out:
+    atf_dynstr_fini(&line);
+    return err;
+}
+
+/** Removes the entries whose key matches a shell pattern.
+ *
+ * Returns how many entries were removed.  The file does not change until
+ * atf_baseline_write is called.
+ */
+size_t
+atf_baseline_remove(atf_baseline_t *b, const char *pattern)
+{
+    size_t i, n;
+
+    n = 0;
+    for (i = 0; i < b->m_nentries; i++) {
+        if (fnmatch(pattern, b->m_entries[i].m_key, 0) == 0) {
+            free(b->m_entries[i].m_values);
+            continue;
+        }
+        b->m_entries[n++] = b->m_entries[i];
+    }
+    i = b->m_nentries - n;
+    b->m_nentries = n;
+    return i;
+}
+
+/** Replaces the baseline file with the entries of the baseline. */
+atf_error_t
+atf_baseline_write(const atf_baseline_t *b)
+{
+
+    return publish(&b->m_file, b->m_entries, b->m_nentries, true);
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_baseline_comparison" type.
+ * --------------------------------------------------------------------- */
+
+/** Compares the sorted samples of a run to the sorted samples of its
+ * baseline. */
+void
+atf_baseline_compare(atf_baseline_comparison_t *c, const double *baseline,
+                     const size_t nbaseline, const double *values,
+                     const size_t nvalues)
+{
+
+    PRE(nbaseline > 0);
+    PRE(nvalues > 0);
+
+    c->m_baseline_median = atf_bench_stats_percentile(baseline, nbaseline,
+                                                      0.5);
+    c->m_median = atf_bench_stats_percentile(values, nvalues, 0.5);
+    if (c->m_baseline_median > 0.0)
+        c->m_change = (c->m_median / c->m_baseline_median - 1.0) * 100.0;
+    else
+        c->m_change = c->m_median > 0.0 ? HUGE_VAL : 0.0;
+    c->m_pvalue = atf_baseline_mann_whitney(baseline, nbaseline, values,
+                                            nvalues);
+}
+
+/** Tells whether a run is significantly slower than its baseline, by more
+ * than max_change percent. */
+bool
+atf_baseline_regressed(const atf_baseline_comparison_t *c,
+                       const double max_change, const double alpha)
+{
+
+    return c->m_change > max_change && c->m_pvalue < alpha;
+}
+
+/** Computes the one-sided p-value of the Mann-Whitney U test for the second
+ * set of sorted samples being larger than the first.
+ *
+ * Uses the normal approximation of the distribution of U, with continuity
+ * and tie corrections, which is accurate enough for the tens of samples of
+ * a benchmark.  Returns 1 if all the samples are equal.
+ */
+double
+atf_baseline_mann_whitney(const double *first, const size_t nfirst,
+                          const double *second, const size_t nsecond)
+{
+    double ranks, ties, n, mean, var, z;
+    size_t i, j, pos;
+
+    PRE(nfirst > 0);
+    PRE(nsecond > 0);
+
+    ranks = 0.0;
+    ties = 0.0;
+    pos = 0;
+    i = j = 0;
+    while (i < nfirst || j < nsecond) {
+        double value, t;
+        size_t c1, c2;
+
+        if (j == nsecond || (i < nfirst && first[i] <= second[j]))
+            value = first[i];
+        else
+            value = second[j];
+
+        c1 = 0;
+        while (i < nfirst && first[i] == value) {
+            c1++;
+            i++;
+        }
+        c2 = 0;
+        while (j < nsecond && second[j] == value) {
+            c2++;
+            j++;
+        }
+
+        /* The tied samples share the average of their ranks. */
+        t = (double)(c1 + c2);
+        ranks += (double)c2 * ((double)pos + (t + 1.0) / 2.0);
+        ties += t * t * t - t;
+        pos += c1 + c2;
+    }
+
+    n = (double)(nfirst + nsecond);
+    mean = (double)nfirst * (double)nsecond / 2.0;
+    var = (double)nfirst * (double)nsecond / 12.0 *
+        (n + 1.0 - ties / (n * (n - 1.0)));
+    if (var <= 0.0)
+        return 1.0;
+
+    z = (ranks - (double)nsecond * ((double)nsecond + 1.0) / 2.0 - mean -
+         0.5) / sqrt(var);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Computes the key of a benchmark record in the baseline stored in file.
+ *
+ * Test programs in different directories often share their names, so the
+ * key starts with the path of the test program relative to the directory
+ * of the baseline, or with its absolute path if it lives elsewhere.  The
+ * keys of a baseline kept at the top of a tree thus do not depend on where
+ * the tree is, and those of two trees can be compared.  The program is
+ * NULL if it could not be located.
+ */
+atf_error_t
+atf_baseline_key(const char *file, const char *program, const char *name,
+                 atf_dynstr_t *key)
+{
+    atf_error_t err;
+    atf_fs_path_t path, dir;
+    char *real;
+    size_t len;
+
+    if (program == NULL)
+        return atf_libc_error(ENOENT, "Cannot locate the test program");
+
+    err = atf_fs_path_init_fmt(&path, "%s", file);
+    if (atf_is_error(err))
+        goto out;
+    err = atf_fs_path_branch_path(&path, &dir);
+    if (atf_is_error(err))
+        goto out_path;
+
+    real = realpath(atf_fs_path_cstring(&dir), NULL);
+    if (real == NULL) {
+        err = atf_libc_error(errno, "Cannot locate the directory of %s",
+                             file);
+        goto out_dir;
+    }
+
+    len = strcmp(real, "/") == 0 ? 0 : strlen(real);
+    if (strncmp(program, real, len) == 0 && program[len] == '/')
+        program += len + 1;
+    err = atf_dynstr_init_fmt(key, "%s:%s", program, name);
+    free(real);
+
+out_dir:
+    atf_fs_path_fini(&dir);
+out_path:
+    atf_fs_path_fini(&path);
+out:
+    return err;
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_BASELINE_H)
+#define ATF_C_DETAIL_BASELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <atf-c/detail/dynstr.h>
+#include <atf-c/detail/fs.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_baseline" type.
+ * --------------------------------------------------------------------- */
+
+/* The samples of a benchmark record, sorted, in nanoseconds per iteration.
+ * The key joins the path of the test program and the name of the record
+ * with a colon. */
+struct atf_baseline_entry {
+    const char *m_key;
+    double *m_values;
+    size_t m_nvalues;
+    size_t m_seq;
+};
+typedef struct atf_baseline_entry atf_baseline_entry_t;
+
+/* A local store of benchmark samples against which later runs of the same
+ * benchmarks are compared.  Entries are appended to the file, and a later
+ * entry for a key replaces the earlier ones. */
+struct atf_baseline {
+    atf_fs_path_t m_file;
+    char *m_buf;
+    atf_baseline_entry_t *m_entries;
+    size_t m_nentries;
+};
+typedef struct atf_baseline atf_baseline_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_baseline_init(atf_baseline_t *, const char *);
+void atf_baseline_fini(atf_baseline_t *);
+
+/* Getters. */
+const atf_baseline_entry_t *atf_baseline_get(const atf_baseline_t *,
+                                             const char *);
+
+/* Modifiers. */
+atf_error_t atf_baseline_append(const atf_baseline_t *, const char *,
+                                const double *, const size_t);
+size_t atf_baseline_remove(atf_baseline_t *, const char *);
+atf_error_t atf_baseline_write(const atf_baseline_t *);
+
+/* ---------------------------------------------------------------------
+ * The "atf_baseline_comparison" type.
+ * --------------------------------------------------------------------- */
+
+/* How the samples of a run compare to those of the baseline.  The change is
+ * that of the median, in percent, and the p-value is that of the one-sided
+ * Mann-Whitney U test for the run being slower. */
+struct atf_baseline_comparison {
+    double m_baseline_median;
+    double m_median;
+    double m_change;
+    double m_pvalue;
+};
+typedef struct atf_baseline_comparison atf_baseline_comparison_t;
+
+void atf_baseline_compare(atf_baseline_comparison_t *, const double *,
+                          const size_t, const double *, const size_t);
+bool atf_baseline_regressed(const atf_baseline_comparison_t *, const double,
+                            const double);
+double atf_baseline_mann_whitney(const double *, const size_t,
+                                 const double *, const size_t);
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+atf_error_t atf_baseline_key(const char *, const char *, const char *,
+                             atf_dynstr_t *);
+
+#endif /* !defined(ATF_C_DETAIL_BASELINE_H) */
@@ -0,0 +1,341 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/baseline.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+#define HEADER "Content-Type: application/X-atf-bench-baseline; version=\"1\""
+
+static
+void
+write_file(const char *path, const char *contents)
+{
+    FILE *f;
+
+    f = fopen(path, "w");
+    ATF_REQUIRE(f != NULL);
+    fprintf(f, "%s", contents);
+    fclose(f);
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_baseline" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(missing_file);
+ATF_TC_BODY(missing_file, tc)
+{
+    atf_baseline_t b;
+
+    RE(atf_baseline_init(&b, "baseline"));
+    ATF_CHECK_EQ(0, b.m_nentries);
+    ATF_CHECK(atf_baseline_get(&b, "prog:tc") == NULL);
+    atf_baseline_fini(&b);
+    ATF_CHECK(!atf_utils_file_exists("baseline"));
+}
+
+ATF_TC(append_and_get);
+ATF_TC_HEAD(append_and_get, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that appended entries are "
+                      "stored sorted and seen by later loads only");
+}
+ATF_TC_BODY(append_and_get, tc)
+{
+    const double values1[] = { 3.0, 1.0, 2.5 };
+    const double values2[] = { 10.0 };
+    const atf_baseline_entry_t *e;
+    atf_baseline_t b;
+
+    RE(atf_baseline_init(&b, "baseline"));
+    RE(atf_baseline_append(&b, "prog:tc/n=8", values1, 3));
+    RE(atf_baseline_append(&b, "prog:other", values2, 1));
+    ATF_CHECK(atf_baseline_get(&b, "prog:tc/n=8") == NULL);
+    atf_baseline_fini(&b);
+
+    ATF_CHECK(atf_utils_compare_file("baseline", HEADER "\n\n"
+        "prog:tc/n=8 3 3.000 1.000 2.500\n"
+        "prog:other 1 10.000\n"));
+
+    RE(atf_baseline_init(&b, "baseline"));
+    ATF_CHECK_EQ(2, b.m_nentries);
+    e = atf_baseline_get(&b, "prog:tc/n=8");
+    ATF_REQUIRE(e != NULL);
+    ATF_REQUIRE_EQ(3, e->m_nvalues);
+    ATF_CHECK_EQ(1.0, e->m_values[0]);
+    ATF_CHECK_EQ(2.5, e->m_values[1]);
+    ATF_CHECK_EQ(3.0, e->m_values[2]);
+    e = atf_baseline_get(&b, "prog:other");
+    ATF_REQUIRE(e != NULL);
+    ATF_CHECK_EQ(1, e->m_nvalues);
+    ATF_CHECK(atf_baseline_get(&b, "prog:tc") == NULL);
+    atf_baseline_fini(&b);
+}
+
+ATF_TC(latest_wins);
+ATF_TC_HEAD(latest_wins, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the last appended entry "
+                      "of a key is the one that counts");
+}
+ATF_TC_BODY(latest_wins, tc)
+{
+    const double old_values[] = { 1.0, 2.0 };
+    const double new_values[] = { 5.0 };
+    const atf_baseline_entry_t *e;
+    atf_baseline_t b;
+
+    RE(atf_baseline_init(&b, "baseline"));
+    RE(atf_baseline_append(&b, "prog:tc", old_values, 2));
+    RE(atf_baseline_append(&b, "prog:tc", new_values, 1));
+    atf_baseline_fini(&b);
+
+    RE(atf_baseline_init(&b, "baseline"));
+    ATF_CHECK_EQ(1, b.m_nentries);
+    e = atf_baseline_get(&b, "prog:tc");
+    ATF_REQUIRE(e != NULL);
+    ATF_REQUIRE_EQ(1, e->m_nvalues);
+    ATF_CHECK_EQ(5.0, e->m_values[0]);
+    atf_baseline_fini(&b);
+}
+
+ATF_TC(corrupt_lines);
+ATF_TC_HEAD(corrupt_lines, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that malformed and incomplete "
+                      "entries in the baseline are ignored");
+}
+ATF_TC_BODY(corrupt_lines, tc)
+{
+    atf_baseline_t b;
+
+    write_file("baseline", HEADER "\n\n"
+               "prog:good 2 1.000 2.000\n"
+               "garbage\n"
+               "prog:zero 0\n"
+               "prog:short 3 1.000 2.000\n"
+               "prog:long 1 1.000 2.000\n"
+               "prog:bad 1 x\n"
+               "prog:negative 1 -1.000\n"
+               "prog:incomplete 1 1.000");
+
+    RE(atf_baseline_init(&b, "baseline"));
+    ATF_CHECK_EQ(1, b.m_nentries);
+    ATF_CHECK(atf_baseline_get(&b, "prog:good") != NULL);
+    atf_baseline_fini(&b);
+}
+
+ATF_TC(unknown_format);
+ATF_TC_HEAD(unknown_format, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that files without the header "
+                      "of a version 1 baseline are rejected");
+}
+ATF_TC_BODY(unknown_format, tc)
+{
+    atf_baseline_t b;
+    atf_error_t err;
+    char buf[1024];
+
+    write_file("baseline", "Content-Type: application/X-atf-bench-baseline; "
+               "version=\"2\"\n\nprog:tc 1 1.000\n");
+    err = atf_baseline_init(&b, "baseline");
+    ATF_REQUIRE(atf_is_error(err));
+    atf_error_format(err, buf, sizeof(buf));
+    ATF_CHECK(strstr(buf, "is not a version 1 benchmark baseline") != NULL);
+    atf_error_free(err);
+}
+
+ATF_TC(remove_and_write);
+ATF_TC_HEAD(remove_and_write, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that entries can be removed by "
+                      "pattern and the baseline rewritten");
+}
+ATF_TC_BODY(remove_and_write, tc)
+{
+    const double values[] = { 1.0 };
+    atf_baseline_t b;
+
+    RE(atf_baseline_init(&b, "baseline"));
+    RE(atf_baseline_append(&b, "prog:a/n=1", values, 1));
+    RE(atf_baseline_append(&b, "prog:a/n=2", values, 1));
+    RE(atf_baseline_append(&b, "prog:b", values, 1));
+    RE(atf_baseline_append(&b, "prog:b", values, 1));
+    atf_baseline_fini(&b);
+
+    RE(atf_baseline_init(&b, "baseline"));
+    ATF_CHECK_EQ(2, atf_baseline_remove(&b, "prog:a/*"));
+    ATF_CHECK_EQ(0, atf_baseline_remove(&b, "other:*"));
+    RE(atf_baseline_write(&b));
+    atf_baseline_fini(&b);
+
+    ATF_CHECK(atf_utils_compare_file("baseline", HEADER "\n\n"
+        "prog:b 1 1.000\n"));
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_baseline_comparison" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(mann_whitney);
+ATF_TC_HEAD(mann_whitney, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the p-values of the Mann-Whitney "
+                      "U test");
+}
+ATF_TC_BODY(mann_whitney, tc)
+{
+    const double low[] = { 1.0, 2.0, 3.0 };
+    const double high[] = { 4.0, 5.0, 6.0 };
+    const double same[] = { 2.0, 2.0, 2.0 };
+    const double mixed[] = { 1.5, 2.5, 3.5 };
+    double p;
+
+    p = atf_baseline_mann_whitney(low, 3, high, 3);
+    ATF_CHECK_MSG(fabs(p - 0.0404) < 0.0001, "p-value is %f", p);
+
+    p = atf_baseline_mann_whitney(high, 3, low, 3);
+    ATF_CHECK_MSG(p > 0.95, "p-value is %f", p);
+
+    p = atf_baseline_mann_whitney(low, 3, mixed, 3);
+    ATF_CHECK_MSG(p > 0.2 && p < 0.5, "p-value is %f", p);
+
+    ATF_CHECK_EQ(1.0, atf_baseline_mann_whitney(same, 3, same, 3));
+}
+
+ATF_TC(compare);
+ATF_TC_HEAD(compare, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that regressions need both a "
+                      "large and a significant change of the times");
+}
+ATF_TC_BODY(compare, tc)
+{
+    double base[20], slower[20], noisy[20];
+    atf_baseline_comparison_t c;
+    size_t i;
+
+    for (i = 0; i < 20; i++) {
+        base[i] = 100.0 + (double)i;
+        slower[i] = 120.0 + (double)i;
+        noisy[i] = i < 10 ? 50.0 + (double)i : 200.0 + (double)i;
+    }
+
+    atf_baseline_compare(&c, base, 20, slower, 20);
+    ATF_CHECK_EQ(109.5, c.m_baseline_median);
+    ATF_CHECK_EQ(129.5, c.m_median);
+    ATF_CHECK(fabs(c.m_change - 18.26) < 0.01);
+    ATF_CHECK(c.m_pvalue < 0.01);
+    ATF_CHECK(atf_baseline_regressed(&c, 10.0, 0.01));
+    ATF_CHECK(!atf_baseline_regressed(&c, 20.0, 0.01));
+
+    atf_baseline_compare(&c, base, 20, base, 20);
+    ATF_CHECK_EQ(0.0, c.m_change);
+    ATF_CHECK(!atf_baseline_regressed(&c, 0.0, 0.01));
+
+    /* The median moves a lot, but the samples do not support it. */
+    atf_baseline_compare(&c, base, 20, noisy, 20);
+    ATF_CHECK(c.m_change > 10.0);
+    ATF_CHECK(!atf_baseline_regressed(&c, 10.0, 0.01));
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(key);
+ATF_TC_HEAD(key, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the keys of the programs "
+                      "under the directory of the baseline are relative to "
+                      "it");
+}
+ATF_TC_BODY(key, tc)
+{
+    atf_dynstr_t key, program;
+    atf_error_t err;
+    char *cwd;
+
+    ATF_REQUIRE(mkdir("dir", 0755) != -1);
+    cwd = realpath(".", NULL);
+    ATF_REQUIRE(cwd != NULL);
+
+    RE(atf_dynstr_init_fmt(&program, "%s/dir/sub/prog", cwd));
+    RE(atf_baseline_key("dir/baseline", atf_dynstr_cstring(&program), "tc",
+                        &key));
+    ATF_CHECK_STREQ("sub/prog:tc", atf_dynstr_cstring(&key));
+    atf_dynstr_fini(&key);
+
+    RE(atf_baseline_key("dir/baseline", "/elsewhere/prog", "tc/1", &key));
+    ATF_CHECK_STREQ("/elsewhere/prog:tc/1", atf_dynstr_cstring(&key));
+    atf_dynstr_fini(&key);
+
+    err = atf_baseline_key("dir/baseline", NULL, "tc", &key);
+    ATF_CHECK(atf_is_error(err));
+    atf_error_free(err);
+
+    err = atf_baseline_key("missing/baseline", atf_dynstr_cstring(&program),
+                           "tc", &key);
+    ATF_CHECK(atf_is_error(err));
+    atf_error_free(err);
+
+    atf_dynstr_fini(&program);
+    free(cwd);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, missing_file);
+    ATF_TP_ADD_TC(tp, append_and_get);
+    ATF_TP_ADD_TC(tp, latest_wins);
+    ATF_TP_ADD_TC(tp, corrupt_lines);
+    ATF_TP_ADD_TC(tp, unknown_format);
+    ATF_TP_ADD_TC(tp, remove_and_write);
+    ATF_TP_ADD_TC(tp, mann_whitney);
+    ATF_TP_ADD_TC(tp, compare);
+    ATF_TP_ADD_TC(tp, key);
+
+    return atf_no_error();
+}
@@ -0,0 +1,704 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/bench.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/baseline.h"
+#include "atf-c/detail/binary.h"
+#include "atf-c/detail/env.h"
+#include "atf-c/detail/fs.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+enum bench_state {
+    CALIBRATE,
+    WARMUP,
+    SAMPLE,
+    DONE,
+};
+
+/* Keeps the iteration count of the fastest code within reasonable
+ * bounds. */
+#define MAX_ITERATIONS ((size_t)1 << 30)
+
+/* The significance level of the comparisons with the baseline. */
+#define BASELINE_ALPHA 0.01
+
+/* The measurement of the running loop of the body, if any, and how many of
+ * these loops the body completed.  The label names the record of the next
+ * loop to complete, and the statistics are those of the last one. */
+static atf_bench_t Bench;
+static bool Bench_running = false;
+static size_t Bench_records = 0;
+static char *Bench_label = NULL;
+static atf_bench_stats_t Bench_last;
+static long Bench_max_regression = -1;
+
+/* The file that receives the records, or NULL for stderr, and whether the
+ * body wrote any record to it yet. */
+static char *Bench_output = NULL;
+static bool Bench_output_started = false;
+
+/* Where to report the problems that do not stop a loop. */
+static atf_bench_fail_t Bench_fail = NULL;
+static void *Bench_fail_data = NULL;
+
+/* The absolute path of the test program, which keys the entries of the
+ * baseline; only located if there is a baseline. */
+static char *Bench_program = NULL;
+
+/* The conditions under which the body runs its loops, set up before the
+ * first one. */
+static bool Bench_prepared = false;
+static atf_perf_counters_t Bench_counters;
+static atf_perf_conditions_t Bench_conditions;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+int
+compare_doubles(const void *v1, const void *v2)
+{
+    const double *d1 = v1, *d2 = v2;
+
+    return *d1 < *d2 ? -1 : *d1 > *d2;
+}
+
+static
+int64_t
+elapsed_nsec(const struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (int64_t)(end.tv_sec - start->tv_sec) * 1000000000 +
+        (end.tv_nsec - start->tv_nsec);
+}
+
+/** Gets the value of an environment variable, or NULL if unset or
+ * empty. */
+static
+const char *
+env_value(const char *name)
+{
+
+    if (!atf_env_has(name) || atf_env_get(name)[0] == '\0')
+        return NULL;
+    return atf_env_get(name);
+}
+
+static
+atf_error_t
+fail_fmt(const char *fmt, ...)
+{
+    atf_error_t err;
+    atf_dynstr_t reason;
+    va_list ap;
+
+    va_start(ap, fmt);
+    err = atf_dynstr_init_ap(&reason, fmt, ap);
+    va_end(ap);
+    if (!atf_is_error(err))
+        Bench_fail(Bench_fail_data, &reason);
+    return err;
+}
+
+/** Reports a problem that does not stop the loop, described by what and
+ * by the error, which is freed. */
+static
+atf_error_t
+fail_error(atf_error_t error, const char *what)
+{
+    char buf[1024];
+
+    atf_error_format(error, buf, sizeof(buf));
+    atf_error_free(error);
+    return fail_fmt("%s: %s", what, buf);
+}
+
+/** Sets up the process for the loops of the body.
+ *
+ * The process is pinned to the CPUs listed in the ATF_BENCH_CPUS
+ * environment variable, if set, and gets as high a scheduling priority as
+ * it is allowed to if ATF_BENCH_PRIORITY is set.  The performance counters
+ * are opened in any case.
+ */
+static
+atf_error_t
+prepare(void)
+{
+    atf_error_t err;
+
+    err = atf_perf_conditions_init(&Bench_conditions,
+                                   env_value("ATF_BENCH_CPUS"),
+                                   env_value("ATF_BENCH_PRIORITY") != NULL);
+    if (atf_is_error(err))
+        return err;
+    Bench_prepared = true;
+
+    err = atf_perf_conditions_apply(&Bench_conditions);
+    if (atf_is_error(err)) {
+        err = fail_error(err, "Cannot pin the benchmark");
+        if (atf_is_error(err))
+            return err;
+    }
+
+    atf_perf_counters_init(&Bench_counters);
+    return atf_no_error();
+}
+
+/** Compares the completed loop with its baseline.
+ *
+ * Only done if the ATF_BENCH_BASELINE environment variable names a
+ * baseline file.  If the baseline has no samples for the loop, its samples
+ * are saved there instead.  Otherwise, the comparison is appended to the
+ * record and the loop fails if it is significantly slower, by more than
+ * the maximum regression.
+ */
+static
+atf_error_t
+compare_baseline(const char *name, atf_dynstr_t *record)
+{
+    atf_error_t err;
+    atf_baseline_t baseline;
+    atf_baseline_comparison_t c;
+    const atf_baseline_entry_t *e;
+    atf_dynstr_t key;
+    const char *file;
+
+    file = env_value("ATF_BENCH_BASELINE");
+    if (file == NULL)
+        return atf_no_error();
+
+    err = atf_baseline_key(file, Bench_program, name, &key);
+    if (atf_is_error(err))
+        return fail_error(err, "Cannot key the benchmark baseline");
+    if (strpbrk(atf_dynstr_cstring(&key), " \t\n") != NULL) {
+        fprintf(stderr, "WARNING: Cannot keep a baseline for %s because its "
+                "name has whitespace\n", name);
+        goto out_key;
+    }
+
+    err = atf_baseline_init(&baseline, file);
+    if (atf_is_error(err)) {
+        err = fail_error(err, "Cannot load the benchmark baseline");
+        goto out_key;
+    }
+
+    e = atf_baseline_get(&baseline, atf_dynstr_cstring(&key));
+    if (e == NULL) {
+        err = atf_baseline_append(&baseline, atf_dynstr_cstring(&key),
+                                  Bench.m_values, Bench.m_nvalues);
+        if (atf_is_error(err))
+            err = fail_error(err, "Cannot save the benchmark baseline");
+        else
+            err = atf_dynstr_append_fmt(record, "baseline: saved\n");
+        goto out_baseline;
+    }
+
+    atf_baseline_compare(&c, e->m_values, e->m_nvalues, Bench.m_values,
+                         Bench.m_nvalues);
+    err = atf_dynstr_append_fmt(record,
+        "baseline: compared\n"
+        "baseline-median: %.3f\n"
+        "change: %.3f\n"
+        "p-value: %.6f\n",
+        c.m_baseline_median, c.m_change, c.m_pvalue);
+    if (!atf_is_error(err) && Bench_max_regression >= 0 &&
+        atf_baseline_regressed(&c, (double)Bench_max_regression,
+                               BASELINE_ALPHA))
+        err = fail_fmt("Benchmark %s is %.1f%% slower than its baseline "
+                       "(p-value %.4f), more than the %ld%% allowed", name,
+                       c.m_change, c.m_pvalue, Bench_max_regression);
+
+out_baseline:
+    atf_baseline_fini(&baseline);
+out_key:
+    atf_dynstr_fini(&key);
+    return err;
+}
+
+/** Writes the statistics of the completed loop.
+ *
+ * The record is named after the test case and the label of the loop, if
+ * any.  Otherwise, the records of the loops after the first one get their
+ * 1-based position appended instead.
+ */
+static
+atf_error_t
+write_record(const char *ident)
+{
+    atf_error_t err;
+    atf_dynstr_t name, record;
+
+    atf_bench_stats_compute(&Bench_last, Bench.m_values, Bench.m_nvalues,
+                            Bench.m_iterations);
+
+    if (Bench_label != NULL)
+        err = atf_dynstr_init_fmt(&name, "%s/%s", ident, Bench_label);
+    else if (Bench_records == 0)
+        err = atf_dynstr_init_fmt(&name, "%s", ident);
+    else
+        err = atf_dynstr_init_fmt(&name, "%s/%zu", ident, Bench_records + 1);
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_dynstr_init(&record);
+    if (atf_is_error(err))
+        goto out_name;
+
+    err = atf_bench_stats_format(&Bench_last, atf_dynstr_cstring(&name),
+                                 Bench.m_values, &record);
+    if (!atf_is_error(err))
+        err = atf_perf_counters_format(&Bench_counters,
+            Bench_last.m_samples * Bench_last.m_iterations, &record);
+    if (!atf_is_error(err))
+        err = atf_perf_conditions_format(&Bench_conditions, &record);
+    if (!atf_is_error(err))
+        err = compare_baseline(atf_dynstr_cstring(&name), &record);
+    if (!atf_is_error(err))
+        atf_bench_body_report(atf_dynstr_cstring(&record));
+
+    atf_dynstr_fini(&record);
+out_name:
+    atf_dynstr_fini(&name);
+out:
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_bench" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+atf_error_t
+atf_bench_init(atf_bench_t *b, const size_t samples, const size_t warmup,
+               const int64_t batch_nsec)
+{
+    PRE(samples > 0);
+    PRE(batch_nsec > 0);
+
+    b->m_values = malloc(sizeof(double) * samples);
+    if (b->m_values == NULL)
+        return atf_no_memory_error();
+
+    b->m_state = CALIBRATE;
+    b->m_iterations = 1;
+    b->m_warmup = warmup;
+    b->m_batch_nsec = batch_nsec;
+    b->m_nvalues = 0;
+    b->m_maxvalues = samples;
+    b->m_running = false;
+    b->m_counters = NULL;
+    return atf_no_error();
+}
+
+void
+atf_bench_fini(atf_bench_t *b)
+{
+    free(b->m_values);
+}
+
+/*
+ * Getters.
+ */
+
+bool
+atf_bench_done(const atf_bench_t *b)
+{
+    return b->m_state == DONE;
+}
+
+/*
+ * Modifiers.
+ */
+
+/** Ends the running batch, if any, and starts the next one.
+ *
+ * Returns false, without starting anything, once all the samples have
+ * been taken.  Otherwise, sets iterations to the number of times the
+ * caller must run the measured code before calling this again.
+ */
+bool
+atf_bench_next(atf_bench_t *b, size_t *iterations)
+{
+    if (b->m_running) {
+        const int64_t nsec = elapsed_nsec(&b->m_start);
+
+        if (b->m_counters != NULL && b->m_state == SAMPLE)
+            atf_perf_counters_stop(b->m_counters);
+        atf_bench_record(b, nsec);
+        b->m_running = false;
+    }
+    if (b->m_state == DONE)
+        return false;
+
+    *iterations = b->m_iterations;
+    b->m_running = true;
+    if (b->m_counters != NULL && b->m_state == SAMPLE)
+        atf_perf_counters_start(b->m_counters);
+    clock_gettime(CLOCK_MONOTONIC, &b->m_start);
+    return true;
+}
+
+/** Accounts for a batch that took the given time. */
+void
+atf_bench_record(atf_bench_t *b, const int64_t nsec)
+{
+    double factor;
+
+    switch (b->m_state) {
+    case CALIBRATE:
+        if (nsec >= b->m_batch_nsec || b->m_iterations >= MAX_ITERATIONS) {
+            b->m_state = b->m_warmup > 0 ? WARMUP : SAMPLE;
+            break;
+        }
+
+        /* Aim a bit over the target so that the next batch is likely the
+         * last one of the calibration. */
+        factor = nsec > 0 ? 1.4 * (double)b->m_batch_nsec / (double)nsec
+                          : 100.0;
+        if (factor < 2.0)
+            factor = 2.0;
+        else if (factor > 100.0)
+            factor = 100.0;
+        if ((double)b->m_iterations * factor >= (double)MAX_ITERATIONS)
+            b->m_iterations = MAX_ITERATIONS;
+        else
+            b->m_iterations = (size_t)((double)b->m_iterations * factor);
+        break;
+
+    case WARMUP:
+        if (--b->m_warmup == 0)
+            b->m_state = SAMPLE;
+        break;
+
+    case SAMPLE:
+        b->m_values[b->m_nvalues++] =
+            (double)nsec / (double)b->m_iterations;
+        if (b->m_nvalues == b->m_maxvalues)
+            b->m_state = DONE;
+        break;
+
+    default:
+        UNREACHABLE;
+    }
+}
+
+/** Reads the given counters around the batches that yield samples, whose
+ * totals are thus those of all the samples.  The counters are not reset.
+ */
+void
+atf_bench_set_counters(atf_bench_t *b, atf_perf_counters_t *counters)
+{
+    PRE(!b->m_running);
+
+    b->m_counters = counters;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_bench_stats" type.
+ * --------------------------------------------------------------------- */
+
+/** Summarizes the given samples, which are sorted in place. */
+void
+atf_bench_stats_compute(atf_bench_stats_t *s, double *values,
+                        const size_t nvalues, const size_t iterations)
+{
+    double sum, sqsum;
+    size_t i;
+
+    PRE(nvalues > 0);
+
+    qsort(values, nvalues, sizeof(*values), compare_doubles);
+
+    sum = 0.0;
+    for (i = 0; i < nvalues; i++)
+        sum += values[i];
+
+    s->m_iterations = iterations;
+    s->m_samples = nvalues;
+    s->m_min = values[0];
+    s->m_median = atf_bench_stats_percentile(values, nvalues, 0.5);
+    s->m_p90 = atf_bench_stats_percentile(values, nvalues, 0.9);
+    s->m_p99 = atf_bench_stats_percentile(values, nvalues, 0.99);
+    s->m_mean = sum / (double)nvalues;
+
+    sqsum = 0.0;
+    for (i = 0; i < nvalues; i++)
+        sqsum += (values[i] - s->m_mean) * (values[i] - s->m_mean);
+    s->m_stddev = nvalues > 1 ? sqrt(sqsum / (double)(nvalues - 1)) : 0.0;
+}
+
+/** Computes a percentile of sorted values.
+ *
+ * Interpolates linearly between the closest ranks, so the result of an
+ * odd number of values for the 0.5 fraction is their middle one.
+ */
+double
+atf_bench_stats_percentile(const double *sorted, const size_t nvalues,
+                           const double fraction)
+{
+    double pos, lowfrac;
+    size_t low;
+
+    PRE(nvalues > 0);
+    PRE(fraction >= 0.0 && fraction <= 1.0);
+
+    pos = fraction * (double)(nvalues - 1);
+    low = (size_t)pos;
+    if (low + 1 >= nvalues)
+        return sorted[nvalues - 1];
+    lowfrac = pos - (double)low;
+    return sorted[low] + (sorted[low + 1] - sorted[low]) * lowfrac;
+}
+
+/** Appends the record of a benchmark to a string.
+ *
+ * The record has one 'key: value' line per statistic, in nanoseconds per
+ * iteration, and ends with the sorted times of all the samples.
+ */
+atf_error_t
+atf_bench_stats_format(const atf_bench_stats_t *s, const char *name,
+                       const double *sorted, atf_dynstr_t *out)
+{
+    atf_error_t err;
+    size_t i;
+
+    err = atf_dynstr_append_fmt(out,
+        "benchmark: %s\n"
+        "iterations: %zu\n"
+        "samples: %zu\n"
+        "min: %.3f\n"
+        "median: %.3f\n"
+        "p90: %.3f\n"
+        "p99: %.3f\n"
+        "mean: %.3f\n"
+        "stddev: %.3f\n"
+        "values:",
+        name, s->m_iterations, s->m_samples, s->m_min, s->m_median,
+        s->m_p90, s->m_p99, s->m_mean, s->m_stddev);
+    for (i = 0; i < s->m_samples && !atf_is_error(err); i++)
+        err = atf_dynstr_append_fmt(out, " %.3f", sorted[i]);
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(out, "\n");
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Locates the running test program given its argv[0].
+ *
+ * Only done if benchmarks are compared with a baseline, and before any
+ * body runs, as bodies may change the working directory.
+ */
+void
+atf_bench_set_program(const char *argv0)
+{
+    atf_error_t err;
+    atf_fs_path_t binary;
+    bool found;
+
+    if (env_value("ATF_BENCH_BASELINE") == NULL)
+        return;
+
+    err = atf_binary_find(argv0, &binary, &found);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        return;
+    }
+    if (found) {
+        free(Bench_program);
+        Bench_program = strdup(atf_fs_path_cstring(&binary));
+        atf_fs_path_fini(&binary);
+    }
+}
+
+/** Gets ready for the loops of the body of a test case.
+ *
+ * The records go to the given file, after removing the records of a
+ * previous run if requested, or to stderr if the file is NULL.  Otherwise,
+ * a run that fails before completing its first loop would leave stale
+ * measurements behind.
+ */
+atf_error_t
+atf_bench_body_init(const char *file, const bool clear,
+                    atf_bench_fail_t fail, void *data)
+{
+    char *copy;
+
+    PRE(!Bench_running);
+
+    if (file == NULL)
+        copy = NULL;
+    else {
+        copy = strdup(file);
+        if (copy == NULL)
+            return atf_no_memory_error();
+    }
+    free(Bench_output);
+    Bench_output = copy;
+    Bench_output_started = false;
+    Bench_records = 0;
+    Bench_fail = fail;
+    Bench_fail_data = data;
+
+    if (clear && file != NULL && unlink(file) == -1 && errno != ENOENT)
+        fprintf(stderr, "WARNING: Cannot remove %s: %s\n", file,
+                strerror(errno));
+    return atf_no_error();
+}
+
+/** Checks whether a loop of the body is running. */
+bool
+atf_bench_body_running(void)
+{
+
+    return Bench_running;
+}
+
+/** Gets the number of loops that the body completed. */
+size_t
+atf_bench_body_records(void)
+{
+
+    return Bench_records;
+}
+
+/** Gets the statistics of the last loop that the body completed. */
+const atf_bench_stats_t *
+atf_bench_body_last(void)
+{
+
+    PRE(Bench_records > 0);
+    return &Bench_last;
+}
+
+/** Starts a loop of the body, setting up the process on the first one. */
+atf_error_t
+atf_bench_body_start(const atf_bench_params_t *params)
+{
+    atf_error_t err;
+
+    PRE(Bench_fail != NULL);
+    PRE(!Bench_running);
+
+    if (!Bench_prepared) {
+        err = prepare();
+        if (atf_is_error(err))
+            return err;
+    }
+
+    err = atf_bench_init(&Bench, params->m_samples, params->m_warmup,
+                         params->m_batch_nsec);
+    if (atf_is_error(err))
+        return err;
+    Bench_max_regression = params->m_max_regression;
+    atf_perf_counters_reset(&Bench_counters);
+    atf_bench_set_counters(&Bench, &Bench_counters);
+    Bench_running = true;
+    return atf_no_error();
+}
+
+/** Ends the running batch of the loop and starts the next one.
+ *
+ * Sets more to false once the loop took all its samples, after writing
+ * their statistics in a record named after ident.
+ */
+atf_error_t
+atf_bench_body_batch(const char *ident, size_t *iterations, bool *more)
+{
+    atf_error_t err;
+
+    PRE(Bench_running);
+
+    *more = atf_bench_next(&Bench, iterations);
+    if (*more)
+        return atf_no_error();
+
+    err = write_record(ident);
+    atf_bench_fini(&Bench);
+    Bench_running = false;
+    Bench_records++;
+    free(Bench_label);
+    Bench_label = NULL;
+    return err;
+}
+
+/** Names the record of the next loop to complete. */
+atf_error_t
+atf_bench_body_label(const char *label)
+{
+    char *copy;
+
+    copy = strdup(label);
+    if (copy == NULL)
+        return atf_no_memory_error();
+    free(Bench_label);
+    Bench_label = copy;
+    return atf_no_error();
+}
+
+/** Outputs a record along with those of the loops of the body.
+ *
+ * The record goes after the previous ones of the body.  As with the
+ * statistics of the checks, problems are only reported as warnings.
+ */
+void
+atf_bench_body_report(const char *record)
+{
+    FILE *f;
+
+    if (Bench_output == NULL) {
+        fprintf(stderr, "%s", record);
+        return;
+    }
+
+    f = fopen(Bench_output, Bench_output_started ? "a" : "w");
+    if (f == NULL) {
+        fprintf(stderr, "WARNING: Cannot create %s: %s\n", Bench_output,
+                strerror(errno));
+    } else {
+        fprintf(f, "%s", record);
+        if (ferror(f) || fclose(f) == EOF)
+            fprintf(stderr, "WARNING: Cannot write %s\n", Bench_output);
+    }
+    Bench_output_started = true;
+}
@@ -0,0 +1,128 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_BENCH_H)
+#define ATF_C_DETAIL_BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <atf-c/detail/dynstr.h>
+#include <atf-c/detail/perf.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_bench" type.
+ * --------------------------------------------------------------------- */
+
+/* The measurement of a piece of code run in batches of iterations.  The
+ * first batches calibrate the number of iterations so that a batch takes
+ * at least a target time, the next ones warm up caches and branch
+ * predictors and the rest are the samples, each of which yields the time
+ * per iteration of its batch. */
+struct atf_bench {
+    int m_state;
+    size_t m_iterations;
+    size_t m_warmup;
+    int64_t m_batch_nsec;
+    double *m_values;
+    size_t m_nvalues;
+    size_t m_maxvalues;
+    bool m_running;
+    struct timespec m_start;
+    atf_perf_counters_t *m_counters;
+};
+typedef struct atf_bench atf_bench_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_bench_init(atf_bench_t *, const size_t, const size_t,
+                           const int64_t);
+void atf_bench_fini(atf_bench_t *);
+
+/* Getters. */
+bool atf_bench_done(const atf_bench_t *);
+
+/* Modifiers. */
+bool atf_bench_next(atf_bench_t *, size_t *);
+void atf_bench_record(atf_bench_t *, const int64_t);
+void atf_bench_set_counters(atf_bench_t *, atf_perf_counters_t *);
+
+/* ---------------------------------------------------------------------
+ * The "atf_bench_stats" type.
+ * --------------------------------------------------------------------- */
+
+/* Summary of the times per iteration of the samples, in nanoseconds. */
+struct atf_bench_stats {
+    size_t m_iterations;
+    size_t m_samples;
+    double m_min;
+    double m_median;
+    double m_p90;
+    double m_p99;
+    double m_mean;
+    double m_stddev;
+};
+typedef struct atf_bench_stats atf_bench_stats_t;
+
+void atf_bench_stats_compute(atf_bench_stats_t *, double *, const size_t,
+                             const size_t);
+double atf_bench_stats_percentile(const double *, const size_t,
+                                  const double);
+atf_error_t atf_bench_stats_format(const atf_bench_stats_t *, const char *,
+                                   const double *, atf_dynstr_t *);
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/* The benchmark loops of the body of the running test case.  Problems that
+ * do not stop a loop are passed to the failure function along with its
+ * data; the function owns the reason, which it must free. */
+typedef void (*atf_bench_fail_t)(void *, atf_dynstr_t *);
+
+/* How to measure a loop, as given by the properties of the test case.  A
+ * negative maximum regression never fails the comparisons. */
+struct atf_bench_params {
+    size_t m_samples;
+    size_t m_warmup;
+    int64_t m_batch_nsec;
+    long m_max_regression;
+};
+typedef struct atf_bench_params atf_bench_params_t;
+
+void atf_bench_set_program(const char *);
+atf_error_t atf_bench_body_init(const char *, const bool, atf_bench_fail_t,
+                                void *);
+bool atf_bench_body_running(void);
+size_t atf_bench_body_records(void);
+const atf_bench_stats_t *atf_bench_body_last(void);
+atf_error_t atf_bench_body_start(const atf_bench_params_t *);
+atf_error_t atf_bench_body_batch(const char *, size_t *, bool *);
+atf_error_t atf_bench_body_label(const char *);
+void atf_bench_body_report(const char *);
+
+#endif /* !defined(ATF_C_DETAIL_BENCH_H) */
@@ -0,0 +1,242 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/bench.h"
+
+#include <string.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+
+/* Compares computed values without depending on their last bits. */
+#define CHECK_NEAR(expected, actual) \
+    ATF_CHECK((actual) > (expected) - 0.001 && \
+              (actual) < (expected) + 0.001)
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_bench" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(record_phases);
+ATF_TC_BODY(record_phases, tc)
+{
+    atf_bench_t b;
+
+    RE(atf_bench_init(&b, 3, 1, 1000));
+    ATF_CHECK_EQ(1, b.m_iterations);
+
+    /* Calibration: 1.4 times the target over the measured time. */
+    atf_bench_record(&b, 250);
+    ATF_CHECK_EQ(5, b.m_iterations);
+    atf_bench_record(&b, 1400);
+    ATF_CHECK_EQ(5, b.m_iterations);
+
+    /* Warmup: not sampled. */
+    atf_bench_record(&b, 1000000);
+    ATF_CHECK_EQ(0, b.m_nvalues);
+
+    atf_bench_record(&b, 500);
+    atf_bench_record(&b, 1000);
+    ATF_CHECK(!atf_bench_done(&b));
+    atf_bench_record(&b, 250);
+    ATF_CHECK(atf_bench_done(&b));
+
+    ATF_REQUIRE_EQ(3, b.m_nvalues);
+    CHECK_NEAR(100.0, b.m_values[0]);
+    CHECK_NEAR(200.0, b.m_values[1]);
+    CHECK_NEAR(50.0, b.m_values[2]);
+    ATF_CHECK_EQ(5, b.m_iterations);
+
+    atf_bench_fini(&b);
+}
+
+ATF_TC_WITHOUT_HEAD(record_no_warmup);
+ATF_TC_BODY(record_no_warmup, tc)
+{
+    atf_bench_t b;
+
+    RE(atf_bench_init(&b, 1, 0, 1000));
+    atf_bench_record(&b, 5000);
+    ATF_CHECK_EQ(0, b.m_nvalues);
+    atf_bench_record(&b, 3000);
+    ATF_CHECK(atf_bench_done(&b));
+    ATF_REQUIRE_EQ(1, b.m_nvalues);
+    CHECK_NEAR(3000.0, b.m_values[0]);
+    atf_bench_fini(&b);
+}
+
+ATF_TC_WITHOUT_HEAD(record_growth_bounds);
+ATF_TC_BODY(record_growth_bounds, tc)
+{
+    atf_bench_t b;
+    size_t previous;
+
+    RE(atf_bench_init(&b, 1, 0, 1000000000));
+
+    /* Grows by at most 100 times per batch, even if it took no time. */
+    atf_bench_record(&b, 0);
+    ATF_CHECK_EQ(100, b.m_iterations);
+
+    /* Grows by at least 2 times per batch. */
+    atf_bench_record(&b, 999999999);
+    ATF_CHECK_EQ(200, b.m_iterations);
+
+    /* Stops calibrating at the maximum count, however fast the code. */
+    do {
+        previous = b.m_iterations;
+        atf_bench_record(&b, 1);
+    } while (b.m_iterations > previous);
+    ATF_CHECK_EQ((size_t)1 << 30, b.m_iterations);
+    atf_bench_record(&b, 1);
+    ATF_CHECK(atf_bench_done(&b));
+
+    atf_bench_fini(&b);
+}
+
+ATF_TC_WITHOUT_HEAD(next);
+ATF_TC_BODY(next, tc)
+{
+    atf_bench_t b;
+    size_t batches, iterations;
+
+    RE(atf_bench_init(&b, 5, 2, 1000));
+
+    batches = 0;
+    while (atf_bench_next(&b, &iterations)) {
+        ATF_REQUIRE(iterations > 0);
+        ATF_REQUIRE(++batches < 100);
+    }
+    ATF_CHECK(atf_bench_done(&b));
+    ATF_CHECK(batches >= 5 + 2 + 1);
+    ATF_CHECK_EQ(5, b.m_nvalues);
+    ATF_CHECK(!atf_bench_next(&b, &iterations));
+
+    atf_bench_fini(&b);
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_bench_stats" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(stats_percentile);
+ATF_TC_BODY(stats_percentile, tc)
+{
+    const double odd[] = { 1.0, 2.0, 3.0, 4.0, 5.0 };
+    const double even[] = { 10.0, 20.0 };
+    const double single[] = { 7.0 };
+
+    CHECK_NEAR(1.0, atf_bench_stats_percentile(odd, 5, 0.0));
+    CHECK_NEAR(3.0, atf_bench_stats_percentile(odd, 5, 0.5));
+    CHECK_NEAR(4.6, atf_bench_stats_percentile(odd, 5, 0.9));
+    CHECK_NEAR(5.0, atf_bench_stats_percentile(odd, 5, 1.0));
+
+    CHECK_NEAR(15.0, atf_bench_stats_percentile(even, 2, 0.5));
+    CHECK_NEAR(19.9, atf_bench_stats_percentile(even, 2, 0.99));
+
+    CHECK_NEAR(7.0, atf_bench_stats_percentile(single, 1, 0.0));
+    CHECK_NEAR(7.0, atf_bench_stats_percentile(single, 1, 0.99));
+}
+
+ATF_TC_WITHOUT_HEAD(stats_compute);
+ATF_TC_BODY(stats_compute, tc)
+{
+    double values[] = { 4.0, 2.0, 1.0, 3.0 };
+    atf_bench_stats_t s;
+
+    atf_bench_stats_compute(&s, values, 4, 128);
+
+    CHECK_NEAR(1.0, values[0]);
+    CHECK_NEAR(2.0, values[1]);
+    CHECK_NEAR(3.0, values[2]);
+    CHECK_NEAR(4.0, values[3]);
+
+    ATF_CHECK_EQ(128, s.m_iterations);
+    ATF_CHECK_EQ(4, s.m_samples);
+    CHECK_NEAR(1.0, s.m_min);
+    CHECK_NEAR(2.5, s.m_median);
+    CHECK_NEAR(3.7, s.m_p90);
+    CHECK_NEAR(3.97, s.m_p99);
+    CHECK_NEAR(2.5, s.m_mean);
+    CHECK_NEAR(1.291, s.m_stddev);
+}
+
+ATF_TC_WITHOUT_HEAD(stats_compute_single);
+ATF_TC_BODY(stats_compute_single, tc)
+{
+    double values[] = { 42.0 };
+    atf_bench_stats_t s;
+
+    atf_bench_stats_compute(&s, values, 1, 1);
+    CHECK_NEAR(42.0, s.m_min);
+    CHECK_NEAR(42.0, s.m_median);
+    CHECK_NEAR(42.0, s.m_p99);
+    CHECK_NEAR(0.0, s.m_stddev);
+}
+
+ATF_TC_WITHOUT_HEAD(stats_format);
+ATF_TC_BODY(stats_format, tc)
+{
+    double values[] = { 2.0, 1.0 };
+    atf_bench_stats_t s;
+    atf_dynstr_t out;
+
+    atf_bench_stats_compute(&s, values, 2, 10);
+    RE(atf_dynstr_init(&out));
+    RE(atf_bench_stats_format(&s, "the-name", values, &out));
+
+    ATF_CHECK_STREQ(
+        "benchmark: the-name\n"
+        "iterations: 10\n"
+        "samples: 2\n"
+        "min: 1.000\n"
+        "median: 1.500\n"
+        "p90: 1.900\n"
+        "p99: 1.990\n"
+        "mean: 1.500\n"
+        "stddev: 0.707\n"
+        "values: 1.000 2.000\n",
+        atf_dynstr_cstring(&out));
+
+    atf_dynstr_fini(&out);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, record_phases);
+    ATF_TP_ADD_TC(tp, record_no_warmup);
+    ATF_TP_ADD_TC(tp, record_growth_bounds);
+    ATF_TP_ADD_TC(tp, next);
+    ATF_TP_ADD_TC(tp, stats_percentile);
+    ATF_TP_ADD_TC(tp, stats_compute);
+    ATF_TP_ADD_TC(tp, stats_compute_single);
+    ATF_TP_ADD_TC(tp, stats_format);
+
+    return atf_no_error();
+}
@@ -0,0 +1,601 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "atf-c/detail/binary.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(HAVE_ELF_H)
+#include <elf.h>
+#endif
+#if defined(HAVE_DL_ITERATE_PHDR)
+#include <link.h>
+#endif
+
+#include "atf-c/defs.h"
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/hash.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+#if defined(HAVE_ELF_H) && !defined(NT_GNU_BUILD_ID)
+#define NT_GNU_BUILD_ID 3
+#endif
+
+/* ---------------------------------------------------------------------
+ * The "binary" error type.
+ * --------------------------------------------------------------------- */
+
+struct binary_error_data {
+    char m_reason[1024];
+};
+typedef struct binary_error_data binary_error_data_t;
+
+static
+void
+binary_format(const atf_error_t err, char *buf, size_t buflen)
+{
+    const binary_error_data_t *data;
+
+    PRE(atf_error_is(err, "binary"));
+
+    data = atf_error_data(err);
+    snprintf(buf, buflen, "Invalid binary %s",
+             data->m_reason);
+}
+
+static
+atf_error_t
+binary_error(const char *fmt, ...)
+{
+    atf_error_t err;
+    binary_error_data_t data;
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(data.m_reason, sizeof(data.m_reason), fmt, ap);
+    va_end(ap);
+
+    err = atf_error_new("binary", &data, sizeof(data), binary_format);
+
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+atf_error_t
+read_at(const int fd, const char *path, const off_t offset, void *buf,
+        const size_t len)
+{
+    size_t done;
+
+    done = 0;
+    while (done < len) {
+        const ssize_t n = pread(fd, (char *)buf + done, len - done,
+                                offset + (off_t)done);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            return atf_libc_error(errno, "Cannot read %s", path);
+        } else if (n == 0)
+            return binary_error("%s: Truncated file", path);
+        done += (size_t)n;
+    }
+    return atf_no_error();
+}
+
+#if defined(HAVE_ELF_H)
+/* The fields we care about of an ELF section header, in native form
+ * regardless of the class of the file. */
+struct shdr {
+    uint32_t m_name;
+    uint32_t m_type;
+    uint64_t m_offset;
+    uint64_t m_size;
+    uint32_t m_link;
+};
+
+struct elf {
+    int m_fd;
+    const char *m_path;
+    bool m_is64;
+    uint64_t m_shoff;
+    uint16_t m_shentsize;
+    uint64_t m_shnum;
+    uint64_t m_shstrndx;
+};
+
+static
+bool
+is_native_byte_order(const unsigned char data)
+{
+    const uint16_t probe = 1;
+
+    if (*(const unsigned char *)&probe == 1)
+        return data == ELFDATA2LSB;
+    else
+        return data == ELFDATA2MSB;
+}
+
+static
+atf_error_t
+read_shdr(const struct elf *e, const uint64_t index, struct shdr *sh)
+{
+    atf_error_t err;
+    const off_t offset = (off_t)(e->m_shoff + index * e->m_shentsize);
+
+    if (e->m_is64) {
+        Elf64_Shdr raw;
+
+        err = read_at(e->m_fd, e->m_path, offset, &raw, sizeof(raw));
+        if (!atf_is_error(err)) {
+            sh->m_name = raw.sh_name;
+            sh->m_type = raw.sh_type;
+            sh->m_offset = raw.sh_offset;
+            sh->m_size = raw.sh_size;
+            sh->m_link = raw.sh_link;
+        }
+    } else {
+        Elf32_Shdr raw;
+
+        err = read_at(e->m_fd, e->m_path, offset, &raw, sizeof(raw));
+        if (!atf_is_error(err)) {
+            sh->m_name = raw.sh_name;
+            sh->m_type = raw.sh_type;
+            sh->m_offset = raw.sh_offset;
+            sh->m_size = raw.sh_size;
+            sh->m_link = raw.sh_link;
+        }
+    }
+    return err;
+}
+
+/* Loads the ELF header of the file.  Sets is_elf to false if the file is
+ * not an ELF file we can process, which is not an error. */
+static
+atf_error_t
+load_elf(struct elf *e, bool *is_elf)
+{
+    atf_error_t err;
+    unsigned char ident[EI_NIDENT];
+    ssize_t n;
+
+    *is_elf = false;
+
+    n = pread(e->m_fd, ident, sizeof(ident), 0);
+    if (n == -1)
+        return atf_libc_error(errno, "Cannot read %s", e->m_path);
+    if ((size_t)n < sizeof(ident) || memcmp(ident, ELFMAG, SELFMAG) != 0 ||
+        !is_native_byte_order(ident[EI_DATA]))
+        return atf_no_error();
+
+    if (ident[EI_CLASS] == ELFCLASS64) {
+        Elf64_Ehdr eh;
+
+        err = read_at(e->m_fd, e->m_path, 0, &eh, sizeof(eh));
+        if (atf_is_error(err))
+            return err;
+        e->m_is64 = true;
+        e->m_shoff = eh.e_shoff;
+        e->m_shentsize = eh.e_shentsize;
+        e->m_shnum = eh.e_shnum;
+        e->m_shstrndx = eh.e_shstrndx;
+        if (e->m_shoff != 0 && e->m_shentsize < sizeof(Elf64_Shdr))
+            return binary_error("%s: Invalid section header size", e->m_path);
+    } else if (ident[EI_CLASS] == ELFCLASS32) {
+        Elf32_Ehdr eh;
+
+        err = read_at(e->m_fd, e->m_path, 0, &eh, sizeof(eh));
+        if (atf_is_error(err))
+            return err;
+        e->m_is64 = false;
+        e->m_shoff = eh.e_shoff;
+        e->m_shentsize = eh.e_shentsize;
+        e->m_shnum = eh.e_shnum;
+        e->m_shstrndx = eh.e_shstrndx;
+        if (e->m_shoff != 0 && e->m_shentsize < sizeof(Elf32_Shdr))
+            return binary_error("%s: Invalid section header size", e->m_path);
+    } else
+        return atf_no_error();
+
+    /* Files with many sections keep the real counts in the first section
+     * header. */
+    if (e->m_shoff != 0 &&
+        (e->m_shnum == 0 || e->m_shstrndx == SHN_XINDEX)) {
+        struct shdr first;
+
+        err = read_shdr(e, 0, &first);
+        if (atf_is_error(err))
+            return err;
+        if (e->m_shnum == 0)
+            e->m_shnum = first.m_size;
+        if (e->m_shstrndx == SHN_XINDEX)
+            e->m_shstrndx = first.m_link;
+    }
+
+    *is_elf = true;
+    return atf_no_error();
+}
+
+static
+atf_error_t
+find_section(const int fd, const char *path, const char *name,
+             struct shdr *section, bool *found)
+{
+    atf_error_t err;
+    struct elf e;
+    struct shdr strtab;
+    char *names;
+    bool is_elf;
+    uint64_t i;
+
+    *found = false;
+
+    e.m_fd = fd;
+    e.m_path = path;
+    err = load_elf(&e, &is_elf);
+    if (atf_is_error(err) || !is_elf || e.m_shoff == 0)
+        return err;
+
+    if (e.m_shstrndx >= e.m_shnum)
+        return binary_error("%s: Invalid section name table index", path);
+    err = read_shdr(&e, e.m_shstrndx, &strtab);
+    if (atf_is_error(err))
+        return err;
+    if (strtab.m_size == 0 || strtab.m_size > SIZE_MAX - 1)
+        return binary_error("%s: Invalid section name table", path);
+
+    names = malloc((size_t)strtab.m_size + 1);
+    if (names == NULL)
+        return atf_no_memory_error();
+    err = read_at(fd, path, (off_t)strtab.m_offset, names,
+                  (size_t)strtab.m_size);
+    if (atf_is_error(err))
+        goto out;
+    names[strtab.m_size] = '\0';
+
+    for (i = 0; i < e.m_shnum && !*found; i++) {
+        struct shdr sh;
+
+        err = read_shdr(&e, i, &sh);
+        if (atf_is_error(err))
+            break;
+
+        if (sh.m_name < strtab.m_size && sh.m_type != SHT_NOBITS &&
+            strcmp(names + sh.m_name, name) == 0) {
+            *section = sh;
+            *found = true;
+        }
+    }
+
+out:
+    free(names);
+    return err;
+}
+#else /* !defined(HAVE_ELF_H) */
+struct shdr {
+    uint64_t m_offset;
+    uint64_t m_size;
+};
+
+static
+atf_error_t
+find_section(const int fd ATF_DEFS_ATTRIBUTE_UNUSED,
+             const char *path ATF_DEFS_ATTRIBUTE_UNUSED,
+             const char *name ATF_DEFS_ATTRIBUTE_UNUSED,
+             struct shdr *section ATF_DEFS_ATTRIBUTE_UNUSED, bool *found)
+{
+    *found = false;
+    return atf_no_error();
+}
+#endif /* defined(HAVE_ELF_H) */
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Reads the contents of a section of a binary.
+ *
+ * On success, and if found is set to true, buf points to a NUL-terminated
+ * copy of the section that the caller must release with free.  found is
+ * set to false, without raising an error, if the file is not an ELF file
+ * of the native byte order or if it lacks the section.
+ */
+atf_error_t
+atf_binary_read_section(const char *path, const char *name, char **buf,
+                        size_t *len, bool *found)
+{
+    atf_error_t err;
+    struct shdr section;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return atf_libc_error(errno, "Cannot open %s", path);
+
+    memset(&section, 0, sizeof(section)); /* Silence GCC warning. */
+    err = find_section(fd, path, name, &section, found);
+    if (atf_is_error(err) || !*found)
+        goto out;
+
+    if (section.m_size >= SIZE_MAX) {
+        err = binary_error("%s: Section %s too large", path, name);
+        goto out;
+    }
+    *buf = malloc((size_t)section.m_size + 1);
+    if (*buf == NULL) {
+        err = atf_no_memory_error();
+        goto out;
+    }
+
+    err = read_at(fd, path, (off_t)section.m_offset, *buf,
+                  (size_t)section.m_size);
+    if (atf_is_error(err)) {
+        free(*buf);
+        goto out;
+    }
+    (*buf)[section.m_size] = '\0';
+    *len = (size_t)section.m_size;
+
+out:
+    close(fd);
+    return err;
+}
+
+/** Gets the build identifier that the linker recorded in a binary.
+ *
+ * Initializes id to the identifier in hexadecimal form, or to the empty
+ * string if the binary lacks one.
+ */
+atf_error_t
+atf_binary_build_id(const char *path, atf_dynstr_t *id)
+{
+    atf_error_t err;
+    char *buf;
+    size_t len, pos;
+    bool found;
+
+    err = atf_dynstr_init(id);
+    if (atf_is_error(err))
+        return err;
+
+    err = atf_binary_read_section(path, ".note.gnu.build-id", &buf, &len,
+                                  &found);
+    if (atf_is_error(err) || !found)
+        goto out;
+
+#if defined(HAVE_ELF_H)
+    /* Notes have the same layout in 32- and 64-bit files. */
+    pos = 0;
+    while (pos <= len && len - pos >= sizeof(Elf32_Nhdr)) {
+        Elf32_Nhdr nhdr;
+        size_t name, desc;
+
+        memcpy(&nhdr, buf + pos, sizeof(nhdr));
+        name = pos + sizeof(nhdr);
+        desc = name + ((nhdr.n_namesz + 3) & ~(size_t)3);
+        if (desc > len || len - desc < nhdr.n_descsz)
+            break;
+
+        if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == 4 &&
+            memcmp(buf + name, "GNU", 4) == 0) {
+            size_t i;
+
+            for (i = 0; i < nhdr.n_descsz && !atf_is_error(err); i++)
+                err = atf_dynstr_append_fmt(id, "%02x",
+                    (unsigned int)(unsigned char)buf[desc + i]);
+            break;
+        }
+
+        pos = desc + ((nhdr.n_descsz + 3) & ~(size_t)3);
+    }
+#else
+    pos = len; /* Silence GCC warning. */
+#endif
+
+    free(buf);
+out:
+    if (atf_is_error(err))
+        atf_dynstr_fini(id);
+    return err;
+}
+
+/** Locates the binary of the running program.
+ *
+ * The binary is not necessarily argv0 because the program may have been
+ * found through the PATH.  found is set to false if the binary cannot be
+ * located; otherwise, binary is initialized to its absolute path.
+ */
+atf_error_t
+atf_binary_find(const char *argv0, atf_fs_path_t *binary, bool *found)
+{
+    atf_error_t err;
+    char *real;
+
+    *found = false;
+    if (access("/proc/self/exe", F_OK) == 0)
+        real = realpath("/proc/self/exe", NULL);
+    else if (strchr(argv0, '/') != NULL)
+        real = realpath(argv0, NULL);
+    else
+        return atf_no_error();
+    if (real == NULL)
+        return atf_libc_error(errno, "Cannot locate the test program");
+
+    err = atf_fs_path_init_fmt(binary, "%s", real);
+    if (!atf_is_error(err))
+        *found = true;
+    free(real);
+    return err;
+}
+
+/** Computes a hash that changes whenever a binary is rebuilt.
+ *
+ * The hash covers the build identifier of the binary, if it has one, and
+ * the attributes that change when it is rebuilt in place.
+ */
+atf_error_t
+atf_binary_identity(const atf_fs_path_t *binary, uint64_t *identity)
+{
+    atf_error_t err;
+    atf_dynstr_t build_id;
+    struct stat sb;
+    uint64_t hash;
+    int64_t value;
+
+    if (stat(atf_fs_path_cstring(binary), &sb) == -1)
+        return atf_libc_error(errno, "Cannot get information of %s",
+                              atf_fs_path_cstring(binary));
+
+    err = atf_binary_build_id(atf_fs_path_cstring(binary), &build_id);
+    if (atf_is_error(err))
+        return err;
+
+    hash = atf_hash_string(ATF_HASH_INIT, PACKAGE_VERSION);
+    hash = atf_hash_string(hash, atf_dynstr_cstring(&build_id));
+    value = (int64_t)sb.st_dev;
+    hash = atf_hash_bytes(hash, &value, sizeof(value));
+    value = (int64_t)sb.st_ino;
+    hash = atf_hash_bytes(hash, &value, sizeof(value));
+    value = (int64_t)sb.st_size;
+    hash = atf_hash_bytes(hash, &value, sizeof(value));
+    value = (int64_t)sb.st_mtime;
+    hash = atf_hash_bytes(hash, &value, sizeof(value));
+    *identity = hash;
+
+    atf_dynstr_fini(&build_id);
+    return atf_no_error();
+}
+
+#if defined(HAVE_DL_ITERATE_PHDR)
+static
+int
+hash_loaded_object(struct dl_phdr_info *info,
+                   size_t size ATF_DEFS_ATTRIBUTE_UNUSED, void *data)
+{
+    uint64_t *hash = data;
+    struct stat sb;
+    int64_t value;
+
+    /* The running binary has an empty name. */
+    if (info->dlpi_name == NULL || info->dlpi_name[0] == '\0')
+        return 0;
+
+    *hash = atf_hash_string(*hash, info->dlpi_name);
+    if (stat(info->dlpi_name, &sb) == -1)
+        return 0;
+    value = (int64_t)sb.st_dev;
+    *hash = atf_hash_bytes(*hash, &value, sizeof(value));
+    value = (int64_t)sb.st_ino;
+    *hash = atf_hash_bytes(*hash, &value, sizeof(value));
+    value = (int64_t)sb.st_size;
+    *hash = atf_hash_bytes(*hash, &value, sizeof(value));
+    value = (int64_t)sb.st_mtime;
+    *hash = atf_hash_bytes(*hash, &value, sizeof(value));
+    return 0;
+}
+#endif
+
+/** Computes a hash of the shared objects loaded by the running program.
+ *
+ * The hash covers the path of every object and the attributes that change
+ * when it is rebuilt or replaced, in load order, so that it changes when
+ * the program would run different code without its binary changing.
+ * Objects without a file, such as the vDSO, only contribute their names.
+ * Platforms without dl_iterate_phdr(3) always yield the same value, in
+ * which case the shared objects are not covered.
+ */
+uint64_t
+atf_binary_loaded_identity(void)
+{
+    uint64_t hash = ATF_HASH_INIT;
+
+#if defined(HAVE_DL_ITERATE_PHDR)
+    (void)dl_iterate_phdr(hash_loaded_object, &hash);
+#endif
+    return hash;
+}
+
+/** Computes the path of a file that caches data about a binary.
+ *
+ * The file lives in dir, which is taken from the directory of the binary
+ * if relative, and is named after the binary followed by the hash of its
+ * full path, which tells apart binaries with the same name that share the
+ * directory, and by suffix.
+ */
+atf_error_t
+atf_binary_cache_file(const atf_fs_path_t *binary, const char *dir,
+                      const char *suffix, atf_fs_path_t *file)
+{
+    atf_error_t err;
+    atf_dynstr_t leaf;
+
+    if (dir[0] == '/')
+        err = atf_fs_path_init_fmt(file, "%s", dir);
+    else {
+        err = atf_fs_path_branch_path(binary, file);
+        if (!atf_is_error(err))
+            err = atf_fs_path_append_fmt(file, "%s", dir);
+    }
+    if (atf_is_error(err))
+        return err;
+
+    err = atf_fs_path_leaf_name(binary, &leaf);
+    if (atf_is_error(err))
+        goto err_file;
+
+    err = atf_fs_path_append_fmt(file, "%s-%016" PRIx64 "%s",
+                                 atf_dynstr_cstring(&leaf),
+                                 atf_hash_string(ATF_HASH_INIT,
+                                                 atf_fs_path_cstring(binary)),
+                                 suffix);
+    atf_dynstr_fini(&leaf);
+    if (atf_is_error(err))
+        goto err_file;
+
+    return atf_no_error();
+
+err_file:
+    atf_fs_path_fini(file);
+    return err;
+}
@@ -0,0 +1,214 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/binary.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/hash.h"
+#include "atf-c/detail/test_helpers.h"
+#include "atf-c/utils.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+bool
+contains(const char *buf, const size_t len, const char *str)
+{
+    const size_t strlength = strlen(str);
+    size_t i;
+
+    for (i = 0; i + strlength <= len; i++)
+        if (memcmp(buf + i, str, strlength) == 0)
+            return true;
+    return false;
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(read_section);
+ATF_TC_HEAD(read_section, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_binary_read_section "
+                      "function");
+}
+ATF_TC_BODY(read_section, tc)
+{
+    char *buf;
+    size_t len;
+    bool found;
+
+    if (access("/proc/self/exe", R_OK) == -1)
+        atf_tc_skip("Cannot locate the test program binary");
+
+    RE(atf_binary_read_section("/proc/self/exe", ".atf-missing", &buf, &len,
+                               &found));
+    ATF_CHECK(!found);
+
+    RE(atf_binary_read_section("/proc/self/exe", "atf_tc_md", &buf, &len,
+                               &found));
+    if (!found)
+        atf_tc_skip("No test case meta-data support in this platform");
+    ATF_CHECK(len > 0);
+    ATF_CHECK(contains(buf, len, "read_section"));
+    ATF_CHECK_EQ(buf[len], '\0');
+    free(buf);
+}
+
+ATF_TC(read_section_not_elf);
+ATF_TC_HEAD(read_section_not_elf, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_binary_read_section "
+                      "does not find sections in files that are not "
+                      "binaries");
+}
+ATF_TC_BODY(read_section_not_elf, tc)
+{
+    char *buf;
+    size_t len;
+    bool found;
+
+    atf_utils_create_file("script", "#! /bin/sh\necho foo\n");
+    RE(atf_binary_read_section("script", "atf_tc_md", &buf, &len, &found));
+    ATF_CHECK(!found);
+
+    atf_utils_create_file("empty", "%s", "");
+    RE(atf_binary_read_section("empty", "atf_tc_md", &buf, &len, &found));
+    ATF_CHECK(!found);
+}
+
+ATF_TC(build_id);
+ATF_TC_HEAD(build_id, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_binary_build_id "
+                      "function");
+}
+ATF_TC_BODY(build_id, tc)
+{
+    atf_dynstr_t id;
+    const char *ptr;
+
+    if (access("/proc/self/exe", R_OK) == -1)
+        atf_tc_skip("Cannot locate the test program binary");
+
+    RE(atf_binary_build_id("/proc/self/exe", &id));
+    if (atf_dynstr_length(&id) == 0) {
+        atf_dynstr_fini(&id);
+        atf_tc_skip("The test program has no build identifier");
+    }
+    printf("Build identifier: %s\n", atf_dynstr_cstring(&id));
+    ATF_CHECK_EQ(atf_dynstr_length(&id) % 2, 0);
+    for (ptr = atf_dynstr_cstring(&id); *ptr != '\0'; ptr++)
+        ATF_CHECK(isxdigit((unsigned char)*ptr));
+    atf_dynstr_fini(&id);
+
+    atf_utils_create_file("script", "#! /bin/sh\necho foo\n");
+    RE(atf_binary_build_id("script", &id));
+    ATF_CHECK_EQ(atf_dynstr_length(&id), 0);
+    atf_dynstr_fini(&id);
+}
+
+ATF_TC(loaded_identity);
+ATF_TC_HEAD(loaded_identity, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the "
+                      "atf_binary_loaded_identity function covers the shared "
+                      "objects of the running program");
+}
+ATF_TC_BODY(loaded_identity, tc)
+{
+    const uint64_t identity = atf_binary_loaded_identity();
+
+    ATF_CHECK_EQ(identity, atf_binary_loaded_identity());
+    if (identity == ATF_HASH_INIT)
+        atf_tc_skip("Cannot list the shared objects of the test program");
+}
+
+ATF_TC(cache_file);
+ATF_TC_HEAD(cache_file, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_binary_cache_file "
+                      "function");
+}
+ATF_TC_BODY(cache_file, tc)
+{
+    atf_fs_path_t binary, binary2, file, path_file;
+    const char *path;
+
+    RE(atf_fs_path_init_fmt(&binary, "/some/dir/prog"));
+    RE(atf_fs_path_init_fmt(&binary2, "/other/dir/prog"));
+
+    RE(atf_binary_cache_file(&binary, "/cache", ".ext", &file));
+    path = atf_fs_path_cstring(&file);
+    printf("Cache file: %s\n", path);
+    ATF_CHECK_MATCH("^/cache/prog-[0-9a-f]{16}\\.ext$", path);
+    atf_fs_path_fini(&file);
+
+    RE(atf_binary_cache_file(&binary, "cache", "", &file));
+    path = atf_fs_path_cstring(&file);
+    printf("Cache file: %s\n", path);
+    ATF_CHECK_MATCH("^/some/dir/cache/prog-[0-9a-f]{16}$", path);
+    atf_fs_path_fini(&file);
+
+    RE(atf_binary_cache_file(&binary2, "cache", "", &file));
+    path = atf_fs_path_cstring(&file);
+    printf("Cache file: %s\n", path);
+    ATF_CHECK_MATCH("^/other/dir/cache/prog-[0-9a-f]{16}$", path);
+    atf_fs_path_fini(&file);
+
+    RE(atf_binary_cache_file(&binary, "/cache", "", &file));
+    RE(atf_binary_cache_file(&binary2, "/cache", "", &path_file));
+    ATF_CHECK(!atf_equal_fs_path_fs_path(&file, &path_file));
+    atf_fs_path_fini(&path_file);
+    atf_fs_path_fini(&file);
+
+    atf_fs_path_fini(&binary2);
+    atf_fs_path_fini(&binary);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, read_section);
+    ATF_TP_ADD_TC(tp, read_section_not_elf);
+    ATF_TP_ADD_TC(tp, build_id);
+    ATF_TP_ADD_TC(tp, loaded_identity);
+    ATF_TP_ADD_TC(tp, cache_file);
+
+    return atf_no_error();
+}
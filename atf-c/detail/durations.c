@@ -0,0 +1,446 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/durations.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/binary.h"
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/env.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+/* The history is rewritten with only the latest entry of every test case
+ * once it has at least this many lines and half of them are stale. */
+#define COMPACT_MIN_LINES 1024
+
+struct atf_durations_entry {
+    const char *m_program;
+    const char *m_ident;
+    int64_t m_usec;
+    size_t m_seq;
+};
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+int
+compare_keys(const void *v1, const void *v2)
+{
+    const struct atf_durations_entry *e1 = v1, *e2 = v2;
+    int cmp;
+
+    cmp = strcmp(e1->m_program, e2->m_program);
+    if (cmp != 0)
+        return cmp;
+    return strcmp(e1->m_ident, e2->m_ident);
+}
+
+/* Orders the entries by key and, for the same key, by their position in
+ * the history file. */
+static
+int
+compare_entries(const void *v1, const void *v2)
+{
+    const struct atf_durations_entry *e1 = v1, *e2 = v2;
+    int cmp;
+
+    cmp = compare_keys(e1, e2);
+    if (cmp != 0)
+        return cmp;
+    return e1->m_seq < e2->m_seq ? -1 : e1->m_seq > e2->m_seq;
+}
+
+/* Parses a "<usec> <ident> <program>" line, without its newline, in
+ * place.  The program is last because its path may have spaces.  Lines
+ * left incomplete by interrupted writers are rejected. */
+static
+bool
+parse_line(char *line, const size_t seq, struct atf_durations_entry *e)
+{
+    char *end;
+
+    errno = 0;
+    e->m_usec = strtoll(line, &end, 10);
+    if (errno != 0 || end == line || *end != ' ' || e->m_usec < 0)
+        return false;
+
+    e->m_ident = end + 1;
+    end = strchr(e->m_ident, ' ');
+    if (end == NULL || end == e->m_ident)
+        return false;
+    *end = '\0';
+
+    e->m_program = end + 1;
+    e->m_seq = seq;
+    return e->m_program[0] == '/';
+}
+
+/* Reads the whole history file into buf and parses its lines in place.
+ * A missing history is empty. */
+static
+atf_error_t
+read_history(const atf_fs_path_t *file, char **buf,
+             struct atf_durations_entry **entries, size_t *nentries)
+{
+    atf_error_t err;
+    struct stat sb;
+    char *line, *end;
+    size_t len, max;
+    FILE *f;
+
+    *buf = NULL;
+    *entries = NULL;
+    *nentries = 0;
+
+    f = fopen(atf_fs_path_cstring(file), "r");
+    if (f == NULL) {
+        if (errno == ENOENT)
+            return atf_no_error();
+        return atf_libc_error(errno, "Cannot open %s",
+                              atf_fs_path_cstring(file));
+    }
+
+    err = atf_no_error();
+    if (fstat(fileno(f), &sb) == -1) {
+        err = atf_libc_error(errno, "Cannot get information of %s",
+                             atf_fs_path_cstring(file));
+        goto out;
+    }
+
+    /* Every line takes at least five bytes. */
+    len = (size_t)sb.st_size;
+    max = len / 5 + 1;
+    *buf = malloc(len + 1);
+    *entries = malloc(sizeof(**entries) * max);
+    if (*buf == NULL || *entries == NULL) {
+        err = atf_no_memory_error();
+        goto out;
+    }
+    len = fread(*buf, 1, len, f);
+    (*buf)[len] = '\0';
+
+    for (line = *buf; *line != '\0'; line = end + 1) {
+        end = strchr(line, '\n');
+        if (end == NULL)
+            break;
+        *end = '\0';
+        if (*nentries < max &&
+            parse_line(line, *nentries, &(*entries)[*nentries]))
+            (*nentries)++;
+    }
+
+out:
+    if (atf_is_error(err)) {
+        free(*buf);
+        free(*entries);
+        *buf = NULL;
+        *entries = NULL;
+    }
+    fclose(f);
+    return err;
+}
+
+/* The entries to compact the history to, as given to write_entries. */
+struct compaction {
+    const struct atf_durations_entry *m_entries;
+    size_t m_nentries;
+};
+
+static
+atf_error_t
+write_entries(FILE *f, void *data)
+{
+    const struct compaction *c = data;
+    size_t i;
+
+    for (i = 0; i < c->m_nentries; i++)
+        fprintf(f, "%" PRId64 " %s %s\n", c->m_entries[i].m_usec,
+                c->m_entries[i].m_ident, c->m_entries[i].m_program);
+    return atf_no_error();
+}
+
+/* Replaces the history file with one that only has the given entries.
+ * Entries appended by other processes in the meantime are lost, which is
+ * harmless because the history is only advisory. */
+static
+atf_error_t
+compact(const atf_fs_path_t *file, const struct atf_durations_entry *entries,
+        const size_t nentries)
+{
+    struct compaction c;
+
+    c.m_entries = entries;
+    c.m_nentries = nentries;
+    return atf_fs_write_atomic(file, true, write_entries, &c);
+}
+
+/* Loads the latest entry of every test case of the program, compacting
+ * the history file if it has grown too much. */
+static
+atf_error_t
+load(atf_durations_t *d)
+{
+    atf_error_t err;
+    struct atf_durations_entry *entries;
+    size_t i, n, nlines;
+    char *buf;
+
+    err = read_history(&d->m_file, &buf, &entries, &nlines);
+    if (atf_is_error(err))
+        return err;
+
+    qsort(entries, nlines, sizeof(*entries), compare_entries);
+    n = 0;
+    for (i = 0; i < nlines; i++) {
+        if (i + 1 < nlines && compare_keys(&entries[i], &entries[i + 1]) == 0)
+            continue;
+        entries[n++] = entries[i];
+    }
+
+    if (nlines >= COMPACT_MIN_LINES && n <= nlines / 2) {
+        /* Another run will try again if this one cannot. */
+        err = compact(&d->m_file, entries, n);
+        if (atf_is_error(err))
+            atf_error_free(err);
+    }
+
+    d->m_nentries = 0;
+    for (i = 0; i < n; i++) {
+        if (strcmp(entries[i].m_program, d->m_program) != 0)
+            continue;
+        entries[d->m_nentries] = entries[i];
+        entries[d->m_nentries].m_program = d->m_program;
+        entries[d->m_nentries].m_ident = strdup(entries[i].m_ident);
+        if (entries[d->m_nentries].m_ident == NULL) {
+            err = atf_no_memory_error();
+            break;
+        }
+        d->m_nentries++;
+    }
+    d->m_entries = entries;
+    free(buf);
+
+    if (atf_is_error(err)) {
+        for (i = 0; i < d->m_nentries; i++)
+            free((char *)(uintptr_t)d->m_entries[i].m_ident);
+        free(d->m_entries);
+        d->m_entries = NULL;
+        d->m_nentries = 0;
+    }
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_durations" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+/** Initializes the duration history of the running program.
+ *
+ * The history is disabled, and all other methods become no-ops, unless
+ * the ATF_DURATIONS_FILE environment variable is set to a non-empty value
+ * and the binary of the program can be located.
+ */
+atf_error_t
+atf_durations_init(atf_durations_t *d, const char *argv0)
+{
+    atf_error_t err;
+    atf_fs_path_t binary;
+    bool found;
+
+    d->m_enabled = false;
+    d->m_entries = NULL;
+    d->m_nentries = 0;
+
+    if (!atf_env_has("ATF_DURATIONS_FILE") ||
+        atf_env_get("ATF_DURATIONS_FILE")[0] == '\0')
+        return atf_no_error();
+
+    err = atf_binary_find(argv0, &binary, &found);
+    if (atf_is_error(err) || !found)
+        return err;
+
+    err = atf_durations_init_file(d, atf_env_get("ATF_DURATIONS_FILE"),
+                                  atf_fs_path_cstring(&binary));
+    atf_fs_path_fini(&binary);
+    return err;
+}
+
+/** Initializes the duration history of a program stored in a file.
+ *
+ * Relative paths are resolved now because the test cases run in their own
+ * work directories.  program must be an absolute path; the history stays
+ * disabled if it has a newline, which its format cannot hold.
+ */
+atf_error_t
+atf_durations_init_file(atf_durations_t *d, const char *file,
+                        const char *program)
+{
+    atf_error_t err;
+    atf_fs_path_t path;
+
+    PRE(program[0] == '/');
+
+    d->m_enabled = false;
+    d->m_entries = NULL;
+    d->m_nentries = 0;
+
+    if (strchr(program, '\n') != NULL)
+        return atf_no_error();
+
+    err = atf_fs_path_init_fmt(&path, "%s", file);
+    if (atf_is_error(err))
+        return err;
+    if (atf_fs_path_is_absolute(&path))
+        d->m_file = path;
+    else {
+        err = atf_fs_path_to_absolute(&path, &d->m_file);
+        atf_fs_path_fini(&path);
+        if (atf_is_error(err))
+            return err;
+    }
+
+    d->m_program = strdup(program);
+    if (d->m_program == NULL) {
+        atf_fs_path_fini(&d->m_file);
+        return atf_no_memory_error();
+    }
+    err = load(d);
+    if (atf_is_error(err)) {
+        free(d->m_program);
+        atf_fs_path_fini(&d->m_file);
+        return err;
+    }
+
+    d->m_enabled = true;
+    return atf_no_error();
+}
+
+void
+atf_durations_fini(atf_durations_t *d)
+{
+    size_t i;
+
+    if (!d->m_enabled)
+        return;
+
+    for (i = 0; i < d->m_nentries; i++)
+        free((char *)(uintptr_t)d->m_entries[i].m_ident);
+    free(d->m_entries);
+    free(d->m_program);
+    atf_fs_path_fini(&d->m_file);
+}
+
+/*
+ * Getters.
+ */
+
+/** Looks up the last recorded wall time of a test case.
+ *
+ * Returns false if the history has no entry for the test case; otherwise,
+ * usec is set to its wall time in microseconds.
+ */
+bool
+atf_durations_get(const atf_durations_t *d, const char *ident, int64_t *usec)
+{
+    struct atf_durations_entry key;
+    const struct atf_durations_entry *e;
+
+    if (!d->m_enabled || d->m_nentries == 0)
+        return false;
+
+    key.m_program = d->m_program;
+    key.m_ident = ident;
+    e = bsearch(&key, d->m_entries, d->m_nentries, sizeof(key),
+                compare_keys);
+    if (e == NULL)
+        return false;
+    *usec = e->m_usec;
+    return true;
+}
+
+/*
+ * Modifiers.
+ */
+
+/** Appends the wall time of a test case, in microseconds, to the history.
+ *
+ * The entries that the history held when it was initialized do not change;
+ * the new one is seen by the next run.
+ */
+atf_error_t
+atf_durations_record(const atf_durations_t *d, const char *ident,
+                     const int64_t usec)
+{
+    atf_error_t err;
+    atf_dynstr_t line;
+    ssize_t ret;
+    int fd;
+
+    PRE(usec >= 0);
+
+    if (!d->m_enabled)
+        return atf_no_error();
+
+    err = atf_dynstr_init_fmt(&line, "%" PRId64 " %s %s\n", usec, ident,
+                              d->m_program);
+    if (atf_is_error(err))
+        return err;
+
+    fd = open(atf_fs_path_cstring(&d->m_file),
+              O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        err = atf_libc_error(errno, "Cannot open %s",
+                             atf_fs_path_cstring(&d->m_file));
+        goto out;
+    }
+
+    /* A single write keeps the lines of concurrent writers apart. */
+    ret = write(fd, atf_dynstr_cstring(&line), atf_dynstr_length(&line));
+    if (ret != (ssize_t)atf_dynstr_length(&line))
+        err = atf_libc_error(ret == -1 ? errno : EIO, "Cannot write %s",
+                             atf_fs_path_cstring(&d->m_file));
+    close(fd);
+
+out:
+    atf_dynstr_fini(&line);
+    return err;
+}
@@ -0,0 +1,70 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_DURATIONS_H)
+#define ATF_C_DETAIL_DURATIONS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atf-c/detail/fs.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_durations" type.
+ * --------------------------------------------------------------------- */
+
+struct atf_durations_entry;
+
+/* The history of the wall times of the test cases of the running test
+ * program, enabled by the ATF_DURATIONS_FILE environment variable.  All
+ * test programs may share the same history file, a text file with one
+ * "<usec> <ident> <program>" line per run test case, where program is the
+ * absolute path of the binary; the latest line of a test case wins.  See
+ * atf-test-program(1). */
+struct atf_durations {
+    bool m_enabled;
+    atf_fs_path_t m_file;
+    char *m_program;
+    struct atf_durations_entry *m_entries;
+    size_t m_nentries;
+};
+typedef struct atf_durations atf_durations_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_durations_init(atf_durations_t *, const char *);
+atf_error_t atf_durations_init_file(atf_durations_t *, const char *,
+                                    const char *);
+void atf_durations_fini(atf_durations_t *);
+
+/* Getters. */
+bool atf_durations_get(const atf_durations_t *, const char *, int64_t *);
+
+/* Modifiers. */
+atf_error_t atf_durations_record(const atf_durations_t *, const char *,
+                                 const int64_t);
+
+#endif /* !defined(ATF_C_DETAIL_DURATIONS_H) */
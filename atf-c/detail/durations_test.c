@@ -0,0 +1,239 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/durations.h"
+
+#include <stdio.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/env.h"
+#include "atf-c/detail/test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+size_t
+count_lines(const char *path)
+{
+    FILE *f;
+    size_t n;
+    int ch;
+
+    f = fopen(path, "r");
+    ATF_REQUIRE(f != NULL);
+    n = 0;
+    while ((ch = fgetc(f)) != EOF)
+        if (ch == '\n')
+            n++;
+    fclose(f);
+    return n;
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_durations" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(disabled);
+ATF_TC_HEAD(disabled, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the history is disabled "
+                      "unless ATF_DURATIONS_FILE is set");
+}
+ATF_TC_BODY(disabled, tc)
+{
+    atf_durations_t d;
+    int64_t usec;
+
+    RE(atf_env_unset("ATF_DURATIONS_FILE"));
+    RE(atf_durations_init(&d, "/bin/sh"));
+    ATF_CHECK(!d.m_enabled);
+    ATF_CHECK(!atf_durations_get(&d, "tc", &usec));
+    RE(atf_durations_record(&d, "tc", 10));
+    atf_durations_fini(&d);
+}
+
+ATF_TC(record_and_get);
+ATF_TC_HEAD(record_and_get, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that recorded durations are "
+                      "seen by later runs of the same program only");
+}
+ATF_TC_BODY(record_and_get, tc)
+{
+    atf_durations_t d;
+    int64_t usec;
+
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    ATF_CHECK(d.m_enabled);
+    ATF_CHECK(!atf_durations_get(&d, "tc1", &usec));
+    RE(atf_durations_record(&d, "tc1", 100));
+    RE(atf_durations_record(&d, "tc2", 5));
+    ATF_CHECK(!atf_durations_get(&d, "tc1", &usec));
+    atf_durations_fini(&d);
+
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    ATF_REQUIRE(atf_durations_get(&d, "tc1", &usec));
+    ATF_CHECK_EQ(100, usec);
+    ATF_REQUIRE(atf_durations_get(&d, "tc2", &usec));
+    ATF_CHECK_EQ(5, usec);
+    ATF_CHECK(!atf_durations_get(&d, "tc3", &usec));
+    atf_durations_fini(&d);
+
+    RE(atf_durations_init_file(&d, "history", "/prog/b"));
+    ATF_CHECK(!atf_durations_get(&d, "tc1", &usec));
+    atf_durations_fini(&d);
+}
+
+ATF_TC(latest_wins);
+ATF_TC_HEAD(latest_wins, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the last recorded duration "
+                      "of a test case is the one that counts");
+}
+ATF_TC_BODY(latest_wins, tc)
+{
+    atf_durations_t d;
+    int64_t usec;
+
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    RE(atf_durations_record(&d, "tc", 300));
+    RE(atf_durations_record(&d, "tc", 200));
+    atf_durations_fini(&d);
+
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    ATF_REQUIRE(atf_durations_get(&d, "tc", &usec));
+    ATF_CHECK_EQ(200, usec);
+    atf_durations_fini(&d);
+}
+
+ATF_TC(corrupt_lines);
+ATF_TC_HEAD(corrupt_lines, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that malformed and incomplete "
+                      "lines in the history are ignored");
+}
+ATF_TC_BODY(corrupt_lines, tc)
+{
+    atf_durations_t d;
+    int64_t usec;
+    FILE *f;
+
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    RE(atf_durations_record(&d, "tc1", 100));
+
+    f = fopen("history", "a");
+    ATF_REQUIRE(f != NULL);
+    fprintf(f, "garbage\n");
+    fprintf(f, "-5 tc2 /prog/a\n");
+    fprintf(f, "x tc2 /prog/a\n");
+    fprintf(f, "2 tc2 prog/a\n");
+    fprintf(f, "2  /prog/a\n");
+    fprintf(f, "2 tc3 /prog/a");
+    fclose(f);
+    atf_durations_fini(&d);
+
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    ATF_REQUIRE(atf_durations_get(&d, "tc1", &usec));
+    ATF_CHECK_EQ(100, usec);
+    ATF_CHECK(!atf_durations_get(&d, "tc2", &usec));
+    ATF_CHECK(!atf_durations_get(&d, "tc3", &usec));
+    atf_durations_fini(&d);
+}
+
+ATF_TC(format);
+ATF_TC_HEAD(format, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the format of the lines of the "
+                      "history, which name the test program by its path");
+}
+ATF_TC_BODY(format, tc)
+{
+    atf_durations_t d;
+    int64_t usec;
+
+    atf_utils_create_file("history", "42 tc2 /prog/with space\n");
+    RE(atf_durations_init_file(&d, "history", "/prog/with space"));
+    ATF_REQUIRE(atf_durations_get(&d, "tc2", &usec));
+    ATF_CHECK_EQ(42, usec);
+    RE(atf_durations_record(&d, "tc1", 100));
+    atf_durations_fini(&d);
+
+    ATF_CHECK(atf_utils_compare_file("history", "42 tc2 /prog/with space\n"
+                                     "100 tc1 /prog/with space\n"));
+}
+
+ATF_TC(compaction);
+ATF_TC_HEAD(compaction, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the history is rewritten "
+                      "with only the latest entries once it grows");
+}
+ATF_TC_BODY(compaction, tc)
+{
+    atf_durations_t d;
+    int64_t usec;
+    int i;
+
+    RE(atf_durations_init_file(&d, "history", "/prog/b"));
+    RE(atf_durations_record(&d, "other", 7));
+    atf_durations_fini(&d);
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    for (i = 0; i < 2000; i++)
+        RE(atf_durations_record(&d, i % 2 == 0 ? "even" : "odd", i));
+    atf_durations_fini(&d);
+    ATF_CHECK_EQ(2001, count_lines("history"));
+
+    RE(atf_durations_init_file(&d, "history", "/prog/a"));
+    ATF_CHECK_EQ(3, count_lines("history"));
+    ATF_REQUIRE(atf_durations_get(&d, "even", &usec));
+    ATF_CHECK_EQ(1998, usec);
+    ATF_REQUIRE(atf_durations_get(&d, "odd", &usec));
+    ATF_CHECK_EQ(1999, usec);
+    atf_durations_fini(&d);
+
+    RE(atf_durations_init_file(&d, "history", "/prog/b"));
+    ATF_REQUIRE(atf_durations_get(&d, "other", &usec));
+    ATF_CHECK_EQ(7, usec);
+    atf_durations_fini(&d);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, disabled);
+    ATF_TP_ADD_TC(tp, record_and_get);
+    ATF_TP_ADD_TC(tp, latest_wins);
+    ATF_TP_ADD_TC(tp, corrupt_lines);
+    ATF_TP_ADD_TC(tp, format);
+    ATF_TP_ADD_TC(tp, compaction);
+
+    return atf_no_error();
+}
@@ -0,0 +1,222 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/events.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+atf_error_t
+append_string(atf_dynstr_t *json, const char *str)
+{
+    atf_error_t err;
+    const char *start, *iter;
+
+    err = atf_dynstr_append_fmt(json, "\"");
+    start = str;
+    for (iter = str; *iter != '\0' && !atf_is_error(err); iter++) {
+        const unsigned char ch = (unsigned char)*iter;
+        char escape[8];
+
+        if (ch == '"' || ch == '\\')
+            snprintf(escape, sizeof(escape), "\\%c", ch);
+        else if (ch == '\n')
+            snprintf(escape, sizeof(escape), "\\n");
+        else if (ch == '\t')
+            snprintf(escape, sizeof(escape), "\\t");
+        else if (ch < 0x20 || ch == 0x7f)
+            snprintf(escape, sizeof(escape), "\\u%04x", ch);
+        else
+            continue;
+
+        err = atf_dynstr_append_fmt(json, "%.*s%s", (int)(iter - start),
+                                    start, escape);
+        start = iter + 1;
+    }
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(json, "%s\"", start);
+
+    return err;
+}
+
+static
+atf_error_t
+append_key(atf_dynstr_t *json, const char *key)
+{
+    atf_error_t err;
+
+    PRE(atf_dynstr_length(json) > 0);
+    PRE(atf_dynstr_cstring(json)[atf_dynstr_length(json) - 1] != '}');
+
+    err = atf_dynstr_append_fmt(json, ",");
+    if (!atf_is_error(err))
+        err = append_string(json, key);
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(json, ":");
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_event" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+atf_error_t
+atf_event_init(atf_event_t *ev, const char *type)
+{
+    atf_error_t err;
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_REALTIME, &now) == -1)
+        return atf_libc_error(errno, "Cannot get the current time");
+
+    err = atf_dynstr_init_fmt(&ev->m_json, "{\"event\":");
+    if (atf_is_error(err))
+        goto out;
+
+    err = append_string(&ev->m_json, type);
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(&ev->m_json, ",\"time\":%ld.%06ld",
+                                    (long)now.tv_sec, now.tv_nsec / 1000);
+    if (atf_is_error(err))
+        atf_dynstr_fini(&ev->m_json);
+
+out:
+    return err;
+}
+
+void
+atf_event_fini(atf_event_t *ev)
+{
+    atf_dynstr_fini(&ev->m_json);
+}
+
+/*
+ * Getters.
+ */
+
+const char *
+atf_event_cstring(const atf_event_t *ev)
+{
+    return atf_dynstr_cstring(&ev->m_json);
+}
+
+/*
+ * Modifiers.
+ */
+
+atf_error_t
+atf_event_add_bool(atf_event_t *ev, const char *key, const bool value)
+{
+    atf_error_t err;
+
+    err = append_key(&ev->m_json, key);
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(&ev->m_json, "%s",
+                                    value ? "true" : "false");
+    return err;
+}
+
+atf_error_t
+atf_event_add_int(atf_event_t *ev, const char *key, const long value)
+{
+    atf_error_t err;
+
+    err = append_key(&ev->m_json, key);
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(&ev->m_json, "%ld", value);
+    return err;
+}
+
+atf_error_t
+atf_event_add_string(atf_event_t *ev, const char *key, const char *value)
+{
+    atf_error_t err;
+
+    err = append_key(&ev->m_json, key);
+    if (!atf_is_error(err))
+        err = append_string(&ev->m_json, value);
+    return err;
+}
+
+/** Terminates the JSON object of the event.
+ *
+ * No more members can be added to the event afterwards.
+ */
+atf_error_t
+atf_event_end(atf_event_t *ev)
+{
+    return atf_dynstr_append_fmt(&ev->m_json, "}");
+}
+
+/*
+ * Operations.
+ */
+
+/** Writes a terminated event, followed by a newline, to a file.
+ *
+ * The event is written with a single call so that events written by
+ * different processes to a file opened with O_APPEND do not mix.
+ */
+atf_error_t
+atf_event_write(const atf_event_t *ev, const int fd)
+{
+    atf_error_t err;
+    atf_dynstr_t line;
+    ssize_t ret;
+
+    PRE(atf_dynstr_cstring(&ev->m_json)[atf_dynstr_length(&ev->m_json) - 1]
+        == '}');
+
+    err = atf_dynstr_init_fmt(&line, "%s\n", atf_dynstr_cstring(&ev->m_json));
+    if (atf_is_error(err))
+        goto out;
+
+    while ((ret = write(fd, atf_dynstr_cstring(&line),
+                        atf_dynstr_length(&line))) == -1 && errno == EINTR)
+        continue; /* Retry. */
+    if (ret == -1)
+        err = atf_libc_error(errno, "Cannot write event");
+    else if ((size_t)ret != atf_dynstr_length(&line))
+        err = atf_libc_error(EIO, "Short write of event");
+
+    atf_dynstr_fini(&line);
+out:
+    return err;
+}
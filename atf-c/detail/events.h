@@ -0,0 +1,63 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_EVENTS_H)
+#define ATF_C_DETAIL_EVENTS_H
+
+#include <stdbool.h>
+
+#include <atf-c/detail/dynstr.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_event" type.
+ * --------------------------------------------------------------------- */
+
+/* An event of a test case, serialized as a JSON object that fits in a
+ * single line so that a stream of events is valid JSON Lines.  Every event
+ * has an "event" member with its type and a "time" member with the number
+ * of seconds since the Epoch at which it was created. */
+struct atf_event {
+    atf_dynstr_t m_json;
+};
+typedef struct atf_event atf_event_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_event_init(atf_event_t *, const char *);
+void atf_event_fini(atf_event_t *);
+
+/* Getters. */
+const char *atf_event_cstring(const atf_event_t *);
+
+/* Modifiers. */
+atf_error_t atf_event_add_bool(atf_event_t *, const char *, const bool);
+atf_error_t atf_event_add_int(atf_event_t *, const char *, const long);
+atf_error_t atf_event_add_string(atf_event_t *, const char *, const char *);
+atf_error_t atf_event_end(atf_event_t *);
+
+/* Operations. */
+atf_error_t atf_event_write(const atf_event_t *, const int);
+
+#endif /* !defined(ATF_C_DETAIL_EVENTS_H) */
@@ -0,0 +1,153 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/events.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+#include "atf-c/utils.h"
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_event" type.
+ * --------------------------------------------------------------------- */
+
+#define TIME_RE "\"time\":[0-9]+\\.[0-9]{6}"
+
+ATF_TC(init);
+ATF_TC_HEAD(init, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_event_init function");
+}
+ATF_TC_BODY(init, tc)
+{
+    atf_event_t ev;
+
+    RE(atf_event_init(&ev, "start"));
+    RE(atf_event_end(&ev));
+    ATF_CHECK(atf_utils_grep_string("^\\{\"event\":\"start\"," TIME_RE "\\}$",
+                                    atf_event_cstring(&ev)));
+    atf_event_fini(&ev);
+}
+
+ATF_TC(add);
+ATF_TC_HEAD(add, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the functions that add members "
+                      "to an event");
+}
+ATF_TC_BODY(add, tc)
+{
+    atf_event_t ev;
+
+    RE(atf_event_init(&ev, "failure"));
+    RE(atf_event_add_string(&ev, "file", "foo.c"));
+    RE(atf_event_add_int(&ev, "line", 123));
+    RE(atf_event_add_int(&ev, "negative", -5));
+    RE(atf_event_add_bool(&ev, "fatal", true));
+    RE(atf_event_add_bool(&ev, "expected", false));
+    RE(atf_event_end(&ev));
+    ATF_CHECK(atf_utils_grep_string("^\\{\"event\":\"failure\"," TIME_RE
+        ",\"file\":\"foo.c\",\"line\":123,\"negative\":-5,\"fatal\":true,"
+        "\"expected\":false\\}$", atf_event_cstring(&ev)));
+    atf_event_fini(&ev);
+}
+
+ATF_TC(escape);
+ATF_TC_HEAD(escape, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that strings are escaped so "
+                      "that events are valid JSON and fit in a line");
+}
+ATF_TC_BODY(escape, tc)
+{
+    atf_event_t ev;
+    const char *json, *reason;
+
+    RE(atf_event_init(&ev, "result"));
+    RE(atf_event_add_string(&ev, "reason",
+                            "a \"quoted\" \\ back\nslash\tand \001 bell"));
+    RE(atf_event_end(&ev));
+
+    json = atf_event_cstring(&ev);
+    ATF_CHECK(strchr(json, '\n') == NULL);
+    reason = strstr(json, ",\"reason\":");
+    ATF_REQUIRE(reason != NULL);
+    ATF_CHECK_STREQ(",\"reason\":\"a \\\"quoted\\\" \\\\ back\\nslash\\tand "
+                    "\\u0001 bell\"}", reason);
+    atf_event_fini(&ev);
+}
+
+ATF_TC(write);
+ATF_TC_HEAD(write, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_event_write appends "
+                      "one event per line");
+}
+ATF_TC_BODY(write, tc)
+{
+    atf_event_t ev;
+    int fd;
+
+    fd = open("events", O_WRONLY | O_CREAT | O_APPEND, 0644);
+    ATF_REQUIRE(fd != -1);
+
+    RE(atf_event_init(&ev, "first"));
+    RE(atf_event_end(&ev));
+    RE(atf_event_write(&ev, fd));
+    atf_event_fini(&ev);
+
+    RE(atf_event_init(&ev, "second"));
+    RE(atf_event_add_int(&ev, "n", 2));
+    RE(atf_event_end(&ev));
+    RE(atf_event_write(&ev, fd));
+    atf_event_fini(&ev);
+
+    close(fd);
+
+    ATF_CHECK(atf_utils_grep_file("^\\{\"event\":\"first\"," TIME_RE "\\}$",
+                                  "events"));
+    ATF_CHECK(atf_utils_grep_file("^\\{\"event\":\"second\"," TIME_RE
+                                  ",\"n\":2\\}$", "events"));
+    atf_utils_cat_file("events", "");
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, init);
+    ATF_TP_ADD_TC(tp, add);
+    ATF_TP_ADD_TC(tp, escape);
+    ATF_TP_ADD_TC(tp, write);
+
+    return atf_no_error();
+}
@@ -770,3 +770,72 @@ atf_fs_unlink(const atf_fs_path_t *p)
 
     return err;
 }
+
+/** Writes a file through a temporary file that is then moved into place.
+ *
+ * The writer callback fills the temporary file, which lives in the same
+ * directory as p, so that concurrent readers never see a half-written
+ * file.  If replace is false, an existing file is left untouched, even
+ * if a concurrent writer creates it in the meantime.  The file is made
+ * readable by everybody so that other users can share it.
+ */
+atf_error_t
+atf_fs_write_atomic(const atf_fs_path_t *p, const bool replace,
+                    atf_error_t (*writer)(FILE *, void *), void *data)
+{
+    atf_error_t err;
+    atf_fs_path_t tmp;
+    bool failed;
+    FILE *f;
+    int fd;
+
+    err = atf_fs_path_init_fmt(&tmp, "%s.XXXXXX", atf_fs_path_cstring(p));
+    if (atf_is_error(err))
+        return err;
+
+    err = atf_fs_mkstemp(&tmp, &fd);
+    if (atf_is_error(err))
+        goto out;
+
+    f = fdopen(fd, "w");
+    if (f == NULL) {
+        err = atf_libc_error(errno, "Cannot write %s",
+                             atf_fs_path_cstring(&tmp));
+        close(fd);
+        goto out_unlink;
+    }
+    err = writer(f, data);
+    failed = ferror(f) != 0;
+    if (atf_is_error(err)) {
+        fclose(f);
+        goto out_unlink;
+    }
+    if (fclose(f) == EOF || failed) {
+        err = atf_libc_error(errno, "Cannot write %s",
+                             atf_fs_path_cstring(&tmp));
+        goto out_unlink;
+    }
+
+    /* mkstemp creates the file with mode 0600. */
+    (void)chmod(atf_fs_path_cstring(&tmp), 0644);
+    if (replace) {
+        if (rename(atf_fs_path_cstring(&tmp), atf_fs_path_cstring(p)) == -1)
+            err = atf_libc_error(errno, "Cannot rename %s to %s",
+                                 atf_fs_path_cstring(&tmp),
+                                 atf_fs_path_cstring(p));
+    } else {
+        /* Unlike rename, link does not clobber the file that a concurrent
+         * writer may have created in the meantime. */
+        if (link(atf_fs_path_cstring(&tmp), atf_fs_path_cstring(p)) == -1 &&
+            errno != EEXIST)
+            err = atf_libc_error(errno, "Cannot create %s",
+                                 atf_fs_path_cstring(p));
+    }
+
+out_unlink:
+    if (atf_is_error(err) || !replace)
+        (void)unlink(atf_fs_path_cstring(&tmp));
+out:
+    atf_fs_path_fini(&tmp);
+    return err;
+}
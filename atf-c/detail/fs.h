@@ -31,6 +31,7 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 #include <atf-c/detail/dynstr.h>
 #include <atf-c/error_fwd.h>
@@ -124,5 +125,7 @@ atf_error_t atf_fs_mkdtemp(atf_fs_path_t *);
 atf_error_t atf_fs_mkstemp(atf_fs_path_t *, int *);
 atf_error_t atf_fs_rmdir(const atf_fs_path_t *);
 atf_error_t atf_fs_unlink(const atf_fs_path_t *);
+atf_error_t atf_fs_write_atomic(const atf_fs_path_t *, const bool,
+                                atf_error_t (*)(FILE *, void *), void *);
 
 #endif /* !defined(ATF_C_DETAIL_FS_H) */
@@ -28,6 +28,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
@@ -1049,6 +1050,69 @@ ATF_TC_BODY(mkstemp_umask, tc)
     atf_fs_path_fini(&p);
 }
 
+static
+atf_error_t
+write_text(FILE *f, void *data)
+{
+    fprintf(f, "%s\n", (const char *)data);
+    return atf_no_error();
+}
+
+static
+atf_error_t
+write_error(FILE *f, void *data ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+    fprintf(f, "partial\n");
+    return atf_libc_error(EINVAL, "Writer failed");
+}
+
+ATF_TC(write_atomic);
+ATF_TC_HEAD(write_atomic, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the atf_fs_write_atomic function");
+}
+ATF_TC_BODY(write_atomic, tc)
+{
+    char first[] = "first", second[] = "second", third[] = "third";
+    atf_fs_path_t p;
+    atf_error_t err;
+    struct stat sb;
+    DIR *d;
+    struct dirent *de;
+    size_t n;
+
+    create_dir("dir", 0755);
+    RE(atf_fs_path_init_fmt(&p, "dir/file"));
+
+    RE(atf_fs_write_atomic(&p, true, write_text, first));
+    ATF_CHECK(atf_utils_compare_file("dir/file", "first\n"));
+    ATF_REQUIRE(stat("dir/file", &sb) != -1);
+    ATF_CHECK_EQ(sb.st_mode & 0777, 0644);
+
+    RE(atf_fs_write_atomic(&p, false, write_text, second));
+    ATF_CHECK(atf_utils_compare_file("dir/file", "first\n"));
+
+    RE(atf_fs_write_atomic(&p, true, write_text, third));
+    ATF_CHECK(atf_utils_compare_file("dir/file", "third\n"));
+
+    err = atf_fs_write_atomic(&p, true, write_error, NULL);
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_CHECK(atf_error_is(err, "libc"));
+    atf_error_free(err);
+    ATF_CHECK(atf_utils_compare_file("dir/file", "third\n"));
+
+    /* No temporary files are left behind. */
+    n = 0;
+    ATF_REQUIRE((d = opendir("dir")) != NULL);
+    while ((de = readdir(d)) != NULL)
+        if (strcmp(de->d_name, ".") != 0 && strcmp(de->d_name, "..") != 0)
+            n++;
+    closedir(d);
+    ATF_CHECK_EQ(n, 1);
+
+    atf_fs_path_fini(&p);
+}
+
 /* ---------------------------------------------------------------------
  * Main.
  * --------------------------------------------------------------------- */
@@ -1084,6 +1148,7 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, mkstemp_ok);
     ATF_TP_ADD_TC(tp, mkstemp_err);
     ATF_TP_ADD_TC(tp, mkstemp_umask);
+    ATF_TP_ADD_TC(tp, write_atomic);
 
     return atf_no_error();
 }
@@ -0,0 +1,79 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/hash.h"
+
+#include <string.h>
+
+#include <atf-c.h>
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(hash_bytes);
+ATF_TC_HEAD(hash_bytes, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_hash_bytes function "
+                      "against known FNV-1a values");
+}
+ATF_TC_BODY(hash_bytes, tc)
+{
+    ATF_CHECK_EQ(atf_hash_bytes(ATF_HASH_INIT, "", 0), ATF_HASH_INIT);
+    ATF_CHECK_EQ(atf_hash_bytes(ATF_HASH_INIT, "a", 1),
+                 UINT64_C(0xaf63dc4c8601ec8c));
+    ATF_CHECK_EQ(atf_hash_bytes(ATF_HASH_INIT, "foobar", 6),
+                 UINT64_C(0x85944171f73967e8));
+    ATF_CHECK_EQ(atf_hash_bytes(atf_hash_bytes(ATF_HASH_INIT, "foo", 3),
+                                "bar", 3),
+                 UINT64_C(0x85944171f73967e8));
+}
+
+ATF_TC(hash_string);
+ATF_TC_HEAD(hash_string, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_hash_string includes the "
+                      "terminator of the string");
+}
+ATF_TC_BODY(hash_string, tc)
+{
+    ATF_CHECK_EQ(atf_hash_string(ATF_HASH_INIT, "foo"),
+                 atf_hash_bytes(ATF_HASH_INIT, "foo", 4));
+    ATF_CHECK(atf_hash_string(atf_hash_string(ATF_HASH_INIT, "foo"), "bar")
+              != atf_hash_string(atf_hash_string(ATF_HASH_INIT, "fo"),
+                                 "obar"));
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, hash_bytes);
+    ATF_TP_ADD_TC(tp, hash_string);
+
+    return atf_no_error();
+}
@@ -0,0 +1,236 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/listing_cache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "atf-c/detail/binary.h"
+#include "atf-c/detail/env.h"
+#include "atf-c/detail/hash.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+#define HEADER_FMT "atf-listing-cache: %016" PRIx64 "\n"
+#define HEADER_LEN (19 + 16 + 1)
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+uint64_t
+cache_key(const atf_listing_cache_t *c)
+{
+    uint64_t hash;
+
+    hash = atf_hash_bytes(ATF_HASH_INIT, &c->m_identity,
+                          sizeof(c->m_identity));
+    return atf_hash_bytes(hash, &c->m_vars, sizeof(c->m_vars));
+}
+
+/* An entry of the cache as given to write_entry. */
+struct entry {
+    uint64_t m_key;
+    const char *m_listing;
+};
+
+static
+atf_error_t
+write_entry(FILE *f, void *data)
+{
+    const struct entry *e = data;
+
+    fprintf(f, HEADER_FMT, e->m_key);
+    fputs(e->m_listing, f);
+    return atf_no_error();
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_listing_cache" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+/** Initializes the listing cache of the running program.
+ *
+ * The cache is disabled, and all other methods become no-ops, unless the
+ * ATF_LIST_CACHE_DIR environment variable is set and the binary of the
+ * program can be located.
+ */
+atf_error_t
+atf_listing_cache_init(atf_listing_cache_t *c, const char *argv0)
+{
+    atf_error_t err;
+    atf_fs_path_t binary;
+    bool found;
+
+    c->m_enabled = false;
+    c->m_identity = 0;
+    c->m_vars = 0;
+
+    if (!atf_env_has("ATF_LIST_CACHE_DIR"))
+        return atf_no_error();
+
+    err = atf_binary_find(argv0, &binary, &found);
+    if (atf_is_error(err) || !found)
+        return err;
+
+    err = atf_binary_identity(&binary, &c->m_identity);
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_binary_cache_file(&binary, atf_env_get("ATF_LIST_CACHE_DIR"),
+                                ".atf-list", &c->m_file);
+    if (!atf_is_error(err))
+        c->m_enabled = true;
+
+out:
+    atf_fs_path_fini(&binary);
+    return err;
+}
+
+void
+atf_listing_cache_fini(atf_listing_cache_t *c)
+{
+    if (c->m_enabled)
+        atf_fs_path_fini(&c->m_file);
+}
+
+/*
+ * Getters.
+ */
+
+/** Looks up the cached listing.
+ *
+ * If found is set to true, listing is initialized to the cached listing.
+ * Unreadable, stale or corrupt entries are reported as not found so that
+ * the caller regenerates them.
+ */
+atf_error_t
+atf_listing_cache_get(const atf_listing_cache_t *c, atf_dynstr_t *listing,
+                      bool *found)
+{
+    atf_error_t err;
+    char header[HEADER_LEN + 1];
+    char *buf;
+    struct stat sb;
+    FILE *f;
+
+    *found = false;
+    if (!c->m_enabled)
+        return atf_no_error();
+
+    f = fopen(atf_fs_path_cstring(&c->m_file), "r");
+    if (f == NULL)
+        return atf_no_error();
+
+    err = atf_no_error();
+    buf = NULL;
+    snprintf(header, sizeof(header), HEADER_FMT, cache_key(c));
+    if (fstat(fileno(f), &sb) == -1 || sb.st_size < HEADER_LEN)
+        goto out;
+
+    buf = malloc((size_t)sb.st_size);
+    if (buf == NULL) {
+        err = atf_no_memory_error();
+        goto out;
+    }
+    if (fread(buf, 1, (size_t)sb.st_size, f) != (size_t)sb.st_size ||
+        memcmp(buf, header, HEADER_LEN) != 0)
+        goto out;
+
+    err = atf_dynstr_init_raw(listing, buf + HEADER_LEN,
+                              (size_t)sb.st_size - HEADER_LEN);
+    if (!atf_is_error(err))
+        *found = true;
+
+out:
+    free(buf);
+    fclose(f);
+    return err;
+}
+
+/*
+ * Modifiers.
+ */
+
+/** Adds a configuration variable to the key of the cache.
+ *
+ * The order in which variables are added does not matter.
+ */
+void
+atf_listing_cache_add_var(atf_listing_cache_t *c, const char *name,
+                          const char *value)
+{
+    c->m_vars += atf_hash_string(atf_hash_string(ATF_HASH_INIT, name),
+                                 value);
+}
+
+/** Stores a listing in the cache, replacing any previous entry.
+ *
+ * The entry is written to a temporary file first and then renamed so
+ * that concurrent readers never see it half-written.
+ */
+atf_error_t
+atf_listing_cache_put(const atf_listing_cache_t *c, const char *listing)
+{
+    atf_error_t err;
+    atf_fs_path_t dir;
+    struct entry e;
+
+    if (!c->m_enabled)
+        return atf_no_error();
+
+    err = atf_fs_path_branch_path(&c->m_file, &dir);
+    if (atf_is_error(err))
+        return err;
+    if (mkdir(atf_fs_path_cstring(&dir), 0755) == -1 && errno != EEXIST) {
+        err = atf_libc_error(errno, "Cannot create cache directory %s",
+                             atf_fs_path_cstring(&dir));
+        atf_fs_path_fini(&dir);
+        return err;
+    }
+    atf_fs_path_fini(&dir);
+
+    e.m_key = cache_key(c);
+    e.m_listing = listing;
+    return atf_fs_write_atomic(&c->m_file, true, write_entry, &e);
+}
@@ -0,0 +1,65 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_LISTING_CACHE_H)
+#define ATF_C_DETAIL_LISTING_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <atf-c/detail/dynstr.h>
+#include <atf-c/detail/fs.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_listing_cache" type.
+ * --------------------------------------------------------------------- */
+
+/* A cache of the test case listing of the running test program, enabled
+ * by the ATF_LIST_CACHE_DIR environment variable.  Entries are keyed by
+ * the identity of the binary and by the configuration variables given to
+ * the test program, which the heads of the test cases may query. */
+struct atf_listing_cache {
+    bool m_enabled;
+    atf_fs_path_t m_file;
+    uint64_t m_identity;
+    uint64_t m_vars;
+};
+typedef struct atf_listing_cache atf_listing_cache_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_listing_cache_init(atf_listing_cache_t *, const char *);
+void atf_listing_cache_fini(atf_listing_cache_t *);
+
+/* Getters. */
+atf_error_t atf_listing_cache_get(const atf_listing_cache_t *, atf_dynstr_t *,
+                                  bool *);
+
+/* Modifiers. */
+void atf_listing_cache_add_var(atf_listing_cache_t *, const char *,
+                               const char *);
+atf_error_t atf_listing_cache_put(const atf_listing_cache_t *, const char *);
+
+#endif /* !defined(ATF_C_DETAIL_LISTING_CACHE_H) */
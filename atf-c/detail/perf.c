@@ -0,0 +1,463 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "config.h"
+
+#include "atf-c/detail/perf.h"
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <sys/syscall.h>
+
+#include <linux/perf_event.h>
+#endif
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+#if defined(HAVE_LINUX_PERF_EVENT_H) && defined(SYS_perf_event_open)
+#   define HAVE_PERF_EVENT_OPEN 1
+#endif
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+#if defined(HAVE_PERF_EVENT_OPEN)
+/** Opens a counter of an event of the running process and of the threads
+ * that it creates later on, or returns -1 if the event is not available.
+ *
+ * Only user space is counted, which unprivileged processes are allowed to
+ * do under the default perf_event_paranoid setting. */
+static
+int
+open_event(const uint32_t type, const uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+        PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                        PERF_FLAG_FD_CLOEXEC);
+}
+
+/** Reads a counter, scaled up for the time that the kernel did not have
+ * it scheduled because there were more events than hardware counters. */
+static
+uint64_t
+read_event(const int fd)
+{
+    uint64_t values[3];
+
+    if (read(fd, values, sizeof(values)) != (ssize_t)sizeof(values))
+        return 0;
+    if (values[2] > 0 && values[2] < values[1])
+        return (uint64_t)((double)values[0] * (double)values[1] /
+                          (double)values[2]);
+    return values[0];
+}
+#endif /* defined(HAVE_PERF_EVENT_OPEN) */
+
+static
+uint64_t
+read_counter(const atf_perf_counters_t *c, const atf_perf_counter_t counter)
+{
+    struct timespec ts;
+    struct rusage ru;
+
+#if defined(HAVE_PERF_EVENT_OPEN)
+    if (c->m_fds[counter] != -1)
+        return read_event(c->m_fds[counter]);
+#endif
+
+    switch (counter) {
+    case ATF_PERF_TASK_CLOCK:
+        if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == -1)
+            return 0;
+        return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+
+    case ATF_PERF_PAGE_FAULTS:
+        if (getrusage(RUSAGE_SELF, &ru) == -1)
+            return 0;
+        return (uint64_t)ru.ru_minflt + (uint64_t)ru.ru_majflt;
+
+    default:
+        return 0;
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_perf_counters" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+void
+atf_perf_counters_init(atf_perf_counters_t *c)
+{
+    int i;
+
+    for (i = 0; i < ATF_PERF_NCOUNTERS; i++)
+        c->m_fds[i] = -1;
+
+#if defined(HAVE_PERF_EVENT_OPEN)
+    c->m_fds[ATF_PERF_TASK_CLOCK] = open_event(PERF_TYPE_SOFTWARE,
+                                               PERF_COUNT_SW_TASK_CLOCK);
+    c->m_fds[ATF_PERF_PAGE_FAULTS] = open_event(PERF_TYPE_SOFTWARE,
+                                                PERF_COUNT_SW_PAGE_FAULTS);
+    c->m_fds[ATF_PERF_CYCLES] = open_event(PERF_TYPE_HARDWARE,
+                                           PERF_COUNT_HW_CPU_CYCLES);
+    c->m_fds[ATF_PERF_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE,
+                                                 PERF_COUNT_HW_INSTRUCTIONS);
+#endif
+
+    atf_perf_counters_reset(c);
+}
+
+void
+atf_perf_counters_fini(atf_perf_counters_t *c)
+{
+    int i;
+
+    for (i = 0; i < ATF_PERF_NCOUNTERS; i++)
+        if (c->m_fds[i] != -1)
+            close(c->m_fds[i]);
+}
+
+/*
+ * Getters.
+ */
+
+/** Tells whether a counter is read; the software ones always are. */
+bool
+atf_perf_counters_available(const atf_perf_counters_t *c,
+                            const atf_perf_counter_t counter)
+{
+    PRE(counter < ATF_PERF_NCOUNTERS);
+
+    return counter == ATF_PERF_TASK_CLOCK ||
+        counter == ATF_PERF_PAGE_FAULTS || c->m_fds[counter] != -1;
+}
+
+/** Returns the name of a counter, as used by perf(1). */
+const char *
+atf_perf_counters_name(const atf_perf_counter_t counter)
+{
+    static const char *const names[ATF_PERF_NCOUNTERS] = {
+        "task-clock",
+        "page-faults",
+        "cycles",
+        "instructions",
+    };
+
+    PRE(counter < ATF_PERF_NCOUNTERS);
+
+    return names[counter];
+}
+
+/** Returns the count of the events within the measured intervals.  The
+ * task clock counts nanoseconds of CPU time. */
+uint64_t
+atf_perf_counters_total(const atf_perf_counters_t *c,
+                        const atf_perf_counter_t counter)
+{
+    PRE(counter < ATF_PERF_NCOUNTERS);
+
+    return c->m_totals[counter];
+}
+
+/** Appends the available counters to a record of a benchmark.
+ *
+ * There is one 'name: value' line per counter with the average count per
+ * iteration over the given number of iterations.
+ */
+atf_error_t
+atf_perf_counters_format(const atf_perf_counters_t *c,
+                         const size_t iterations, atf_dynstr_t *out)
+{
+    atf_error_t err;
+    int i;
+
+    PRE(iterations > 0);
+
+    err = atf_no_error();
+    for (i = 0; i < ATF_PERF_NCOUNTERS && !atf_is_error(err); i++) {
+        if (!atf_perf_counters_available(c, (atf_perf_counter_t)i))
+            continue;
+        err = atf_dynstr_append_fmt(out, "%s: %.3f\n",
+                                    atf_perf_counters_name(
+                                        (atf_perf_counter_t)i),
+                                    (double)c->m_totals[i] /
+                                    (double)iterations);
+    }
+    return err;
+}
+
+/*
+ * Modifiers.
+ */
+
+void
+atf_perf_counters_reset(atf_perf_counters_t *c)
+{
+    int i;
+
+    for (i = 0; i < ATF_PERF_NCOUNTERS; i++) {
+        c->m_start[i] = 0;
+        c->m_totals[i] = 0;
+    }
+}
+
+/** Starts a measured interval. */
+void
+atf_perf_counters_start(atf_perf_counters_t *c)
+{
+    int i;
+
+    for (i = 0; i < ATF_PERF_NCOUNTERS; i++)
+        c->m_start[i] = read_counter(c, (atf_perf_counter_t)i);
+}
+
+/** Ends a measured interval and adds its events to the totals.  The
+ * counters are read in the reverse order of start so that each of them
+ * includes as little as possible of the reading of the others. */
+void
+atf_perf_counters_stop(atf_perf_counters_t *c)
+{
+    int i;
+
+    for (i = ATF_PERF_NCOUNTERS - 1; i >= 0; i--) {
+        const uint64_t value = read_counter(c, (atf_perf_counter_t)i);
+
+        if (value > c->m_start[i])
+            c->m_totals[i] += value - c->m_start[i];
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_perf_conditions" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+/** Describes the conditions under which to run benchmarks.
+ *
+ * The list of CPUs may be NULL not to pin the process.
+ */
+atf_error_t
+atf_perf_conditions_init(atf_perf_conditions_t *c, const char *cpus,
+                         const bool raise)
+{
+
+    if (cpus == NULL)
+        c->m_cpus = NULL;
+    else {
+        c->m_cpus = strdup(cpus);
+        if (c->m_cpus == NULL)
+            return atf_no_memory_error();
+    }
+    c->m_raise = raise;
+    c->m_niced = false;
+    c->m_nice = 0;
+    return atf_no_error();
+}
+
+void
+atf_perf_conditions_fini(atf_perf_conditions_t *c)
+{
+
+    free(c->m_cpus);
+}
+
+/*
+ * Getters.
+ */
+
+/** Appends the conditions to a record of a benchmark.
+ *
+ * The list of CPUs is recorded even if the process could not be pinned to
+ * them, as the record is only meant to tell runs apart.
+ */
+atf_error_t
+atf_perf_conditions_format(const atf_perf_conditions_t *c, atf_dynstr_t *out)
+{
+    atf_error_t err;
+
+    err = atf_no_error();
+    if (c->m_cpus != NULL)
+        err = atf_dynstr_append_fmt(out, "cpus: %s\n", c->m_cpus);
+    if (!atf_is_error(err) && c->m_niced)
+        err = atf_dynstr_append_fmt(out, "nice: %d\n", c->m_nice);
+    return err;
+}
+
+/*
+ * Modifiers.
+ */
+
+/** Sets up the running process for its benchmarks.
+ *
+ * The priority is raised even if the process cannot be pinned, in which
+ * case the error is returned afterwards.
+ */
+atf_error_t
+atf_perf_conditions_apply(atf_perf_conditions_t *c)
+{
+    atf_error_t err;
+
+    err = atf_no_error();
+    if (c->m_cpus != NULL)
+        err = atf_perf_pin(c->m_cpus);
+    if (c->m_raise) {
+        c->m_nice = atf_perf_raise_priority();
+        c->m_niced = true;
+    }
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Parses a list of CPUs such as "0,2-3" into a set of ATF_PERF_MAX_CPUS
+ * flags. */
+atf_error_t
+atf_perf_parse_cpus(const char *str, bool *cpus)
+{
+    const char *p;
+    char *end;
+    unsigned long first, last, i;
+
+    for (i = 0; i < ATF_PERF_MAX_CPUS; i++)
+        cpus[i] = false;
+
+    p = str;
+    do {
+        errno = 0;
+        if (*p < '0' || *p > '9')
+            goto invalid;
+        first = strtoul(p, &end, 10);
+        if (errno != 0)
+            goto invalid;
+        last = first;
+        if (*end == '-') {
+            p = end + 1;
+            if (*p < '0' || *p > '9')
+                goto invalid;
+            last = strtoul(p, &end, 10);
+            if (errno != 0)
+                goto invalid;
+        }
+        if (first > last || last >= ATF_PERF_MAX_CPUS)
+            goto invalid;
+        for (i = first; i <= last; i++)
+            cpus[i] = true;
+        p = end + 1;
+    } while (*end == ',');
+    if (*end != '\0')
+        goto invalid;
+
+    return atf_no_error();
+
+invalid:
+    return atf_libc_error(EINVAL, "Invalid CPU list '%s'", str);
+}
+
+/** Restricts the running process, and the threads that it creates later
+ * on, to a list of CPUs. */
+atf_error_t
+atf_perf_pin(const char *str)
+{
+    atf_error_t err;
+    bool cpus[ATF_PERF_MAX_CPUS];
+
+    err = atf_perf_parse_cpus(str, cpus);
+    if (atf_is_error(err))
+        return err;
+
+#if defined(CPU_SET)
+    {
+        cpu_set_t set;
+        size_t i;
+
+        CPU_ZERO(&set);
+        for (i = 0; i < ATF_PERF_MAX_CPUS; i++) {
+            if (!cpus[i])
+                continue;
+            if (i >= CPU_SETSIZE)
+                return atf_libc_error(EINVAL, "Invalid CPU list '%s'", str);
+            CPU_SET(i, &set);
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) == -1)
+            return atf_libc_error(errno, "Cannot pin the process to CPUs "
+                                  "%s", str);
+    }
+    return atf_no_error();
+#else
+    return atf_libc_error(ENOSYS, "Cannot pin the process to CPUs %s on "
+                          "this platform", str);
+#endif
+}
+
+/** Raises the scheduling priority of the running process as much as it is
+ * allowed to, and returns the resulting nice value. */
+int
+atf_perf_raise_priority(void)
+{
+    int current, target;
+
+    errno = 0;
+    current = getpriority(PRIO_PROCESS, 0);
+    if (current == -1 && errno != 0)
+        return 0;
+
+    /* Unprivileged processes may still be allowed some raise by their
+     * RLIMIT_NICE, so try from the highest priority down. */
+    for (target = PRIO_MIN; target < current; target++)
+        if (setpriority(PRIO_PROCESS, 0, target) != -1)
+            return target;
+    return current;
+}
@@ -0,0 +1,117 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_PERF_H)
+#define ATF_C_DETAIL_PERF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atf-c/detail/dynstr.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_perf_counters" type.
+ * --------------------------------------------------------------------- */
+
+enum atf_perf_counter {
+    ATF_PERF_TASK_CLOCK,
+    ATF_PERF_PAGE_FAULTS,
+    ATF_PERF_CYCLES,
+    ATF_PERF_INSTRUCTIONS,
+    ATF_PERF_NCOUNTERS,
+};
+typedef enum atf_perf_counter atf_perf_counter_t;
+
+/* Counters of the events caused by the running process, accumulated over
+ * the intervals between calls to start and stop.  They are read with
+ * perf_event_open(2) where available.  The software counters fall back to
+ * the CPU time clock and getrusage(2) otherwise, but the hardware ones are
+ * only available through perf_event_open(2). */
+struct atf_perf_counters {
+    int m_fds[ATF_PERF_NCOUNTERS];
+    uint64_t m_start[ATF_PERF_NCOUNTERS];
+    uint64_t m_totals[ATF_PERF_NCOUNTERS];
+};
+typedef struct atf_perf_counters atf_perf_counters_t;
+
+/* Constructors/destructors. */
+void atf_perf_counters_init(atf_perf_counters_t *);
+void atf_perf_counters_fini(atf_perf_counters_t *);
+
+/* Getters. */
+bool atf_perf_counters_available(const atf_perf_counters_t *,
+                                 const atf_perf_counter_t);
+const char *atf_perf_counters_name(const atf_perf_counter_t);
+uint64_t atf_perf_counters_total(const atf_perf_counters_t *,
+                                 const atf_perf_counter_t);
+atf_error_t atf_perf_counters_format(const atf_perf_counters_t *,
+                                     const size_t, atf_dynstr_t *);
+
+/* Modifiers. */
+void atf_perf_counters_reset(atf_perf_counters_t *);
+void atf_perf_counters_start(atf_perf_counters_t *);
+void atf_perf_counters_stop(atf_perf_counters_t *);
+
+/* ---------------------------------------------------------------------
+ * The "atf_perf_conditions" type.
+ * --------------------------------------------------------------------- */
+
+/* The conditions under which the benchmarks of the running process run:
+ * pinned to a list of CPUs, if any, and with a raised scheduling priority
+ * if requested.  The nice value is only known once applied. */
+struct atf_perf_conditions {
+    char *m_cpus;
+    bool m_raise;
+    bool m_niced;
+    int m_nice;
+};
+typedef struct atf_perf_conditions atf_perf_conditions_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_perf_conditions_init(atf_perf_conditions_t *, const char *,
+                                     const bool);
+void atf_perf_conditions_fini(atf_perf_conditions_t *);
+
+/* Getters. */
+atf_error_t atf_perf_conditions_format(const atf_perf_conditions_t *,
+                                       atf_dynstr_t *);
+
+/* Modifiers. */
+atf_error_t atf_perf_conditions_apply(atf_perf_conditions_t *);
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/* Upper bound of the CPU numbers that atf_perf_parse_cpus accepts. */
+#define ATF_PERF_MAX_CPUS 1024
+
+atf_error_t atf_perf_parse_cpus(const char *, bool *);
+atf_error_t atf_perf_pin(const char *);
+int atf_perf_raise_priority(void);
+
+#endif /* !defined(ATF_C_DETAIL_PERF_H) */
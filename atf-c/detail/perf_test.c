@@ -0,0 +1,287 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "config.h"
+
+#include "atf-c/detail/perf.h"
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+void
+check_cpus(const char *str, const char *expected)
+{
+    bool cpus[ATF_PERF_MAX_CPUS];
+    char buf[64];
+    size_t i, len;
+
+    printf("Parsing '%s'\n", str);
+    RE(atf_perf_parse_cpus(str, cpus));
+
+    len = 0;
+    for (i = 0; i < ATF_PERF_MAX_CPUS; i++)
+        if (cpus[i])
+            len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%s%zu",
+                                    len == 0 ? "" : " ", i);
+    buf[len] = '\0';
+    ATF_CHECK_STREQ(expected, buf);
+}
+
+static
+void
+check_invalid_cpus(const char *str)
+{
+    bool cpus[ATF_PERF_MAX_CPUS];
+    atf_error_t err;
+
+    printf("Parsing '%s'\n", str);
+    err = atf_perf_parse_cpus(str, cpus);
+    ATF_CHECK(atf_is_error(err));
+    if (atf_is_error(err)) {
+        ATF_CHECK(atf_error_is(err, "libc"));
+        atf_error_free(err);
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_perf_counters" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(counters_software);
+ATF_TC_HEAD(counters_software, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the software counters are "
+                      "always available and count the measured intervals "
+                      "only");
+}
+ATF_TC_BODY(counters_software, tc)
+{
+    atf_perf_counters_t c;
+    volatile unsigned long counter = 0;
+    unsigned long i;
+    char *buf;
+    size_t size = 16 * 1024 * 1024;
+
+    atf_perf_counters_init(&c);
+    ATF_CHECK(atf_perf_counters_available(&c, ATF_PERF_TASK_CLOCK));
+    ATF_CHECK(atf_perf_counters_available(&c, ATF_PERF_PAGE_FAULTS));
+    ATF_CHECK_EQ(0, atf_perf_counters_total(&c, ATF_PERF_TASK_CLOCK));
+
+    atf_perf_counters_start(&c);
+    for (i = 0; i < 10000000; i++)
+        counter++;
+    buf = malloc(size);
+    ATF_REQUIRE(buf != NULL);
+    memset(buf, 1, size);
+    atf_perf_counters_stop(&c);
+    free(buf);
+
+    ATF_CHECK(atf_perf_counters_total(&c, ATF_PERF_TASK_CLOCK) > 1000000);
+    ATF_CHECK(atf_perf_counters_total(&c, ATF_PERF_PAGE_FAULTS) > 0);
+    if (atf_perf_counters_available(&c, ATF_PERF_INSTRUCTIONS))
+        ATF_CHECK(atf_perf_counters_total(&c, ATF_PERF_INSTRUCTIONS) >
+                  10000000);
+
+    atf_perf_counters_reset(&c);
+    ATF_CHECK_EQ(0, atf_perf_counters_total(&c, ATF_PERF_TASK_CLOCK));
+    ATF_CHECK_EQ(0, atf_perf_counters_total(&c, ATF_PERF_PAGE_FAULTS));
+    atf_perf_counters_fini(&c);
+}
+
+ATF_TC(counters_format);
+ATF_TC_HEAD(counters_format, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the available counters are "
+                      "formatted per iteration");
+}
+ATF_TC_BODY(counters_format, tc)
+{
+    atf_perf_counters_t c;
+    atf_dynstr_t out;
+    char expected[256];
+
+    atf_perf_counters_init(&c);
+    c.m_totals[ATF_PERF_TASK_CLOCK] = 1000;
+    c.m_totals[ATF_PERF_PAGE_FAULTS] = 3;
+    c.m_totals[ATF_PERF_CYCLES] = 4000;
+    c.m_totals[ATF_PERF_INSTRUCTIONS] = 8000;
+
+    RE(atf_dynstr_init(&out));
+    RE(atf_perf_counters_format(&c, 8, &out));
+    snprintf(expected, sizeof(expected), "task-clock: 125.000\n"
+             "page-faults: 0.375\n%s%s",
+             atf_perf_counters_available(&c, ATF_PERF_CYCLES) ?
+             "cycles: 500.000\n" : "",
+             atf_perf_counters_available(&c, ATF_PERF_INSTRUCTIONS) ?
+             "instructions: 1000.000\n" : "");
+    ATF_CHECK_STREQ(expected, atf_dynstr_cstring(&out));
+    atf_dynstr_fini(&out);
+    atf_perf_counters_fini(&c);
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_perf_conditions" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(conditions);
+ATF_TC_HEAD(conditions, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the conditions are recorded "
+                      "even if the process cannot be pinned");
+}
+ATF_TC_BODY(conditions, tc)
+{
+    atf_perf_conditions_t c;
+    atf_dynstr_t out;
+    atf_error_t err;
+    char expected[64];
+
+    RE(atf_perf_conditions_init(&c, NULL, false));
+    RE(atf_perf_conditions_apply(&c));
+    RE(atf_dynstr_init(&out));
+    RE(atf_perf_conditions_format(&c, &out));
+    ATF_CHECK_STREQ("", atf_dynstr_cstring(&out));
+    atf_dynstr_fini(&out);
+    atf_perf_conditions_fini(&c);
+
+    RE(atf_perf_conditions_init(&c, "x", true));
+    err = atf_perf_conditions_apply(&c);
+    ATF_REQUIRE(atf_is_error(err));
+    atf_error_free(err);
+    ATF_CHECK(c.m_niced);
+    RE(atf_dynstr_init(&out));
+    RE(atf_perf_conditions_format(&c, &out));
+    snprintf(expected, sizeof(expected), "cpus: x\nnice: %d\n", c.m_nice);
+    ATF_CHECK_STREQ(expected, atf_dynstr_cstring(&out));
+    atf_dynstr_fini(&out);
+    atf_perf_conditions_fini(&c);
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(parse_cpus);
+ATF_TC_HEAD(parse_cpus, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the parsing of CPU lists");
+}
+ATF_TC_BODY(parse_cpus, tc)
+{
+    check_cpus("0", "0");
+    check_cpus("3", "3");
+    check_cpus("0,2-4", "0 2 3 4");
+    check_cpus("5-5,1", "1 5");
+    check_cpus("1023", "1023");
+
+    check_invalid_cpus("");
+    check_invalid_cpus("a");
+    check_invalid_cpus("-1");
+    check_invalid_cpus("1-");
+    check_invalid_cpus("3-1");
+    check_invalid_cpus("0,");
+    check_invalid_cpus(",0");
+    check_invalid_cpus("0 1");
+    check_invalid_cpus("1024");
+}
+
+ATF_TC(pin);
+ATF_TC_HEAD(pin, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the process can be pinned "
+                      "to one of the CPUs it may run on");
+}
+ATF_TC_BODY(pin, tc)
+{
+#if defined(CPU_SET)
+    cpu_set_t set;
+    char cpu[16];
+    int i;
+
+    ATF_REQUIRE(sched_getaffinity(0, sizeof(set), &set) != -1);
+    for (i = CPU_SETSIZE - 1; i >= 0 && !CPU_ISSET(i, &set); i--)
+        continue;
+    ATF_REQUIRE(i >= 0);
+    snprintf(cpu, sizeof(cpu), "%d", i);
+
+    RE(atf_perf_pin(cpu));
+    ATF_REQUIRE(sched_getaffinity(0, sizeof(set), &set) != -1);
+    ATF_CHECK_EQ(1, CPU_COUNT(&set));
+    ATF_CHECK(CPU_ISSET(i, &set));
+#else
+    atf_tc_skip("CPU pinning is not supported on this platform");
+#endif
+}
+
+ATF_TC(raise_priority);
+ATF_TC_HEAD(raise_priority, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the priority of the process "
+                      "never goes down");
+}
+ATF_TC_BODY(raise_priority, tc)
+{
+    int before, after;
+
+    errno = 0;
+    before = getpriority(PRIO_PROCESS, 0);
+    ATF_REQUIRE(before != -1 || errno == 0);
+
+    after = atf_perf_raise_priority();
+    ATF_CHECK(after <= before);
+    ATF_CHECK_EQ(after, getpriority(PRIO_PROCESS, 0));
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, counters_software);
+    ATF_TP_ADD_TC(tp, counters_format);
+    ATF_TP_ADD_TC(tp, conditions);
+    ATF_TP_ADD_TC(tp, parse_cpus);
+    ATF_TP_ADD_TC(tp, pin);
+    ATF_TP_ADD_TC(tp, raise_priority);
+
+    return atf_no_error();
+}
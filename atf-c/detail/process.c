@@ -28,14 +28,22 @@
 #include "atf-c/detail/process.h"
 
 #include <sys/types.h>
+#if defined(HAVE_SYS_PRCTL_H)
+#include <sys/prctl.h>
+#endif
+#if defined(HAVE_SYS_PROCCTL_H)
+#include <sys/procctl.h>
+#endif
 #include <sys/wait.h>
 
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "atf-c/defs.h"
@@ -657,3 +665,251 @@ out:
     free(argv2);
     return err;
 }
+
+#if defined(PR_SET_CHILD_SUBREAPER)
+static
+void
+children_path(char *buf, const size_t buflen)
+{
+    /* The test programs are single-threaded, so the main thread is the
+     * only one that can have children. */
+    snprintf(buf, buflen, "/proc/self/task/%d/children", (int)getpid());
+}
+#endif
+
+/** Makes the calling process adopt its orphaned descendants.
+ *
+ * Descendants whose parent terminates are reparented to the calling process
+ * instead of to init, so that atf_process_kill_descendants can get rid of
+ * them.  The setting is not inherited by children.  Returns false if the
+ * platform cannot do this or cannot enumerate the descendants afterwards.
+ */
+bool
+atf_process_acquire_reaper(void)
+{
+#if defined(PR_SET_CHILD_SUBREAPER)
+    char path[64];
+
+    children_path(path, sizeof(path));
+    if (access(path, R_OK) == -1)
+        return false;
+    return prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0) != -1;
+#elif defined(PROC_REAP_ACQUIRE)
+    return procctl(P_PID, getpid(), PROC_REAP_ACQUIRE, NULL) != -1 ||
+        errno == EBUSY;
+#else
+    return false;
+#endif
+}
+
+#if defined(PR_SET_CHILD_SUBREAPER) || defined(PROC_REAP_KILL)
+static
+void
+deadline_init(struct timespec *deadline, const unsigned int grace)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += grace / 1000;
+    deadline->tv_nsec += (long)(grace % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+/** Sleeps for a little while unless the deadline has passed already.
+ *
+ * Returns whether it did sleep. */
+static
+bool
+deadline_wait(const struct timespec *deadline)
+{
+    const struct timespec step = { 0, 10 * 1000 * 1000 };
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > deadline->tv_sec ||
+        (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec))
+        return false;
+    nanosleep(&step, NULL);
+    return true;
+}
+
+/** Reaps the given children as they terminate until the deadline passes.
+ *
+ * The children that terminate are removed from pids; returns how many are
+ * left. */
+static
+size_t
+reap_until(pid_t *pids, size_t npids, const struct timespec *deadline)
+{
+    size_t i;
+    pid_t ret;
+
+    do {
+        for (i = 0; i < npids; ) {
+            ret = waitpid(pids[i], NULL, WNOHANG);
+            if (ret == pids[i] || (ret == -1 && errno == ECHILD))
+                pids[i] = pids[--npids];
+            else
+                i++;
+        }
+    } while (npids > 0 && deadline_wait(deadline));
+    return npids;
+}
+
+static
+bool
+is_spared(const pid_t pid, const pid_t *spare, const size_t nspare)
+{
+    size_t i;
+
+    for (i = 0; i < nspare; i++) {
+        if (spare[i] == pid)
+            return true;
+    }
+    return false;
+}
+
+/** Sends a signal to a child of the reaper and to its descendants.
+ *
+ * Returns whether the child itself got the signal. */
+static
+bool
+signal_child(const pid_t pid, const int sig)
+{
+#if defined(PROC_REAP_KILL)
+    struct procctl_reaper_kill rk;
+
+    memset(&rk, 0, sizeof(rk));
+    rk.rk_sig = sig;
+    rk.rk_flags = REAPER_KILL_SUBTREE;
+    rk.rk_subtree = pid;
+    (void)procctl(P_PID, getpid(), PROC_REAP_KILL, &rk);
+#endif
+    /* On Linux, the descendants of the child are adopted once it dies and
+     * get their signals in the next round. */
+    return kill(pid, sig) == 0;
+}
+#endif
+
+/** Lists the children of the calling process.
+ *
+ * Once it is a reaper, these include the orphaned descendants that it
+ * adopted.  At most maxpids of them are stored in pids; npids is set to
+ * their number.  Lists none where the platform cannot tell.
+ */
+atf_error_t
+atf_process_list_children(pid_t *pids, const size_t maxpids, size_t *npids)
+{
+#if defined(PR_SET_CHILD_SUBREAPER)
+    char path[64];
+    FILE *f;
+    int pid;
+
+    children_path(path, sizeof(path));
+    f = fopen(path, "r");
+    if (f == NULL)
+        return atf_libc_error(errno, "Cannot list the children of "
+                              "process %d", (int)getpid());
+    *npids = 0;
+    while (*npids < maxpids && fscanf(f, "%d", &pid) == 1)
+        pids[(*npids)++] = (pid_t)pid;
+    fclose(f);
+    return atf_no_error();
+#elif defined(PROC_REAP_GETPIDS)
+    struct procctl_reaper_pidinfo info[64];
+    struct procctl_reaper_pids rp;
+    size_t i;
+
+    memset(info, 0, sizeof(info));
+    memset(&rp, 0, sizeof(rp));
+    rp.rp_count = sizeof(info) / sizeof(info[0]);
+    rp.rp_pids = info;
+    if (procctl(P_PID, getpid(), PROC_REAP_GETPIDS, &rp) == -1)
+        return atf_libc_error(errno, "Cannot list the children of "
+                              "process %d", (int)getpid());
+    *npids = 0;
+    for (i = 0; i < rp.rp_count && *npids < maxpids; i++) {
+        if ((info[i].pi_flags & REAPER_PIDINFO_VALID) &&
+            (info[i].pi_flags & REAPER_PIDINFO_CHILD))
+            pids[(*npids)++] = info[i].pi_pid;
+    }
+    return atf_no_error();
+#else
+    (void)pids;
+    (void)maxpids;
+    *npids = 0;
+    return atf_no_error();
+#endif
+}
+
+/** Kills and reaps the descendants of a reaper but for the spared ones.
+ *
+ * Must only be called once the reaper has waited for the children it
+ * started, as it does away with any other child that is not in spare, and
+ * with its descendants.  The descendants get a SIGTERM first so that
+ * daemons can shut down cleanly; those still running grace milliseconds
+ * later get a SIGKILL.  nkilled is set to the number of children that were
+ * still running; those that had already exited are reaped silently.
+ */
+atf_error_t
+atf_process_kill_descendants_except(const unsigned int grace,
+                                    const pid_t *spare, const size_t nspare,
+                                    size_t *nkilled)
+{
+#if defined(PR_SET_CHILD_SUBREAPER) || defined(PROC_REAP_KILL)
+    pid_t pids[64];
+    size_t i, nlisted, nothers, npids;
+    struct timespec deadline;
+    atf_error_t err;
+
+    *nkilled = 0;
+    do {
+        err = atf_process_list_children(pids, sizeof(pids) / sizeof(pids[0]),
+                                        &nlisted);
+        if (atf_is_error(err))
+            return err;
+
+        nothers = 0;
+        npids = 0;
+        for (i = 0; i < nlisted; i++) {
+            if (is_spared(pids[i], spare, nspare))
+                continue;
+            nothers++;
+            if (waitpid(pids[i], NULL, WNOHANG) == pids[i])
+                continue;
+            if (signal_child(pids[i], SIGTERM))
+                (*nkilled)++;
+            pids[npids++] = pids[i];
+        }
+
+        deadline_init(&deadline, grace);
+        npids = reap_until(pids, npids, &deadline);
+        for (i = 0; i < npids; i++) {
+            signal_child(pids[i], SIGKILL);
+            while (waitpid(pids[i], NULL, 0) == -1 && errno == EINTR)
+                continue;
+        }
+
+        /* The children of the killed processes become ours in turn, so
+         * keep going until there are none left. */
+    } while (nothers > 0);
+    return atf_no_error();
+#else
+    (void)grace;
+    (void)spare;
+    (void)nspare;
+    *nkilled = 0;
+    return atf_no_error();
+#endif
+}
+
+/** Kills and reaps all the descendants of a reaper.
+ *
+ * See atf_process_kill_descendants_except, which this calls sparing none.
+ */
+atf_error_t
+atf_process_kill_descendants(const unsigned int grace, size_t *nkilled)
+{
+    return atf_process_kill_descendants_except(grace, NULL, 0, nkilled);
+}
@@ -30,6 +30,7 @@
 
 #include <signal.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <atf-c/detail/fs.h>
 #include <atf-c/detail/list.h>
@@ -129,4 +130,15 @@ atf_error_t atf_process_exec_list(atf_process_status_t *,
                                   const atf_process_stream_t *,
                                   void (*)(void));
 
+/* Milliseconds that the processes left behind by a test case get to
+ * terminate after a SIGTERM before they get a SIGKILL. */
+#define ATF_PROCESS_KILL_GRACE 1000
+
+bool atf_process_acquire_reaper(void);
+atf_error_t atf_process_list_children(pid_t *, const size_t, size_t *);
+atf_error_t atf_process_kill_descendants(const unsigned int, size_t *);
+atf_error_t atf_process_kill_descendants_except(const unsigned int,
+                                                const pid_t *, const size_t,
+                                                size_t *);
+
 #endif /* !defined(ATF_C_DETAIL_PROCESS_H) */
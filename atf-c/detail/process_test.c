@@ -1104,6 +1104,187 @@ TC_FORK_STREAMS(redirect_path, REDIRECT_PATH, redirect_path, REDIRECT_PATH);
 
 #undef TC_FORK_STREAMS
 
+ATF_TC(kill_descendants);
+ATF_TC_HEAD(kill_descendants, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_process_kill_descendants "
+                      "kills the running orphans adopted by a reaper and "
+                      "silently reaps those that exited");
+}
+ATF_TC_BODY(kill_descendants, tc)
+{
+    size_t nkilled;
+    pid_t pid, orphan;
+    int fds[2];
+    int status;
+
+    if (!atf_process_acquire_reaper())
+        atf_tc_skip("Cannot become the reaper of orphaned processes");
+
+    RE(atf_process_kill_descendants(ATF_PROCESS_KILL_GRACE, &nkilled));
+    ATF_REQUIRE_EQ(0, nkilled);
+
+    ATF_REQUIRE(pipe(fds) != -1);
+    pid = fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        siginfo_t info;
+        pid_t exited;
+
+        orphan = fork();
+        if (orphan == 0) {
+            for (;;)
+                pause();
+        }
+        exited = fork();
+        if (exited == 0)
+            _exit(EXIT_SUCCESS);
+        /* Leave a zombie behind. */
+        waitid(P_PID, (id_t)exited, &info, WEXITED | WNOWAIT);
+        if (write(fds[1], &orphan, sizeof(orphan)) != sizeof(orphan))
+            _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+    ATF_REQUIRE_EQ(sizeof(orphan), read(fds[0], &orphan, sizeof(orphan)));
+    close(fds[0]);
+    ATF_REQUIRE(waitpid(pid, &status, 0) != -1);
+    ATF_REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+
+    RE(atf_process_kill_descendants(ATF_PROCESS_KILL_GRACE, &nkilled));
+    ATF_CHECK_EQ(1, nkilled);
+    ATF_CHECK(kill(orphan, 0) == -1 && errno == ESRCH);
+
+    RE(atf_process_kill_descendants(ATF_PROCESS_KILL_GRACE, &nkilled));
+    ATF_CHECK_EQ(0, nkilled);
+}
+
+static int Term_fd = -1;
+
+static
+void
+term_handler(int sig ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+    const char c = 'T';
+
+    /* Note the signal but keep running, as a stuck daemon would. */
+    if (write(Term_fd, &c, sizeof(c)) != sizeof(c))
+        _exit(EXIT_FAILURE);
+}
+
+ATF_TC(kill_descendants_grace);
+ATF_TC_HEAD(kill_descendants_grace, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_process_kill_descendants "
+                      "sends SIGTERM to the orphans first and SIGKILL to "
+                      "those that ignore it");
+}
+ATF_TC_BODY(kill_descendants_grace, tc)
+{
+    size_t nkilled;
+    pid_t pid, orphan;
+    int fds[2];
+    int status;
+    char c;
+
+    if (!atf_process_acquire_reaper())
+        atf_tc_skip("Cannot become the reaper of orphaned processes");
+
+    ATF_REQUIRE(pipe(fds) != -1);
+    pid = fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        orphan = fork();
+        if (orphan == 0) {
+            Term_fd = fds[1];
+            signal(SIGTERM, term_handler);
+            if (write(fds[1], "R", 1) != 1)
+                _exit(EXIT_FAILURE);
+            for (;;)
+                pause();
+        }
+        _exit(orphan == -1 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    close(fds[1]);
+    ATF_REQUIRE(waitpid(pid, &status, 0) != -1);
+    ATF_REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    ATF_REQUIRE_EQ(1, read(fds[0], &c, 1));
+    ATF_REQUIRE_EQ('R', c);
+
+    RE(atf_process_kill_descendants(100, &nkilled));
+    ATF_CHECK_EQ(1, nkilled);
+    ATF_REQUIRE_EQ(1, read(fds[0], &c, 1));
+    ATF_CHECK_EQ('T', c);
+    ATF_CHECK_EQ(0, read(fds[0], &c, 1));
+    close(fds[0]);
+}
+
+static
+pid_t
+spawn_orphan(void)
+{
+    pid_t pid, orphan;
+    int fds[2];
+    int status;
+
+    ATF_REQUIRE(pipe(fds) != -1);
+    pid = fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        orphan = fork();
+        if (orphan == 0) {
+            for (;;)
+                pause();
+        }
+        if (write(fds[1], &orphan, sizeof(orphan)) != sizeof(orphan))
+            _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+    ATF_REQUIRE_EQ(sizeof(orphan), read(fds[0], &orphan, sizeof(orphan)));
+    close(fds[0]);
+    ATF_REQUIRE(waitpid(pid, &status, 0) != -1);
+    ATF_REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    return orphan;
+}
+
+ATF_TC(kill_descendants_except);
+ATF_TC_HEAD(kill_descendants_except, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that "
+                      "atf_process_kill_descendants_except leaves the spared "
+                      "orphans alone and that atf_process_list_children "
+                      "lists them");
+}
+ATF_TC_BODY(kill_descendants_except, tc)
+{
+    pid_t pids[8];
+    size_t nkilled, npids;
+    pid_t kept, killed;
+
+    if (!atf_process_acquire_reaper())
+        atf_tc_skip("Cannot become the reaper of orphaned processes");
+
+    kept = spawn_orphan();
+    killed = spawn_orphan();
+
+    RE(atf_process_list_children(pids, sizeof(pids) / sizeof(pids[0]),
+                                 &npids));
+    ATF_REQUIRE_EQ(2, npids);
+    ATF_CHECK((pids[0] == kept && pids[1] == killed) ||
+              (pids[0] == killed && pids[1] == kept));
+
+    RE(atf_process_kill_descendants_except(ATF_PROCESS_KILL_GRACE, &kept, 1,
+                                           &nkilled));
+    ATF_CHECK_EQ(1, nkilled);
+    ATF_CHECK(kill(killed, 0) == -1 && errno == ESRCH);
+    ATF_CHECK(kill(kept, 0) == 0);
+
+    RE(atf_process_kill_descendants(ATF_PROCESS_KILL_GRACE, &nkilled));
+    ATF_CHECK_EQ(1, nkilled);
+    ATF_CHECK(kill(kept, 0) == -1 && errno == ESRCH);
+}
+
 /* ---------------------------------------------------------------------
  * Main.
  * --------------------------------------------------------------------- */
@@ -1168,6 +1349,9 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, fork_out_redirect_path_err_inherit);
     ATF_TP_ADD_TC(tp, fork_out_redirect_path_err_redirect_fd);
     ATF_TP_ADD_TC(tp, fork_out_redirect_path_err_redirect_path);
+    ATF_TP_ADD_TC(tp, kill_descendants);
+    ATF_TP_ADD_TC(tp, kill_descendants_grace);
+    ATF_TP_ADD_TC(tp, kill_descendants_except);
 
     return atf_no_error();
 }
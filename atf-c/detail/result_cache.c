@@ -0,0 +1,426 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/result_cache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/binary.h"
+#include "atf-c/detail/env.h"
+#include "atf-c/detail/hash.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/detail/text.h"
+#include "atf-c/error.h"
+#include "atf-c/tc.h"
+
+#define HEADER_FMT "atf-result-cache: %016" PRIx64 "\n"
+#define HEADER_LEN (18 + 16 + 1)
+
+extern char **environ;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+int
+compare_strings(const void *v1, const void *v2)
+{
+    const char *const *s1 = v1, *const *s2 = v2;
+
+    return strcmp(*s1, *s2);
+}
+
+/* Hashes the environment, which is sorted first because its order does not
+ * matter to the test case. */
+static
+atf_error_t
+hash_environ(uint64_t *hash)
+{
+    const char **vars;
+    size_t i, n;
+
+    for (n = 0; environ[n] != NULL; n++)
+        continue;
+    vars = malloc(sizeof(*vars) * (n + 1));
+    if (vars == NULL)
+        return atf_no_memory_error();
+    for (i = 0; i < n; i++)
+        vars[i] = environ[i];
+    qsort(vars, n, sizeof(*vars), compare_strings);
+
+    for (i = 0; i < n; i++)
+        *hash = atf_hash_string(*hash, vars[i]);
+    free(vars);
+    return atf_no_error();
+}
+
+struct input_data {
+    const char *m_srcdir;
+    uint64_t *m_hash;
+};
+
+/* Hashes the name and the contents of an input file of a test case.
+ * Relative names are taken from the source directory.  Files that cannot
+ * be read are hashed as such, so that they become part of the fingerprint
+ * as soon as they can. */
+static
+atf_error_t
+hash_input(const char *name, void *data)
+{
+    struct input_data *id = data;
+    atf_error_t err;
+    atf_fs_path_t path;
+    char buf[4096];
+    ssize_t n;
+    int fd;
+
+    if (name[0] == '/')
+        err = atf_fs_path_init_fmt(&path, "%s", name);
+    else
+        err = atf_fs_path_init_fmt(&path, "%s/%s", id->m_srcdir, name);
+    if (atf_is_error(err))
+        return err;
+
+    *id->m_hash = atf_hash_string(*id->m_hash, atf_fs_path_cstring(&path));
+    fd = open(atf_fs_path_cstring(&path), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        *id->m_hash = atf_hash_string(*id->m_hash, "unreadable");
+    else {
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+            *id->m_hash = atf_hash_bytes(*id->m_hash, buf, (size_t)n);
+        if (n == -1)
+            *id->m_hash = atf_hash_string(*id->m_hash, "unreadable");
+        close(fd);
+    }
+
+    atf_fs_path_fini(&path);
+    return atf_no_error();
+}
+
+/* Benchmarks are never cached: their output is the measurement itself. */
+static
+bool
+is_benchmark(const atf_tc_t *tc)
+{
+    atf_error_t err;
+    bool value;
+
+    if (!atf_tc_has_md_var(tc, "X-benchmark"))
+        return false;
+    err = atf_text_to_bool(atf_tc_get_md_var(tc, "X-benchmark"), &value);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        return false;
+    }
+    return value;
+}
+
+static
+atf_error_t
+fingerprint(const atf_result_cache_t *c, const atf_tc_t *tc, uint64_t *fp)
+{
+    atf_error_t err;
+    struct input_data id;
+    uint64_t hash;
+
+    hash = atf_hash_bytes(ATF_HASH_INIT, &c->m_identity,
+                          sizeof(c->m_identity));
+    hash = atf_hash_bytes(hash, &c->m_vars, sizeof(c->m_vars));
+    hash = atf_hash_string(hash, atf_tc_get_ident(tc));
+
+    err = hash_environ(&hash);
+    if (atf_is_error(err))
+        return err;
+
+    if (atf_tc_has_md_var(tc, "X-cache.inputs")) {
+        id.m_srcdir = atf_tc_has_config_var(tc, "srcdir") ?
+            atf_tc_get_config_var(tc, "srcdir") : ".";
+        id.m_hash = &hash;
+        err = atf_text_for_each_word(atf_tc_get_md_var(tc, "X-cache.inputs"),
+                                     " \t", hash_input, &id);
+        if (atf_is_error(err))
+            return err;
+    }
+
+    *fp = hash;
+    return atf_no_error();
+}
+
+/* An entry of the cache as given to write_entry. */
+struct entry {
+    uint64_t m_fp;
+    const char *m_buf;
+    size_t m_len;
+};
+
+static
+atf_error_t
+write_entry(FILE *f, void *data)
+{
+    const struct entry *e = data;
+
+    fprintf(f, HEADER_FMT, e->m_fp);
+    fwrite(e->m_buf, 1, e->m_len, f);
+    return atf_no_error();
+}
+
+static
+atf_error_t
+cache_file(const atf_result_cache_t *c, const atf_tc_t *tc,
+           atf_fs_path_t *file)
+{
+    return atf_fs_path_init_fmt(file, "%s-%s.atf-result",
+                                atf_fs_path_cstring(&c->m_prefix),
+                                atf_tc_get_ident(tc));
+}
+
+/* Reads a whole file into a newly allocated, NUL-terminated buffer. */
+static
+atf_error_t
+read_file(const char *path, char **buf, size_t *len, bool *found)
+{
+    atf_error_t err;
+    struct stat sb;
+    FILE *f;
+
+    *found = false;
+    f = fopen(path, "r");
+    if (f == NULL)
+        return atf_no_error();
+
+    err = atf_no_error();
+    if (fstat(fileno(f), &sb) == -1 || !S_ISREG(sb.st_mode))
+        goto out;
+
+    *buf = malloc((size_t)sb.st_size + 1);
+    if (*buf == NULL) {
+        err = atf_no_memory_error();
+        goto out;
+    }
+    *len = fread(*buf, 1, (size_t)sb.st_size, f);
+    (*buf)[*len] = '\0';
+    if (*len == (size_t)sb.st_size)
+        *found = true;
+    else
+        free(*buf);
+
+out:
+    fclose(f);
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_result_cache" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+/** Initializes the result cache of the running program.
+ *
+ * The cache is disabled, and all other methods become no-ops, unless the
+ * ATF_RESULT_CACHE_DIR environment variable is set and the binary of the
+ * program can be located.  Relative cache directories are taken from the
+ * directory of the binary.
+ */
+atf_error_t
+atf_result_cache_init(atf_result_cache_t *c, const char *argv0)
+{
+    atf_error_t err;
+    atf_fs_path_t binary;
+    const char *dir;
+    uint64_t loaded;
+    bool found;
+
+    c->m_enabled = false;
+    c->m_identity = 0;
+    c->m_vars = 0;
+
+    if (!atf_env_has("ATF_RESULT_CACHE_DIR"))
+        return atf_no_error();
+    dir = atf_env_get("ATF_RESULT_CACHE_DIR");
+
+    err = atf_binary_find(argv0, &binary, &found);
+    if (atf_is_error(err) || !found)
+        return err;
+
+    err = atf_binary_identity(&binary, &c->m_identity);
+    if (atf_is_error(err))
+        goto out;
+    loaded = atf_binary_loaded_identity();
+    c->m_identity = atf_hash_bytes(c->m_identity, &loaded, sizeof(loaded));
+
+    err = atf_binary_cache_file(&binary, dir, "", &c->m_prefix);
+    if (atf_is_error(err))
+        goto out;
+
+    c->m_enabled = true;
+
+out:
+    atf_fs_path_fini(&binary);
+    return err;
+}
+
+void
+atf_result_cache_fini(atf_result_cache_t *c)
+{
+    if (c->m_enabled)
+        atf_fs_path_fini(&c->m_prefix);
+}
+
+/*
+ * Getters.
+ */
+
+/** Looks up the cached result of a test case.
+ *
+ * If found is set to true, result is initialized to the contents that the
+ * results file had when the test case last passed with the same
+ * fingerprint.  Unreadable, stale or corrupt entries are reported as not
+ * found so that the caller runs the test case.
+ */
+atf_error_t
+atf_result_cache_get(const atf_result_cache_t *c, const atf_tc_t *tc,
+                     atf_dynstr_t *result, bool *found)
+{
+    atf_error_t err;
+    atf_fs_path_t file;
+    char header[HEADER_LEN + 1];
+    char *buf;
+    size_t len;
+    uint64_t fp;
+    bool exists;
+
+    *found = false;
+    if (!c->m_enabled || is_benchmark(tc))
+        return atf_no_error();
+
+    err = fingerprint(c, tc, &fp);
+    if (atf_is_error(err))
+        return err;
+
+    err = cache_file(c, tc, &file);
+    if (atf_is_error(err))
+        return err;
+
+    err = read_file(atf_fs_path_cstring(&file), &buf, &len, &exists);
+    if (atf_is_error(err) || !exists)
+        goto out;
+
+    snprintf(header, sizeof(header), HEADER_FMT, fp);
+    if (len > HEADER_LEN && memcmp(buf, header, HEADER_LEN) == 0) {
+        err = atf_dynstr_init_raw(result, buf + HEADER_LEN,
+                                  len - HEADER_LEN);
+        if (!atf_is_error(err))
+            *found = true;
+    }
+    free(buf);
+
+out:
+    atf_fs_path_fini(&file);
+    return err;
+}
+
+/*
+ * Modifiers.
+ */
+
+void
+atf_result_cache_add_var(atf_result_cache_t *c, const char *name,
+                         const char *value)
+{
+    /* Summing the hashes of the variables makes their order irrelevant. */
+    c->m_vars += atf_hash_string(atf_hash_string(ATF_HASH_INIT, name),
+                                 value);
+}
+
+/** Stores the result of a test case if it passed.
+ *
+ * The result is read back from resfile, which is left untouched; results
+ * that cannot be read back, such as those printed to stdout, and results
+ * other than 'passed' are not stored.  The entry is written to a temporary
+ * file that is then renamed so that concurrent readers never see it
+ * half-written.
+ */
+atf_error_t
+atf_result_cache_put(const atf_result_cache_t *c, const atf_tc_t *tc,
+                     const char *resfile)
+{
+    atf_error_t err;
+    atf_fs_path_t dir, file;
+    struct entry e;
+    char *buf;
+    size_t len;
+    uint64_t fp;
+    bool exists;
+
+    if (!c->m_enabled || is_benchmark(tc))
+        return atf_no_error();
+
+    err = read_file(resfile, &buf, &len, &exists);
+    if (atf_is_error(err) || !exists)
+        return err;
+    if (strncmp(buf, "passed\n", 7) != 0)
+        goto out_buf;
+
+    err = fingerprint(c, tc, &fp);
+    if (atf_is_error(err))
+        goto out_buf;
+
+    err = atf_fs_path_branch_path(&c->m_prefix, &dir);
+    if (atf_is_error(err))
+        goto out_buf;
+    if (mkdir(atf_fs_path_cstring(&dir), 0755) == -1 && errno != EEXIST)
+        err = atf_libc_error(errno, "Cannot create cache directory %s",
+                             atf_fs_path_cstring(&dir));
+    atf_fs_path_fini(&dir);
+    if (atf_is_error(err))
+        goto out_buf;
+
+    err = cache_file(c, tc, &file);
+    if (atf_is_error(err))
+        goto out_buf;
+
+    e.m_fp = fp;
+    e.m_buf = buf;
+    e.m_len = len;
+    err = atf_fs_write_atomic(&file, true, write_entry, &e);
+    atf_fs_path_fini(&file);
+
+out_buf:
+    free(buf);
+    return err;
+}
@@ -0,0 +1,1410 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/runner.h"
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atf-c/detail/durations.h"
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/fs.h"
+#include "atf-c/detail/hash.h"
+#include "atf-c/detail/list.h"
+#include "atf-c/detail/process.h"
+#include "atf-c/detail/result_cache.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/detail/tc.h"
+#include "atf-c/detail/text.h"
+#include "atf-c/error.h"
+#include "atf-c/tc.h"
+
+/* State of the server, if any, that children must get rid of. */
+static int Server_fds[2] = { -1, -1 };
+static bool Server_sigpipe_saved = false;
+static struct sigaction Server_old_sigpipe;
+
+/* The process that became the reaper of the orphaned descendants of the
+ * children it forks, if any; children do not inherit the setting. */
+static pid_t Reaper_pid = -1;
+static bool Reaper_ok = false;
+
+/* The children of the reaper that outlived the part of the test case that
+ * left them behind, along with that test case.  Those of a test case whose
+ * cleanup routine has yet to run are spared when the leftovers of others
+ * are killed. */
+struct leftover {
+    const atf_tc_t *m_tc;
+    pid_t m_pid;
+};
+static struct leftover Leftovers[64];
+static size_t Leftovers_count = 0;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+struct child_data {
+    const atf_runner_job_t *m_job;
+    const char *m_resfile;
+};
+
+static
+void
+run_child(void *v)
+{
+    const struct child_data *cd = v;
+    atf_error_t err;
+    size_t i;
+
+    for (i = 0; i < sizeof(Server_fds) / sizeof(Server_fds[0]); i++) {
+        if (Server_fds[i] != -1)
+            close(Server_fds[i]);
+    }
+    if (Server_sigpipe_saved) {
+        int fd;
+
+        sigaction(SIGPIPE, &Server_old_sigpipe, NULL);
+
+        /* The commands of a server may come from stdin, and anything that
+         * the test case reads from it would be lost to the server. */
+        fd = open("/dev/null", O_RDONLY);
+        if (fd == -1 || dup2(fd, STDIN_FILENO) == -1) {
+            fprintf(stderr, "Cannot redirect stdin to /dev/null: %s\n",
+                    strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if (fd != STDIN_FILENO)
+            close(fd);
+    }
+
+    err = atf_no_error(); /* Silence GCC warning. */
+    switch (cd->m_job->m_part) {
+    case atf_runner_part_body:
+        /* Only returns on error; the result is reported by exiting. */
+        err = atf_tc_run(cd->m_job->m_tc, cd->m_resfile);
+        break;
+
+    case atf_runner_part_cleanup:
+        err = atf_tc_cleanup(cd->m_job->m_tc);
+        break;
+
+    default:
+        UNREACHABLE;
+    }
+
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        fprintf(stderr, "Unhandled error: %s\n", buf);
+        atf_error_free(err);
+
+        exit(EXIT_FAILURE);
+    } else
+        exit(EXIT_SUCCESS);
+}
+
+/** Attributes the new children of the reaper to the job that just ended.
+ *
+ * Children that are gone are forgotten; those that were already known keep
+ * the test case that left them behind. */
+static
+void
+track_leftovers(const atf_runner_job_t *job)
+{
+    pid_t pids[sizeof(Leftovers) / sizeof(Leftovers[0])];
+    struct leftover known[sizeof(Leftovers) / sizeof(Leftovers[0])];
+    size_t i, j, npids;
+    atf_error_t err;
+
+    err = atf_process_list_children(pids, sizeof(pids) / sizeof(pids[0]),
+                                    &npids);
+    if (atf_is_error(err)) {
+        /* Reported by reap_leftovers, if it ever runs. */
+        atf_error_free(err);
+        return;
+    }
+
+    memcpy(known, Leftovers, sizeof(known));
+    for (i = 0; i < npids; i++) {
+        Leftovers[i].m_tc = job->m_tc;
+        Leftovers[i].m_pid = pids[i];
+        for (j = 0; j < Leftovers_count; j++) {
+            if (known[j].m_pid == pids[i]) {
+                Leftovers[i].m_tc = known[j].m_tc;
+                break;
+            }
+        }
+    }
+    Leftovers_count = npids;
+}
+
+/** Kills the processes left behind by a test case that terminated.
+ *
+ * Only called once the last part of the test case is done: the cleanup
+ * routine, if any, may have to stop the daemons that the body started.
+ * Bodies run under the supervisor of atf_tc_run without a cleanup routine
+ * clean up after themselves already, so this mostly catches what cleanup
+ * routines leave behind.  The processes left behind by other test cases,
+ * whose cleanup routines have yet to run, are spared.  The leak is also
+ * noted in the results. */
+static
+void
+reap_leftovers(const atf_runner_job_t *job, const char *resfile)
+{
+    pid_t spare[sizeof(Leftovers) / sizeof(Leftovers[0])];
+    atf_error_t err;
+    size_t i, nkilled, nspare;
+
+    if (!Reaper_ok)
+        return;
+
+    track_leftovers(job);
+    nspare = 0;
+    for (i = 0; i < Leftovers_count; i++) {
+        if (Leftovers[i].m_tc != job->m_tc)
+            spare[nspare++] = Leftovers[i].m_pid;
+    }
+
+    err = atf_process_kill_descendants_except(ATF_PROCESS_KILL_GRACE, spare,
+                                              nspare, &nkilled);
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        fprintf(stderr, "WARNING: Cannot kill the processes left behind by "
+                "test case `%s': %s\n", atf_tc_get_ident(job->m_tc), buf);
+    } else if (nkilled > 0) {
+        fprintf(stderr, "WARNING: Test case `%s' left %zu process(es) "
+                "behind; killed them\n", atf_tc_get_ident(job->m_tc),
+                nkilled);
+        atf_tc_record_leak(resfile, nkilled);
+    }
+    track_leftovers(job);
+}
+
+/** Raises the signal that killed a child, if any, in the caller. */
+static
+void
+mirror_signal(const atf_process_status_t *status)
+{
+    if (atf_process_status_signaled(status)) {
+        const int signo = atf_process_status_termsig(status);
+        const struct rlimit rl = { 0, 0 };
+        sigset_t mask;
+
+        /* The child has already dumped core if it had to. */
+        setrlimit(RLIMIT_CORE, &rl);
+        signal(signo, SIG_DFL);
+        sigemptyset(&mask);
+        sigaddset(&mask, signo);
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        raise(signo);
+    }
+}
+
+static
+atf_error_t
+prepare_resdir(const char *resdir)
+{
+    atf_error_t err;
+
+    /* All the test cases share the collector listening on a socket. */
+    if (atf_tc_resfile_is_socket(resdir))
+        return atf_no_error();
+
+    if (mkdir(resdir, 0755) == -1 && errno != EEXIST)
+        err = atf_libc_error(errno, "Cannot create results directory '%s'",
+                             resdir);
+    else
+        err = atf_no_error();
+
+    return err;
+}
+
+/** Splits a "<tc>[:<part>]" argument into its components.
+ *
+ * valid is set to false, and tcname left uninitialized, if the part is not
+ * known.
+ */
+static
+atf_error_t
+parse_tcarg(const char *tcarg, atf_dynstr_t *tcname,
+            enum atf_runner_part *part, bool *valid)
+{
+    const char *delim;
+
+    *valid = true;
+
+    delim = strchr(tcarg, ':');
+    if (delim == NULL) {
+        *part = atf_runner_part_body;
+        return atf_dynstr_init_fmt(tcname, "%s", tcarg);
+    }
+
+    if (strcmp(delim + 1, "body") == 0)
+        *part = atf_runner_part_body;
+    else if (strcmp(delim + 1, "cleanup") == 0)
+        *part = atf_runner_part_cleanup;
+    else {
+        *valid = false;
+        return atf_no_error();
+    }
+
+    return atf_dynstr_init_raw(tcname, tcarg, delim - tcarg);
+}
+
+/* ---------------------------------------------------------------------
+ * The "line_reader" auxiliary type.
+ * --------------------------------------------------------------------- */
+
+/* Unbuffered stdio would do, but we must not share any buffered input
+ * with the children we fork while a command is being processed. */
+struct line_reader {
+    int m_fd;
+    char m_buf[1024];
+    size_t m_len;
+};
+
+static
+void
+line_reader_init(struct line_reader *lr, const int fd)
+{
+    lr->m_fd = fd;
+    lr->m_len = 0;
+}
+
+/** Reads the next line, without its terminator, from the reader.
+ *
+ * eof is set to true if the input was exhausted before any character could
+ * be read, in which case line is left uninitialized.
+ */
+static
+atf_error_t
+line_reader_next(struct line_reader *lr, atf_dynstr_t *line, bool *eof)
+{
+    atf_error_t err;
+
+    *eof = false;
+    err = atf_dynstr_init(line);
+    if (atf_is_error(err))
+        return err;
+
+    for (;;) {
+        const char *nl;
+        size_t len;
+        ssize_t ret;
+
+        nl = memchr(lr->m_buf, '\n', lr->m_len);
+        len = nl == NULL ? lr->m_len : (size_t)(nl - lr->m_buf);
+        if (len > 0) {
+            err = atf_dynstr_append_fmt(line, "%.*s", (int)len, lr->m_buf);
+            if (atf_is_error(err))
+                break;
+        }
+
+        if (nl != NULL) {
+            memmove(lr->m_buf, nl + 1, lr->m_len - len - 1);
+            lr->m_len -= len + 1;
+            break;
+        }
+        lr->m_len = 0;
+
+        ret = read(lr->m_fd, lr->m_buf, sizeof(lr->m_buf));
+        if (ret == -1) {
+            if (errno == EINTR)
+                continue;
+            err = atf_libc_error(errno, "Failed to read command");
+            break;
+        } else if (ret == 0) {
+            *eof = atf_dynstr_length(line) == 0;
+            break;
+        }
+        lr->m_len = (size_t)ret;
+    }
+
+    if (atf_is_error(err) || *eof)
+        atf_dynstr_fini(line);
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * The server.
+ * --------------------------------------------------------------------- */
+
+struct server {
+    atf_runner_lookup_t m_lookup;
+    const void *m_lookup_data;
+    int m_replyfd;
+};
+
+static
+atf_error_t
+reply(const struct server *srv, const char *fmt, ...)
+{
+    atf_error_t err;
+    atf_dynstr_t line;
+    const char *ptr;
+    size_t left;
+    va_list ap;
+
+    va_start(ap, fmt);
+    err = atf_dynstr_init_ap(&line, fmt, ap);
+    va_end(ap);
+    if (atf_is_error(err))
+        return err;
+
+    err = atf_dynstr_append_fmt(&line, "\n");
+    if (atf_is_error(err))
+        goto out;
+
+    ptr = atf_dynstr_cstring(&line);
+    left = atf_dynstr_length(&line);
+    while (left > 0) {
+        const ssize_t ret = write(srv->m_replyfd, ptr, left);
+        if (ret == -1) {
+            if (errno == EINTR)
+                continue;
+            err = atf_libc_error(errno, "Failed to send reply");
+            break;
+        }
+        ptr += ret;
+        left -= (size_t)ret;
+    }
+
+out:
+    atf_dynstr_fini(&line);
+    return err;
+}
+
+static
+atf_error_t
+reply_error(const struct server *srv, atf_error_t failure)
+{
+    char buf[1024];
+
+    atf_error_format(failure, buf, sizeof(buf));
+    atf_error_free(failure);
+    return reply(srv, "error %s", buf);
+}
+
+static
+atf_error_t
+init_output(atf_process_stream_t *sb, atf_fs_path_t *path, const char *name)
+{
+    atf_error_t err;
+
+    if (name == NULL)
+        return atf_process_stream_init_redirect_fd(sb, STDERR_FILENO);
+
+    err = atf_fs_path_init_fmt(path, "%s", name);
+    if (atf_is_error(err))
+        return err;
+
+    err = atf_process_stream_init_redirect_path(sb, path);
+    if (atf_is_error(err))
+        atf_fs_path_fini(path);
+    return err;
+}
+
+static
+void
+fini_output(atf_process_stream_t *sb, atf_fs_path_t *path, const char *name)
+{
+    atf_process_stream_fini(sb);
+    if (name != NULL)
+        atf_fs_path_fini(path);
+}
+
+/** Executes a "run <tc>[:<part>] <resfile> [<stdout> [<stderr>]]" command.
+ *
+ * The outcome of the test case is always reported to the client; only
+ * errors in talking to the client are returned.
+ */
+static
+atf_error_t
+run_command(const struct server *srv, const atf_list_t *words)
+{
+    atf_error_t err;
+    atf_dynstr_t tcname;
+    atf_runner_job_t job;
+    atf_process_stream_t outsb, errsb;
+    atf_fs_path_t outpath, errpath;
+    atf_process_status_t status;
+    const char *outname, *errname;
+    const size_t nwords = atf_list_size(words);
+    bool valid;
+
+    outname = nwords > 3 ? atf_list_index_c(words, 3) : NULL;
+    errname = nwords > 4 ? atf_list_index_c(words, 4) : NULL;
+
+    err = parse_tcarg(atf_list_index_c(words, 1), &tcname, &job.m_part,
+                      &valid);
+    if (atf_is_error(err))
+        return err;
+    else if (!valid)
+        return reply(srv, "error Invalid test case part in `%s'",
+                     (const char *)atf_list_index_c(words, 1));
+
+    job.m_tc = srv->m_lookup(atf_dynstr_cstring(&tcname), srv->m_lookup_data);
+    if (job.m_tc == NULL) {
+        err = reply(srv, "error Unknown test case `%s'",
+                    atf_dynstr_cstring(&tcname));
+        goto out_tcname;
+    }
+
+    err = init_output(&outsb, &outpath, outname);
+    if (atf_is_error(err)) {
+        err = reply_error(srv, err);
+        goto out_tcname;
+    }
+
+    err = init_output(&errsb, &errpath, errname);
+    if (atf_is_error(err)) {
+        err = reply_error(srv, err);
+        goto out_outsb;
+    }
+
+    err = atf_runner_fork(&job, atf_list_index_c(words, 2), &outsb, &errsb,
+                          &status);
+    if (atf_is_error(err))
+        err = reply_error(srv, err);
+    else {
+        if (atf_process_status_exited(&status))
+            err = reply(srv, "exit %d",
+                        atf_process_status_exitstatus(&status));
+        else {
+            INV(atf_process_status_signaled(&status));
+            err = reply(srv, "signal %d", atf_process_status_termsig(&status));
+        }
+        atf_process_status_fini(&status);
+    }
+
+    fini_output(&errsb, &errpath, errname);
+out_outsb:
+    fini_output(&outsb, &outpath, outname);
+out_tcname:
+    atf_dynstr_fini(&tcname);
+    return err;
+}
+
+static
+atf_error_t
+handle_command(const struct server *srv, const char *line, bool *quit)
+{
+    atf_error_t err;
+    atf_list_t words;
+    const char *cmd;
+    size_t nwords;
+
+    err = atf_text_split(line, " ", &words);
+    if (atf_is_error(err))
+        return err;
+
+    nwords = atf_list_size(&words);
+    cmd = nwords > 0 ? atf_list_index_c(&words, 0) : "";
+    if (strcmp(cmd, "quit") == 0 && nwords == 1)
+        *quit = true;
+    else if (strcmp(cmd, "run") == 0 && nwords >= 3 && nwords <= 5)
+        err = run_command(srv, &words);
+    else
+        err = reply(srv, "error Invalid command `%s'", line);
+
+    atf_list_fini(&words);
+    return err;
+}
+
+/** Processes commands from a stream until it is exhausted or until a client
+ * asks the server to quit. */
+static
+atf_error_t
+serve_stream(struct server *srv, const int infd, const int outfd, bool *quit)
+{
+    atf_error_t err;
+    struct line_reader lr;
+
+    srv->m_replyfd = outfd;
+    line_reader_init(&lr, infd);
+
+    err = atf_no_error();
+    while (!atf_is_error(err) && !*quit) {
+        atf_dynstr_t line;
+        bool eof;
+
+        err = line_reader_next(&lr, &line, &eof);
+        if (atf_is_error(err) || eof)
+            break;
+
+        err = handle_command(srv, atf_dynstr_cstring(&line), quit);
+        atf_dynstr_fini(&line);
+    }
+
+    return err;
+}
+
+static
+atf_error_t
+serve_socket(struct server *srv, const char *path)
+{
+    atf_error_t err;
+    struct sockaddr_un addr;
+    bool quit;
+    int sock;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return atf_libc_error(ENAMETOOLONG, "Socket path '%s' is too long",
+                              path);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == -1)
+        return atf_libc_error(errno, "Cannot create socket");
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        err = atf_libc_error(errno, "Cannot bind socket to '%s'", path);
+        goto out_sock;
+    }
+
+    if (listen(sock, 1) == -1) {
+        err = atf_libc_error(errno, "Cannot listen on '%s'", path);
+        goto out_path;
+    }
+    Server_fds[0] = sock;
+
+    err = atf_no_error();
+    quit = false;
+    while (!atf_is_error(err) && !quit) {
+        const int conn = accept(sock, NULL, NULL);
+        if (conn == -1) {
+            if (errno != EINTR && errno != ECONNABORTED)
+                err = atf_libc_error(errno, "Cannot accept connection");
+            continue;
+        }
+
+        Server_fds[1] = conn;
+        err = serve_stream(srv, conn, conn, &quit);
+        if (atf_is_error(err) && atf_error_is(err, "libc") &&
+            atf_libc_error_code(err) == EPIPE) {
+            /* The client went away; that is not our problem. */
+            atf_error_free(err);
+            err = atf_no_error();
+        }
+        Server_fds[1] = -1;
+        close(conn);
+    }
+    Server_fds[0] = -1;
+
+out_path:
+    unlink(path);
+out_sock:
+    close(sock);
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Worker pool.
+ * --------------------------------------------------------------------- */
+
+/* The parts to execute for a single test case, in the order they were
+ * requested.  All of them share the same work directory. */
+struct group {
+    const atf_runner_job_t *const *m_jobs;
+    size_t m_njobs;
+    const char *m_resdir;
+    const atf_durations_t *m_durations;
+    size_t m_order;
+    int64_t m_usec;  /* Wall time in previous runs; -1 if unknown. */
+};
+
+struct worker {
+    atf_process_child_t m_child;
+    bool m_busy;
+};
+
+/* Appends the wall time of the body of a test case to the history.  The
+ * history is only advisory, so failures do not stop the run. */
+static
+void
+record_duration(const atf_durations_t *durations, const atf_tc_t *tc,
+                const struct timespec *start)
+{
+    atf_error_t err;
+    struct timespec end;
+    int64_t usec;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    usec = (int64_t)(end.tv_sec - start->tv_sec) * 1000000 +
+           (end.tv_nsec - start->tv_nsec) / 1000;
+    err = atf_durations_record(durations, atf_tc_get_ident(tc),
+                               usec < 0 ? 0 : usec);
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        fprintf(stderr, "WARNING: Cannot record the duration of %s: %s\n",
+                atf_tc_get_ident(tc), buf);
+        atf_error_free(err);
+    }
+}
+
+static
+atf_error_t
+run_job(const atf_runner_job_t *job, const char *resdir,
+        const atf_durations_t *durations, bool *ok)
+{
+    atf_error_t err;
+    atf_fs_path_t resfile;
+    atf_process_status_t status;
+    struct timespec start;
+
+    if (atf_tc_resfile_is_socket(resdir))
+        err = atf_fs_path_init_fmt(&resfile, "%s", resdir);
+    else
+        err = atf_fs_path_init_fmt(&resfile, "%s/%s", resdir,
+                                   atf_tc_get_ident(job->m_tc));
+    if (atf_is_error(err))
+        goto out;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err = atf_runner_fork(job, atf_fs_path_cstring(&resfile), NULL, NULL,
+                          &status);
+    if (atf_is_error(err))
+        goto out_resfile;
+    if (job->m_part == atf_runner_part_body)
+        record_duration(durations, job->m_tc, &start);
+
+    *ok = atf_process_status_exited(&status) &&
+          atf_process_status_exitstatus(&status) == EXIT_SUCCESS;
+    atf_process_status_fini(&status);
+
+out_resfile:
+    atf_fs_path_fini(&resfile);
+out:
+    return err;
+}
+
+static
+atf_error_t
+remove_tree(const atf_fs_path_t *path)
+{
+    atf_error_t err;
+    struct stat sb;
+
+    if (lstat(atf_fs_path_cstring(path), &sb) == -1)
+        return atf_libc_error(errno, "Cannot get information of %s",
+                              atf_fs_path_cstring(path));
+
+    if (S_ISDIR(sb.st_mode)) {
+        DIR *dir;
+        struct dirent *de;
+
+        /* The test case may have left unwritable directories behind. */
+        (void)chmod(atf_fs_path_cstring(path), 0700);
+
+        dir = opendir(atf_fs_path_cstring(path));
+        if (dir == NULL)
+            return atf_libc_error(errno, "Cannot open directory %s",
+                                  atf_fs_path_cstring(path));
+
+        err = atf_no_error();
+        while (!atf_is_error(err) && (de = readdir(dir)) != NULL) {
+            atf_fs_path_t entry;
+
+            if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+                continue;
+
+            err = atf_fs_path_init_fmt(&entry, "%s/%s",
+                                       atf_fs_path_cstring(path), de->d_name);
+            if (!atf_is_error(err)) {
+                err = remove_tree(&entry);
+                atf_fs_path_fini(&entry);
+            }
+        }
+        closedir(dir);
+
+        if (!atf_is_error(err))
+            err = atf_fs_rmdir(path);
+    } else
+        err = atf_fs_unlink(path);
+
+    return err;
+}
+
+static
+atf_error_t
+make_workdir(atf_fs_path_t *workdir)
+{
+    atf_error_t err;
+    const char *tmpdir;
+
+    tmpdir = getenv("TMPDIR");
+    if (tmpdir == NULL || tmpdir[0] == '\0')
+        tmpdir = "/tmp";
+
+    err = atf_fs_path_init_fmt(workdir, "%s/atf.XXXXXX", tmpdir);
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_fs_mkdtemp(workdir);
+    if (atf_is_error(err))
+        atf_fs_path_fini(workdir);
+
+out:
+    return err;
+}
+
+static
+atf_error_t
+run_group_parts(const struct group *g, bool *ok)
+{
+    atf_error_t err;
+    atf_fs_path_t workdir;
+    size_t i;
+
+    *ok = true;
+
+    err = make_workdir(&workdir);
+    if (atf_is_error(err))
+        goto out;
+
+    if (chdir(atf_fs_path_cstring(&workdir)) == -1) {
+        err = atf_libc_error(errno, "Cannot enter work directory %s",
+                             atf_fs_path_cstring(&workdir));
+        goto out_workdir;
+    }
+
+    for (i = 0; i < g->m_njobs && !atf_is_error(err); i++) {
+        bool jobok;
+
+        err = run_job(g->m_jobs[i], g->m_resdir, g->m_durations, &jobok);
+        if (!atf_is_error(err) && !jobok)
+            *ok = false;
+    }
+
+    if (chdir("/") == -1 && !atf_is_error(err))
+        err = atf_libc_error(errno, "Cannot leave work directory %s",
+                             atf_fs_path_cstring(&workdir));
+
+out_workdir:
+    /* Only one error can be in flight, so keep the work directory around
+     * for inspection if something already went wrong. */
+    if (!atf_is_error(err))
+        err = remove_tree(&workdir);
+    atf_fs_path_fini(&workdir);
+out:
+    return err;
+}
+
+static
+void
+run_group(void *v)
+{
+    const struct group *g = v;
+    atf_error_t err;
+    bool ok;
+
+    err = run_group_parts(g, &ok);
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        fprintf(stderr, "Unhandled error: %s\n", buf);
+        atf_error_free(err);
+
+        exit(EXIT_FAILURE);
+    } else
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/* Returns the slot of the index that holds the first job of the test case
+ * named ident or, if there is no such job yet, the empty slot where it
+ * would go.  The index entries hold the position of the job plus one. */
+static
+size_t
+group_slot(const size_t *index, const size_t size,
+           const atf_runner_job_t *jobs, const char *ident)
+{
+    size_t i;
+
+    i = (size_t)atf_hash_string(ATF_HASH_INIT, ident) & (size - 1);
+    while (index[i] != 0 &&
+           strcmp(atf_tc_get_ident(jobs[index[i] - 1].m_tc), ident) != 0)
+        i = (i + 1) & (size - 1);
+    return i;
+}
+
+/* Splits the jobs into groups, one per test case, preserving the order in
+ * which the test cases first appear.  jobsbuf receives the jobs reordered
+ * so that every group is contiguous.  The groups are found through a hash
+ * table keyed on the identifier of the test case. */
+static
+size_t
+make_groups(const atf_runner_job_t *jobs, const size_t njobs,
+            const atf_runner_job_t **jobsbuf, struct group *groups,
+            const char *resdir)
+{
+    size_t *index, *group_of;
+    size_t i, n, ngroups, size;
+
+    size = 64;
+    while (size < njobs * 2)
+        size *= 2;
+    index = calloc(size, sizeof(*index));
+    group_of = malloc((njobs > 0 ? njobs : 1) * sizeof(*group_of));
+    if (index == NULL || group_of == NULL) {
+        free(index);
+        free(group_of);
+        return 0;
+    }
+
+    ngroups = 0;
+    for (i = 0; i < njobs; i++) {
+        const size_t slot = group_slot(index, size, jobs,
+                                       atf_tc_get_ident(jobs[i].m_tc));
+
+        if (index[slot] == 0) {
+            index[slot] = i + 1;
+            groups[ngroups].m_njobs = 0;
+            groups[ngroups].m_resdir = resdir;
+            groups[ngroups].m_order = ngroups;
+            group_of[i] = ngroups++;
+        } else
+            group_of[i] = group_of[index[slot] - 1];
+        groups[group_of[i]].m_njobs++;
+    }
+
+    /* Lay the groups out one after the other and fill them in order. */
+    n = 0;
+    for (i = 0; i < ngroups; i++) {
+        groups[i].m_jobs = &jobsbuf[n];
+        n += groups[i].m_njobs;
+        groups[i].m_njobs = 0;
+    }
+    INV(n == njobs);
+
+    for (i = 0; i < njobs; i++) {
+        struct group *g = &groups[group_of[i]];
+
+        jobsbuf[g->m_jobs - jobsbuf + g->m_njobs++] = &jobs[i];
+    }
+
+    free(group_of);
+    free(index);
+    return ngroups;
+}
+
+/* Waits for any of the busy workers to terminate and releases it. */
+static
+atf_error_t
+wait_worker(struct worker *workers, const size_t nworkers, bool *ok)
+{
+    atf_error_t err;
+    siginfo_t info;
+    atf_process_status_t status;
+    size_t i;
+
+    /* Only peek at the terminated child so that its worker can reap it. */
+    while (waitid(P_ALL, 0, &info, WEXITED | WNOWAIT) == -1) {
+        if (errno != EINTR)
+            return atf_libc_error(errno, "Failed waiting for workers");
+    }
+
+    for (i = 0; i < nworkers; i++) {
+        if (workers[i].m_busy &&
+            atf_process_child_pid(&workers[i].m_child) == info.si_pid)
+            break;
+    }
+    if (i == nworkers) {
+        /* Not one of ours; just reap it. */
+        (void)waitpid(info.si_pid, NULL, 0);
+        *ok = true;
+        return atf_no_error();
+    }
+
+    err = atf_process_child_wait(&workers[i].m_child, &status);
+    workers[i].m_busy = false;
+    if (atf_is_error(err))
+        return err;
+
+    *ok = atf_process_status_exited(&status) &&
+          atf_process_status_exitstatus(&status) == EXIT_SUCCESS;
+    atf_process_status_fini(&status);
+    return atf_no_error();
+}
+
+static
+int
+compare_groups(const void *v1, const void *v2)
+{
+    const struct group *g1 = v1, *g2 = v2;
+
+    if (g1->m_usec != g2->m_usec) {
+        if (g1->m_usec == -1)
+            return -1;
+        if (g2->m_usec == -1)
+            return 1;
+        return g1->m_usec > g2->m_usec ? -1 : 1;
+    }
+    return g1->m_order < g2->m_order ? -1 : g1->m_order > g2->m_order;
+}
+
+/* Starts the test cases that took the longest in previous runs first, so
+ * that they do not end up running alone at the end of the batch.  Test
+ * cases without history go even before them because they may be just as
+ * slow. */
+static
+void
+sort_groups(struct group *groups, const size_t ngroups,
+            const atf_durations_t *durations)
+{
+    size_t i;
+
+    for (i = 0; i < ngroups; i++) {
+        groups[i].m_durations = durations;
+        if (!atf_durations_get(durations,
+                               atf_tc_get_ident(groups[i].m_jobs[0]->m_tc),
+                               &groups[i].m_usec))
+            groups[i].m_usec = -1;
+    }
+    if (durations->m_enabled)
+        qsort(groups, ngroups, sizeof(*groups), compare_groups);
+}
+
+static
+atf_error_t
+run_pool(const atf_runner_job_t *jobs, const size_t njobs,
+         const char *resdir, const size_t maxworkers,
+         const atf_durations_t *durations, bool *success)
+{
+    atf_error_t err;
+    atf_fs_path_t resdirpath, absresdir;
+    const atf_runner_job_t **jobsbuf;
+    const char *prefix;
+    struct group *groups;
+    struct worker *workers;
+    size_t i, next, ngroups, nworkers, running;
+
+    PRE(maxworkers > 0);
+
+    /* The workers change their working directory. */
+    prefix = atf_tc_resfile_is_socket(resdir) ? "unix:" : "";
+    err = atf_fs_path_init_fmt(&resdirpath, "%s", resdir + strlen(prefix));
+    if (atf_is_error(err))
+        goto out;
+    if (atf_fs_path_is_absolute(&resdirpath))
+        absresdir = resdirpath;
+    else {
+        err = atf_fs_path_to_absolute(&resdirpath, &absresdir);
+        atf_fs_path_fini(&resdirpath);
+        if (atf_is_error(err))
+            goto out;
+    }
+    if (prefix[0] != '\0') {
+        err = atf_fs_path_init_fmt(&resdirpath, "%s%s", prefix,
+                                   atf_fs_path_cstring(&absresdir));
+        atf_fs_path_fini(&absresdir);
+        if (atf_is_error(err))
+            goto out;
+        absresdir = resdirpath;
+    }
+
+    jobsbuf = malloc(sizeof(*jobsbuf) * (njobs + 1));
+    groups = malloc(sizeof(*groups) * (njobs + 1));
+    nworkers = maxworkers < njobs ? maxworkers : njobs;
+    workers = malloc(sizeof(*workers) * (nworkers + 1));
+    if (jobsbuf == NULL || groups == NULL || workers == NULL) {
+        err = atf_no_memory_error();
+        goto out_bufs;
+    }
+
+    ngroups = make_groups(jobs, njobs, jobsbuf, groups,
+                          atf_fs_path_cstring(&absresdir));
+    if (ngroups == 0 && njobs > 0) {
+        err = atf_no_memory_error();
+        goto out_bufs;
+    }
+    sort_groups(groups, ngroups, durations);
+    for (i = 0; i < nworkers; i++)
+        workers[i].m_busy = false;
+
+    /* Do not let the workers flush any output we have buffered so far. */
+    fflush(stdout);
+    fflush(stderr);
+
+    next = 0;
+    running = 0;
+    while (!atf_is_error(err) && (next < ngroups || running > 0)) {
+        if (next < ngroups && running < nworkers) {
+            for (i = 0; workers[i].m_busy; i++)
+                INV(i < nworkers);
+
+            err = atf_process_fork(&workers[i].m_child, run_group, NULL,
+                                   NULL, &groups[next]);
+            if (!atf_is_error(err)) {
+                workers[i].m_busy = true;
+                next++;
+                running++;
+            }
+        } else {
+            bool ok = true; /* Silence GCC warning. */
+
+            err = wait_worker(workers, nworkers, &ok);
+            if (!atf_is_error(err)) {
+                if (!ok)
+                    *success = false;
+                running--;
+            }
+        }
+    }
+
+    /* Do not leave any orphaned workers behind if something went wrong. */
+    for (i = 0; i < nworkers; i++) {
+        if (workers[i].m_busy) {
+            /* Cannot report a second error; just reap the worker. */
+            (void)waitpid(atf_process_child_pid(&workers[i].m_child),
+                          NULL, 0);
+        }
+    }
+
+out_bufs:
+    free(workers);
+    free(groups);
+    free(jobsbuf);
+    atf_fs_path_fini(&absresdir);
+out:
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Executes a single test case part in a forked child and waits for it.
+ *
+ * outsb and errsb describe where the output of the child goes; NULL means
+ * that the child inherits the corresponding stream of the caller.
+ *
+ * The child inherits the initialized test program, so no head is rerun and
+ * no configuration is parsed again; it terminates as soon as the test case
+ * part does.  If that was the last part of the test case, any descendant
+ * of the child that is still running by then is killed, where the platform
+ * allows the caller to adopt them.
+ */
+atf_error_t
+atf_runner_fork(const atf_runner_job_t *job, const char *resfile,
+                const atf_process_stream_t *outsb,
+                const atf_process_stream_t *errsb,
+                atf_process_status_t *status)
+{
+    atf_error_t err;
+    atf_process_child_t child;
+    struct child_data cd;
+
+    cd.m_job = job;
+    cd.m_resfile = resfile;
+
+    if (Reaper_pid != getpid()) {
+        Reaper_ok = atf_process_acquire_reaper();
+        Reaper_pid = getpid();
+        Leftovers_count = 0;
+    }
+
+    /* Do not let the child flush any output we have buffered so far. */
+    fflush(stdout);
+    fflush(stderr);
+
+    err = atf_process_fork(&child, run_child, outsb, errsb, &cd);
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_process_child_wait(&child, status);
+    if (atf_is_error(err) || !Reaper_ok)
+        goto out;
+    if (job->m_part == atf_runner_part_cleanup ||
+        !atf_tc_has_cleanup(job->m_tc))
+        reap_leftovers(job, resfile);
+    else
+        track_leftovers(job);
+
+out:
+    return err;
+}
+
+/** Executes the body and the cleanup routine of a test case.
+ *
+ * Each part runs in its own child forked from the calling process, one
+ * after the other, so that a test case with a cleanup routine does not need
+ * two invocations of the test program.  The body stores its result in
+ * resfile.  Processes left behind by the body keep running until the
+ * cleanup routine is done, so that it can stop them.
+ *
+ * exitcode is set to the exit code of the body, or to EXIT_FAILURE if the
+ * cleanup routine failed, which is also reported on stderr.  If the body
+ * was killed by a signal, this function raises the same signal once the
+ * cleanup routine is done so that the caller terminates as the body did.
+ */
+atf_error_t
+atf_runner_run_all(const struct atf_tc *tc, const char *resfile,
+                   int *exitcode)
+{
+    atf_error_t err;
+    atf_runner_job_t job;
+    atf_process_status_t bodystatus, cleanupstatus;
+    bool cleanupok;
+
+    job.m_tc = tc;
+    job.m_part = atf_runner_part_body;
+    err = atf_runner_fork(&job, resfile, NULL, NULL, &bodystatus);
+    if (atf_is_error(err))
+        goto out;
+
+    cleanupok = true;
+    if (atf_tc_has_cleanup(tc)) {
+        job.m_part = atf_runner_part_cleanup;
+        err = atf_runner_fork(&job, resfile, NULL, NULL, &cleanupstatus);
+        if (atf_is_error(err))
+            goto out_bodystatus;
+
+        cleanupok = atf_process_status_exited(&cleanupstatus) &&
+            atf_process_status_exitstatus(&cleanupstatus) == EXIT_SUCCESS;
+        atf_process_status_fini(&cleanupstatus);
+        if (!cleanupok)
+            fprintf(stderr, "Cleanup routine of test case `%s' failed\n",
+                    atf_tc_get_ident(tc));
+    }
+
+    mirror_signal(&bodystatus);
+    if (!cleanupok || !atf_process_status_exited(&bodystatus))
+        *exitcode = EXIT_FAILURE;
+    else
+        *exitcode = atf_process_status_exitstatus(&bodystatus);
+
+out_bodystatus:
+    atf_process_status_fini(&bodystatus);
+out:
+    return err;
+}
+
+/* Writes a result taken from the result cache to where the test case would
+ * have written it. */
+static
+atf_error_t
+write_cached_result(const char *resfile, const char *result)
+{
+    atf_error_t err;
+    const size_t len = strlen(result);
+    ssize_t ret;
+    int fd;
+
+    if (strcmp(resfile, "/dev/stdout") == 0)
+        fd = STDOUT_FILENO;
+    else if (strcmp(resfile, "/dev/stderr") == 0)
+        fd = STDERR_FILENO;
+    else {
+        fd = open(resfile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+            return atf_libc_error(errno, "Cannot create results file '%s'",
+                                  resfile);
+    }
+
+    err = atf_no_error();
+    ret = write(fd, result, len);
+    if (ret != (ssize_t)len)
+        err = atf_libc_error(ret == -1 ? errno : EIO,
+                             "Cannot write results file '%s'", resfile);
+    if (fd != STDOUT_FILENO && fd != STDERR_FILENO)
+        close(fd);
+    return err;
+}
+
+/** Executes a test case unless the result cache has its result.
+ *
+ * If the cache has a passing result for the current fingerprint of the
+ * test case, that result is written to resfile and no part of the test
+ * case runs.  Otherwise, the body, and the cleanup routine if with_cleanup
+ * is true, run in forked children as in atf_runner_run_all, and a passing
+ * result is stored in the cache for the next time.  Results sent to a
+ * socket are never cached.
+ */
+atf_error_t
+atf_runner_run_cached(const atf_result_cache_t *cache,
+                      const struct atf_tc *tc, const bool with_cleanup,
+                      const char *resfile, int *exitcode)
+{
+    atf_error_t err;
+    const bool cacheable = !atf_tc_resfile_is_socket(resfile);
+
+    if (cacheable) {
+        atf_dynstr_t result;
+        bool found;
+
+        err = atf_result_cache_get(cache, tc, &result, &found);
+        if (atf_is_error(err))
+            return err;
+        if (found) {
+            err = write_cached_result(resfile, atf_dynstr_cstring(&result));
+            atf_dynstr_fini(&result);
+            if (!atf_is_error(err))
+                *exitcode = EXIT_SUCCESS;
+            return err;
+        }
+    }
+
+    if (with_cleanup)
+        err = atf_runner_run_all(tc, resfile, exitcode);
+    else {
+        atf_runner_job_t job;
+        atf_process_status_t status;
+
+        job.m_tc = tc;
+        job.m_part = atf_runner_part_body;
+        err = atf_runner_fork(&job, resfile, NULL, NULL, &status);
+        if (!atf_is_error(err)) {
+            mirror_signal(&status);
+            *exitcode = atf_process_status_exited(&status) ?
+                atf_process_status_exitstatus(&status) : EXIT_FAILURE;
+            atf_process_status_fini(&status);
+        }
+    }
+
+    if (!atf_is_error(err) && cacheable && *exitcode == EXIT_SUCCESS) {
+        atf_error_t puterr = atf_result_cache_put(cache, tc, resfile);
+
+        if (atf_is_error(puterr)) {
+            char buf[1024];
+
+            atf_error_format(puterr, buf, sizeof(buf));
+            fprintf(stderr, "WARNING: Cannot store the result of %s in the "
+                    "result cache: %s\n", atf_tc_get_ident(tc), buf);
+            atf_error_free(puterr);
+        }
+    }
+    return err;
+}
+
+/** Executes a list of test case parts.
+ *
+ * Each body stores its result in a file named after the test case inside
+ * resdir, which is created if it does not exist yet.  If resdir names a
+ * socket instead, every test case sends its result to it.  success is set to
+ * false if any of the children did not exit cleanly; the details of every
+ * test case are left in the results files.
+ *
+ * If maxworkers is 0, the parts are executed one after the other in the
+ * current directory.  Otherwise, the parts of each test case are executed
+ * in a fresh work directory that is removed afterwards, and the parts of
+ * up to maxworkers different test cases are executed concurrently, longest
+ * first according to durations.
+ *
+ * The wall time of every body is appended to durations.
+ */
+atf_error_t
+atf_runner_run_batch(const atf_runner_job_t *jobs, const size_t njobs,
+                     const char *resdir, const size_t maxworkers,
+                     const atf_durations_t *durations, bool *success)
+{
+    atf_error_t err;
+    size_t i;
+
+    *success = true;
+
+    err = prepare_resdir(resdir);
+    if (atf_is_error(err))
+        goto out;
+
+    if (maxworkers > 0) {
+        err = run_pool(jobs, njobs, resdir, maxworkers, durations, success);
+        goto out;
+    }
+
+    for (i = 0; i < njobs && !atf_is_error(err); i++) {
+        bool ok;
+
+        err = run_job(&jobs[i], resdir, durations, &ok);
+        if (!atf_is_error(err) && !ok)
+            *success = false;
+    }
+
+out:
+    return err;
+}
+
+/** Serves requests to run test cases until told to quit.
+ *
+ * The commands are read from stdin, with replies sent to stdout, if source
+ * is "-"; otherwise, source is the path to a Unix socket to listen on.
+ * Every command is executed in a child forked from the calling process, so
+ * the test program is initialized once for the lifetime of the server.
+ */
+atf_error_t
+atf_runner_serve(const char *source, atf_runner_lookup_t lookup,
+                 const void *data)
+{
+    atf_error_t err;
+    struct server srv;
+    struct sigaction sa;
+
+    srv.m_lookup = lookup;
+    srv.m_lookup_data = data;
+    srv.m_replyfd = -1;
+
+    /* Broken clients must not take the server down with them. */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPIPE, &sa, &Server_old_sigpipe) == -1)
+        return atf_libc_error(errno, "Cannot ignore SIGPIPE");
+    Server_sigpipe_saved = true;
+
+    if (strcmp(source, "-") == 0) {
+        bool quit = false;
+        err = serve_stream(&srv, STDIN_FILENO, STDOUT_FILENO, &quit);
+    } else
+        err = serve_socket(&srv, source);
+
+    sigaction(SIGPIPE, &Server_old_sigpipe, NULL);
+    Server_sigpipe_saved = false;
+
+    return err;
+}
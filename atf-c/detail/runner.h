@@ -0,0 +1,78 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_RUNNER_H)
+#define ATF_C_DETAIL_RUNNER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <atf-c/detail/durations.h>
+#include <atf-c/detail/process.h>
+#include <atf-c/detail/result_cache.h>
+#include <atf-c/error_fwd.h>
+
+struct atf_tc;
+
+/* ---------------------------------------------------------------------
+ * The "atf_runner_job" type.
+ * --------------------------------------------------------------------- */
+
+enum atf_runner_part {
+    atf_runner_part_body,
+    atf_runner_part_cleanup,
+};
+
+/* A test case part to be executed in a forked child of the test program. */
+struct atf_runner_job {
+    const struct atf_tc *m_tc;
+    enum atf_runner_part m_part;
+};
+typedef struct atf_runner_job atf_runner_job_t;
+
+/* Resolves a test case name to its test case; NULL if there is no such
+ * test case.  Must not fail in any other way. */
+typedef const struct atf_tc *(*atf_runner_lookup_t)(const char *,
+                                                   const void *);
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+atf_error_t atf_runner_fork(const atf_runner_job_t *, const char *,
+                            const atf_process_stream_t *,
+                            const atf_process_stream_t *,
+                            atf_process_status_t *);
+atf_error_t atf_runner_run_all(const struct atf_tc *, const char *, int *);
+atf_error_t atf_runner_run_cached(const atf_result_cache_t *,
+                                  const struct atf_tc *, const bool,
+                                  const char *, int *);
+atf_error_t atf_runner_run_batch(const atf_runner_job_t *, const size_t,
+                                 const char *, const size_t,
+                                 const atf_durations_t *, bool *);
+atf_error_t atf_runner_serve(const char *, atf_runner_lookup_t,
+                             const void *);
+
+#endif /* !defined(ATF_C_DETAIL_RUNNER_H) */
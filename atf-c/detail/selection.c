@@ -0,0 +1,166 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/selection.h"
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atf-c/detail/hash.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+bool
+parse_size(const char *str, const char *end, size_t *value)
+{
+    unsigned long long v;
+    char *endptr;
+
+    if (str == end || *str < '0' || *str > '9')
+        return false;
+
+    errno = 0;
+    v = strtoull(str, &endptr, 10);
+    if (errno != 0 || endptr != end || v > SIZE_MAX)
+        return false;
+
+    *value = (size_t)v;
+    return true;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_selection" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+void
+atf_selection_init(atf_selection_t *s)
+{
+    s->m_glob = NULL;
+    s->m_regex_str = NULL;
+    s->m_has_regex = false;
+    s->m_shard_str = NULL;
+    s->m_shard = 0;
+    s->m_nshards = 0;
+}
+
+void
+atf_selection_fini(atf_selection_t *s)
+{
+    if (s->m_has_regex)
+        regfree(&s->m_regex);
+}
+
+/*
+ * Getters.
+ */
+
+bool
+atf_selection_is_empty(const atf_selection_t *s)
+{
+    return s->m_glob == NULL && !s->m_has_regex && s->m_nshards == 0;
+}
+
+bool
+atf_selection_matches(const atf_selection_t *s, const char *ident)
+{
+    if (s->m_glob != NULL && fnmatch(s->m_glob, ident, 0) != 0)
+        return false;
+    if (s->m_has_regex && regexec(&s->m_regex, ident, 0, NULL, 0) != 0)
+        return false;
+    /* The shard of a test case depends on nothing else than its identifier
+     * so that every node of a distributed run agrees on it. */
+    if (s->m_nshards > 0 &&
+        atf_hash_bytes(ATF_HASH_INIT, ident, strlen(ident)) % s->m_nshards !=
+        s->m_shard)
+        return false;
+    return true;
+}
+
+/*
+ * Modifiers.
+ */
+
+void
+atf_selection_set_glob(atf_selection_t *s, const char *glob)
+{
+    s->m_glob = glob;
+}
+
+/** Restricts the selection to the identifiers matching an extended
+ * regular expression, which is not anchored.
+ *
+ * Returns false, leaving the selection untouched, if the expression is
+ * invalid. */
+bool
+atf_selection_set_regex(atf_selection_t *s, const char *regex)
+{
+    regex_t compiled;
+
+    if (regcomp(&compiled, regex, REG_EXTENDED | REG_NOSUB) != 0)
+        return false;
+
+    if (s->m_has_regex)
+        regfree(&s->m_regex);
+    s->m_regex = compiled;
+    s->m_regex_str = regex;
+    s->m_has_regex = true;
+    return true;
+}
+
+/** Restricts the selection to one of several disjoint shards given as
+ * k/n, where k goes from 1 to n.
+ *
+ * Returns false, leaving the selection untouched, if the specification is
+ * malformed or out of range. */
+bool
+atf_selection_set_shard(atf_selection_t *s, const char *spec)
+{
+    const char *slash;
+    size_t shard, nshards;
+
+    slash = strchr(spec, '/');
+    if (slash == NULL)
+        return false;
+    if (!parse_size(spec, slash, &shard) ||
+        !parse_size(slash + 1, slash + 1 + strlen(slash + 1), &nshards))
+        return false;
+    if (nshards == 0 || shard == 0 || shard > nshards)
+        return false;
+
+    s->m_shard_str = spec;
+    s->m_shard = shard - 1;
+    s->m_nshards = nshards;
+    return true;
+}
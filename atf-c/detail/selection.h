@@ -0,0 +1,68 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_SELECTION_H)
+#define ATF_C_DETAIL_SELECTION_H
+
+#include <sys/types.h>
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_selection" type.
+ * --------------------------------------------------------------------- */
+
+/* The subset of the test cases of a test program that a listing or a run
+ * of several test cases is restricted to.  A test case is selected if its
+ * identifier matches the glob pattern and the regular expression, when
+ * given, and if it hashes into the requested shard.  The patterns are not
+ * copied and must outlive the selection. */
+struct atf_selection {
+    const char *m_glob;
+    const char *m_regex_str;
+    bool m_has_regex;
+    regex_t m_regex;
+    const char *m_shard_str;
+    size_t m_shard;
+    size_t m_nshards;
+};
+typedef struct atf_selection atf_selection_t;
+
+/* Constructors/destructors. */
+void atf_selection_init(atf_selection_t *);
+void atf_selection_fini(atf_selection_t *);
+
+/* Getters. */
+bool atf_selection_is_empty(const atf_selection_t *);
+bool atf_selection_matches(const atf_selection_t *, const char *);
+
+/* Modifiers. */
+void atf_selection_set_glob(atf_selection_t *, const char *);
+bool atf_selection_set_regex(atf_selection_t *, const char *);
+bool atf_selection_set_shard(atf_selection_t *, const char *);
+
+#endif /* !defined(ATF_C_DETAIL_SELECTION_H) */
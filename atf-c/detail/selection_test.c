@@ -0,0 +1,189 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/selection.h"
+
+#include <stdio.h>
+
+#include <atf-c.h>
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_selection" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(empty);
+ATF_TC_BODY(empty, tc)
+{
+    atf_selection_t s;
+
+    atf_selection_init(&s);
+    ATF_CHECK(atf_selection_is_empty(&s));
+    ATF_CHECK(atf_selection_matches(&s, "anything"));
+    atf_selection_fini(&s);
+}
+
+ATF_TC_WITHOUT_HEAD(glob);
+ATF_TC_BODY(glob, tc)
+{
+    atf_selection_t s;
+
+    atf_selection_init(&s);
+    atf_selection_set_glob(&s, "foo_*");
+    ATF_CHECK(!atf_selection_is_empty(&s));
+    ATF_CHECK(atf_selection_matches(&s, "foo_bar"));
+    ATF_CHECK(atf_selection_matches(&s, "foo_"));
+    ATF_CHECK(!atf_selection_matches(&s, "foo"));
+    ATF_CHECK(!atf_selection_matches(&s, "a_foo_bar"));
+    atf_selection_fini(&s);
+}
+
+ATF_TC_WITHOUT_HEAD(regex);
+ATF_TC_BODY(regex, tc)
+{
+    atf_selection_t s;
+
+    atf_selection_init(&s);
+    ATF_REQUIRE(atf_selection_set_regex(&s, "^(a|b)_[0-9]+$"));
+    ATF_CHECK(atf_selection_matches(&s, "a_1"));
+    ATF_CHECK(atf_selection_matches(&s, "b_23"));
+    ATF_CHECK(!atf_selection_matches(&s, "c_1"));
+    ATF_CHECK(!atf_selection_matches(&s, "a_x"));
+
+    ATF_REQUIRE(atf_selection_set_regex(&s, "mid"));
+    ATF_CHECK(atf_selection_matches(&s, "in_the_middle"));
+    ATF_CHECK(!atf_selection_matches(&s, "a_1"));
+
+    ATF_CHECK(!atf_selection_set_regex(&s, "(unbalanced"));
+    ATF_CHECK(atf_selection_matches(&s, "in_the_middle"));
+    atf_selection_fini(&s);
+}
+
+ATF_TC_WITHOUT_HEAD(combined);
+ATF_TC_BODY(combined, tc)
+{
+    atf_selection_t s;
+
+    atf_selection_init(&s);
+    atf_selection_set_glob(&s, "*_fast");
+    ATF_REQUIRE(atf_selection_set_regex(&s, "^net"));
+    ATF_CHECK(atf_selection_matches(&s, "net_fast"));
+    ATF_CHECK(!atf_selection_matches(&s, "net_slow"));
+    ATF_CHECK(!atf_selection_matches(&s, "disk_fast"));
+    atf_selection_fini(&s);
+}
+
+ATF_TC_WITHOUT_HEAD(shard_spec);
+ATF_TC_BODY(shard_spec, tc)
+{
+    atf_selection_t s;
+
+    atf_selection_init(&s);
+    ATF_CHECK(!atf_selection_set_shard(&s, ""));
+    ATF_CHECK(!atf_selection_set_shard(&s, "1"));
+    ATF_CHECK(!atf_selection_set_shard(&s, "/2"));
+    ATF_CHECK(!atf_selection_set_shard(&s, "1/"));
+    ATF_CHECK(!atf_selection_set_shard(&s, "0/2"));
+    ATF_CHECK(!atf_selection_set_shard(&s, "3/2"));
+    ATF_CHECK(!atf_selection_set_shard(&s, "1/0"));
+    ATF_CHECK(!atf_selection_set_shard(&s, "-1/2"));
+    ATF_CHECK(!atf_selection_set_shard(&s, "1/2x"));
+    ATF_CHECK(atf_selection_is_empty(&s));
+
+    ATF_CHECK(atf_selection_set_shard(&s, "2/2"));
+    ATF_CHECK(!atf_selection_is_empty(&s));
+    atf_selection_fini(&s);
+}
+
+ATF_TC(shard_partition);
+ATF_TC_HEAD(shard_partition, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the shards of a test "
+                      "program are disjoint, cover all of its test cases "
+                      "and are reasonably balanced");
+}
+ATF_TC_BODY(shard_partition, tc)
+{
+    static const char *specs[] = { "1/3", "2/3", "3/3" };
+    atf_selection_t s[3];
+    size_t counts[3] = { 0, 0, 0 };
+    size_t i, j;
+
+    for (j = 0; j < 3; j++) {
+        atf_selection_init(&s[j]);
+        ATF_REQUIRE(atf_selection_set_shard(&s[j], specs[j]));
+    }
+
+    for (i = 0; i < 300; i++) {
+        char ident[32];
+        size_t hits;
+
+        snprintf(ident, sizeof(ident), "test_case_%zu", i);
+        hits = 0;
+        for (j = 0; j < 3; j++) {
+            if (atf_selection_matches(&s[j], ident)) {
+                counts[j]++;
+                hits++;
+            }
+        }
+        ATF_CHECK_EQ_MSG(1, hits, "%s is in %zu shards", ident, hits);
+    }
+
+    for (j = 0; j < 3; j++) {
+        ATF_CHECK_MSG(counts[j] > 50, "Shard %s only has %zu test cases",
+                      specs[j], counts[j]);
+        atf_selection_fini(&s[j]);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(shard_stable);
+ATF_TC_BODY(shard_stable, tc)
+{
+    atf_selection_t s;
+
+    /* The FNV-1a hashes of these identifiers are fixed, so their shards
+     * must not change across releases or platforms. */
+    atf_selection_init(&s);
+    ATF_REQUIRE(atf_selection_set_shard(&s, "1/2"));
+    ATF_CHECK(atf_selection_matches(&s, "a"));
+    ATF_CHECK(!atf_selection_matches(&s, "b"));
+    atf_selection_fini(&s);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, empty);
+    ATF_TP_ADD_TC(tp, glob);
+    ATF_TP_ADD_TC(tp, regex);
+    ATF_TP_ADD_TC(tp, combined);
+    ATF_TP_ADD_TC(tp, shard_spec);
+    ATF_TP_ADD_TC(tp, shard_partition);
+    ATF_TP_ADD_TC(tp, shard_stable);
+
+    return atf_no_error();
+}
@@ -0,0 +1,349 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/tc_md.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atf-c/detail/binary.h"
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+/* Name of the section that holds the records and layout of every record,
+ * as generated by ATF_TP_ADD_TC and ATF_ADD_TEST_CASE: the tag, the flags
+ * as a digit, the line of the registration and the identifier of the test
+ * case, the last two NUL-terminated.  The test cases with a static head
+ * also leave a record of their variables, generated by ATFU_TC_MD_VARS:
+ * the tag, the NUL-terminated identifier and the variables as described
+ * in atf_tc_md_record.  Records may be separated by padding NUL bytes. */
+#define SECTION_NAME "atf_tc_md"
+#define RECORD_TAG "atf1"
+#define RECORD_TAG_LEN 4
+#define RECORD_MIN_LEN (RECORD_TAG_LEN + 1 + 2 + 2)
+#define VARS_TAG "atfm"
+#define VARS_MIN_LEN (RECORD_TAG_LEN + 2 + 1)
+#define FLAG_HEAD 1
+#define FLAG_CLEANUP 2
+#define FLAG_STATIC 4
+
+/* ---------------------------------------------------------------------
+ * The "tc_md" error type.
+ * --------------------------------------------------------------------- */
+
+struct tc_md_error_data {
+    char m_reason[1024];
+};
+typedef struct tc_md_error_data tc_md_error_data_t;
+
+static
+void
+tc_md_format(const atf_error_t err, char *buf, size_t buflen)
+{
+    const tc_md_error_data_t *data;
+
+    PRE(atf_error_is(err, "tc_md"));
+
+    data = atf_error_data(err);
+    snprintf(buf, buflen, "Invalid test case meta-data: %s",
+             data->m_reason);
+}
+
+static
+atf_error_t
+tc_md_error(const char *fmt, ...)
+{
+    atf_error_t err;
+    tc_md_error_data_t data;
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(data.m_reason, sizeof(data.m_reason), fmt, ap);
+    va_end(ap);
+
+    err = atf_error_new("tc_md", &data, sizeof(data), tc_md_format);
+
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+/* A parsed record along with the keys to sort it by.  The pointers
+ * refer to the buffer being parsed. */
+struct entry {
+    unsigned long m_line;
+    size_t m_offset;
+    int m_flags;
+    const char *m_ident;
+    const char *m_vars;
+    size_t m_vars_len;
+};
+
+/* The variables of a test case with a static head. */
+struct vars {
+    const char *m_ident;
+    const char *m_vars;
+    size_t m_len;
+};
+
+static
+int
+compare_entries(const void *a, const void *b)
+{
+    const struct entry *e1 = a;
+    const struct entry *e2 = b;
+
+    if (e1->m_line != e2->m_line)
+        return e1->m_line < e2->m_line ? -1 : 1;
+    else if (e1->m_offset != e2->m_offset)
+        return e1->m_offset < e2->m_offset ? -1 : 1;
+    else
+        return 0;
+}
+
+/* Skips the NUL-terminated decimal line number at the beginning of str.
+ * Returns a pointer past its terminator or NULL if it is malformed. */
+static
+const char *
+parse_line(const char *str, const char *limit)
+{
+    const char *ptr;
+
+    for (ptr = str; ptr < limit && *ptr >= '0' && *ptr <= '9'; ptr++)
+        ;
+    if (ptr == str || ptr == limit || *ptr != '\0' || ptr - str > 9)
+        return NULL;
+    return ptr + 1;
+}
+
+/* Parses the variables record at the beginning of str, past its tag.
+ * Returns a pointer past the empty name that terminates it or NULL if it
+ * is malformed. */
+static
+const char *
+parse_vars(const char *str, const char *limit, struct vars *v)
+{
+    const char *ptr;
+
+    v->m_ident = str;
+    ptr = memchr(str, '\0', (size_t)(limit - str));
+    if (ptr == NULL || ptr == str)
+        return NULL;
+    v->m_vars = ++ptr;
+
+    while (ptr < limit && *ptr != '\0') {
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            ptr = memchr(ptr, '\0', (size_t)(limit - ptr));
+            if (ptr == NULL)
+                return NULL;
+            ptr++;
+        }
+    }
+    if (ptr == limit)
+        return NULL;
+    ptr++;
+
+    v->m_len = (size_t)(ptr - v->m_vars);
+    return ptr;
+}
+
+/* Attaches to e the variables of its test case if it has a static head. */
+static
+atf_error_t
+attach_vars(struct entry *e, const struct vars *vars, const size_t nvars)
+{
+    size_t i;
+
+    if (!(e->m_flags & FLAG_STATIC))
+        return atf_no_error();
+
+    for (i = 0; i < nvars; i++) {
+        if (strcmp(vars[i].m_ident, e->m_ident) == 0) {
+            e->m_vars = vars[i].m_vars;
+            e->m_vars_len = vars[i].m_len;
+            return atf_no_error();
+        }
+    }
+    return tc_md_error("Missing meta-data of test case %s", e->m_ident);
+}
+
+/* Returns a new record for e or NULL if there is not enough memory. */
+static
+atf_tc_md_record_t *
+new_record(const struct entry *e)
+{
+    atf_tc_md_record_t *rec;
+    const size_t identlen = strlen(e->m_ident) + 1;
+
+    rec = malloc(sizeof(*rec) + identlen + e->m_vars_len);
+    if (rec == NULL)
+        return NULL;
+
+    rec->m_has_head = (e->m_flags & FLAG_HEAD) != 0;
+    rec->m_has_cleanup = (e->m_flags & FLAG_CLEANUP) != 0;
+    memcpy(rec->m_ident, e->m_ident, identlen);
+    if (e->m_vars == NULL)
+        rec->m_static_md = NULL;
+    else {
+        memcpy(rec->m_ident + identlen, e->m_vars, e->m_vars_len);
+        rec->m_static_md = rec->m_ident + identlen;
+    }
+
+    return rec;
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Parses the contents of the meta-data section.
+ *
+ * Appends one atf_tc_md_record_t per record found in buf to records, in
+ * the order in which the test cases were registered.  Compilers do not
+ * necessarily emit the records in source order, so they are sorted by the
+ * line of their registration.  The list owns the new entries.
+ */
+atf_error_t
+atf_tc_md_parse(const char *buf, const size_t len, atf_list_t *records)
+{
+    atf_error_t err;
+    struct entry *entries;
+    struct vars *vars;
+    size_t i, nentries, nvars, pos;
+
+    entries = malloc(sizeof(*entries) * (len / RECORD_MIN_LEN + 1));
+    vars = malloc(sizeof(*vars) * (len / VARS_MIN_LEN + 1));
+    if (entries == NULL || vars == NULL) {
+        err = atf_no_memory_error();
+        goto out;
+    }
+
+    err = atf_no_error();
+    nentries = 0;
+    nvars = 0;
+    pos = 0;
+    while (pos < len) {
+        struct entry *e;
+        const char *line, *ident, *end;
+        int flags;
+
+        if (buf[pos] == '\0') {
+            pos++;
+            continue;
+        }
+
+        if (len - pos >= VARS_MIN_LEN &&
+            memcmp(buf + pos, VARS_TAG, RECORD_TAG_LEN) == 0) {
+            end = parse_vars(buf + pos + RECORD_TAG_LEN, buf + len,
+                             &vars[nvars]);
+            if (end == NULL) {
+                err = tc_md_error("Malformed record at offset %zu", pos);
+                goto out;
+            }
+            nvars++;
+
+            pos = (size_t)(end - buf);
+            continue;
+        }
+
+        if (len - pos < RECORD_MIN_LEN ||
+            memcmp(buf + pos, RECORD_TAG, RECORD_TAG_LEN) != 0) {
+            err = tc_md_error("Malformed record at offset %zu", pos);
+            goto out;
+        }
+        flags = buf[pos + RECORD_TAG_LEN] - '0';
+        line = buf + pos + RECORD_TAG_LEN + 1;
+        ident = parse_line(line, buf + len);
+        end = ident == NULL ? NULL :
+            memchr(ident, '\0', len - (size_t)(ident - buf));
+        if (flags < 0 || flags > (FLAG_HEAD | FLAG_CLEANUP | FLAG_STATIC) ||
+            ((flags & FLAG_STATIC) && !(flags & FLAG_HEAD)) ||
+            end == NULL || end == ident) {
+            err = tc_md_error("Malformed record at offset %zu", pos);
+            goto out;
+        }
+
+        e = &entries[nentries];
+        e->m_line = strtoul(line, NULL, 10);
+        e->m_offset = pos;
+        e->m_flags = flags;
+        e->m_ident = ident;
+        e->m_vars = NULL;
+        e->m_vars_len = 0;
+        nentries++;
+
+        pos = (size_t)(end - buf) + 1;
+    }
+
+    for (i = 0; i < nentries && !atf_is_error(err); i++)
+        err = attach_vars(&entries[i], vars, nvars);
+
+    qsort(entries, nentries, sizeof(*entries), compare_entries);
+    for (i = 0; i < nentries && !atf_is_error(err); i++) {
+        atf_tc_md_record_t *rec;
+
+        rec = new_record(&entries[i]);
+        if (rec == NULL)
+            err = atf_no_memory_error();
+        else {
+            err = atf_list_append(records, rec, true);
+            if (atf_is_error(err))
+                free(rec);
+        }
+    }
+
+out:
+    free(vars);
+    free(entries);
+    return err;
+}
+
+/** Reads the test case meta-data records embedded in a binary.
+ *
+ * found is set to false, without raising an error, if the file is not an
+ * ELF file of the native byte order or if it lacks the meta-data section;
+ * callers should then resort to running the binary with -l.
+ */
+atf_error_t
+atf_tc_md_read(const char *path, atf_list_t *records, bool *found)
+{
+    atf_error_t err;
+    char *buf;
+    size_t len;
+
+    err = atf_binary_read_section(path, SECTION_NAME, &buf, &len, found);
+    if (atf_is_error(err) || !*found)
+        return err;
+
+    err = atf_tc_md_parse(buf, len, records);
+    free(buf);
+    return err;
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_TC_MD_H)
+#define ATF_C_DETAIL_TC_MD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <atf-c/detail/list.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_tc_md_record" type.
+ * --------------------------------------------------------------------- */
+
+/* The static meta-data of a test case as left in the binary by
+ * ATF_TP_ADD_TC and ATF_ADD_TEST_CASE.  m_static_md holds the variables
+ * set by the head of the test cases defined with ATF_TC_WITH_MD and
+ * friends, as NUL-terminated names and values ending with an empty name,
+ * and is NULL for any other test case. */
+struct atf_tc_md_record {
+    bool m_has_head;
+    bool m_has_cleanup;
+    const char *m_static_md;
+    char m_ident[];
+};
+typedef struct atf_tc_md_record atf_tc_md_record_t;
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+atf_error_t atf_tc_md_parse(const char *, const size_t, atf_list_t *);
+atf_error_t atf_tc_md_read(const char *, atf_list_t *, bool *);
+
+#endif /* !defined(ATF_C_DETAIL_TC_MD_H) */
@@ -0,0 +1,323 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/tc_md.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+#include "atf-c/utils.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+const atf_tc_md_record_t *
+find_record(const atf_list_t *records, const char *ident)
+{
+    atf_list_citer_t iter;
+
+    atf_list_for_each_c(iter, records) {
+        const atf_tc_md_record_t *record = atf_list_citer_data(iter);
+        if (strcmp(record->m_ident, ident) == 0)
+            return record;
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(parse);
+ATF_TC_HEAD(parse, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_tc_md_parse function "
+                      "and that it sorts records by line");
+}
+ATF_TC_BODY(parse, tc)
+{
+    const char buf[] = "atf1320\0second\0\0\0atf1010\0first\0atf1130\0third";
+    atf_list_t records;
+    const atf_tc_md_record_t *record;
+
+    RE(atf_list_init(&records));
+    RE(atf_tc_md_parse(buf, sizeof(buf), &records));
+    ATF_REQUIRE_EQ(atf_list_size(&records), 3);
+
+    record = atf_list_index_c(&records, 0);
+    ATF_CHECK_STREQ(record->m_ident, "first");
+    ATF_CHECK(!record->m_has_head);
+    ATF_CHECK(!record->m_has_cleanup);
+
+    record = atf_list_index_c(&records, 1);
+    ATF_CHECK_STREQ(record->m_ident, "second");
+    ATF_CHECK(record->m_has_head);
+    ATF_CHECK(record->m_has_cleanup);
+
+    record = atf_list_index_c(&records, 2);
+    ATF_CHECK_STREQ(record->m_ident, "third");
+    ATF_CHECK(record->m_has_head);
+    ATF_CHECK(!record->m_has_cleanup);
+
+    atf_list_fini(&records);
+}
+
+ATF_TC(parse_static);
+ATF_TC_HEAD(parse_static, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_tc_md_parse attaches "
+                      "the variables of static heads to their records");
+}
+ATF_TC_BODY(parse_static, tc)
+{
+    const char buf[] = "atf1520\0second\0\0atfmfirst\0\0\0"
+        "atfmsecond\0descr\0Some text\0timeout\0\0\0\0atf1710\0first";
+    atf_list_t records;
+    const atf_tc_md_record_t *record;
+    const char *vars;
+
+    RE(atf_list_init(&records));
+    RE(atf_tc_md_parse(buf, sizeof(buf), &records));
+    ATF_REQUIRE_EQ(atf_list_size(&records), 2);
+
+    record = atf_list_index_c(&records, 0);
+    ATF_CHECK_STREQ(record->m_ident, "first");
+    ATF_CHECK(record->m_has_head);
+    ATF_CHECK(record->m_has_cleanup);
+    ATF_REQUIRE(record->m_static_md != NULL);
+    ATF_CHECK_EQ(record->m_static_md[0], '\0');
+
+    record = atf_list_index_c(&records, 1);
+    ATF_CHECK_STREQ(record->m_ident, "second");
+    ATF_CHECK(record->m_has_head);
+    ATF_CHECK(!record->m_has_cleanup);
+    ATF_REQUIRE(record->m_static_md != NULL);
+    vars = record->m_static_md;
+    ATF_CHECK_STREQ(vars, "descr");
+    vars += strlen(vars) + 1;
+    ATF_CHECK_STREQ(vars, "Some text");
+    vars += strlen(vars) + 1;
+    ATF_CHECK_STREQ(vars, "timeout");
+    vars += strlen(vars) + 1;
+    ATF_CHECK_STREQ(vars, "");
+    vars += strlen(vars) + 1;
+    ATF_CHECK_EQ(vars[0], '\0');
+
+    atf_list_fini(&records);
+}
+
+ATF_TC(parse_static_missing);
+ATF_TC_HEAD(parse_static_missing, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_tc_md_parse rejects "
+                      "static heads without variables");
+}
+ATF_TC_BODY(parse_static_missing, tc)
+{
+    const char buf[] = "atfmother\0\0atf1510\0first";
+    atf_list_t records;
+    atf_error_t err;
+    char msg[1024];
+
+    RE(atf_list_init(&records));
+    err = atf_tc_md_parse(buf, sizeof(buf), &records);
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "tc_md"));
+    atf_error_format(err, msg, sizeof(msg));
+    ATF_CHECK(strstr(msg, "Missing meta-data of test case first") != NULL);
+    atf_error_free(err);
+    atf_list_fini(&records);
+}
+
+ATF_TC(parse_malformed);
+ATF_TC_HEAD(parse_malformed, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_tc_md_parse rejects "
+                      "malformed records");
+}
+ATF_TC_BODY(parse_malformed, tc)
+{
+    static const struct {
+        const char *m_buf;
+        size_t m_len;
+    } tests[] = {
+        { "atf10", 5 },
+        { "atf101\0\0", 8 },
+        { "atf191\0name\0", 12 },
+        { "atf101\0name", 11 },
+        { "xyz101\0name\0", 12 },
+        { "atf10x\0name\0", 12 },
+        { "atf10\0name\0", 11 },
+        { "atf141\0name\0", 12 },
+        { "atf181\0name\0", 12 },
+        { "atfm\0\0\0", 7 },
+        { "atfmname\0k", 10 },
+        { "atfmname\0k\0v\0", 13 },
+        { NULL, 0 }
+    };
+    size_t i;
+
+    for (i = 0; tests[i].m_buf != NULL; i++) {
+        atf_list_t records;
+        atf_error_t err;
+        char msg[1024];
+
+        printf("Parsing record %zu\n", i);
+        RE(atf_list_init(&records));
+        err = atf_tc_md_parse(tests[i].m_buf, tests[i].m_len, &records);
+        ATF_REQUIRE(atf_is_error(err));
+        ATF_REQUIRE(atf_error_is(err, "tc_md"));
+        atf_error_format(err, msg, sizeof(msg));
+        ATF_CHECK(strstr(msg, "Malformed record at offset 0") != NULL);
+        atf_error_free(err);
+        atf_list_fini(&records);
+    }
+}
+
+ATF_TC(read_self);
+ATF_TC_HEAD(read_self, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_tc_md_read finds the "
+                      "records of the running test program");
+}
+ATF_TC_BODY(read_self, tc)
+{
+    atf_list_t records;
+    const atf_tc_md_record_t *record;
+    bool found;
+
+    if (access("/proc/self/exe", R_OK) == -1)
+        atf_tc_skip("Cannot locate the test program binary");
+
+    RE(atf_list_init(&records));
+    RE(atf_tc_md_read("/proc/self/exe", &records, &found));
+    if (!found)
+        atf_tc_skip("No test case meta-data support in this platform");
+    ATF_REQUIRE_EQ(atf_list_size(&records), 9);
+
+    record = atf_list_index_c(&records, 0);
+    ATF_CHECK_STREQ(record->m_ident, "parse");
+    record = atf_list_index_c(&records, 8);
+    ATF_CHECK_STREQ(record->m_ident, "read_not_elf");
+
+    record = find_record(&records, "read_self");
+    ATF_REQUIRE(record != NULL);
+    ATF_CHECK(record->m_has_head);
+    ATF_CHECK(!record->m_has_cleanup);
+
+    record = find_record(&records, "read_cleanup");
+    ATF_REQUIRE(record != NULL);
+    ATF_CHECK(record->m_has_head);
+    ATF_CHECK(record->m_has_cleanup);
+    ATF_CHECK(record->m_static_md == NULL);
+
+    record = find_record(&records, "read_static");
+    ATF_REQUIRE(record != NULL);
+    ATF_CHECK(record->m_has_head);
+    ATF_CHECK(record->m_has_cleanup);
+    ATF_REQUIRE(record->m_static_md != NULL);
+    ATF_CHECK_EQ(memcmp(record->m_static_md, "descr\0Helper with a static "
+                        "head\0timeout\0" "30\0", 44), 0);
+
+    record = find_record(&records, "read_headless");
+    ATF_REQUIRE(record != NULL);
+    ATF_CHECK(!record->m_has_head);
+    ATF_CHECK(!record->m_has_cleanup);
+
+    atf_list_fini(&records);
+}
+
+ATF_TC_WITH_CLEANUP(read_cleanup);
+ATF_TC_HEAD(read_cleanup, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper whose record is inspected by "
+                      "read_self");
+}
+ATF_TC_BODY(read_cleanup, tc)
+{
+}
+ATF_TC_CLEANUP(read_cleanup, tc)
+{
+}
+
+ATF_TC_WITH_CLEANUP_MD(read_static,
+    ATF_MD("descr", "Helper with a static head")
+    ATF_MD("timeout", "30"));
+ATF_TC_BODY(read_static, tc)
+{
+}
+ATF_TC_CLEANUP(read_static, tc)
+{
+}
+
+ATF_TC_WITHOUT_HEAD(read_headless);
+ATF_TC_BODY(read_headless, tc)
+{
+}
+
+ATF_TC(read_not_elf);
+ATF_TC_HEAD(read_not_elf, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_tc_md_read does not "
+                      "find records in files that are not binaries");
+}
+ATF_TC_BODY(read_not_elf, tc)
+{
+    atf_list_t records;
+    bool found;
+
+    atf_utils_create_file("script", "#! /bin/sh\necho foo\n");
+
+    RE(atf_list_init(&records));
+    RE(atf_tc_md_read("script", &records, &found));
+    ATF_CHECK(!found);
+    ATF_CHECK_EQ(atf_list_size(&records), 0);
+    atf_list_fini(&records);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, parse);
+    ATF_TP_ADD_TC(tp, parse_static);
+    ATF_TP_ADD_TC(tp, parse_static_missing);
+    ATF_TP_ADD_TC(tp, parse_malformed);
+    ATF_TP_ADD_TC(tp, read_self);
+    ATF_TP_ADD_TC(tp, read_cleanup);
+    ATF_TP_ADD_TC(tp, read_static);
+    ATF_TP_ADD_TC(tp, read_headless);
+    ATF_TP_ADD_TC(tp, read_not_elf);
+
+    return atf_no_error();
+}
@@ -34,11 +34,20 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "atf-c/detail/bench.h"
+#include "atf-c/detail/durations.h"
 #include "atf-c/detail/dynstr.h"
 #include "atf-c/detail/env.h"
 #include "atf-c/detail/fs.h"
+#include "atf-c/detail/listing_cache.h"
 #include "atf-c/detail/map.h"
+#include "atf-c/detail/result_cache.h"
+#include "atf-c/detail/runner.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/selection.h"
+#include "atf-c/detail/tc.h"
+#include "atf-c/detail/text.h"
+#include "atf-c/detail/trace.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
 #include "atf-c/tp.h"
@@ -60,6 +69,7 @@ int atf_tp_main(int, char **, atf_error_t (*)(atf_tp_t *));
 enum tc_part {
     BODY,
     CLEANUP,
+    ALL,
 };
 
 /* ---------------------------------------------------------------------
@@ -136,10 +146,17 @@ print_warning(const char *message)
 
 struct params {
     bool m_do_list;
+    bool m_do_all;
     atf_fs_path_t m_srcdir;
     char *m_tcname;
     enum tc_part m_tcpart;
+    char **m_tcargs;
+    int m_ntcargs;
+    const char *m_server;
+    bool m_has_resfile;
     atf_fs_path_t m_resfile;
+    size_t m_maxworkers;
+    atf_selection_t m_selection;
     atf_map_t m_config;
 };
 
@@ -168,8 +185,15 @@ params_init(struct params *p, const char *argv0)
     atf_error_t err;
 
     p->m_do_list = false;
+    p->m_do_all = false;
     p->m_tcname = NULL;
     p->m_tcpart = BODY;
+    p->m_tcargs = NULL;
+    p->m_ntcargs = 0;
+    p->m_server = NULL;
+    p->m_has_resfile = false;
+    p->m_maxworkers = 0;
+    atf_selection_init(&p->m_selection);
 
     err = argv0_to_dir(argv0, &p->m_srcdir);
     if (atf_is_error(err))
@@ -196,6 +220,7 @@ void
 params_fini(struct params *p)
 {
     atf_map_fini(&p->m_config);
+    atf_selection_fini(&p->m_selection);
     atf_fs_path_fini(&p->m_resfile);
     atf_fs_path_fini(&p->m_srcdir);
     free(p->m_tcname);
@@ -245,36 +270,48 @@ replace_path_param(atf_fs_path_t *param, const char *value)
  * --------------------------------------------------------------------- */
 
 static
-void
-list_tcs(const atf_tp_t *tp)
+atf_error_t
+format_tcs(const atf_tp_t *tp, const atf_selection_t *selection,
+           atf_dynstr_t *listing)
 {
+    atf_error_t err;
     const atf_tc_t **tcs;
     const atf_tc_t *const *tcsptr;
+    bool first = true;
 
-    printf("Content-Type: application/X-atf-tp; version=\"1\"\n\n");
+    err = atf_dynstr_append_fmt(listing, "Content-Type: application/X-atf-tp; "
+                                "version=\"1\"\n\n");
 
     tcs = atf_tp_get_tcs(tp);
     INV(tcs != NULL);  /* Should be checked. */
-    for (tcsptr = tcs; *tcsptr != NULL; tcsptr++) {
+    for (tcsptr = tcs; *tcsptr != NULL && !atf_is_error(err); tcsptr++) {
         const atf_tc_t *tc = *tcsptr;
-        char **vars = atf_tc_get_md_vars(tc);
+        char **vars;
         char **ptr;
 
+        /* Skip before querying the meta-data: doing so runs the head. */
+        if (!atf_selection_matches(selection, atf_tc_get_ident(tc)))
+            continue;
+
+        vars = atf_tc_get_md_vars(tc);
         INV(vars != NULL);  /* Should be checked. */
 
-        if (tcsptr != tcs)  /* Not first. */
-            printf("\n");
+        if (!first)
+            err = atf_dynstr_append_fmt(listing, "\n");
+        first = false;
 
-        for (ptr = vars; *ptr != NULL; ptr += 2) {
+        for (ptr = vars; *ptr != NULL && !atf_is_error(err); ptr += 2) {
             if (strcmp(*ptr, "ident") == 0) {
-                printf("ident: %s\n", *(ptr + 1));
+                err = atf_dynstr_append_fmt(listing, "ident: %s\n",
+                                            *(ptr + 1));
                 break;
             }
         }
 
-        for (ptr = vars; *ptr != NULL; ptr += 2) {
+        for (ptr = vars; *ptr != NULL && !atf_is_error(err); ptr += 2) {
             if (strcmp(*ptr, "ident") != 0) {
-                printf("%s: %s\n", *ptr, *(ptr + 1));
+                err = atf_dynstr_append_fmt(listing, "%s: %s\n", *ptr,
+                                            *(ptr + 1));
             }
         }
 
@@ -282,6 +319,8 @@ list_tcs(const atf_tp_t *tp)
     }
     free(tcs);
     tcs = NULL;
+
+    return err;
 }
 
 /* ---------------------------------------------------------------------
@@ -312,6 +351,8 @@ handle_tcarg(const char *tcarg, char **tcname_out, enum tc_part *tcpart)
             *tcpart = BODY;
         } else if (strcmp(delim, "cleanup") == 0) {
             *tcpart = CLEANUP;
+        } else if (strcmp(delim, "all") == 0) {
+            *tcpart = ALL;
         } else {
             err = usage_error("Invalid test case part `%s'", delim);
             free(tcname);
@@ -323,6 +364,32 @@ handle_tcarg(const char *tcarg, char **tcname_out, enum tc_part *tcpart)
     return err;
 }
 
+static
+bool
+is_batch(const struct params *p)
+{
+    return p->m_do_all || p->m_ntcargs > 0 || p->m_maxworkers > 0;
+}
+
+static
+atf_error_t
+parse_jflag(const char *arg, size_t *maxworkers)
+{
+    atf_error_t err;
+    long value;
+
+    err = atf_text_to_long(arg, &value);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        return usage_error("Invalid number of parallel jobs `%s'", arg);
+    }
+    if (value < 1)
+        return usage_error("Invalid number of parallel jobs `%s'", arg);
+
+    *maxworkers = (size_t)value;
+    return atf_no_error();
+}
+
 static
 atf_error_t
 process_params(int argc, char **argv, struct params *p)
@@ -336,14 +403,42 @@ process_params(int argc, char **argv, struct params *p)
     old_opterr = opterr;
     opterr = 0;
     while (!atf_is_error(err) &&
-           (ch = getopt(argc, argv, GETOPT_POSIX ":lr:s:v:")) != -1) {
+           (ch = getopt(argc, argv, GETOPT_POSIX ":ae:g:j:k:lr:S:s:v:")) != -1) {
         switch (ch) {
+        case 'a':
+            p->m_do_all = true;
+            break;
+
+        case 'e':
+            if (!atf_selection_set_regex(&p->m_selection, optarg))
+                err = usage_error("Invalid regular expression `%s'", optarg);
+            break;
+
+        case 'g':
+            atf_selection_set_glob(&p->m_selection, optarg);
+            break;
+
+        case 'j':
+            err = parse_jflag(optarg, &p->m_maxworkers);
+            break;
+
+        case 'k':
+            if (!atf_selection_set_shard(&p->m_selection, optarg))
+                err = usage_error("Invalid shard `%s'; must be k/n with "
+                                  "1 <= k <= n", optarg);
+            break;
+
         case 'l':
             p->m_do_list = true;
             break;
 
         case 'r':
             err = replace_path_param(&p->m_resfile, optarg);
+            p->m_has_resfile = true;
+            break;
+
+        case 'S':
+            p->m_server = optarg;
             break;
 
         case 's':
@@ -374,21 +469,44 @@ process_params(int argc, char **argv, struct params *p)
 #endif
 
     if (!atf_is_error(err)) {
-        if (p->m_do_list) {
+        if (p->m_server != NULL) {
+            if (argc > 0)
+                err = usage_error("Cannot provide test case names with -S");
+            else if (p->m_do_all || p->m_maxworkers > 0 || p->m_do_list ||
+                     p->m_has_resfile)
+                err = usage_error("Cannot provide -a, -j, -l nor -r with -S");
+            else if (!atf_selection_is_empty(&p->m_selection))
+                err = usage_error("Cannot provide -e, -g nor -k with -S");
+        } else if (p->m_do_list) {
             if (argc > 0)
                 err = usage_error("Cannot provide test case names with -l");
+            else if (p->m_do_all || p->m_maxworkers > 0)
+                err = usage_error("Cannot provide -a nor -j with -l");
+        } else if (p->m_do_all) {
+            if (argc > 0)
+                err = usage_error("Cannot provide test case names with -a");
         } else {
             if (argc == 0)
                 err = usage_error("Must provide a test case name");
-            else if (argc == 1)
+            else if (argc == 1 && p->m_maxworkers == 0 &&
+                     atf_selection_is_empty(&p->m_selection))
                 err = handle_tcarg(argv[0], &p->m_tcname, &p->m_tcpart);
-            else if (argc > 1) {
-                err = usage_error("Cannot provide more than one test case "
-                                  "name");
+            else {
+                p->m_tcargs = argv;
+                p->m_ntcargs = argc;
             }
         }
     }
 
+    if (!atf_is_error(err) && is_batch(p) && !p->m_has_resfile) {
+        if (p->m_maxworkers > 0)
+            err = usage_error("Must provide a results directory with -r "
+                              "when using -j");
+        else
+            err = usage_error("Must provide a results directory with -r "
+                              "when running more than one test case");
+    }
+
     return err;
 }
 
@@ -476,24 +594,246 @@ out:
     return err;
 }
 
+static
+void
+print_runtime_warnings(void)
+{
+    if (!atf_env_has("__RUNNING_INSIDE_ATF_RUN") || strcmp(atf_env_get(
+        "__RUNNING_INSIDE_ATF_RUN"), "internal-yes-value") != 0)
+    {
+        print_warning("Running test cases outside of kyua(1) is unsupported");
+        print_warning("No isolation is being applied; you may get unexpected "
+                      "failures; see atf-test-case(4)");
+    }
+}
+
+static
+enum atf_runner_part
+to_runner_part(const enum tc_part part)
+{
+    switch (part) {
+    case BODY:
+        return atf_runner_part_body;
+    case CLEANUP:
+        return atf_runner_part_cleanup;
+    default:
+        UNREACHABLE;
+    }
+    return atf_runner_part_body;
+}
+
+/* Appends the jobs that run the given part of a test case to jobs, which
+ * already holds njobs of them, and returns their new count.  The 'all'
+ * part expands to a job for the body followed by another one for the
+ * cleanup routine, if the test case has one. */
+static
+size_t
+add_jobs(atf_runner_job_t *jobs, size_t njobs, const atf_tc_t *tc,
+         const enum tc_part part)
+{
+    if (part == ALL) {
+        jobs[njobs].m_tc = tc;
+        jobs[njobs++].m_part = atf_runner_part_body;
+        if (atf_tc_has_cleanup(tc)) {
+            jobs[njobs].m_tc = tc;
+            jobs[njobs++].m_part = atf_runner_part_cleanup;
+        }
+    } else {
+        jobs[njobs].m_tc = tc;
+        jobs[njobs++].m_part = to_runner_part(part);
+    }
+    return njobs;
+}
+
+/* Test cases given without a part, or selected with -a, run in full.  As
+ * the 'all' part of a test case expands to up to two jobs, so can every
+ * argument. */
 static
 atf_error_t
-run_tc(const atf_tp_t *tp, struct params *p, int *exitcode)
+build_jobs(const atf_tp_t *tp, const struct params *p,
+           atf_runner_job_t **jobs_out, size_t *njobs_out)
 {
     atf_error_t err;
+    atf_runner_job_t *jobs;
+    const atf_tc_t **tcs;
+    size_t i, nargs, njobs;
 
-    if (!atf_tp_has_tc(tp, p->m_tcname))
-        return usage_error("Unknown test case `%s'", p->m_tcname);
+    tcs = NULL;
+    if (p->m_do_all) {
+        tcs = atf_tp_get_tcs(tp);
+        if (tcs == NULL)
+            return atf_no_memory_error();
+        for (nargs = 0; tcs[nargs] != NULL; nargs++)
+            continue;
+    } else
+        nargs = (size_t)p->m_ntcargs;
+
+    jobs = malloc(sizeof(atf_runner_job_t) * (2 * nargs + 1));
+    if (jobs == NULL) {
+        free(tcs);
+        return atf_no_memory_error();
+    }
 
     err = atf_no_error();
+    njobs = 0;
+    for (i = 0; i < nargs && !atf_is_error(err); i++) {
+        if (tcs != NULL) {
+            if (!atf_selection_matches(&p->m_selection,
+                                       atf_tc_get_ident(tcs[i])))
+                continue;
+            njobs = add_jobs(jobs, njobs, tcs[i], ALL);
+        } else {
+            char *tcname;
+            enum tc_part tcpart = ALL;
 
-    if (!atf_env_has("__RUNNING_INSIDE_ATF_RUN") || strcmp(atf_env_get(
-        "__RUNNING_INSIDE_ATF_RUN"), "internal-yes-value") != 0)
-    {
-        print_warning("Running test cases outside of kyua(1) is unsupported");
-        print_warning("No isolation nor timeout control is being applied; you "
-                      "may get unexpected failures; see atf-test-case(4)");
+            err = handle_tcarg(p->m_tcargs[i], &tcname, &tcpart);
+            if (atf_is_error(err))
+                break;
+
+            if (!atf_tp_has_tc(tp, tcname))
+                err = usage_error("Unknown test case `%s'", tcname);
+            else if (!atf_selection_matches(&p->m_selection, tcname)) {
+                /* Filtered out. */
+            } else
+                njobs = add_jobs(jobs, njobs, atf_tp_get_tc(tp, tcname),
+                                 tcpart);
+            free(tcname);
+        }
+    }
+    free(tcs);
+
+    if (atf_is_error(err))
+        free(jobs);
+    else {
+        *jobs_out = jobs;
+        *njobs_out = njobs;
+    }
+    return err;
+}
+
+static
+void
+print_store_warning(const char *store, atf_error_t err)
+{
+    char buf[4096];
+    char message[4096 + 64];
+
+    atf_error_format(err, buf, sizeof(buf));
+    snprintf(message, sizeof(message), "Cannot use the %s: %s", store, buf);
+    print_warning(message);
+    atf_error_free(err);
+}
+
+static
+atf_error_t
+run_tcs(const atf_tp_t *tp, struct params *p, const char *argv0,
+        int *exitcode)
+{
+    atf_error_t err;
+    atf_durations_t durations;
+    atf_runner_job_t *jobs = NULL; /* Silence GCC warning. */
+    size_t njobs = 0; /* Silence GCC warning. */
+    bool success;
+
+    err = build_jobs(tp, p, &jobs, &njobs);
+    if (atf_is_error(err))
+        return err;
+
+    print_runtime_warnings();
+
+    err = atf_durations_init(&durations, argv0);
+    if (atf_is_error(err)) {
+        print_store_warning("duration history", err);
+        err = atf_no_error();
+    }
+
+    err = atf_runner_run_batch(jobs, njobs, atf_fs_path_cstring(&p->m_resfile),
+                               p->m_maxworkers, &durations, &success);
+    if (!atf_is_error(err))
+        *exitcode = success ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    atf_durations_fini(&durations);
+    free(jobs);
+    return err;
+}
+
+static
+const atf_tc_t *
+lookup_tc(const char *tcname, const void *data)
+{
+    const atf_tp_t *tp = data;
+
+    return atf_tp_has_tc(tp, tcname) ? atf_tp_get_tc(tp, tcname) : NULL;
+}
+
+static
+atf_error_t
+serve(atf_tp_t *tp, struct params *p, int *exitcode)
+{
+    atf_error_t err;
+
+    print_runtime_warnings();
+
+    err = atf_runner_serve(p->m_server, lookup_tc, tp);
+    if (!atf_is_error(err))
+        *exitcode = EXIT_SUCCESS;
+    return err;
+}
+
+/* Executes the body of a test case, with its cleanup routine if requested,
+ * unless the result cache knows its result already.  Sets ran to false,
+ * without running anything, if the cache is not enabled. */
+static
+atf_error_t
+run_tc_cached(const atf_tp_t *tp, const struct params *p, const char *argv0,
+              bool *ran, int *exitcode)
+{
+    atf_error_t err;
+    atf_result_cache_t cache;
+    atf_map_citer_t iter;
+
+    *ran = false;
+    if (p->m_tcpart == CLEANUP)
+        return atf_no_error();
+
+    err = atf_result_cache_init(&cache, argv0);
+    if (atf_is_error(err)) {
+        print_store_warning("result cache", err);
+        return atf_no_error();
     }
+    if (!cache.m_enabled)
+        goto out;
+
+    atf_map_for_each_c(iter, &p->m_config)
+        atf_result_cache_add_var(&cache, atf_map_citer_key(iter),
+                                 atf_map_citer_data(iter));
+
+    err = atf_runner_run_cached(&cache, atf_tp_get_tc(tp, p->m_tcname),
+                                p->m_tcpart == ALL,
+                                atf_fs_path_cstring(&p->m_resfile), exitcode);
+    *ran = true;
+
+out:
+    atf_result_cache_fini(&cache);
+    return err;
+}
+
+static
+atf_error_t
+run_tc(const atf_tp_t *tp, struct params *p, const char *argv0,
+       int *exitcode)
+{
+    atf_error_t err;
+    bool ran;
+
+    if (!atf_tp_has_tc(tp, p->m_tcname))
+        return usage_error("Unknown test case `%s'", p->m_tcname);
+
+    print_runtime_warnings();
+
+    err = run_tc_cached(tp, p, argv0, &ran, exitcode);
+    if (atf_is_error(err) || ran)
+        return err;
 
     switch (p->m_tcpart) {
     case BODY:
@@ -520,6 +860,14 @@ run_tc(const atf_tp_t *tp, struct params *p, int *exitcode)
 
         break;
 
+    case ALL:
+        err = atf_runner_run_all(atf_tp_get_tc(tp, p->m_tcname),
+                                 atf_fs_path_cstring(&p->m_resfile), exitcode);
+        if (atf_is_error(err))
+            return err;
+
+        break;
+
     default:
         UNREACHABLE;
     }
@@ -528,6 +876,104 @@ run_tc(const atf_tp_t *tp, struct params *p, int *exitcode)
     return err;
 }
 
+static
+atf_error_t
+init_tp(atf_tp_t *tp, const struct params *p,
+        atf_error_t (*add_tcs_hook)(atf_tp_t *))
+{
+    atf_error_t err;
+    char **raw_config;
+
+    raw_config = atf_map_to_charpp(&p->m_config);
+    if (raw_config == NULL)
+        return atf_no_memory_error();
+    err = atf_tp_init(tp, (const char* const*)raw_config);
+    atf_utils_free_charpp(raw_config);
+    if (atf_is_error(err))
+        return err;
+
+    err = add_tcs_hook(tp);
+    if (atf_is_error(err))
+        atf_tp_fini(tp);
+    return err;
+}
+
+/* Keys the listing cache on the selection options so that the listings of
+ * different subsets of the test cases do not replace each other. */
+static
+void
+add_selection_vars(atf_listing_cache_t *cache,
+                   const atf_selection_t *selection)
+{
+    if (selection->m_glob != NULL)
+        atf_listing_cache_add_var(cache, "-g", selection->m_glob);
+    if (selection->m_has_regex)
+        atf_listing_cache_add_var(cache, "-e", selection->m_regex_str);
+    if (selection->m_nshards > 0)
+        atf_listing_cache_add_var(cache, "-k", selection->m_shard_str);
+}
+
+/* Prints the listing of the test cases, straight from the listing cache if
+ * it is enabled and up to date, in which case the test program is not
+ * initialized at all. */
+static
+atf_error_t
+list_tcs(const struct params *p, const char *argv0,
+         atf_error_t (*add_tcs_hook)(atf_tp_t *), int *exitcode)
+{
+    atf_error_t err;
+    atf_listing_cache_t cache;
+    atf_map_citer_t iter;
+    atf_dynstr_t listing;
+    bool found;
+
+    err = atf_listing_cache_init(&cache, argv0);
+    if (atf_is_error(err)) {
+        print_store_warning("listing cache", err);
+        err = atf_no_error();
+    }
+    atf_map_for_each_c(iter, &p->m_config)
+        atf_listing_cache_add_var(&cache, atf_map_citer_key(iter),
+                                  atf_map_citer_data(iter));
+    add_selection_vars(&cache, &p->m_selection);
+
+    err = atf_listing_cache_get(&cache, &listing, &found);
+    if (atf_is_error(err))
+        goto out;
+
+    if (!found) {
+        atf_tp_t tp;
+
+        err = init_tp(&tp, p, add_tcs_hook);
+        if (atf_is_error(err))
+            goto out;
+
+        err = atf_dynstr_init(&listing);
+        if (!atf_is_error(err)) {
+            err = format_tcs(&tp, &p->m_selection, &listing);
+            if (atf_is_error(err))
+                atf_dynstr_fini(&listing);
+        }
+        atf_tp_fini(&tp);
+        if (atf_is_error(err))
+            goto out;
+
+        err = atf_listing_cache_put(&cache, atf_dynstr_cstring(&listing));
+        if (atf_is_error(err)) {
+            print_store_warning("listing cache", err);
+            err = atf_no_error();
+        }
+    }
+
+    printf("%s", atf_dynstr_cstring(&listing));
+    atf_dynstr_fini(&listing);
+    *exitcode = EXIT_SUCCESS;
+
+out:
+    atf_listing_cache_fini(&cache);
+    return err;
+}
+
 static
 atf_error_t
 controlled_main(int argc, char **argv,
@@ -537,7 +983,10 @@ controlled_main(int argc, char **argv,
     atf_error_t err;
     struct params p;
     atf_tp_t tp;
-    char **raw_config;
+
+    /* Ends before the test cases are listed or run; left open on errors, as
+     * the process is about to exit anyway. */
+    atf_trace_begin("startup", NULL);
 
     err = params_init(&p, argv[0]);
     if (atf_is_error(err))
@@ -547,33 +996,33 @@ controlled_main(int argc, char **argv,
     if (atf_is_error(err))
         goto out_p;
 
+    atf_trace_begin("handle_srcdir", NULL);
     err = handle_srcdir(&p);
+    atf_trace_end();
     if (atf_is_error(err))
         goto out_p;
 
-    raw_config = atf_map_to_charpp(&p.m_config);
-    if (raw_config == NULL) {
-        err = atf_no_memory_error();
+    if (p.m_do_list) {
+        atf_trace_end();
+        err = list_tcs(&p, argv[0], add_tcs_hook, exitcode);
         goto out_p;
     }
-    err = atf_tp_init(&tp, (const char* const*)raw_config);
-    atf_utils_free_charpp(raw_config);
-    if (atf_is_error(err))
-        goto out_p;
 
-    err = add_tcs_hook(&tp);
+    atf_trace_begin("atf_tp_init", NULL);
+    err = init_tp(&tp, &p, add_tcs_hook);
+    atf_trace_end();
     if (atf_is_error(err))
-        goto out_tp;
+        goto out_p;
+    atf_trace_end();
 
-    if (p.m_do_list) {
-        list_tcs(&tp);
-        INV(!atf_is_error(err));
-        *exitcode = EXIT_SUCCESS;
+    if (p.m_server != NULL) {
+        err = serve(&tp, &p, exitcode);
+    } else if (is_batch(&p)) {
+        err = run_tcs(&tp, &p, argv[0], exitcode);
     } else {
-        err = run_tc(&tp, &p, exitcode);
+        err = run_tc(&tp, &p, argv[0], exitcode);
     }
 
-out_tp:
     atf_tp_fini(&tp);
 out_p:
     params_fini(&p);
@@ -592,6 +1041,7 @@ atf_tp_main(int argc, char **argv, atf_error_t (*add_tcs_hook)(atf_tp_t *))
         progname = argv[0];
     else
         progname++;
+    atf_bench_set_program(argv[0]);
 
     exitcode = EXIT_FAILURE; /* Silence GCC warning. */
     err = controlled_main(argc, argv, add_tcs_hook, &exitcode);
@@ -0,0 +1,236 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/trace.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atf-c/detail/env.h"
+#include "atf-c/detail/sanity.h"
+
+/* Maximum nesting of phases; deeper phases are not recorded. */
+#define MAX_DEPTH 32
+
+/* A phase that has begun but not ended yet.  Forked children inherit the
+ * phases of their parent, which they must not end, so every phase knows
+ * the process that began it. */
+struct phase {
+    pid_t pid;
+    const char *name;
+};
+
+/* The descriptor of the trace file, -1 if tracing is disabled and -2 if
+ * the environment has not been checked yet. */
+static int Trace_fd = -2;
+static struct phase Phases[MAX_DEPTH];
+static size_t Depth;
+static size_t Overflow;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+void
+disable(const char *what)
+{
+    fprintf(stderr, "WARNING: Disabling tracing: %s: %s\n", what,
+            strerror(errno));
+    if (Trace_fd >= 0)
+        close(Trace_fd);
+    Trace_fd = -1;
+}
+
+/** Appends a string to a buffer as a JSON string, truncating it if it
+ * does not fit. */
+static
+size_t
+append_string(char *buf, size_t pos, const size_t size, const char *str)
+{
+    const size_t reserve = 2;  /* For a backslash and the closing quote. */
+
+    if (pos + 1 + reserve >= size)
+        return pos;
+    buf[pos++] = '"';
+    for (; *str != '\0' && pos + reserve + 1 < size; str++) {
+        const unsigned char ch = (unsigned char)*str;
+
+        if (ch == '"' || ch == '\\')
+            buf[pos++] = '\\';
+        else if (ch < 0x20 || ch == 0x7f)
+            continue;
+        buf[pos++] = (char)ch;
+    }
+    buf[pos++] = '"';
+    buf[pos] = '\0';
+    return pos;
+}
+
+static
+void
+write_event(const char *name, const char ph, const char *arg)
+{
+    char buf[512];
+    struct timespec ts;
+    size_t len;
+    ssize_t ret;
+    int n;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    n = snprintf(buf, sizeof(buf), "{\"name\":");
+    INV(n > 0 && (size_t)n < sizeof(buf));
+    len = append_string(buf, (size_t)n, sizeof(buf), name);
+    n = snprintf(buf + len, sizeof(buf) - len, ",\"cat\":\"atf\",\"ph\":\"%c\","
+                 "\"ts\":%lld.%03ld,\"pid\":%ld,\"tid\":%ld", ph,
+                 (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000,
+                 ts.tv_nsec % 1000, (long)getpid(), (long)getpid());
+    INV(n > 0 && len + (size_t)n < sizeof(buf));
+    len += (size_t)n;
+    if (arg != NULL) {
+        n = snprintf(buf + len, sizeof(buf) - len, ",\"args\":{\"arg\":");
+        INV(n > 0 && len + (size_t)n < sizeof(buf));
+        len = append_string(buf, len + (size_t)n, sizeof(buf) - 4, arg);
+        buf[len++] = '}';
+    }
+    buf[len++] = '}';
+    buf[len++] = ',';
+    buf[len++] = '\n';
+
+    /* A single write, so that the events of different processes appending
+     * to the same file do not mix. */
+    while ((ret = write(Trace_fd, buf, len)) == -1 && errno == EINTR)
+        continue; /* Retry. */
+    if (ret == -1)
+        disable("Cannot write trace event");
+}
+
+/** Closes the phases of the exiting process. */
+static
+void
+end_all(void)
+{
+    while (Trace_fd >= 0 && Depth > 0 && Phases[Depth - 1].pid == getpid())
+        atf_trace_end();
+}
+
+/** Opens the trace file on first use, if requested.
+ *
+ * The trace file is shared by all the processes that record events to it,
+ * which append to it.  Whoever creates it starts the JSON array of events,
+ * which the trace-event format allows to be left unterminated.
+ */
+static
+bool
+enabled(void)
+{
+    struct stat sb;
+    const char *path;
+
+    if (Trace_fd != -2)
+        return Trace_fd >= 0;
+
+    Trace_fd = -1;
+    if (!atf_env_has("ATF_TRACE_FILE"))
+        return false;
+    path = atf_env_get("ATF_TRACE_FILE");
+    if (path[0] == '\0')
+        return false;
+
+    Trace_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (Trace_fd == -1) {
+        disable("Cannot open trace file");
+        return false;
+    }
+    if (fstat(Trace_fd, &sb) == -1) {
+        disable("Cannot stat trace file");
+        return false;
+    }
+    if (sb.st_size == 0 && write(Trace_fd, "[\n", 2) != 2) {
+        disable("Cannot write trace file");
+        return false;
+    }
+
+    if (atexit(end_all) != 0) {
+        errno = ENOMEM;
+        disable("Cannot register exit handler");
+        return false;
+    }
+    return true;
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Begins a phase of the test program.
+ *
+ * The optional arg describes the subject of the phase, like the test case
+ * it belongs to.  Only the name pointer is kept, so it must outlive the
+ * phase.
+ */
+void
+atf_trace_begin(const char *name, const char *arg)
+{
+    if (!enabled())
+        return;
+
+    if (Depth == MAX_DEPTH) {
+        Overflow++;
+        return;
+    }
+    Phases[Depth].pid = getpid();
+    Phases[Depth].name = name;
+    Depth++;
+    write_event(name, 'B', arg);
+}
+
+/** Ends the innermost phase begun by the calling process. */
+void
+atf_trace_end(void)
+{
+    if (Trace_fd < 0)
+        return;
+
+    if (Overflow > 0) {
+        Overflow--;
+        return;
+    }
+    if (Depth == 0 || Phases[Depth - 1].pid != getpid())
+        return;
+    Depth--;
+    write_event(Phases[Depth].name, 'E', NULL);
+}
@@ -26,6 +26,8 @@
 #if !defined(ATF_C_MACROS_H)
 #define ATF_C_MACROS_H
 
+#include <errno.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <atf-c/defs.h>
@@ -40,9 +42,18 @@
 #define ATF_TC_PACK_NAME(tc) \
     (atfu_ ## tc ## _tc_pack)
 
+/* Flags of the static meta-data record of a test case; see
+ * ATF_TP_ADD_TC. */
+#define ATFU_TC_MD_HEAD 1
+#define ATFU_TC_MD_CLEANUP 2
+#define ATFU_TC_MD_STATIC 4
+#define ATFU_TC_MD_LINE(line) ATFU_TC_MD_LINE2(line)
+#define ATFU_TC_MD_LINE2(line) #line
+
 #define ATF_TC_WITHOUT_HEAD(tc) \
     static void atfu_ ## tc ## _body(const atf_tc_t *); \
     static atf_tc_t atfu_ ## tc ## _tc; \
+    enum { atfu_ ## tc ## _tc_md = 0 }; \
     static atf_tc_pack_t atfu_ ## tc ## _tc_pack = { \
         .m_ident = #tc, \
         .m_head = NULL, \
@@ -54,6 +65,7 @@
     static void atfu_ ## tc ## _head(atf_tc_t *); \
     static void atfu_ ## tc ## _body(const atf_tc_t *); \
     static atf_tc_t atfu_ ## tc ## _tc; \
+    enum { atfu_ ## tc ## _tc_md = ATFU_TC_MD_HEAD }; \
     static atf_tc_pack_t atfu_ ## tc ## _tc_pack = { \
         .m_ident = #tc, \
         .m_head = atfu_ ## tc ## _head, \
@@ -66,6 +78,59 @@
     static void atfu_ ## tc ## _body(const atf_tc_t *); \
     static void atfu_ ## tc ## _cleanup(const atf_tc_t *); \
     static atf_tc_t atfu_ ## tc ## _tc; \
+    enum { atfu_ ## tc ## _tc_md = ATFU_TC_MD_HEAD | ATFU_TC_MD_CLEANUP }; \
+    static atf_tc_pack_t atfu_ ## tc ## _tc_pack = { \
+        .m_ident = #tc, \
+        .m_head = atfu_ ## tc ## _head, \
+        .m_body = atfu_ ## tc ## _body, \
+        .m_cleanup = atfu_ ## tc ## _cleanup, \
+    }
+
+/* A meta-data variable of the test cases defined by ATF_TC_WITH_MD and
+ * ATF_TC_WITH_CLEANUP_MD.  The value is not a format string. */
+#define ATF_MD(name, value) name "\0" value "\0"
+
+/* Leaves the meta-data of a test case in the atf_tc_md section of the
+ * binary, where atf-list finds it, and defines a head that sets it.  The
+ * record holds no pointers: a tag, the identifier of the test case and
+ * the variables as NUL-terminated names and values, ending with an empty
+ * name. */
+#define ATFU_TC_MD_VARS(tc, md) \
+    static const struct { \
+        char m_tag[4]; \
+        char m_ident[sizeof(#tc)]; \
+        char m_vars[sizeof(md)]; \
+    } atfu_ ## tc ## _md_vars ATF_DEFS_ATTRIBUTE_TC_MD = { \
+        { 'a', 't', 'f', 'm' }, #tc, md \
+    }; \
+    static void \
+    atfu_ ## tc ## _head(atf_tc_t *atfu_tc) \
+    { \
+        atf_tc_set_md_vars_packed(atfu_tc, atfu_ ## tc ## _md_vars.m_vars); \
+    }
+
+/* Like ATF_TC and ATF_TC_WITH_CLEANUP, but with a head that only sets the
+ * md meta-data, a sequence of ATF_MD, so that the test case can be listed
+ * without running the test program. */
+#define ATF_TC_WITH_MD(tc, md) \
+    static void atfu_ ## tc ## _body(const atf_tc_t *); \
+    ATFU_TC_MD_VARS(tc, md) \
+    static atf_tc_t atfu_ ## tc ## _tc; \
+    enum { atfu_ ## tc ## _tc_md = ATFU_TC_MD_HEAD | ATFU_TC_MD_STATIC }; \
+    static atf_tc_pack_t atfu_ ## tc ## _tc_pack = { \
+        .m_ident = #tc, \
+        .m_head = atfu_ ## tc ## _head, \
+        .m_body = atfu_ ## tc ## _body, \
+        .m_cleanup = NULL, \
+    }
+
+#define ATF_TC_WITH_CLEANUP_MD(tc, md) \
+    static void atfu_ ## tc ## _body(const atf_tc_t *); \
+    static void atfu_ ## tc ## _cleanup(const atf_tc_t *); \
+    ATFU_TC_MD_VARS(tc, md) \
+    static atf_tc_t atfu_ ## tc ## _tc; \
+    enum { atfu_ ## tc ## _tc_md = ATFU_TC_MD_HEAD | ATFU_TC_MD_CLEANUP | \
+                                   ATFU_TC_MD_STATIC }; \
     static atf_tc_pack_t atfu_ ## tc ## _tc_pack = { \
         .m_ident = #tc, \
         .m_head = atfu_ ## tc ## _head, \
@@ -73,6 +138,25 @@
         .m_cleanup = atfu_ ## tc ## _cleanup, \
     }
 
+/* Like ATF_TC, but marks the test case as a benchmark whose body measures
+ * the statements under ATF_BENCHMARK_LOOP; see atf_tc_benchmark_batch. */
+#define ATF_TC_BENCHMARK(tc) \
+    static void atfu_ ## tc ## _head(atf_tc_t *); \
+    static void atfu_ ## tc ## _body(const atf_tc_t *); \
+    static void atfu_ ## tc ## _bench_head(atf_tc_t *atfu_tc) \
+    { \
+        atf_tc_set_md_var(atfu_tc, "X-benchmark", "true"); \
+        atfu_ ## tc ## _head(atfu_tc); \
+    } \
+    static atf_tc_t atfu_ ## tc ## _tc; \
+    enum { atfu_ ## tc ## _tc_md = ATFU_TC_MD_HEAD }; \
+    static atf_tc_pack_t atfu_ ## tc ## _tc_pack = { \
+        .m_ident = #tc, \
+        .m_head = atfu_ ## tc ## _bench_head, \
+        .m_body = atfu_ ## tc ## _body, \
+        .m_cleanup = NULL, \
+    }
+
 #define ATF_TC_HEAD(tc, tcptr) \
     static \
     void \
@@ -89,6 +173,14 @@
 #define ATF_TC_BODY_NAME(tc) \
     (atfu_ ## tc ## _body)
 
+/* Runs the statement that follows as many times as the benchmark of the
+ * tcptr test case asks for, in timed batches.  The statement must not
+ * break out of the loop. */
+#define ATF_BENCHMARK_LOOP(tcptr) \
+    for (size_t atfu_bench_n = 0; \
+         atf_tc_benchmark_batch(tcptr, &atfu_bench_n); ) \
+        while (atfu_bench_n-- > 0)
+
 #define ATF_TC_CLEANUP(tc, tcptr) \
     static \
     void \
@@ -97,6 +189,26 @@
 #define ATF_TC_CLEANUP_NAME(tc) \
     (atfu_ ## tc ## _cleanup)
 
+/* Defining ATF_CHECK_STATS before including this file enables the check
+ * statistics regardless of the environment; see atf_tc_count_check. */
+#if defined(ATF_CHECK_STATS)
+#   define ATFU_INIT_CHECK_STATS atf_tc_check_stats = true
+#else
+#   define ATFU_INIT_CHECK_STATS (void)0
+#endif
+
+/* Declares the statistics of the check at the call site, which
+ * ATFU_COUNT_CHECK updates if they are enabled. */
+#define ATFU_CHECK_SITE \
+    static struct atf_tc_check_site atfu_site = \
+        { __FILE__, __LINE__, 0, 0, false, NULL }
+
+#define ATFU_COUNT_CHECK(passed) \
+    do { \
+        if (atf_tc_check_stats) \
+            atf_tc_count_check(&atfu_site, passed); \
+    } while (0)
+
 #define ATF_TP_ADD_TCS(tps) \
     static atf_error_t atfu_tp_add_tcs(atf_tp_t *); \
     int atf_tp_main(int, char **, atf_error_t (*)(atf_tp_t *)); \
@@ -104,51 +216,70 @@
     int \
     main(int argc, char **argv) \
     { \
+        ATFU_INIT_CHECK_STATS; \
         return atf_tp_main(argc, argv, atfu_tp_add_tcs); \
     } \
     static \
     atf_error_t \
     atfu_tp_add_tcs(atf_tp_t *tps)
 
+/* Besides registering the test case, leaves a record describing it in the
+ * atf_tc_md section of the binary so that it can be listed without being
+ * run.  The record holds no pointers: a tag, the flags as a digit, the
+ * line of the registration, which tells the order of the test cases, and
+ * the identifier of the test case. */
 #define ATF_TP_ADD_TC(tp, tc) \
     do { \
+        static const struct { \
+            char m_tag[4]; \
+            char m_flags; \
+            char m_line[sizeof(ATFU_TC_MD_LINE(__LINE__))]; \
+            char m_ident[sizeof(#tc)]; \
+        } atfu_md ATF_DEFS_ATTRIBUTE_TC_MD = { \
+            { 'a', 't', 'f', '1' }, '0' + atfu_ ## tc ## _tc_md, \
+            ATFU_TC_MD_LINE(__LINE__), #tc \
+        }; \
         atf_error_t atfu_err; \
-        char **atfu_config = atf_tp_get_config(tp); \
-        if (atfu_config == NULL) \
-            return atf_no_memory_error(); \
-        atfu_err = atf_tc_init_pack(&atfu_ ## tc ## _tc, \
-                                    &atfu_ ## tc ## _tc_pack, \
-                                    (const char *const *)atfu_config); \
-        atf_utils_free_charpp(atfu_config); \
-        if (atf_is_error(atfu_err)) \
-            return atfu_err; \
-        atfu_err = atf_tp_add_tc(tp, &atfu_ ## tc ## _tc); \
+        atfu_err = atf_tp_add_tc_pack(tp, &atfu_ ## tc ## _tc, \
+                                      &atfu_ ## tc ## _tc_pack); \
         if (atf_is_error(atfu_err)) \
             return atfu_err; \
     } while (0)
 
 #define ATF_REQUIRE_MSG(expression, fmt, ...) \
     do { \
-        if (expression) {} else \
+        ATFU_CHECK_SITE; \
+        const bool atfu_passed = (expression) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_passed); \
+        if (atfu_passed) {} else \
             atf_tc_fail_requirement(__FILE__, __LINE__, fmt, ##__VA_ARGS__); \
     } while(0)
 
 #define ATF_CHECK_MSG(expression, fmt, ...) \
     do { \
-        if (expression) {} else \
+        ATFU_CHECK_SITE; \
+        const bool atfu_passed = (expression) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_passed); \
+        if (atfu_passed) {} else \
             atf_tc_fail_check(__FILE__, __LINE__, fmt, ##__VA_ARGS__); \
     } while(0)
 
 #define ATF_REQUIRE(expression) \
     do { \
-        if (expression) {} else \
+        ATFU_CHECK_SITE; \
+        const bool atfu_passed = (expression) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_passed); \
+        if (atfu_passed) {} else \
             atf_tc_fail_requirement(__FILE__, __LINE__, "%s", \
                                     #expression " not met"); \
     } while(0)
 
 #define ATF_CHECK(expression) \
     do { \
-        if (expression) {} else \
+        ATFU_CHECK_SITE; \
+        const bool atfu_passed = (expression) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_passed); \
+        if (atfu_passed) {} else \
             atf_tc_fail_check(__FILE__, __LINE__, "%s", \
                               #expression " not met"); \
     } while(0)
@@ -223,9 +354,48 @@
                   ##__VA_ARGS__);
 
 #define ATF_CHECK_ERRNO(exp_errno, bool_expr) \
-    atf_tc_check_errno(__FILE__, __LINE__, exp_errno, #bool_expr, bool_expr)
+    do { \
+        ATFU_CHECK_SITE; \
+        const bool atfu_result = (bool_expr) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_result && errno == (exp_errno)); \
+        atf_tc_check_errno(__FILE__, __LINE__, exp_errno, #bool_expr, \
+                           atfu_result); \
+    } while(0)
 
 #define ATF_REQUIRE_ERRNO(exp_errno, bool_expr) \
-    atf_tc_require_errno(__FILE__, __LINE__, exp_errno, #bool_expr, bool_expr)
+    do { \
+        ATFU_CHECK_SITE; \
+        const bool atfu_result = (bool_expr) ? true : false; \
+        ATFU_COUNT_CHECK(atfu_result && errno == (exp_errno)); \
+        atf_tc_require_errno(__FILE__, __LINE__, exp_errno, #bool_expr, \
+                             atfu_result); \
+    } while(0)
+
+/* Runs the statement and fails if it takes more wall or CPU time than the
+ * budget, in milliseconds, scaled by the perf_scale configuration
+ * variable.  The budget is computed before the clock starts. */
+#define ATFU_WITHIN(fail_func, cpu, budget_ms, ...) \
+    do { \
+        ATFU_CHECK_SITE; \
+        const double atfu_budget = atf_tc_within_budget(budget_ms); \
+        const double atfu_start = atf_tc_within_clock(cpu); \
+        { __VA_ARGS__; } \
+        const double atfu_elapsed = atf_tc_within_clock(cpu) - atfu_start; \
+        ATFU_COUNT_CHECK(atfu_elapsed <= atfu_budget); \
+        fail_func(__FILE__, __LINE__, cpu, #__VA_ARGS__, atfu_elapsed, \
+                  atfu_budget); \
+    } while(0)
+
+#define ATF_CHECK_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_check_within, false, budget_ms, __VA_ARGS__)
+
+#define ATF_REQUIRE_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_require_within, false, budget_ms, __VA_ARGS__)
+
+#define ATF_CHECK_CPU_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_check_within, true, budget_ms, __VA_ARGS__)
+
+#define ATF_REQUIRE_CPU_WITHIN(budget_ms, ...) \
+    ATFU_WITHIN(atf_tc_require_within, true, budget_ms, __VA_ARGS__)
 
 #endif /* !defined(ATF_C_MACROS_H) */
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <atf-c.h>
@@ -76,17 +77,27 @@ exists(const char *p)
 
 static
 void
-init_and_run_h_tc(const char *name, void (*head)(atf_tc_t *),
-                  void (*body)(const atf_tc_t *))
+init_and_run_h_tc_config(const char *name, void (*head)(atf_tc_t *),
+                         void (*body)(const atf_tc_t *),
+                         const char *const *config)
 {
     atf_tc_t tc;
-    const char *const config[] = { NULL };
 
     RE(atf_tc_init(&tc, name, head, body, NULL, config));
     run_h_tc(&tc, "output", "error", "result");
     atf_tc_fini(&tc);
 }
 
+static
+void
+init_and_run_h_tc(const char *name, void (*head)(atf_tc_t *),
+                  void (*body)(const atf_tc_t *))
+{
+    const char *const config[] = { NULL };
+
+    init_and_run_h_tc_config(name, head, body, config);
+}
+
 /* ---------------------------------------------------------------------
  * Helper test cases.
  * --------------------------------------------------------------------- */
@@ -205,6 +216,32 @@ init_and_run_h_tc(const char *name, void (*head)(atf_tc_t *),
 #define H_REQUIRE_ERRNO(id, exp_errno, bool_expr) \
     H_DEF(require_errno_ ## id, ATF_REQUIRE_ERRNO(exp_errno, bool_expr))
 
+#define H_CHECK_WITHIN_HEAD_NAME(id) ATF_TC_HEAD_NAME(h_check_within_ ## id)
+#define H_CHECK_WITHIN_BODY_NAME(id) ATF_TC_BODY_NAME(h_check_within_ ## id)
+#define H_CHECK_WITHIN(id, ms, stmt) \
+    H_DEF(check_within_ ## id, ATF_CHECK_WITHIN(ms, stmt))
+
+#define H_CHECK_CPU_WITHIN_HEAD_NAME(id) \
+    ATF_TC_HEAD_NAME(h_check_cpu_within_ ## id)
+#define H_CHECK_CPU_WITHIN_BODY_NAME(id) \
+    ATF_TC_BODY_NAME(h_check_cpu_within_ ## id)
+#define H_CHECK_CPU_WITHIN(id, ms, stmt) \
+    H_DEF(check_cpu_within_ ## id, ATF_CHECK_CPU_WITHIN(ms, stmt))
+
+#define H_REQUIRE_WITHIN_HEAD_NAME(id) \
+    ATF_TC_HEAD_NAME(h_require_within_ ## id)
+#define H_REQUIRE_WITHIN_BODY_NAME(id) \
+    ATF_TC_BODY_NAME(h_require_within_ ## id)
+#define H_REQUIRE_WITHIN(id, ms, stmt) \
+    H_DEF(require_within_ ## id, ATF_REQUIRE_WITHIN(ms, stmt))
+
+#define H_REQUIRE_CPU_WITHIN_HEAD_NAME(id) \
+    ATF_TC_HEAD_NAME(h_require_cpu_within_ ## id)
+#define H_REQUIRE_CPU_WITHIN_BODY_NAME(id) \
+    ATF_TC_BODY_NAME(h_require_cpu_within_ ## id)
+#define H_REQUIRE_CPU_WITHIN(id, ms, stmt) \
+    H_DEF(require_cpu_within_ ## id, ATF_REQUIRE_CPU_WITHIN(ms, stmt))
+
 /* ---------------------------------------------------------------------
  * Test cases for the ATF_{CHECK,REQUIRE}_ERRNO macros.
  * --------------------------------------------------------------------- */
@@ -319,6 +356,173 @@ ATF_TC_BODY(require_errno, tc)
     }
 }
 
+/* ---------------------------------------------------------------------
+ * Test cases for the ATF_{CHECK,REQUIRE}_{,CPU_}WITHIN macros.
+ * --------------------------------------------------------------------- */
+
+static void
+sleep_ms(const long ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        continue;
+}
+
+static void
+spin_ms(const long ms)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    do {
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000 +
+             (now.tv_nsec - start.tv_nsec) / 1000000 < ms);
+}
+
+H_CHECK_WITHIN(ok, 10000, sleep_ms(1));
+H_CHECK_WITHIN(fail, 1, sleep_ms(50));
+H_CHECK_CPU_WITHIN(sleep, 20, sleep_ms(50));
+H_CHECK_CPU_WITHIN(fail, 1, spin_ms(50));
+
+H_REQUIRE_WITHIN(ok, 10000, sleep_ms(1));
+H_REQUIRE_WITHIN(fail, 20, sleep_ms(50));
+H_REQUIRE_CPU_WITHIN(ok, 10000, spin_ms(1));
+H_REQUIRE_CPU_WITHIN(fail, 1, spin_ms(50));
+
+ATF_TC(check_within);
+ATF_TC_HEAD(check_within, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the ATF_CHECK_WITHIN and "
+                      "ATF_CHECK_CPU_WITHIN macros");
+}
+ATF_TC_BODY(check_within, tc)
+{
+    struct test {
+        void (*head)(atf_tc_t *);
+        void (*body)(const atf_tc_t *);
+        bool ok;
+        const char *exp_regex;
+    } *t, tests[] = {
+        { H_CHECK_WITHIN_HEAD_NAME(ok),
+          H_CHECK_WITHIN_BODY_NAME(ok),
+          true, NULL },
+        { H_CHECK_WITHIN_HEAD_NAME(fail),
+          H_CHECK_WITHIN_BODY_NAME(fail),
+          false, "sleep_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of wall time, "
+          "more than the 1\\.000 ms allowed" },
+        { H_CHECK_CPU_WITHIN_HEAD_NAME(sleep),
+          H_CHECK_CPU_WITHIN_BODY_NAME(sleep),
+          true, NULL },
+        { H_CHECK_CPU_WITHIN_HEAD_NAME(fail),
+          H_CHECK_CPU_WITHIN_BODY_NAME(fail),
+          false, "spin_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of CPU time, "
+          "more than the 1\\.000 ms allowed" },
+        { NULL, NULL, false, NULL }
+    };
+
+    for (t = &tests[0]; t->head != NULL; t++) {
+        init_and_run_h_tc("h_check_within", t->head, t->body);
+
+        ATF_REQUIRE(exists("before"));
+        ATF_REQUIRE(exists("after"));
+
+        if (t->ok) {
+            ATF_REQUIRE(atf_utils_grep_file("^passed", "result"));
+        } else {
+            ATF_REQUIRE(atf_utils_grep_file("^failed", "result"));
+            ATF_REQUIRE(atf_utils_grep_file(
+                "macros_test.c:[0-9]+: %s$", "error", t->exp_regex));
+        }
+
+        ATF_REQUIRE(unlink("before") != -1);
+        ATF_REQUIRE(unlink("after") != -1);
+    }
+}
+
+ATF_TC(require_within);
+ATF_TC_HEAD(require_within, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the ATF_REQUIRE_WITHIN and "
+                      "ATF_REQUIRE_CPU_WITHIN macros");
+}
+ATF_TC_BODY(require_within, tc)
+{
+    struct test {
+        void (*head)(atf_tc_t *);
+        void (*body)(const atf_tc_t *);
+        bool ok;
+        const char *exp_regex;
+    } *t, tests[] = {
+        { H_REQUIRE_WITHIN_HEAD_NAME(ok),
+          H_REQUIRE_WITHIN_BODY_NAME(ok),
+          true, NULL },
+        { H_REQUIRE_WITHIN_HEAD_NAME(fail),
+          H_REQUIRE_WITHIN_BODY_NAME(fail),
+          false, "sleep_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of wall time, "
+          "more than the 20\\.000 ms allowed" },
+        { H_REQUIRE_CPU_WITHIN_HEAD_NAME(ok),
+          H_REQUIRE_CPU_WITHIN_BODY_NAME(ok),
+          true, NULL },
+        { H_REQUIRE_CPU_WITHIN_HEAD_NAME(fail),
+          H_REQUIRE_CPU_WITHIN_BODY_NAME(fail),
+          false, "spin_ms\\(50\\) took [0-9]+\\.[0-9]{3} ms of CPU time, "
+          "more than the 1\\.000 ms allowed" },
+        { NULL, NULL, false, NULL }
+    };
+
+    for (t = &tests[0]; t->head != NULL; t++) {
+        init_and_run_h_tc("h_require_within", t->head, t->body);
+
+        ATF_REQUIRE(exists("before"));
+        if (t->ok) {
+            ATF_REQUIRE(atf_utils_grep_file("^passed", "result"));
+            ATF_REQUIRE(exists("after"));
+        } else {
+            ATF_REQUIRE(atf_utils_grep_file(
+                "^failed: .*macros_test.c:[0-9]+: %s$", "result",
+                t->exp_regex));
+            ATF_REQUIRE(!exists("after"));
+        }
+
+        ATF_REQUIRE(unlink("before") != -1);
+        if (t->ok)
+            ATF_REQUIRE(unlink("after") != -1);
+    }
+}
+
+ATF_TC(within_perf_scale);
+ATF_TC_HEAD(within_perf_scale, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the perf_scale configuration "
+                      "variable scales the budgets of the bounded-time "
+                      "macros");
+}
+ATF_TC_BODY(within_perf_scale, tc)
+{
+    const char *const slow[] = { "perf_scale", "10", NULL };
+    const char *const invalid[] = { "perf_scale", "0", NULL };
+
+    init_and_run_h_tc_config("h_require_within",
+                             H_REQUIRE_WITHIN_HEAD_NAME(fail),
+                             H_REQUIRE_WITHIN_BODY_NAME(fail), slow);
+    ATF_REQUIRE(atf_utils_grep_file("^passed", "result"));
+    ATF_REQUIRE(unlink("before") != -1);
+    ATF_REQUIRE(unlink("after") != -1);
+
+    init_and_run_h_tc_config("h_check_within",
+                             H_CHECK_WITHIN_HEAD_NAME(ok),
+                             H_CHECK_WITHIN_BODY_NAME(ok), invalid);
+    ATF_REQUIRE(atf_utils_grep_file("^failed: Configuration variable "
+                                    "perf_scale does not have a valid "
+                                    "positive value; found 0$", "result"));
+    ATF_REQUIRE(unlink("before") != -1);
+    ATF_REQUIRE(!exists("after"));
+}
+
 /* ---------------------------------------------------------------------
  * Test cases for the ATF_CHECK and ATF_CHECK_MSG macros.
  * --------------------------------------------------------------------- */
@@ -831,6 +1035,52 @@ ATF_TC_BODY(msg_embedded_fmt, tc)
     }
 }
 
+ATF_TC_WITH_MD(h_with_md,
+    ATF_MD("descr", "Helper test case with static meta-data")
+    ATF_MD("X-custom", "50%s")
+    ATF_MD("timeout", ""));
+ATF_TC_BODY(h_with_md, tc)
+{
+}
+
+ATF_TC_WITH_CLEANUP_MD(h_with_cleanup_md,
+    ATF_MD("require.user", "root"));
+ATF_TC_BODY(h_with_cleanup_md, tc)
+{
+}
+ATF_TC_CLEANUP(h_with_cleanup_md, tc)
+{
+}
+
+ATF_TC(with_md);
+ATF_TC_HEAD(with_md, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the heads defined by "
+                      "ATF_TC_WITH_MD and ATF_TC_WITH_CLEANUP_MD set the "
+                      "variables given with ATF_MD verbatim");
+}
+ATF_TC_BODY(with_md, tc)
+{
+    const char *const config[] = { NULL };
+    atf_tc_t *h;
+
+    h = &ATF_TC_NAME(h_with_md);
+    RE(atf_tc_init_pack(h, &ATF_TC_PACK_NAME(h_with_md), config));
+    ATF_CHECK_STREQ(atf_tc_get_md_var(h, "descr"),
+                    "Helper test case with static meta-data");
+    ATF_CHECK_STREQ(atf_tc_get_md_var(h, "X-custom"), "50%s");
+    ATF_CHECK_STREQ(atf_tc_get_md_var(h, "timeout"), "");
+    ATF_CHECK(!atf_tc_has_md_var(h, "has.cleanup"));
+    atf_tc_fini(h);
+
+    h = &ATF_TC_NAME(h_with_cleanup_md);
+    RE(atf_tc_init_pack(h, &ATF_TC_PACK_NAME(h_with_cleanup_md), config));
+    ATF_CHECK_STREQ(atf_tc_get_md_var(h, "require.user"), "root");
+    ATF_CHECK(!atf_tc_has_md_var(h, "descr"));
+    ATF_CHECK_STREQ(atf_tc_get_md_var(h, "has.cleanup"), "true");
+    atf_tc_fini(h);
+}
+
 /* ---------------------------------------------------------------------
  * Tests cases for the header file.
  * --------------------------------------------------------------------- */
@@ -876,15 +1126,21 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, check_streq);
     ATF_TP_ADD_TC(tp, check_errno);
     ATF_TP_ADD_TC(tp, check_match);
+    ATF_TP_ADD_TC(tp, check_within);
 
     ATF_TP_ADD_TC(tp, require);
     ATF_TP_ADD_TC(tp, require_eq);
     ATF_TP_ADD_TC(tp, require_streq);
     ATF_TP_ADD_TC(tp, require_errno);
     ATF_TP_ADD_TC(tp, require_match);
+    ATF_TP_ADD_TC(tp, require_within);
+
+    ATF_TP_ADD_TC(tp, within_perf_scale);
 
     ATF_TP_ADD_TC(tp, msg_embedded_fmt);
 
+    ATF_TP_ADD_TC(tp, with_md);
+
     /* Add the test cases for the header file. */
     ATF_TP_ADD_TC(tp, use);
     ATF_TP_ADD_TC(tp, detect_unused_tests);
@@ -26,25 +26,41 @@
 #include "atf-c/tc.h"
 
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "atf-c/defs.h"
+#include "atf-c/detail/bench.h"
 #include "atf-c/detail/env.h"
+#include "atf-c/detail/events.h"
 #include "atf-c/detail/fs.h"
+#include "atf-c/detail/hash.h"
 #include "atf-c/detail/map.h"
+#include "atf-c/detail/process.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/tc.h"
 #include "atf-c/detail/text.h"
+#include "atf-c/detail/trace.h"
 #include "atf-c/error.h"
 
 /* ---------------------------------------------------------------------
@@ -60,23 +76,63 @@ enum expect_type {
     EXPECT_TIMEOUT,
 };
 
+/* Number of failures at a single check site that are reported on stderr
+ * unless ATF_CHECK_FAILURE_LIMIT says otherwise; 0 reports all of them
+ * without tracking their sites. */
+#define DEFAULT_CHECK_FAILURE_LIMIT 0
+
+/* A source location where non-fatal checks failed. */
+struct check_site {
+    const char *file;
+    size_t line;
+    size_t failures;
+    size_t expected_failures;
+};
+
+/* The sites of the failed checks of a test case, in the order in which
+ * they first failed.  index is an open-addressing hash table of the
+ * sites; its entries hold the position of a site plus one, so that zero
+ * marks an empty slot, and its size is always a power of two. */
+struct check_sites {
+    struct check_site *sites;
+    size_t nsites;
+    size_t capacity;
+    size_t *index;
+    size_t index_size;
+};
+
 struct context {
     const atf_tc_t *tc;
     const char *resfile;
     int resfilefd;
+    int eventsfd;
     size_t fail_count;
 
     enum expect_type expect;
+    int *expect_mirror;  /* Shared with the watchdog; may be NULL. */
     atf_dynstr_t expect_reason;
     size_t expect_previous_fail_count;
     size_t expect_fail_count;
     int expect_exitcode;
     int expect_signo;
+
+    struct check_sites check_sites;
+    size_t check_failure_limit;  /* 0 means no limit. */
 };
 
+static void check_sites_init(struct check_sites *);
+static struct check_site *check_sites_get(struct check_sites *, const char *,
+                                          const size_t);
 static void context_init(struct context *, const atf_tc_t *, const char *);
+static void report_check_sites(const struct context *);
+static void timespec_diff(const struct timespec *, const struct timespec *,
+                          struct timeval *);
+static void context_set_expect(struct context *, const enum expect_type);
 static void context_set_resfile(struct context *, const char *);
+static int connect_resfile(const char *);
 static void context_close_resfile(struct context *);
+static bool context_resfile_is_regular(const struct context *);
+static void context_open_events(struct context *);
 static void check_fatal_error(atf_error_t);
 static void report_fatal_error(const char *, ...)
     ATF_DEFS_ATTRIBUTE_NORETURN;
@@ -89,9 +145,12 @@ static void error_in_expect(struct context *, const char *, ...)
 static void validate_expect(struct context *);
 static void expected_failure(struct context *, atf_dynstr_t *)
     ATF_DEFS_ATTRIBUTE_NORETURN;
-static void fail_requirement(struct context *, atf_dynstr_t *)
+static void fail_test(struct context *, atf_dynstr_t *)
     ATF_DEFS_ATTRIBUTE_NORETURN;
-static void fail_check(struct context *, atf_dynstr_t *);
+static void fail_requirement(struct context *, const char *, const size_t,
+                             atf_dynstr_t *) ATF_DEFS_ATTRIBUTE_NORETURN;
+static void fail_check(struct context *, const char *, const size_t,
+                       atf_dynstr_t *);
 static void pass(struct context *)
     ATF_DEFS_ATTRIBUTE_NORETURN;
 static void skip(struct context *, atf_dynstr_t *)
@@ -102,27 +161,172 @@ static void format_reason_fmt(atf_dynstr_t *, const char *, const size_t,
                               const char *, ...);
 static void errno_test(struct context *, const char *, const size_t,
                        const int, const char *, const bool,
-                       void (*)(struct context *, atf_dynstr_t *));
+                       void (*)(struct context *, const char *, const size_t,
+                                atf_dynstr_t *));
+static void within_test(struct context *, const char *, const size_t,
+                        const bool, const char *, const double, const double,
+                        void (*)(struct context *, const char *,
+                                 const size_t, atf_dynstr_t *));
 static atf_error_t check_prog_in_dir(const char *, void *);
 static atf_error_t check_prog(struct context *, const char *);
 
 /* No prototype in header for this one, it's a little sketchy (internal). */
 void atf_tc_set_resultsfile(const char *);
 
+/* ---------------------------------------------------------------------
+ * The "check_sites" auxiliary type.
+ * --------------------------------------------------------------------- */
+
+static void
+check_sites_init(struct check_sites *cs)
+{
+    cs->sites = NULL;
+    cs->nsites = 0;
+    cs->capacity = 0;
+    cs->index = NULL;
+    cs->index_size = 0;
+}
+
+static size_t
+hash_site(const char *file, const size_t line)
+{
+    return (size_t)atf_hash_bytes(atf_hash_string(ATF_HASH_INIT, file),
+                                  &line, sizeof(line));
+}
+
+/* Returns the slot of the index that holds the given site or, if there is
+ * no such site, the empty slot where it would go. */
+static size_t
+check_sites_slot(const struct check_sites *cs, const size_t *index,
+                 const size_t size, const char *file, const size_t line)
+{
+    size_t i;
+
+    i = hash_site(file, line) & (size - 1);
+    while (index[i] != 0) {
+        const struct check_site *site = &cs->sites[index[i] - 1];
+        if (site->line == line && strcmp(site->file, file) == 0)
+            break;
+        i = (i + 1) & (size - 1);
+    }
+    return i;
+}
+
+static void
+check_sites_grow(struct check_sites *cs)
+{
+    size_t *index;
+    size_t i, size;
+
+    size = cs->index_size == 0 ? 64 : cs->index_size * 2;
+    index = calloc(size, sizeof(*index));
+    if (index == NULL)
+        check_fatal_error(atf_no_memory_error());
+
+    for (i = 0; i < cs->nsites; i++)
+        index[check_sites_slot(cs, index, size, cs->sites[i].file,
+                               cs->sites[i].line)] = i + 1;
+
+    free(cs->index);
+    cs->index = index;
+    cs->index_size = size;
+}
+
+/** Gets the given check site, adding it if it has not failed before.
+ *
+ * The returned pointer is only valid until the next call.  Errors are
+ * fatal.
+ */
+static struct check_site *
+check_sites_get(struct check_sites *cs, const char *file, const size_t line)
+{
+    size_t slot;
+    struct check_site *site;
+
+    if (cs->index_size == 0 || (cs->nsites + 1) * 2 > cs->index_size)
+        check_sites_grow(cs);
+
+    slot = check_sites_slot(cs, cs->index, cs->index_size, file, line);
+    if (cs->index[slot] != 0)
+        return &cs->sites[cs->index[slot] - 1];
+
+    if (cs->nsites == cs->capacity) {
+        const size_t capacity = cs->capacity == 0 ? 16 : cs->capacity * 2;
+        struct check_site *sites;
+
+        sites = realloc(cs->sites, capacity * sizeof(*sites));
+        if (sites == NULL)
+            check_fatal_error(atf_no_memory_error());
+        cs->sites = sites;
+        cs->capacity = capacity;
+    }
+
+    site = &cs->sites[cs->nsites];
+    site->file = file;
+    site->line = line;
+    site->failures = 0;
+    site->expected_failures = 0;
+    cs->index[slot] = ++cs->nsites;
+    return site;
+}
+
+/* ---------------------------------------------------------------------
+ * The "context" type.
+ * --------------------------------------------------------------------- */
+
+/** Gets the number of failures to report for every check site.
+ *
+ * Returns 0 if all of them must be reported.
+ */
+static size_t
+check_failure_limit(void)
+{
+    atf_error_t err;
+    const char *value;
+    long limit;
+
+    if (!atf_env_has("ATF_CHECK_FAILURE_LIMIT"))
+        return DEFAULT_CHECK_FAILURE_LIMIT;
+
+    value = atf_env_get("ATF_CHECK_FAILURE_LIMIT");
+    err = atf_text_to_long(value, &limit);
+    if (atf_is_error(err) || limit < 0) {
+        if (atf_is_error(err))
+            atf_error_free(err);
+        report_fatal_error("Invalid value for ATF_CHECK_FAILURE_LIMIT: %s",
+                           value);
+        UNREACHABLE;
+    }
+    return (size_t)limit;
+}
+
 static void
 context_init(struct context *ctx, const atf_tc_t *tc, const char *resfile)
 {
 
     ctx->tc = tc;
     ctx->resfilefd = -1;
+    ctx->eventsfd = -1;
     context_set_resfile(ctx, resfile);
     ctx->fail_count = 0;
-    ctx->expect = EXPECT_PASS;
+    ctx->expect_mirror = NULL;
+    context_set_expect(ctx, EXPECT_PASS);
     check_fatal_error(atf_dynstr_init(&ctx->expect_reason));
     ctx->expect_previous_fail_count = 0;
     ctx->expect_fail_count = 0;
     ctx->expect_exitcode = 0;
     ctx->expect_signo = 0;
+    check_sites_init(&ctx->check_sites);
+    ctx->check_failure_limit = check_failure_limit();
+}
+
+static void
+context_set_expect(struct context *ctx, const enum expect_type expect)
+{
+
+    ctx->expect = expect;
+    if (ctx->expect_mirror != NULL)
+        *ctx->expect_mirror = (int)expect;
 }
 
 static void
@@ -136,7 +340,14 @@ context_set_resfile(struct context *ctx, const char *resfile)
         ctx->resfilefd = STDOUT_FILENO;
     else if (strcmp(resfile, "/dev/stderr") == 0)
         ctx->resfilefd = STDERR_FILENO;
-    else
+    else if (atf_tc_resfile_is_socket(resfile)) {
+        ctx->resfilefd = connect_resfile(resfile + strlen("unix:"));
+        if (ctx->resfilefd == -1) {
+            err = atf_libc_error(errno,
+                "Cannot connect to results socket '%s'", resfile);
+            check_fatal_error(err);
+        }
+    } else
         ctx->resfilefd = open(resfile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
     if (ctx->resfilefd == -1) {
@@ -146,12 +357,48 @@ context_set_resfile(struct context *ctx, const char *resfile)
     }
 
     ctx->resfile = resfile;
+    context_open_events(ctx);
+}
+
+/** Connects to the collector listening on the Unix socket at path.
+ *
+ * Returns the connected descriptor, or -1 with errno set on failure.
+ */
+static int
+connect_resfile(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd, olderrno;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1 ||
+        connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        olderrno = errno;
+        close(fd);
+        errno = olderrno;
+        return -1;
+    }
+    return fd;
 }
 
 static void
 context_close_resfile(struct context *ctx)
 {
 
+    if (ctx->eventsfd != -1) {
+        close(ctx->eventsfd);
+        ctx->eventsfd = -1;
+    }
     if (ctx->resfilefd == -1)
         return;
     if (ctx->resfilefd != STDOUT_FILENO && ctx->resfilefd != STDERR_FILENO)
@@ -160,6 +407,59 @@ context_close_resfile(struct context *ctx)
     ctx->resfile = NULL;
 }
 
+/** Checks whether the results file is a regular file.
+ *
+ * Side records, such as the events of the test case, are only stored next
+ * to results files that live in the file system.
+ */
+static bool
+context_resfile_is_regular(const struct context *ctx)
+{
+    struct stat sb;
+
+    if (ctx->resfilefd == STDOUT_FILENO || ctx->resfilefd == STDERR_FILENO)
+        return false;
+    return fstat(ctx->resfilefd, &sb) != -1 && S_ISREG(sb.st_mode);
+}
+
+/** Opens the events file of the test case, if requested.
+ *
+ * The events are only recorded if the ATF_RESULT_EVENTS environment
+ * variable is set to a non-empty value.  They go to a file named after the
+ * results file with an added '.jsonl' suffix or, if the results go to a
+ * socket, to the socket itself, interleaved with the result lines.
+ */
+static void
+context_open_events(struct context *ctx)
+{
+    atf_dynstr_t path;
+
+    INV(ctx->eventsfd == -1);
+
+    if (!atf_env_has("ATF_RESULT_EVENTS") ||
+        atf_env_get("ATF_RESULT_EVENTS")[0] == '\0')
+        return;
+
+    if (atf_tc_resfile_is_socket(ctx->resfile)) {
+        ctx->eventsfd = fcntl(ctx->resfilefd, F_DUPFD_CLOEXEC, 0);
+        if (ctx->eventsfd == -1)
+            check_fatal_error(atf_libc_error(errno,
+                "Cannot duplicate results socket '%s'", ctx->resfile));
+        return;
+    }
+    if (!context_resfile_is_regular(ctx))
+        return;
+
+    check_fatal_error(atf_dynstr_init_fmt(&path, "%s.jsonl", ctx->resfile));
+    ctx->eventsfd = open(atf_dynstr_cstring(&path),
+        O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+        S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (ctx->eventsfd == -1)
+        check_fatal_error(atf_libc_error(errno,
+            "Cannot create events file '%s'", atf_dynstr_cstring(&path)));
+    atf_dynstr_fini(&path);
+}
+
 static void
 check_fatal_error(atf_error_t err)
 {
@@ -186,6 +486,190 @@ report_fatal_error(const char *msg, ...)
     abort();
 }
 
+/* ---------------------------------------------------------------------
+ * Events.
+ * --------------------------------------------------------------------- */
+
+static const char *
+expect_type_name(const enum expect_type expect)
+{
+    switch (expect) {
+    case EXPECT_PASS:
+        return "pass";
+    case EXPECT_FAIL:
+        return "fail";
+    case EXPECT_EXIT:
+        return "exit";
+    case EXPECT_SIGNAL:
+        return "signal";
+    case EXPECT_DEATH:
+        return "death";
+    case EXPECT_TIMEOUT:
+        return "timeout";
+    default:
+        UNREACHABLE;
+    }
+    return NULL;
+}
+
+/** Strips the "file:line: " prefix that format_reason_ap adds. */
+static const char *
+reason_message(const atf_dynstr_t *reason, const char *file,
+               const size_t line)
+{
+    const char *str = atf_dynstr_cstring(reason);
+
+    if (file != NULL) {
+        const int prefix = snprintf(NULL, 0, "%s:%zd: ", file, line);
+
+        if (prefix > 0 && (size_t)prefix <= atf_dynstr_length(reason))
+            str += prefix;
+    }
+    return str;
+}
+
+/** Stops recording events after an error.
+ *
+ * Events are only informational, so errors do not affect the test case:
+ * they are reported as a warning and no more events are recorded.
+ */
+static void
+disable_events(struct context *ctx, atf_error_t err)
+{
+    char buf[1024];
+
+    atf_error_format(err, buf, sizeof(buf));
+    fprintf(stderr, "WARNING: Disabling events: %s\n", buf);
+    atf_error_free(err);
+
+    close(ctx->eventsfd);
+    ctx->eventsfd = -1;
+}
+
+/** Terminates an event and writes it to the events file.
+ *
+ * err carries the result of building the event.  The event is released in
+ * all cases.
+ */
+static void
+emit_event(struct context *ctx, atf_event_t *ev, atf_error_t err)
+{
+    if (!atf_is_error(err))
+        err = atf_event_end(ev);
+    if (!atf_is_error(err))
+        err = atf_event_write(ev, ctx->eventsfd);
+    atf_event_fini(ev);
+
+    if (atf_is_error(err))
+        disable_events(ctx, err);
+}
+
+static void
+event_start(struct context *ctx)
+{
+    atf_error_t err;
+    atf_event_t ev;
+
+    if (ctx->eventsfd == -1)
+        return;
+
+    err = atf_event_init(&ev, "start");
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_event_add_string(&ev, "test_case", atf_tc_get_ident(ctx->tc));
+    emit_event(ctx, &ev, err);
+    return;
+
+out:
+    disable_events(ctx, err);
+}
+
+static void
+event_expect(struct context *ctx, const int arg, const char *reason)
+{
+    atf_error_t err;
+    atf_event_t ev;
+
+    if (ctx->eventsfd == -1)
+        return;
+
+    err = atf_event_init(&ev, "expect");
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_event_add_string(&ev, "expect", expect_type_name(ctx->expect));
+    if (!atf_is_error(err) && arg != -1)
+        err = atf_event_add_int(&ev, ctx->expect == EXPECT_SIGNAL ?
+                                "signal" : "exit_code", arg);
+    if (!atf_is_error(err) && reason != NULL)
+        err = atf_event_add_string(&ev, "reason", reason);
+    emit_event(ctx, &ev, err);
+    return;
+
+out:
+    disable_events(ctx, err);
+}
+
+static void
+event_failure(struct context *ctx, const char *file, const size_t line,
+              const atf_dynstr_t *reason, const bool fatal)
+{
+    atf_error_t err;
+    atf_event_t ev;
+
+    if (ctx->eventsfd == -1)
+        return;
+
+    err = atf_event_init(&ev, "failure");
+    if (atf_is_error(err))
+        goto out;
+
+    if (file != NULL) {
+        err = atf_event_add_string(&ev, "file", file);
+        if (!atf_is_error(err))
+            err = atf_event_add_int(&ev, "line", (long)line);
+    }
+    if (!atf_is_error(err))
+        err = atf_event_add_string(&ev, "reason",
+                                   reason_message(reason, file, line));
+    if (!atf_is_error(err))
+        err = atf_event_add_bool(&ev, "fatal", fatal);
+    if (!atf_is_error(err))
+        err = atf_event_add_bool(&ev, "expected", ctx->expect == EXPECT_FAIL);
+    emit_event(ctx, &ev, err);
+    return;
+
+out:
+    disable_events(ctx, err);
+}
+
+static void
+event_result(struct context *ctx, const char *result, const int arg,
+             const atf_dynstr_t *reason)
+{
+    atf_error_t err;
+    atf_event_t ev;
+
+    if (ctx->eventsfd == -1)
+        return;
+
+    err = atf_event_init(&ev, "result");
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_event_add_string(&ev, "result", result);
+    if (!atf_is_error(err) && arg != -1)
+        err = atf_event_add_int(&ev, "arg", arg);
+    if (!atf_is_error(err) && reason != NULL)
+        err = atf_event_add_string(&ev, "reason", atf_dynstr_cstring(reason));
+    emit_event(ctx, &ev, err);
+    return;
+
+out:
+    disable_events(ctx, err);
+}
+
 /** Writes to a results file.
  *
  * The results file is supposed to be already open.
@@ -262,7 +746,14 @@ create_resfile(struct context *ctx, const char *result, const int arg,
     if (ctx->resfilefd != STDOUT_FILENO && ctx->resfilefd != STDERR_FILENO &&
         ftruncate(ctx->resfilefd, 0) != -1)
         lseek(ctx->resfilefd, 0, SEEK_SET);
+    atf_trace_begin("write_resfile", result);
     err = write_resfile(ctx->resfilefd, result, arg, reason);
+    atf_trace_end();
+
+    /* Results of expectations that depend on how the body terminates are
+     * not final yet; their events were recorded when they were set. */
+    if (ctx->expect == EXPECT_PASS || ctx->expect == EXPECT_FAIL)
+        event_result(ctx, result, arg, reason);
 
     if (reason != NULL)
         atf_dynstr_fini(reason);
@@ -281,8 +772,9 @@ error_in_expect(struct context *ctx, const char *fmt, ...)
     format_reason_ap(&reason, NULL, 0, fmt, ap);
     va_end(ap);
 
-    ctx->expect = EXPECT_PASS;  /* Ensure fail_requirement really fails. */
-    fail_requirement(ctx, &reason);
+    /* Ensure fail_test really fails. */
+    context_set_expect(ctx, EXPECT_PASS);
+    fail_test(ctx, &reason);
 }
 
 /** Ensures that the "expect" state is correct.
@@ -326,8 +818,13 @@ expected_failure(struct context *ctx, atf_dynstr_t *reason)
     exit(EXIT_SUCCESS);
 }
 
+/** Terminates the test case with a failure.
+ *
+ * Unlike fail_requirement, this does not record a failure event, so it is
+ * meant for failures detected by the library itself.
+ */
 static void
-fail_requirement(struct context *ctx, atf_dynstr_t *reason)
+fail_test(struct context *ctx, atf_dynstr_t *reason)
 {
     if (ctx->expect == EXPECT_FAIL) {
         expected_failure(ctx, reason);
@@ -343,21 +840,134 @@ fail_requirement(struct context *ctx, atf_dynstr_t *reason)
 }
 
 static void
-fail_check(struct context *ctx, atf_dynstr_t *reason)
+fail_requirement(struct context *ctx, const char *file, const size_t line,
+                 atf_dynstr_t *reason)
+{
+    event_failure(ctx, file, line, reason, true);
+    report_check_sites(ctx);
+    fail_test(ctx, reason);
+}
+
+/** Prints how many check failures were not reported at every site. */
+static void
+report_check_sites(const struct context *ctx)
+{
+    const struct check_sites *cs = &ctx->check_sites;
+    size_t i;
+
+    if (ctx->check_failure_limit == 0)
+        return;
+
+    for (i = 0; i < cs->nsites; i++) {
+        const struct check_site *site = &cs->sites[i];
+        const size_t total = site->failures + site->expected_failures;
+
+        if (total > ctx->check_failure_limit)
+            fprintf(stderr, "*** %zu more check failures at %s:%zd were not "
+                "reported\n", total - ctx->check_failure_limit, site->file,
+                site->line);
+    }
+}
+
+/** Formats the reason of a test case whose non-fatal checks failed.
+ *
+ * If there is a limit of failures per site, the reason lists the sites of
+ * the failures, in the order in which they first failed, along with how
+ * many times they failed.
+ */
+static void
+format_failed_checks(const struct context *ctx, atf_dynstr_t *reason,
+                     const size_t count, const bool expected)
+{
+    /* Keep the reason reasonably short if checks failed at many sites. */
+    const size_t max_listed = 10;
+    const struct check_sites *cs = &ctx->check_sites;
+    atf_error_t err;
+    size_t i, listed, unlisted;
+
+    err = atf_dynstr_init_fmt(reason, "%zu checks failed%s", count,
+                              expected ? " as expected" : "");
+
+    listed = 0;
+    unlisted = 0;
+    for (i = 0; i < cs->nsites && !atf_is_error(err); i++) {
+        const struct check_site *site = &cs->sites[i];
+        const size_t n = expected ? site->expected_failures : site->failures;
+
+        if (n == 0)
+            continue;
+        else if (listed == max_listed) {
+            unlisted++;
+            continue;
+        }
+
+        err = atf_dynstr_append_fmt(reason, "%s%s:%zd", listed == 0 ? ": " :
+                                    ", ", site->file, site->line);
+        if (!atf_is_error(err) && n > 1)
+            err = atf_dynstr_append_fmt(reason, " (%zu times)", n);
+        listed++;
+    }
+    if (!atf_is_error(err) && unlisted > 0)
+        err = atf_dynstr_append_fmt(reason, ", and %zu more sites", unlisted);
+    if (!atf_is_error(err))
+        err = atf_dynstr_append_fmt(reason, "; see output for more details");
+
+    check_fatal_error(err);
+}
+
+/** Records a failed non-fatal check.
+ *
+ * Failures are reported on stderr and as events, except that only the
+ * first failures at every check site are reported if there is a limit;
+ * the rest are only counted and summarized by report_check_sites.
+ */
+static void
+fail_check(struct context *ctx, const char *file, const size_t line,
+           atf_dynstr_t *reason)
 {
+    bool report = true, last = false;
+
+    if (ctx->check_failure_limit > 0 && file != NULL &&
+        (ctx->expect == EXPECT_FAIL || ctx->expect == EXPECT_PASS)) {
+        struct check_site *site;
+        size_t total;
+
+        site = check_sites_get(&ctx->check_sites, file, line);
+        if (ctx->expect == EXPECT_FAIL)
+            site->expected_failures++;
+        else
+            site->failures++;
+
+        total = site->failures + site->expected_failures;
+        if (total > ctx->check_failure_limit)
+            report = false;
+        else if (total == ctx->check_failure_limit)
+            last = true;
+    }
+
+    if (report)
+        event_failure(ctx, file, line, reason, false);
+
     if (ctx->expect == EXPECT_FAIL) {
-        fprintf(stderr, "*** Expected check failure: %s: %s\n",
-            atf_dynstr_cstring(&ctx->expect_reason),
-            atf_dynstr_cstring(reason));
+        if (report)
+            fprintf(stderr, "*** Expected check failure: %s: %s\n",
+                atf_dynstr_cstring(&ctx->expect_reason),
+                atf_dynstr_cstring(reason));
         ctx->expect_fail_count++;
     } else if (ctx->expect == EXPECT_PASS) {
-        fprintf(stderr, "*** Check failed: %s\n", atf_dynstr_cstring(reason));
+        if (report)
+            fprintf(stderr, "*** Check failed: %s\n",
+                    atf_dynstr_cstring(reason));
         ctx->fail_count++;
     } else {
         error_in_expect(ctx, "Test case raised a failure but was not "
             "expecting one; reason was %s", atf_dynstr_cstring(reason));
     }
 
+    if (last)
+        fprintf(stderr, "*** Not reporting further check failures at "
+            "%s:%zd\n", file, line);
+
     atf_dynstr_fini(reason);
 }
 
@@ -439,7 +1049,8 @@ static void
 errno_test(struct context *ctx, const char *file, const size_t line,
            const int exp_errno, const char *expr_str,
            const bool expr_result,
-           void (*fail_func)(struct context *, atf_dynstr_t *))
+           void (*fail_func)(struct context *, const char *, const size_t,
+                             atf_dynstr_t *))
 {
     const int actual_errno = errno;
 
@@ -449,14 +1060,31 @@ errno_test(struct context *ctx, const char *file, const size_t line,
 
             format_reason_fmt(&reason, file, line, "Expected errno %d, got %d, "
                 "in %s", exp_errno, actual_errno, expr_str);
-            fail_func(ctx, &reason);
+            fail_func(ctx, file, line, &reason);
         }
     } else {
         atf_dynstr_t reason;
 
         format_reason_fmt(&reason, file, line, "Expected true value in %s",
             expr_str);
-        fail_func(ctx, &reason);
+        fail_func(ctx, file, line, &reason);
+    }
+}
+
+static void
+within_test(struct context *ctx, const char *file, const size_t line,
+            const bool cpu, const char *stmt_str, const double elapsed,
+            const double budget,
+            void (*fail_func)(struct context *, const char *, const size_t,
+                              atf_dynstr_t *))
+{
+    if (elapsed > budget) {
+        atf_dynstr_t reason;
+
+        format_reason_fmt(&reason, file, line, "%s took %.3f ms of %s time, "
+            "more than the %.3f ms allowed", stmt_str, elapsed,
+            cpu ? "CPU" : "wall", budget);
+        fail_func(ctx, file, line, &reason);
     }
 }
 
@@ -548,7 +1176,7 @@ check_prog(struct context *ctx, const char *prog)
             atf_fs_path_fini(&p);
             format_reason_fmt(&reason, NULL, 0, "The required program %s could "
                 "not be found in the PATH", prog);
-            fail_requirement(ctx, &reason);
+            fail_requirement(ctx, NULL, 0, &reason);
         }
 
 out_bp:
@@ -566,10 +1194,17 @@ out:
  * --------------------------------------------------------------------- */
 
 struct atf_tc_impl {
+    /* The test case this belongs to; the head needs a mutable one. */
+    atf_tc_t *m_tc;
     const char *m_ident;
 
     atf_map_t m_vars;
-    atf_map_t m_config;
+    bool m_vars_loaded;
+
+    /* Points to m_own_config unless the configuration is shared with the
+     * test program. */
+    const atf_map_t *m_config;
+    atf_map_t m_own_config;
 
     atf_tc_head_t m_head;
     atf_tc_body_t m_body;
@@ -580,60 +1215,97 @@ struct atf_tc_impl {
  * Constructors/destructors.
  */
 
+static
 atf_error_t
-atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
-            atf_tc_body_t body, atf_tc_cleanup_t cleanup,
-            const char *const *config)
+tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
+        atf_tc_body_t body, atf_tc_cleanup_t cleanup)
 {
     atf_error_t err;
 
     tc->pimpl = malloc(sizeof(struct atf_tc_impl));
-    if (tc->pimpl == NULL) {
-        err = atf_no_memory_error();
-        goto err;
-    }
+    if (tc->pimpl == NULL)
+        return atf_no_memory_error();
 
+    tc->pimpl->m_tc = tc;
     tc->pimpl->m_ident = ident;
     tc->pimpl->m_head = head;
     tc->pimpl->m_body = body;
     tc->pimpl->m_cleanup = cleanup;
-
-    err = atf_map_init_charpp(&tc->pimpl->m_config, config);
-    if (atf_is_error(err))
-        goto err;
+    tc->pimpl->m_config = NULL;
+    tc->pimpl->m_vars_loaded = false;
 
     err = atf_map_init(&tc->pimpl->m_vars);
-    if (atf_is_error(err))
-        goto err_vars;
+    if (atf_is_error(err)) {
+        free(tc->pimpl);
+        tc->pimpl = NULL;
+    }
 
-    err = atf_tc_set_md_var(tc, "ident", ident);
-    if (atf_is_error(err))
-        goto err_map;
+    return err;
+}
 
-    if (cleanup != NULL) {
-        err = atf_tc_set_md_var(tc, "has.cleanup", "true");
-        if (atf_is_error(err))
-            goto err_map;
+/** Runs the head of the test case, if not done yet.
+ *
+ * The head is only executed on the first access to the meta-data of the
+ * test case or right before running any of its parts, so that programs
+ * with many test cases do not pay for the heads they do not use.
+ */
+static
+void
+load_vars(const atf_tc_t *tc)
+{
+    atf_tc_t *mtc = tc->pimpl->m_tc;
+    atf_error_t err;
+
+    if (tc->pimpl->m_vars_loaded)
+        return;
+    /* Set early so that the accessors used by the head do not recurse. */
+    tc->pimpl->m_vars_loaded = true;
+
+    err = atf_tc_set_md_var(mtc, "ident", tc->pimpl->m_ident);
+    if (!atf_is_error(err) && tc->pimpl->m_cleanup != NULL)
+        err = atf_tc_set_md_var(mtc, "has.cleanup", "true");
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        report_fatal_error("Cannot initialize the meta-data of test case "
+            "'%s'", tc->pimpl->m_ident);
+        UNREACHABLE;
     }
 
     /* XXX Should the head be able to return error codes? */
-    if (tc->pimpl->m_head != NULL)
-        tc->pimpl->m_head(tc);
+    if (tc->pimpl->m_head != NULL) {
+        atf_trace_begin("head", tc->pimpl->m_ident);
+        tc->pimpl->m_head(mtc);
+        atf_trace_end();
+    }
 
-    if (strcmp(atf_tc_get_md_var(tc, "ident"), ident) != 0) {
+    if (strcmp(atf_tc_get_md_var(tc, "ident"), tc->pimpl->m_ident) != 0) {
         report_fatal_error("Test case head modified the read-only 'ident' "
             "property");
         UNREACHABLE;
     }
+}
 
-    INV(!atf_is_error(err));
-    return err;
-
-err_map:
-    atf_map_fini(&tc->pimpl->m_vars);
-err_vars:
-    atf_map_fini(&tc->pimpl->m_config);
-err:
+atf_error_t
+atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
+            atf_tc_body_t body, atf_tc_cleanup_t cleanup,
+            const char *const *config)
+{
+    atf_error_t err;
+
+    err = tc_init(tc, ident, head, body, cleanup);
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_map_init_charpp(&tc->pimpl->m_own_config, config);
+    if (atf_is_error(err)) {
+        atf_map_fini(&tc->pimpl->m_vars);
+        free(tc->pimpl);
+        tc->pimpl = NULL;
+        goto out;
+    }
+    tc->pimpl->m_config = &tc->pimpl->m_own_config;
+
+out:
     return err;
 }
 
@@ -645,10 +1317,29 @@ atf_tc_init_pack(atf_tc_t *tc, const atf_tc_pack_t *pack,
                        pack->m_cleanup, config);
 }
 
+/** Initializes a test case that uses a configuration owned by the caller.
+ *
+ * The configuration must outlive the test case.  Internal to tp.c.
+ */
+atf_error_t
+atf_tc_init_pack_shared(atf_tc_t *tc, const atf_tc_pack_t *pack,
+                        const atf_map_t *config)
+{
+    atf_error_t err;
+
+    err = tc_init(tc, pack->m_ident, pack->m_head, pack->m_body,
+                  pack->m_cleanup);
+    if (!atf_is_error(err))
+        tc->pimpl->m_config = config;
+
+    return err;
+}
+
 void
 atf_tc_fini(atf_tc_t *tc)
 {
-    atf_map_fini(&tc->pimpl->m_config);
+    if (tc->pimpl->m_config == &tc->pimpl->m_own_config)
+        atf_map_fini(&tc->pimpl->m_own_config);
     atf_map_fini(&tc->pimpl->m_vars);
     free(tc->pimpl);
     tc->pimpl = NULL;
@@ -671,7 +1362,7 @@ atf_tc_get_config_var(const atf_tc_t *tc, const char *name)
     atf_map_citer_t iter;
 
     PRE(atf_tc_has_config_var(tc, name));
-    iter = atf_map_find_c(&tc->pimpl->m_config, name);
+    iter = atf_map_find_c(tc->pimpl->m_config, name);
     val = atf_map_citer_data(iter);
     INV(val != NULL);
 
@@ -763,6 +1454,7 @@ atf_tc_get_md_var(const atf_tc_t *tc, const char *name)
     atf_map_citer_t iter;
 
     PRE(atf_tc_has_md_var(tc, name));
+    load_vars(tc);
     iter = atf_map_find_c(&tc->pimpl->m_vars, name);
     val = atf_map_citer_data(iter);
     INV(val != NULL);
@@ -773,6 +1465,7 @@ atf_tc_get_md_var(const atf_tc_t *tc, const char *name)
 char **
 atf_tc_get_md_vars(const atf_tc_t *tc)
 {
+    load_vars(tc);
     return atf_map_to_charpp(&tc->pimpl->m_vars);
 }
 
@@ -781,8 +1474,8 @@ atf_tc_has_config_var(const atf_tc_t *tc, const char *name)
 {
     atf_map_citer_t end, iter;
 
-    iter = atf_map_find_c(&tc->pimpl->m_config, name);
-    end = atf_map_end_c(&tc->pimpl->m_config);
+    iter = atf_map_find_c(tc->pimpl->m_config, name);
+    end = atf_map_end_c(tc->pimpl->m_config);
     return !atf_equal_map_citer_map_citer(iter, end);
 }
 
@@ -791,6 +1484,7 @@ atf_tc_has_md_var(const atf_tc_t *tc, const char *name)
 {
     atf_map_citer_t end, iter;
 
+    load_vars(tc);
     iter = atf_map_find_c(&tc->pimpl->m_vars, name);
     end = atf_map_end_c(&tc->pimpl->m_vars);
     return !atf_equal_map_citer_map_citer(iter, end);
@@ -807,6 +1501,8 @@ atf_tc_set_md_var(atf_tc_t *tc, const char *name, const char *fmt, ...)
     char *value;
     va_list ap;
 
+    load_vars(tc);
+
     va_start(ap, fmt);
     err = atf_text_format_ap(&value, fmt, ap);
     va_end(ap);
@@ -825,6 +1521,17 @@ atf_tc_set_md_var(atf_tc_t *tc, const char *name, const char *fmt, ...)
  * Free functions, as they should be publicly but they can't.
  * --------------------------------------------------------------------- */
 
+void
+atf_tc_set_md_vars_packed(atf_tc_t *tc, const char *vars)
+{
+    while (*vars != '\0') {
+        const char *value = vars + strlen(vars) + 1;
+
+        check_fatal_error(atf_tc_set_md_var(tc, vars, "%s", value));
+        vars = value + strlen(value) + 1;
+    }
+}
+
 static void _atf_tc_fail(struct context *, const char *, va_list)
     ATF_DEFS_ATTRIBUTE_NORETURN;
 static void _atf_tc_fail_nonfatal(struct context *, const char *, va_list);
@@ -840,6 +1547,11 @@ static void _atf_tc_check_errno(struct context *, const char *, const size_t,
     const int, const char *, const bool);
 static void _atf_tc_require_errno(struct context *, const char *, const size_t,
     const int, const char *, const bool);
+static double _atf_tc_within_budget(struct context *, const double);
+static void _atf_tc_check_within(struct context *, const char *, const size_t,
+    const bool, const char *, const double, const double);
+static void _atf_tc_require_within(struct context *, const char *,
+    const size_t, const bool, const char *, const double, const double);
 static void _atf_tc_expect_pass(struct context *);
 static void _atf_tc_expect_fail(struct context *, const char *, va_list);
 static void _atf_tc_expect_exit(struct context *, const int, const char *,
@@ -859,7 +1571,7 @@ _atf_tc_fail(struct context *ctx, const char *fmt, va_list ap)
     format_reason_ap(&reason, NULL, 0, fmt, ap2);
     va_end(ap2);
 
-    fail_requirement(ctx, &reason);
+    fail_requirement(ctx, NULL, 0, &reason);
     UNREACHABLE;
 }
 
@@ -873,7 +1585,7 @@ _atf_tc_fail_nonfatal(struct context *ctx, const char *fmt, va_list ap)
     format_reason_ap(&reason, NULL, 0, fmt, ap2);
     va_end(ap2);
 
-    fail_check(ctx, &reason);
+    fail_check(ctx, NULL, 0, &reason);
 }
 
 static void
@@ -887,7 +1599,7 @@ _atf_tc_fail_check(struct context *ctx, const char *file, const size_t line,
     format_reason_ap(&reason, file, line, fmt, ap2);
     va_end(ap2);
 
-    fail_check(ctx, &reason);
+    fail_check(ctx, file, line, &reason);
 }
 
 static void
@@ -901,7 +1613,7 @@ _atf_tc_fail_requirement(struct context *ctx, const char *file,
     format_reason_ap(&reason, file, line, fmt, ap2);
     va_end(ap2);
 
-    fail_requirement(ctx, &reason);
+    fail_requirement(ctx, file, line, &reason);
     UNREACHABLE;
 }
 
@@ -948,12 +1660,56 @@ _atf_tc_require_errno(struct context *ctx, const char *file, const size_t line,
         fail_requirement);
 }
 
+/*
+ * Scales the time budget of a bounded-time check by the perf_scale
+ * configuration variable, so that slow or emulated hosts can loosen all
+ * the budgets of a test program at once.
+ */
+static double
+_atf_tc_within_budget(struct context *ctx, const double budget)
+{
+    const char *strval;
+    char *end;
+    double scale;
+
+    if (!atf_tc_has_config_var(ctx->tc, "perf_scale"))
+        return budget;
+
+    strval = atf_tc_get_config_var(ctx->tc, "perf_scale");
+    errno = 0;
+    scale = strtod(strval, &end);
+    if (strval[0] == '\0' || *end != '\0' || errno != 0 || !(scale > 0))
+        atf_tc_fail("Configuration variable perf_scale does not have a "
+                    "valid positive value; found %s", strval);
+
+    return budget * scale;
+}
+
+static void
+_atf_tc_check_within(struct context *ctx, const char *file, const size_t line,
+                     const bool cpu, const char *stmt_str,
+                     const double elapsed, const double budget)
+{
+    within_test(ctx, file, line, cpu, stmt_str, elapsed, budget, fail_check);
+}
+
+static void
+_atf_tc_require_within(struct context *ctx, const char *file,
+                       const size_t line, const bool cpu,
+                       const char *stmt_str, const double elapsed,
+                       const double budget)
+{
+    within_test(ctx, file, line, cpu, stmt_str, elapsed, budget,
+        fail_requirement);
+}
+
 static void
 _atf_tc_expect_pass(struct context *ctx)
 {
     validate_expect(ctx);
 
-    ctx->expect = EXPECT_PASS;
+    context_set_expect(ctx, EXPECT_PASS);
+    event_expect(ctx, -1, NULL);
 }
 
 static void
@@ -963,12 +1719,13 @@ _atf_tc_expect_fail(struct context *ctx, const char *reason, va_list ap)
 
     validate_expect(ctx);
 
-    ctx->expect = EXPECT_FAIL;
+    context_set_expect(ctx, EXPECT_FAIL);
     atf_dynstr_fini(&ctx->expect_reason);
     va_copy(ap2, ap);
     check_fatal_error(atf_dynstr_init_ap(&ctx->expect_reason, reason, ap2));
     va_end(ap2);
     ctx->expect_previous_fail_count = ctx->expect_fail_count;
+    event_expect(ctx, -1, atf_dynstr_cstring(&ctx->expect_reason));
 }
 
 static void
@@ -980,11 +1737,12 @@ _atf_tc_expect_exit(struct context *ctx, const int exitcode, const char *reason,
 
     validate_expect(ctx);
 
-    ctx->expect = EXPECT_EXIT;
+    context_set_expect(ctx, EXPECT_EXIT);
     va_copy(ap2, ap);
     check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
     va_end(ap2);
 
+    event_expect(ctx, exitcode, atf_dynstr_cstring(&formatted));
     create_resfile(ctx, "expected_exit", exitcode, &formatted);
 }
 
@@ -997,11 +1755,12 @@ _atf_tc_expect_signal(struct context *ctx, const int signo, const char *reason,
 
     validate_expect(ctx);
 
-    ctx->expect = EXPECT_SIGNAL;
+    context_set_expect(ctx, EXPECT_SIGNAL);
     va_copy(ap2, ap);
     check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
     va_end(ap2);
 
+    event_expect(ctx, signo, atf_dynstr_cstring(&formatted));
     create_resfile(ctx, "expected_signal", signo, &formatted);
 }
 
@@ -1013,11 +1772,12 @@ _atf_tc_expect_death(struct context *ctx, const char *reason, va_list ap)
 
     validate_expect(ctx);
 
-    ctx->expect = EXPECT_DEATH;
+    context_set_expect(ctx, EXPECT_DEATH);
     va_copy(ap2, ap);
     check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
     va_end(ap2);
 
+    event_expect(ctx, -1, atf_dynstr_cstring(&formatted));
     create_resfile(ctx, "expected_death", -1, &formatted);
 }
 
@@ -1029,11 +1789,12 @@ _atf_tc_expect_timeout(struct context *ctx, const char *reason, va_list ap)
 
     validate_expect(ctx);
 
-    ctx->expect = EXPECT_TIMEOUT;
+    context_set_expect(ctx, EXPECT_TIMEOUT);
     va_copy(ap2, ap);
     check_fatal_error(atf_dynstr_init_ap(&formatted, reason, ap2));
     va_end(ap2);
 
+    event_expect(ctx, -1, atf_dynstr_cstring(&formatted));
     create_resfile(ctx, "expected_timeout", -1, &formatted);
 }
 
@@ -1044,32 +1805,1046 @@ _atf_tc_set_resultsfile(struct context *ctx, const char *file)
     context_set_resfile(ctx, file);
 }
 
+/* ---------------------------------------------------------------------
+ * Check statistics.
+ * --------------------------------------------------------------------- */
+
+bool atf_tc_check_stats = false;
+
+/* The sites of the checks evaluated by the body, in the order in which
+ * they were first evaluated. */
+static struct atf_tc_check_site *Check_sites = NULL;
+static struct atf_tc_check_site **Check_sites_tail = &Check_sites;
+static struct timespec Check_stats_start;
+static char *Check_stats_path = NULL;
+
+/** Checks whether the statistics of the checks must be recorded.
+ *
+ * They are recorded if the test program was built with ATF_CHECK_STATS
+ * defined or if the ATF_CHECK_STATS environment variable is set to a
+ * non-empty value.  Like the resources used by the body, they live next to
+ * the results file, so the latter must be a regular file.
+ */
+static
+bool
+check_stats_wanted(const struct context *ctx)
+{
+    if (atf_env_has("ATF_CHECK_STATS") &&
+        strlen(atf_env_get("ATF_CHECK_STATS")) > 0)
+        atf_tc_check_stats = true;
+    return atf_tc_check_stats && context_resfile_is_regular(ctx);
+}
+
+/** Starts measuring the checks of the body.
+ *
+ * The results file is closed by the time the statistics are written, so
+ * this remembers where they go.  Returns false if they cannot be recorded.
+ */
+static
+bool
+check_stats_start(const struct context *ctx)
+{
+    atf_dynstr_t path;
+    atf_error_t err;
+
+    err = atf_dynstr_init_fmt(&path, "%s.checks", ctx->resfile);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        fprintf(stderr, "WARNING: Cannot record the statistics of the "
+                "checks: Not enough memory\n");
+        return false;
+    }
+    Check_stats_path = atf_dynstr_fini_disown(&path);
+
+    clock_gettime(CLOCK_MONOTONIC, &Check_stats_start);
+    return true;
+}
+
+/** Writes the statistics of the checks next to the results file.
+ *
+ * The record goes to a file named after the results file with an added
+ * '.checks' suffix.  It has one 'key: value' line per total, followed by a
+ * 'site' line per call site with how many times its check was evaluated
+ * and how many times it failed.
+ *
+ * As with the resources used by the body, problems are only reported as
+ * warnings.
+ */
+static
+void
+check_stats_write(void)
+{
+    const struct atf_tc_check_site *site;
+    struct timespec end;
+    struct timeval elapsed;
+    unsigned long evaluated, failed;
+    double seconds;
+    FILE *f;
+
+    PRE(Check_stats_path != NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    timespec_diff(&Check_stats_start, &end, &elapsed);
+    seconds = (double)elapsed.tv_sec + (double)elapsed.tv_usec / 1000000.0;
+
+    evaluated = 0;
+    failed = 0;
+    for (site = Check_sites; site != NULL; site = site->m_next) {
+        evaluated += site->m_evaluated;
+        failed += site->m_failed;
+    }
+
+    f = fopen(Check_stats_path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "WARNING: Cannot create %s: %s\n", Check_stats_path,
+                strerror(errno));
+    } else {
+        fprintf(f, "checks-evaluated: %lu\n", evaluated);
+        fprintf(f, "checks-passed: %lu\n", evaluated - failed);
+        fprintf(f, "checks-failed: %lu\n", failed);
+        fprintf(f, "checks-per-second: %.0f\n",
+                seconds > 0 ? (double)evaluated / seconds : 0.0);
+        for (site = Check_sites; site != NULL; site = site->m_next)
+            fprintf(f, "site: %s:%zu: %lu evaluated, %lu failed\n",
+                    site->m_file, site->m_line, site->m_evaluated,
+                    site->m_failed);
+        if (ferror(f) || fclose(f) == EOF)
+            fprintf(stderr, "WARNING: Cannot write %s\n", Check_stats_path);
+    }
+
+    free(Check_stats_path);
+    Check_stats_path = NULL;
+}
+
+/* ---------------------------------------------------------------------
+ * Benchmarks.
+ * --------------------------------------------------------------------- */
+
+/* Default values of the benchmark properties, as documented in
+ * atf-test-case(7). */
+#define DEFAULT_BENCH_SAMPLES 30
+#define DEFAULT_BENCH_WARMUP 2
+#define DEFAULT_BENCH_BATCH_TIME 20 /* In milliseconds. */
+
+/** Checks whether the test case was defined with ATF_TC_BENCHMARK. */
+static
+bool
+bench_wanted(const atf_tc_t *tc)
+{
+    atf_error_t err;
+    const char *value;
+    bool benchmark;
+
+    if (!atf_tc_has_md_var(tc, "X-benchmark"))
+        return false;
+
+    value = atf_tc_get_md_var(tc, "X-benchmark");
+    err = atf_text_to_bool(value, &benchmark);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        report_fatal_error("Invalid value for the X-benchmark property: %s",
+                           value);
+        UNREACHABLE;
+    }
+    return benchmark;
+}
+
+static
+long
+bench_property(const atf_tc_t *tc, const char *name, const long defval,
+               const long min)
+{
+    atf_error_t err;
+    const char *value;
+    long l;
+
+    if (!atf_tc_has_md_var(tc, name))
+        return defval;
+
+    value = atf_tc_get_md_var(tc, name);
+    err = atf_text_to_long(value, &l);
+    if (atf_is_error(err) || l < min) {
+        if (atf_is_error(err))
+            atf_error_free(err);
+        report_fatal_error("Invalid value for the %s property: %s", name,
+                           value);
+        UNREACHABLE;
+    }
+    return l;
+}
+
+/* Reports a problem of a benchmark loop that does not stop the loop. */
+static
+void
+bench_fail(void *data, atf_dynstr_t *reason)
+{
+    struct context *ctx = data;
+
+    fail_check(ctx, NULL, 0, reason);
+}
+
+/** Gets ready for the benchmark loops of the body.
+ *
+ * Their records go to a file named after the results file with an added
+ * '.bench' suffix, or to stderr if the results file is not a regular file.
+ */
+static
+void
+bench_init(struct context *ctx)
+{
+    atf_dynstr_t path;
+
+    if (!context_resfile_is_regular(ctx)) {
+        check_fatal_error(atf_bench_body_init(NULL, false, bench_fail, ctx));
+        return;
+    }
+
+    check_fatal_error(atf_dynstr_init_fmt(&path, "%s.bench", ctx->resfile));
+    check_fatal_error(atf_bench_body_init(atf_dynstr_cstring(&path),
+                                          bench_wanted(ctx->tc), bench_fail,
+                                          ctx));
+    atf_dynstr_fini(&path);
+}
+
+/** Ends the running batch of a benchmark loop and starts the next one.
+ *
+ * The first batch of a loop configures its measurement from the
+ * properties of the test case.  Returns false once the loop took all its
+ * samples, after writing their statistics.
+ */
+static
+bool
+bench_batch(struct context *ctx, size_t *iterations)
+{
+    bool more;
+
+    if (!atf_bench_body_running()) {
+        atf_bench_params_t params;
+
+        params.m_samples = (size_t)bench_property(ctx->tc,
+            "X-benchmark.samples", DEFAULT_BENCH_SAMPLES, 1);
+        params.m_warmup = (size_t)bench_property(ctx->tc,
+            "X-benchmark.warmup", DEFAULT_BENCH_WARMUP, 0);
+        params.m_batch_nsec = (int64_t)bench_property(ctx->tc,
+            "X-benchmark.batch_time", DEFAULT_BENCH_BATCH_TIME, 1) * 1000000;
+        params.m_max_regression = bench_property(ctx->tc,
+            "X-benchmark.max_regression", -1, 0);
+        check_fatal_error(atf_bench_body_start(&params));
+    }
+
+    check_fatal_error(atf_bench_body_batch(atf_tc_get_ident(ctx->tc),
+                                           iterations, &more));
+    return more;
+}
+
+/** Fails a benchmark whose body returned without measuring anything. */
+static
+void
+bench_validate(struct context *ctx)
+{
+    atf_dynstr_t reason;
+
+    if (!bench_wanted(ctx->tc) || atf_bench_body_records() > 0 ||
+        ctx->fail_count > 0)
+        return;
+
+    format_reason_fmt(&reason, NULL, 0, "Benchmark body did not complete "
+                      "any ATF_BENCHMARK_LOOP");
+    fail_test(ctx, &reason);
+}
+
+/* ---------------------------------------------------------------------
+ * The body supervisor.
+ * --------------------------------------------------------------------- */
+
+/* Default value of the timeout property, as documented in
+ * atf-test-case(7). */
+#define DEFAULT_TIMEOUT 300
+
+static volatile sig_atomic_t Watchdog_fired;
+static pid_t Watchdog_target;
+
+static
+void
+watchdog_alarm(const int signo ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+    Watchdog_fired = 1;
+}
+
+static
+void
+watchdog_forward(const int signo)
+{
+    kill(Watchdog_target, signo);
+}
+
+/** Gets the timeout to enforce on the body of a test case.
+ *
+ * Returns 0 if the timeout must not be enforced: when its timeout property
+ * is 0 or when running under kyua(1), which applies timeouts on its own.
+ */
+static
+long
+watchdog_timeout(const atf_tc_t *tc)
+{
+    atf_error_t err;
+    const char *value;
+    long timeout;
+
+    if (atf_env_has("__RUNNING_INSIDE_ATF_RUN") && strcmp(atf_env_get(
+        "__RUNNING_INSIDE_ATF_RUN"), "internal-yes-value") == 0)
+        return 0;
+
+    if (!atf_tc_has_md_var(tc, "timeout"))
+        return DEFAULT_TIMEOUT;
+
+    value = atf_tc_get_md_var(tc, "timeout");
+    err = atf_text_to_long(value, &timeout);
+    if (atf_is_error(err) || timeout < 0) {
+        if (atf_is_error(err))
+            atf_error_free(err);
+        report_fatal_error("Invalid value for the timeout property: %s",
+                           value);
+        UNREACHABLE;
+    }
+    return timeout;
+}
+
+/** Checks whether the resources used by the body must be recorded.
+ *
+ * They are only recorded if the ATF_RUSAGE environment variable is set to
+ * a non-empty value, as measuring them needs a supervisor process.  The
+ * record lives next to the results file, so the latter must be a regular
+ * file.
+ */
+static
+bool
+rusage_wanted(const struct context *ctx)
+{
+    return atf_env_has("ATF_RUSAGE") && strlen(atf_env_get("ATF_RUSAGE")) > 0
+        && context_resfile_is_regular(ctx);
+}
+
+static
+void
+timespec_diff(const struct timespec *start, const struct timespec *end,
+              struct timeval *diff)
+{
+    long nsec = end->tv_nsec - start->tv_nsec;
+    time_t sec = end->tv_sec - start->tv_sec;
+
+    if (nsec < 0) {
+        nsec += 1000000000L;
+        sec--;
+    }
+    diff->tv_sec = sec;
+    diff->tv_usec = (suseconds_t)(nsec / 1000);
+}
+
+/** Writes the resources used by the body next to the results file.
+ *
+ * The record goes to a file named after the results file with an added
+ * '.rusage' suffix and has one 'key: value' line per measure.  Times are
+ * given in seconds and the maximum resident set size in kilobytes.  The
+ * number of processes the body left behind is only known, and recorded,
+ * if the supervisor became their reaper.
+ *
+ * Failing to write the record does not affect the result of the test case,
+ * so problems are only reported as warnings.
+ */
+static
+void
+rusage_write(const struct context *ctx, const struct rusage *ru,
+             const struct timeval *wall, const bool reaper,
+             const size_t leaked)
+{
+    atf_dynstr_t path;
+    atf_error_t err;
+    FILE *f;
+    long maxrss;
+
+    err = atf_dynstr_init_fmt(&path, "%s.rusage", ctx->resfile);
+    if (atf_is_error(err)) {
+        atf_error_free(err);
+        fprintf(stderr, "WARNING: Cannot record the resources used by the "
+                "test case: Not enough memory\n");
+        return;
+    }
+
+    maxrss = ru->ru_maxrss;
+#if defined(__APPLE__)
+    maxrss /= 1024;  /* Reported in bytes instead of kilobytes. */
+#endif
+
+    f = fopen(atf_dynstr_cstring(&path), "w");
+    if (f == NULL) {
+        fprintf(stderr, "WARNING: Cannot create %s: %s\n",
+                atf_dynstr_cstring(&path), strerror(errno));
+    } else {
+        fprintf(f, "wall-time: %ld.%06ld\n", (long)wall->tv_sec,
+                (long)wall->tv_usec);
+        fprintf(f, "user-time: %ld.%06ld\n", (long)ru->ru_utime.tv_sec,
+                (long)ru->ru_utime.tv_usec);
+        fprintf(f, "system-time: %ld.%06ld\n", (long)ru->ru_stime.tv_sec,
+                (long)ru->ru_stime.tv_usec);
+        fprintf(f, "max-rss: %ld\n", maxrss);
+        fprintf(f, "voluntary-context-switches: %ld\n", (long)ru->ru_nvcsw);
+        fprintf(f, "involuntary-context-switches: %ld\n",
+                (long)ru->ru_nivcsw);
+        if (reaper)
+            fprintf(f, "leaked-processes: %zu\n", leaked);
+        if (ferror(f) || fclose(f) == EOF)
+            fprintf(stderr, "WARNING: Cannot write %s\n",
+                    atf_dynstr_cstring(&path));
+    }
+
+    atf_dynstr_fini(&path);
+}
+
+/* The output of the body captured by the supervisor.  Only the last
+ * 'size' bytes are kept: 'head' tells where the next byte goes and 'total'
+ * how many bytes the body wrote. */
+struct capture {
+    int fds[2];
+    int outfd;
+    const char *name;
+    char *buf;
+    size_t size;
+    size_t head;
+    size_t total;
+};
+
+/** Gets how much of the output of the body to capture per stream.
+ *
+ * The output of the body is only captured if the ATF_OUTPUT_CAPTURE
+ * environment variable holds a positive number of bytes and there is a
+ * results file to tell whether the output is worth keeping.  Returns 0
+ * otherwise.
+ */
+static
+size_t
+capture_wanted(const struct context *ctx)
+{
+    atf_error_t err;
+    const char *value;
+    long size;
+
+    if (!atf_env_has("ATF_OUTPUT_CAPTURE"))
+        return 0;
+
+    value = atf_env_get("ATF_OUTPUT_CAPTURE");
+    err = atf_text_to_long(value, &size);
+    if (atf_is_error(err) || size < 0) {
+        if (atf_is_error(err))
+            atf_error_free(err);
+        report_fatal_error("Invalid value for ATF_OUTPUT_CAPTURE: %s", value);
+        UNREACHABLE;
+    }
+    if (size == 0 || !context_resfile_is_regular(ctx))
+        return 0;
+    return (size_t)size;
+}
+
+static
+void
+capture_init(struct capture *c, const int outfd, const char *name,
+             const size_t size)
+{
+    c->buf = malloc(size);
+    if (c->buf == NULL)
+        check_fatal_error(atf_no_memory_error());
+    if (pipe(c->fds) == -1)
+        report_fatal_error("Cannot capture the %s of the test case: %s",
+                           name, strerror(errno));
+    c->outfd = outfd;
+    c->name = name;
+    c->size = size;
+    c->head = 0;
+    c->total = 0;
+}
+
+/** Sends the output of the body, which calls this, to the capture. */
+static
+void
+capture_child(struct capture *c)
+{
+    close(c->fds[0]);
+    if (dup2(c->fds[1], c->outfd) == -1)
+        report_fatal_error("Cannot capture the %s of the test case: %s",
+                           c->name, strerror(errno));
+    close(c->fds[1]);
+    free(c->buf);
+}
+
+static
+void
+capture_parent(struct capture *c)
+{
+    close(c->fds[1]);
+    c->fds[1] = -1;
+    fcntl(c->fds[0], F_SETFL, fcntl(c->fds[0], F_GETFL) | O_NONBLOCK);
+}
+
+/** Reads all the output that is available without blocking.
+ *
+ * Closes the capture once all the writers are gone.
+ */
+static
+void
+capture_read(struct capture *c)
+{
+    ssize_t n;
+
+    while (c->fds[0] != -1) {
+        n = read(c->fds[0], c->buf + c->head, c->size - c->head);
+        if (n > 0) {
+            c->head = (c->head + (size_t)n) % c->size;
+            c->total += (size_t)n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && errno == EAGAIN) {
+            break;
+        } else {
+            close(c->fds[0]);
+            c->fds[0] = -1;
+        }
+    }
+}
+
+static
+void
+write_all(const int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, buf, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        else if (n <= 0)
+            break;
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+/** Releases the capture, passing the output kept in it to its stream
+ * first if requested. */
+static
+void
+capture_fini(struct capture *c, const bool flush)
+{
+    if (flush && c->total > c->size) {
+        char note[128];
+
+        snprintf(note, sizeof(note), "*** Discarded the first %zu bytes "
+                 "of the %s of the test case\n", c->total - c->size,
+                 c->name);
+        write_all(c->outfd, note, strlen(note));
+        write_all(c->outfd, c->buf + c->head, c->size - c->head);
+        write_all(c->outfd, c->buf, c->head);
+    } else if (flush)
+        write_all(c->outfd, c->buf, c->total);
+
+    if (c->fds[0] != -1)
+        close(c->fds[0]);
+    free(c->buf);
+}
+
+/** Checks whether the results file tells that the test case failed.
+ *
+ * A missing or unreadable result counts as a failure.
+ */
+static
+bool
+result_is_failure(const struct context *ctx)
+{
+    static const char *good[] = { "passed", "skipped", "expected_" };
+    char buf[16];
+    ssize_t n;
+    size_t i;
+    int fd;
+
+    fd = open(ctx->resfile, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return true;
+    n = read(fd, buf, sizeof(buf));
+    close(fd);
+
+    for (i = 0; n > 0 && i < sizeof(good) / sizeof(good[0]); i++)
+        if ((size_t)n >= strlen(good[i]) &&
+            strncmp(buf, good[i], strlen(good[i])) == 0)
+            return false;
+    return true;
+}
+
+/** Waits for the body to terminate.
+ *
+ * Meanwhile, collects the output of the body into the given captures and
+ * kills the body if the watchdog fires.  Returns whether it did.
+ */
+static
+bool
+watchdog_wait(const pid_t pid, int *status, struct rusage *ru,
+              struct capture *caps, const size_t ncaps)
+{
+    struct pollfd fds[2];
+    bool reaped, timed_out;
+    nfds_t nfds;
+    size_t i;
+    pid_t ret;
+
+    PRE(ncaps <= sizeof(fds) / sizeof(fds[0]));
+
+    reaped = false;
+    timed_out = false;
+    for (;;) {
+        nfds = 0;
+        for (i = 0; i < ncaps; i++) {
+            if (caps[i].fds[0] == -1)
+                continue;
+            fds[nfds].fd = caps[i].fds[0];
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+
+        if (nfds > 0) {
+            /* Descendants of the body may keep the pipes open after it
+             * terminates, so check for its termination now and then. */
+            if (poll(fds, nfds, 1000) == -1 && errno != EINTR)
+                report_fatal_error("Cannot capture the output of the test "
+                                   "case: %s", strerror(errno));
+            for (i = 0; i < ncaps; i++)
+                capture_read(&caps[i]);
+            ret = wait4(pid, status, WNOHANG, ru);
+        } else
+            ret = wait4(pid, status, 0, ru);
+
+        if (ret == pid) {
+            reaped = true;
+            break;
+        } else if (ret == -1 && errno != EINTR)
+            report_fatal_error("Cannot wait for the test case body: %s",
+                               strerror(errno));
+
+        if (Watchdog_fired && !timed_out) {
+            kill(-pid, SIGKILL);
+            timed_out = true;
+        }
+    }
+    INV(reaped);
+
+    /* Pick up whatever the body wrote right before terminating. */
+    for (i = 0; i < ncaps; i++)
+        capture_read(&caps[i]);
+
+    return timed_out;
+}
+
+/** Kills and reaps the descendants that the body left behind.
+ *
+ * Daemons started by the body, or children it forked before failing a
+ * requirement, would otherwise outlive the test case and hold on to the
+ * resources that later ones need.  They get a chance to terminate cleanly
+ * before being killed.  Returns how many were still running.
+ */
+static
+size_t
+watchdog_reap(void)
+{
+    atf_error_t err;
+    size_t nkilled;
+
+    err = atf_process_kill_descendants(ATF_PROCESS_KILL_GRACE, &nkilled);
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        fprintf(stderr, "WARNING: Cannot kill the processes left behind by "
+                "the test case: %s\n", buf);
+        return 0;
+    }
+
+    if (nkilled > 0)
+        fprintf(stderr, "WARNING: The test case left %zu process(es) "
+                "behind; killed them\n", nkilled);
+    return nkilled;
+}
+
+/** Terminates the supervisor in the same way as the supervised body. */
+static
+void
+watchdog_mirror(const int status)
+{
+    if (WIFSIGNALED(status)) {
+        const int signo = WTERMSIG(status);
+        const struct rlimit rl = { 0, 0 };
+        sigset_t mask;
+
+        /* The body has already dumped core if it had to. */
+        setrlimit(RLIMIT_CORE, &rl);
+        signal(signo, SIG_DFL);
+        sigemptyset(&mask);
+        sigaddset(&mask, signo);
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        raise(signo);
+        exit(EXIT_FAILURE);
+    } else if (WIFEXITED(status))
+        exit(WEXITSTATUS(status));
+    else
+        exit(EXIT_FAILURE);
+}
+
+/** Runs the body of the test case under a supervisor.
+ *
+ * Forks the process that runs the body and returns in it.  The original
+ * process supervises it and records the resources it used, if there is a
+ * results file to put them next to.
+ *
+ * If capture_size is not 0, the supervisor keeps the last capture_size
+ * bytes of the standard output and error of the body in memory and only
+ * passes them on to its own if the test case does not succeed.
+ *
+ * If a timeout is given, the body runs in its own process group: if it
+ * does not finish in time, the supervisor kills the whole group and
+ * records the result of the test case, which is only successful if the
+ * body expected to time out.  Otherwise, the supervisor terminates in the
+ * same way as the body did.
+ *
+ * Where supported, the supervisor also becomes the reaper of the orphaned
+ * descendants of the body and kills any of them that are still running
+ * once the body terminates, noting the leak in the results.  Test cases
+ * with a cleanup routine are the exception: the cleanup routine may have
+ * to stop the daemons started by the body, so their descendants are left
+ * to whoever runs it.
+ */
+static
+void
+watchdog_run(struct context *ctx, const long timeout,
+             const size_t capture_size)
+{
+    struct sigaction sa;
+    struct rusage ru;
+    struct timespec start, end;
+    struct timeval wall;
+    int *expect;
+    pid_t pid;
+    int status;
+    bool timed_out;
+    struct capture caps[2];
+    size_t ncaps;
+    const int forwarded[] = { SIGHUP, SIGINT, SIGTERM };
+    size_t i, leaked;
+    bool reaper;
+
+    expect = mmap(NULL, sizeof(*expect), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANON, -1, 0);
+    if (expect == MAP_FAILED)
+        report_fatal_error("Cannot set up the test case supervisor: %s",
+                           strerror(errno));
+    *expect = (int)ctx->expect;
+
+    fflush(stdout);
+    fflush(stderr);
+    ncaps = 0;
+    if (capture_size > 0) {
+        capture_init(&caps[ncaps++], STDOUT_FILENO, "standard output",
+                     capture_size);
+        capture_init(&caps[ncaps++], STDERR_FILENO, "standard error",
+                     capture_size);
+    }
+    reaper = ctx->tc->pimpl->m_cleanup == NULL &&
+        atf_process_acquire_reaper();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid = fork();
+    if (pid == -1)
+        report_fatal_error("Cannot fork the test case body: %s",
+                           strerror(errno));
+    else if (pid == 0) {
+        if (timeout > 0)
+            setpgid(0, 0);
+        for (i = 0; i < ncaps; i++)
+            capture_child(&caps[i]);
+        ctx->expect_mirror = expect;
+        return;
+    }
+    for (i = 0; i < ncaps; i++)
+        capture_parent(&caps[i]);
+    if (timeout > 0) {
+        /* Also done here so that the group exists before it is killed. */
+        setpgid(pid, pid);
+        Watchdog_target = -pid;
+    } else
+        Watchdog_target = pid;
+
+    Watchdog_fired = 0;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sa.sa_handler = watchdog_forward;
+    for (i = 0; i < sizeof(forwarded) / sizeof(forwarded[0]); i++)
+        sigaction(forwarded[i], &sa, NULL);
+    if (timeout > 0) {
+        sa.sa_handler = watchdog_alarm;
+        sigaction(SIGALRM, &sa, NULL);
+        alarm(timeout > (long)UINT_MAX ? UINT_MAX : (unsigned int)timeout);
+    }
+
+    timed_out = watchdog_wait(pid, &status, &ru, caps, ncaps);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (timeout > 0)
+        alarm(0);
+    leaked = reaper ? watchdog_reap() : 0;
+
+    if (rusage_wanted(ctx)) {
+        timespec_diff(&start, &end, &wall);
+        rusage_write(ctx, &ru, &wall, reaper, leaked);
+    }
+
+    /* If the body timed out as expected, atf_tc_expect_timeout already
+     * recorded the result. */
+    if (timed_out && *expect != EXPECT_TIMEOUT) {
+        atf_dynstr_t reason;
+
+        format_reason_fmt(&reason, NULL, 0, "Test case body timed out "
+            "after %ld seconds", timeout);
+        create_resfile(ctx, "broken", -1, &reason);
+    }
+    if (leaked > 0)
+        atf_tc_record_leak(ctx->resfile, leaked);
+
+    if (ncaps > 0) {
+        const bool flush = result_is_failure(ctx);
+
+        for (i = 0; i < ncaps; i++)
+            capture_fini(&caps[i], flush);
+    }
+
+    if (timed_out)
+        exit(*expect == EXPECT_TIMEOUT ? EXIT_SUCCESS : EXIT_FAILURE);
+    watchdog_mirror(status);
+    UNREACHABLE;
+}
+
 /* ---------------------------------------------------------------------
  * Free functions.
  * --------------------------------------------------------------------- */
 
 static struct context Current;
 
+/** Checks whether a results file names a Unix socket.
+ *
+ * Results files of the form 'unix:<path>' are not created in the file
+ * system: the test case connects to the collector listening on <path> and
+ * sends its results there instead.  Also used by runner.c.
+ */
+bool
+atf_tc_resfile_is_socket(const char *resfile)
+{
+    return strncmp(resfile, "unix:", strlen("unix:")) == 0;
+}
+
+/** Checks whether a test case has a cleanup routine.
+ *
+ * Unlike the 'has.cleanup' meta-data variable, this does not run the head
+ * of the test case.  Also used by runner.c and the mains of the test
+ * programs.
+ */
+bool
+atf_tc_has_cleanup(const atf_tc_t *tc)
+{
+    return tc->pimpl->m_cleanup != NULL;
+}
+
+/* Appends a warning about leaked processes to the reason of the result in
+ * the open results file fd, if the result has a reason. */
+static
+atf_error_t
+leak_amend_result(const int fd, const char *resfile, const size_t nprocs)
+{
+    atf_error_t err;
+    atf_dynstr_t line, amended;
+    char buf[1024];
+    const char *str;
+    size_t len;
+    ssize_t n;
+
+    err = atf_dynstr_init(&line);
+    if (atf_is_error(err))
+        return err;
+
+    while (!atf_is_error(err) && (n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n == -1) {
+            if (errno != EINTR)
+                err = atf_libc_error(errno, "Cannot read results file '%s'",
+                                     resfile);
+        } else
+            err = atf_dynstr_append_fmt(&line, "%.*s", (int)n, buf);
+    }
+    if (atf_is_error(err))
+        goto out;
+
+    /* Only complete results with a reason can take one more remark. */
+    str = atf_dynstr_cstring(&line);
+    len = atf_dynstr_length(&line);
+    if (len == 0 || str[len - 1] != '\n' || strstr(str, ": ") == NULL)
+        goto out;
+
+    err = atf_dynstr_init_fmt(&amended, "%.*s (warning: left %zu "
+                              "process(es) behind)\n", (int)(len - 1), str,
+                              nprocs);
+    if (atf_is_error(err))
+        goto out;
+
+    str = atf_dynstr_cstring(&amended);
+    len = atf_dynstr_length(&amended);
+    n = ftruncate(fd, 0) == -1 ? -1 : pwrite(fd, str, len, 0);
+    if (n != (ssize_t)len)
+        err = atf_libc_error(n == -1 ? errno : EIO,
+                             "Cannot write results file '%s'", resfile);
+    atf_dynstr_fini(&amended);
+
+out:
+    atf_dynstr_fini(&line);
+    return err;
+}
+
+/* Appends a 'leak' event to the events of the test case, if recorded. */
+static
+atf_error_t
+leak_event(const char *resfile, const size_t nprocs)
+{
+    atf_error_t err;
+    atf_dynstr_t path;
+    atf_event_t ev;
+    int fd;
+
+    if (!atf_env_has("ATF_RESULT_EVENTS") ||
+        atf_env_get("ATF_RESULT_EVENTS")[0] == '\0')
+        return atf_no_error();
+
+    err = atf_dynstr_init_fmt(&path, "%s.jsonl", resfile);
+    if (atf_is_error(err))
+        return err;
+
+    fd = open(atf_dynstr_cstring(&path),
+              O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+              S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+        err = atf_libc_error(errno, "Cannot open events file '%s'",
+                             atf_dynstr_cstring(&path));
+        goto out;
+    }
+
+    err = atf_event_init(&ev, "leak");
+    if (!atf_is_error(err)) {
+        err = atf_event_add_int(&ev, "processes", (long)nprocs);
+        if (!atf_is_error(err))
+            err = atf_event_end(&ev);
+        if (!atf_is_error(err))
+            err = atf_event_write(&ev, fd);
+        atf_event_fini(&ev);
+    }
+    close(fd);
+
+out:
+    atf_dynstr_fini(&path);
+    return err;
+}
+
+/** Records in the results of a test case that it left processes behind.
+ *
+ * resfile must already hold the result of the test case.  The warning is
+ * appended to the reason of the result; 'passed' results cannot have one,
+ * so they are left alone.  If events are being recorded, a 'leak' event
+ * with the number of processes is appended to them as well.  Results sent
+ * to a socket or a standard stream are gone by now and are not amended.
+ *
+ * The result of the test case does not change, so problems are only
+ * reported as warnings.  Also used by runner.c.
+ */
+void
+atf_tc_record_leak(const char *resfile, const size_t nprocs)
+{
+    atf_error_t err;
+    struct stat sb;
+    int fd;
+
+    PRE(nprocs > 0);
+
+    if (atf_tc_resfile_is_socket(resfile))
+        return;
+
+    fd = open(resfile, O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        fprintf(stderr, "WARNING: Cannot open results file '%s': %s\n",
+                resfile, strerror(errno));
+        return;
+    }
+    if (fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode)) {
+        close(fd);
+        return;
+    }
+
+    err = leak_amend_result(fd, resfile, nprocs);
+    close(fd);
+    if (!atf_is_error(err))
+        err = leak_event(resfile, nprocs);
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        fprintf(stderr, "WARNING: Cannot record the processes left behind "
+                "by the test case: %s\n", buf);
+    }
+}
+
 atf_error_t
 atf_tc_run(const atf_tc_t *tc, const char *resfile)
 {
-    context_init(&Current, tc, resfile);
+    long timeout;
+    size_t capture_size;
+
+    load_vars(tc);
 
+    context_init(&Current, tc, resfile);
+    event_start(&Current);
+    bench_init(&Current);
+
+    timeout = watchdog_timeout(tc);
+    capture_size = capture_wanted(&Current);
+    if (timeout > 0 || rusage_wanted(&Current) || capture_size > 0)
+        /* Only returns in the body. */
+        watchdog_run(&Current, timeout, capture_size);
+
+    /* The body terminates the process in many ways, so the statistics of
+     * its checks are recorded on exit. */
+    if (check_stats_wanted(&Current) && check_stats_start(&Current) &&
+        atexit(check_stats_write) != 0)
+        fprintf(stderr, "WARNING: Cannot record the statistics of the "
+                "checks\n");
+
+    /* The body usually ends by terminating the process, which ends the
+     * phase as well. */
+    atf_trace_begin("body", tc->pimpl->m_ident);
     tc->pimpl->m_body(tc);
 
+    report_check_sites(&Current);
+
     validate_expect(&Current);
+    bench_validate(&Current);
 
     if (Current.fail_count > 0) {
         atf_dynstr_t reason;
 
-        format_reason_fmt(&reason, NULL, 0, "%d checks failed; see output for "
-            "more details", Current.fail_count);
-        fail_requirement(&Current, &reason);
+        format_failed_checks(&Current, &reason, Current.fail_count, false);
+        fail_test(&Current, &reason);
     } else if (Current.expect_fail_count > 0) {
         atf_dynstr_t reason;
 
-        format_reason_fmt(&reason, NULL, 0, "%d checks failed as expected; "
-            "see output for more details", Current.expect_fail_count);
+        format_failed_checks(&Current, &reason, Current.expect_fail_count,
+                             true);
         expected_failure(&Current, &reason);
     } else {
         pass(&Current);
@@ -1078,11 +2853,36 @@ atf_tc_run(const atf_tc_t *tc, const char *resfile)
     return atf_no_error();
 }
 
+/** Records the evaluation of a check by the macros in macros.h.
+ *
+ * Registers the call site the first time its check is evaluated, so that
+ * its statistics can be reported when the body finishes.
+ */
+void
+atf_tc_count_check(struct atf_tc_check_site *site, const bool passed)
+{
+    if (!site->m_registered) {
+        site->m_registered = true;
+        site->m_next = NULL;
+        *Check_sites_tail = site;
+        Check_sites_tail = &site->m_next;
+    }
+
+    site->m_evaluated++;
+    if (!passed)
+        site->m_failed++;
+}
+
 atf_error_t
 atf_tc_cleanup(const atf_tc_t *tc)
 {
-    if (tc->pimpl->m_cleanup != NULL)
+    load_vars(tc);
+
+    if (tc->pimpl->m_cleanup != NULL) {
+        atf_trace_begin("cleanup", tc->pimpl->m_ident);
         tc->pimpl->m_cleanup(tc);
+        atf_trace_end();
+    }
     return atf_no_error(); /* XXX */
 }
 
@@ -1198,6 +2998,46 @@ atf_tc_require_errno(const char *file, const size_t line, const int exp_errno,
                           expr_result);
 }
 
+double
+atf_tc_within_budget(const double budget)
+{
+    PRE(Current.tc != NULL);
+
+    return _atf_tc_within_budget(&Current, budget);
+}
+
+/* Returns the wall or CPU time of the process in milliseconds. */
+double
+atf_tc_within_clock(const bool cpu)
+{
+    struct timespec ts;
+
+    clock_gettime(cpu ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+void
+atf_tc_check_within(const char *file, const size_t line, const bool cpu,
+                    const char *stmt_str, const double elapsed,
+                    const double budget)
+{
+    PRE(Current.tc != NULL);
+
+    _atf_tc_check_within(&Current, file, line, cpu, stmt_str, elapsed,
+                         budget);
+}
+
+void
+atf_tc_require_within(const char *file, const size_t line, const bool cpu,
+                      const char *stmt_str, const double elapsed,
+                      const double budget)
+{
+    PRE(Current.tc != NULL);
+
+    _atf_tc_require_within(&Current, file, line, cpu, stmt_str, elapsed,
+                           budget);
+}
+
 void
 atf_tc_expect_pass(void)
 {
@@ -1266,6 +3106,52 @@ atf_tc_expect_timeout(const char *reason, ...)
     va_end(ap);
 }
 
+/** Drives the batches of ATF_BENCHMARK_LOOP; internal to macros.h.
+ *
+ * Returns whether the caller must run the measured statement the number of
+ * times stored in iterations and call this again.
+ */
+bool
+atf_tc_benchmark_batch(const atf_tc_t *tc, size_t *iterations)
+{
+    PRE(Current.tc != NULL);
+    PRE(tc == Current.tc);
+
+    return bench_batch(&Current, iterations);
+}
+
+/** Names the record of the next benchmark loop; internal to atf-c++. */
+void
+atf_tc_benchmark_label(const atf_tc_t *tc, const char *label)
+{
+    PRE(Current.tc != NULL);
+    PRE(tc == Current.tc);
+
+    check_fatal_error(atf_bench_body_label(label));
+}
+
+/** Gets the median time per iteration, in nanoseconds, of the last
+ * benchmark loop; internal to atf-c++. */
+double
+atf_tc_benchmark_median(const atf_tc_t *tc)
+{
+    PRE(Current.tc != NULL);
+    PRE(tc == Current.tc);
+
+    return atf_bench_body_last()->m_median;
+}
+
+/** Outputs a free-form record along with those of the benchmark loops;
+ * internal to atf-c++. */
+void
+atf_tc_benchmark_report(const atf_tc_t *tc, const char *record)
+{
+    PRE(Current.tc != NULL);
+    PRE(tc == Current.tc);
+
+    atf_bench_body_report(record);
+}
+
 /* Internal! */
 void
 atf_tc_set_resultsfile(const char *file)
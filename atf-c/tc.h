@@ -122,6 +122,9 @@ void atf_tc_expect_death(const char *, ...)
 void atf_tc_expect_timeout(const char *, ...)
     ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(1, 2);
 
+/* To be run from test case heads only; internal to macros.h. */
+void atf_tc_set_md_vars_packed(atf_tc_t *, const char *);
+
 /* To be run from test case bodies only; internal to macros.h. */
 void atf_tc_fail_check(const char *, const size_t, const char *, ...)
     ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(3, 4);
@@ -133,4 +136,36 @@ void atf_tc_check_errno(const char *, const size_t, const int,
 void atf_tc_require_errno(const char *, const size_t, const int,
                           const char *, const bool);
 
+/* To be run from test case bodies only; internal to the bounded-time
+ * macros of macros.h and atf-c++.  Times are in milliseconds. */
+double atf_tc_within_budget(const double);
+double atf_tc_within_clock(const bool);
+void atf_tc_check_within(const char *, const size_t, const bool,
+                         const char *, const double, const double);
+void atf_tc_require_within(const char *, const size_t, const bool,
+                           const char *, const double, const double);
+
+/* Statistics of the checks and requirements at a call site; internal to
+ * macros.h.  For static initialization only. */
+struct atf_tc_check_site {
+    const char *m_file;
+    size_t m_line;
+    unsigned long m_evaluated;
+    unsigned long m_failed;
+    bool m_registered;
+    struct atf_tc_check_site *m_next;
+};
+
+/* Whether the macros in macros.h count the checks they evaluate. */
+extern bool atf_tc_check_stats;
+
+void atf_tc_count_check(struct atf_tc_check_site *, const bool);
+
+/* To be run from the bodies of benchmark test cases only; internal to
+ * macros.h and atf-c++. */
+bool atf_tc_benchmark_batch(const atf_tc_t *, size_t *);
+void atf_tc_benchmark_label(const atf_tc_t *, const char *);
+double atf_tc_benchmark_median(const atf_tc_t *);
+void atf_tc_benchmark_report(const atf_tc_t *, const char *);
+
 #endif /* !defined(ATF_C_TC_H) */
@@ -49,6 +49,14 @@ ATF_TC_HEAD(test_var, tc)
     atf_tc_set_md_var(tc, "test-var", "Test text");
 }
 
+static int head_calls;
+
+ATF_TC_HEAD(counted, tc)
+{
+    head_calls++;
+    atf_tc_set_md_var(tc, "test-var", "Test text");
+}
+
 /* ---------------------------------------------------------------------
  * Test cases for the "atf_tc_t" type.
  * --------------------------------------------------------------------- */
@@ -156,6 +164,41 @@ ATF_TC_BODY(config, tcin)
     atf_tc_fini(&tc);
 }
 
+ATF_TC(lazy_head);
+ATF_TC_HEAD(lazy_head, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the head is not run until "
+                      "the meta-data of the test case is needed, and that "
+                      "it is run only once");
+}
+ATF_TC_BODY(lazy_head, tcin)
+{
+    atf_tc_t tc;
+
+    head_calls = 0;
+    RE(atf_tc_init(&tc, "test1", ATF_TC_HEAD_NAME(counted),
+                   ATF_TC_BODY_NAME(empty), NULL, NULL));
+    ATF_REQUIRE_EQ(0, head_calls);
+    ATF_REQUIRE(strcmp(atf_tc_get_ident(&tc), "test1") == 0);
+    ATF_REQUIRE(!atf_tc_has_config_var(&tc, "test-var"));
+    ATF_REQUIRE_EQ(0, head_calls);
+
+    ATF_REQUIRE(atf_tc_has_md_var(&tc, "test-var"));
+    ATF_REQUIRE_EQ(1, head_calls);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "ident"), "test1") == 0);
+    ATF_REQUIRE(!atf_tc_has_md_var(&tc, "has.cleanup"));
+    ATF_REQUIRE_EQ(1, head_calls);
+    atf_tc_fini(&tc);
+
+    head_calls = 0;
+    RE(atf_tc_init(&tc, "test2", ATF_TC_HEAD_NAME(counted),
+                   ATF_TC_BODY_NAME(empty), NULL, NULL));
+    RE(atf_tc_set_md_var(&tc, "test-var", "Overridden"));
+    ATF_REQUIRE_EQ(1, head_calls);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "test-var"), "Overridden") == 0);
+    atf_tc_fini(&tc);
+}
+
 /* ---------------------------------------------------------------------
  * Test cases for the free functions.
  * --------------------------------------------------------------------- */
@@ -175,6 +218,7 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, init_pack);
     ATF_TP_ADD_TC(tp, vars);
     ATF_TP_ADD_TC(tp, config);
+    ATF_TP_ADD_TC(tp, lazy_head);
 
     /* Add the test cases for the free functions. */
     /* TODO */
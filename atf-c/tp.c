@@ -31,37 +31,74 @@
 #include <unistd.h>
 
 #include "atf-c/detail/fs.h"
+#include "atf-c/detail/hash.h"
 #include "atf-c/detail/map.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/tc.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
 
 struct atf_tp_impl {
     atf_list_t m_tcs;
     atf_map_t m_config;
+
+    /* Open-addressing hash table of the test cases in m_tcs, indexed by
+     * their identifier.  m_index_size is always a power of two. */
+    const atf_tc_t **m_index;
+    size_t m_index_size;
 };
 
 /* ---------------------------------------------------------------------
  * Auxiliary functions.
  * --------------------------------------------------------------------- */
 
+/* Returns the slot of the index that holds the test case named ident or,
+ * if there is no such test case, the empty slot where it would go. */
 static
-const atf_tc_t *
-find_tc(const atf_tp_t *tp, const char *ident)
+size_t
+index_slot(const atf_tc_t *const *index, const size_t size,
+           const char *ident)
 {
-    const atf_tc_t *tc;
-    atf_list_citer_t iter;
+    size_t i;
 
-    tc = NULL;
-    atf_list_for_each_c(iter, &tp->pimpl->m_tcs) {
-        const atf_tc_t *tc2;
-        tc2 = atf_list_citer_data(iter);
-        if (strcmp(atf_tc_get_ident(tc2), ident) == 0) {
-            tc = tc2;
-            break;
-        }
+    i = (size_t)atf_hash_string(ATF_HASH_INIT, ident) & (size - 1);
+    while (index[i] != NULL && strcmp(atf_tc_get_ident(index[i]), ident) != 0)
+        i = (i + 1) & (size - 1);
+    return i;
+}
+
+static
+atf_error_t
+grow_index(struct atf_tp_impl *pimpl)
+{
+    const atf_tc_t **index;
+    size_t i, size;
+
+    size = pimpl->m_index_size == 0 ? 64 : pimpl->m_index_size * 2;
+    index = calloc(size, sizeof(*index));
+    if (index == NULL)
+        return atf_no_memory_error();
+
+    for (i = 0; i < pimpl->m_index_size; i++) {
+        const atf_tc_t *tc = pimpl->m_index[i];
+        if (tc != NULL)
+            index[index_slot(index, size, atf_tc_get_ident(tc))] = tc;
     }
-    return tc;
+
+    free(pimpl->m_index);
+    pimpl->m_index = index;
+    pimpl->m_index_size = size;
+    return atf_no_error();
+}
+
+static
+const atf_tc_t *
+find_tc(const atf_tp_t *tp, const char *ident)
+{
+    if (tp->pimpl->m_index_size == 0)
+        return NULL;
+    return tp->pimpl->m_index[index_slot(tp->pimpl->m_index,
+                                         tp->pimpl->m_index_size, ident)];
 }
 
 /* ---------------------------------------------------------------------
@@ -83,6 +120,9 @@ atf_tp_init(atf_tp_t *tp, const char *const *config)
     if (tp->pimpl == NULL)
         return atf_no_memory_error();
 
+    tp->pimpl->m_index = NULL;
+    tp->pimpl->m_index_size = 0;
+
     err = atf_list_init(&tp->pimpl->m_tcs);
     if (atf_is_error(err))
         goto out;
@@ -110,6 +150,7 @@ atf_tp_fini(atf_tp_t *tp)
         atf_tc_fini(tc);
     }
     atf_list_fini(&tp->pimpl->m_tcs);
+    free(tp->pimpl->m_index);
 
     free(tp->pimpl);
     tp->pimpl = NULL;
@@ -180,13 +221,48 @@ atf_tp_add_tc(atf_tp_t *tp, atf_tc_t *tc)
 
     PRE(find_tc(tp, atf_tc_get_ident(tc)) == NULL);
 
+    /* Keep the index at most half full so that probe sequences stay
+     * short. */
+    if ((atf_list_size(&tp->pimpl->m_tcs) + 1) * 2 > tp->pimpl->m_index_size) {
+        err = grow_index(tp->pimpl);
+        if (atf_is_error(err))
+            return err;
+    }
+
     err = atf_list_append(&tp->pimpl->m_tcs, tc, false);
+    if (atf_is_error(err))
+        return err;
+    tp->pimpl->m_index[index_slot(tp->pimpl->m_index, tp->pimpl->m_index_size,
+                                  atf_tc_get_ident(tc))] = tc;
 
     POST(find_tc(tp, atf_tc_get_ident(tc)) != NULL);
 
     return err;
 }
 
+/** Initializes the test case described by pack and adds it to tp.
+ *
+ * The test case shares the configuration of the test program and does not
+ * run its head until its meta-data is needed.
+ */
+atf_error_t
+atf_tp_add_tc_pack(atf_tp_t *tp, struct atf_tc *tc,
+                   const struct atf_tc_pack *pack)
+{
+    atf_error_t err;
+
+    err = atf_tc_init_pack_shared(tc, pack, &tp->pimpl->m_config);
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_tp_add_tc(tp, tc);
+    if (atf_is_error(err))
+        atf_tc_fini(tc);
+
+out:
+    return err;
+}
+
 /* ---------------------------------------------------------------------
  * Free functions.
  * --------------------------------------------------------------------- */
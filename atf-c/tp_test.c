@@ -26,11 +26,15 @@
 #include "config.h"
 #include "atf-c/tp.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include <atf-c.h>
 
+#include "atf-c/tc.h"
+
 ATF_TC(getopt);
 ATF_TC_HEAD(getopt, tc)
 {
@@ -77,6 +81,99 @@ ATF_TC_BODY(getopt, tc)
         "invalid");
 }
 
+static int head_calls;
+
+ATF_TC_HEAD(counted, tc)
+{
+    head_calls++;
+    atf_tc_set_md_var(tc, "test-var", "Test text");
+}
+ATF_TC_BODY(counted, tc)
+{
+    if (tc != NULL) {}
+}
+
+ATF_TC(add_tc_pack);
+ATF_TC_HEAD(add_tc_pack, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_tp_add_tc_pack registers "
+        "a test case that shares the configuration of the test program "
+        "and defers running its head");
+}
+ATF_TC_BODY(add_tc_pack, tcin)
+{
+    const char *const config[] = { "test-var", "test-value", NULL };
+    atf_tc_pack_t pack = {
+        .m_ident = "test1",
+        .m_head = ATF_TC_HEAD_NAME(counted),
+        .m_body = ATF_TC_BODY_NAME(counted),
+        .m_cleanup = NULL,
+    };
+    atf_tp_t tp;
+    atf_tc_t tc;
+    const atf_tc_t *tcp;
+
+    head_calls = 0;
+    ATF_REQUIRE(!atf_is_error(atf_tp_init(&tp, config)));
+    ATF_REQUIRE(!atf_is_error(atf_tp_add_tc_pack(&tp, &tc, &pack)));
+    ATF_REQUIRE(atf_tp_has_tc(&tp, "test1"));
+    ATF_REQUIRE(!atf_tp_has_tc(&tp, "test2"));
+    ATF_REQUIRE_EQ(0, head_calls);
+
+    tcp = atf_tp_get_tc(&tp, "test1");
+    ATF_REQUIRE(tcp == &tc);
+    ATF_REQUIRE_STREQ("test-value", atf_tc_get_config_var(tcp, "test-var"));
+    ATF_REQUIRE_EQ(0, head_calls);
+    ATF_REQUIRE_STREQ("Test text", atf_tc_get_md_var(tcp, "test-var"));
+    ATF_REQUIRE_EQ(1, head_calls);
+
+    atf_tp_fini(&tp);
+}
+
+ATF_TC(many_tcs);
+ATF_TC_HEAD(many_tcs, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that test cases can be found "
+        "after registering many of them, in registration order");
+}
+ATF_TC_BODY(many_tcs, tcin)
+{
+#define NTCS 1000
+    const char *const config[] = { NULL };
+    static char idents[NTCS][16];
+    static struct atf_tc_pack packs[NTCS];
+    static atf_tc_t tcs[NTCS];
+    const atf_tc_t **all;
+    atf_tp_t tp;
+    size_t i;
+
+    ATF_REQUIRE(!atf_is_error(atf_tp_init(&tp, config)));
+    for (i = 0; i < NTCS; i++) {
+        snprintf(idents[i], sizeof(idents[i]), "tc%zu", i);
+        packs[i].m_ident = idents[i];
+        packs[i].m_body = ATF_TC_BODY_NAME(counted);
+        ATF_REQUIRE(!atf_is_error(atf_tp_add_tc_pack(&tp, &tcs[i],
+                                                     &packs[i])));
+    }
+
+    for (i = 0; i < NTCS; i++) {
+        ATF_REQUIRE(atf_tp_has_tc(&tp, idents[i]));
+        ATF_REQUIRE(atf_tp_get_tc(&tp, idents[i]) == &tcs[i]);
+    }
+    ATF_REQUIRE(!atf_tp_has_tc(&tp, "tc"));
+    ATF_REQUIRE(!atf_tp_has_tc(&tp, "tc1000"));
+
+    all = atf_tp_get_tcs(&tp);
+    ATF_REQUIRE(all != NULL);
+    for (i = 0; i < NTCS; i++)
+        ATF_REQUIRE(all[i] == &tcs[i]);
+    ATF_REQUIRE(all[NTCS] == NULL);
+    free(all);
+
+    atf_tp_fini(&tp);
+#undef NTCS
+}
+
 /* ---------------------------------------------------------------------
  * Main.
  * --------------------------------------------------------------------- */
@@ -84,6 +181,8 @@ ATF_TC_BODY(getopt, tc)
 ATF_TP_ADD_TCS(tp)
 {
     ATF_TP_ADD_TC(tp, getopt);
+    ATF_TP_ADD_TC(tp, add_tc_pack);
+    ATF_TP_ADD_TC(tp, many_tcs);
 
     return atf_no_error();
 }
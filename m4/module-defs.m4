@@ -121,9 +121,30 @@ function(int a __attribute__((__unused__)))
     AC_SUBST([ATTRIBUTE_UNUSED], [${value}])
 ])
 
+dnl Must come after ATF_ATTRIBUTE_UNUSED, whose value is used as a fallback
+dnl so that the records still do not raise unused variable warnings.
+AC_DEFUN([ATF_ATTRIBUTE_TC_MD], [
+    AC_MSG_CHECKING(
+        [whether __attribute__((__section__("atf_tc_md"))) is supported])
+    AC_COMPILE_IFELSE(
+        [AC_LANG_PROGRAM([
+static const char record@<:@@:>@
+    __attribute__((__section__("atf_tc_md"), __used__)) = "record";
+], [
+    return 0;
+])],
+        [AC_MSG_RESULT(yes)
+         value='__attribute__((__section__("atf_tc_md"), __used__))'],
+        [AC_MSG_RESULT(no)
+         value="${ATTRIBUTE_UNUSED}"]
+    )
+    AC_SUBST([ATTRIBUTE_TC_MD], [${value}])
+])
+
 AC_DEFUN([ATF_MODULE_DEFS], [
     ATF_ATTRIBUTE_FORMAT_PRINTF
     ATF_ATTRIBUTE_NONNULL
     ATF_ATTRIBUTE_NORETURN
     ATF_ATTRIBUTE_UNUSED
+    ATF_ATTRIBUTE_TC_MD
 ])
@@ -0,0 +1,365 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+atf_test_case several_tcs
+several_tcs_head()
+{
+    atf_set "descr" "Tests that several test cases can be run from a" \
+                    "single invocation, each one with its own results file"
+}
+several_tcs_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -rf resdir
+        atf_check -s eq:1 -o inline:"msg\nmsg\nmsg\n" -e ignore "${h}" \
+            -s "${srcdir}" -r resdir result_pass result_fail result_skip
+        atf_check -o inline:"passed\n" cat resdir/result_pass
+        atf_check -o inline:"failed: Failure reason\n" cat resdir/result_fail
+        atf_check -o inline:"skipped: Skipped reason\n" \
+            cat resdir/result_skip
+
+        rm -rf resdir
+        atf_check -s eq:0 -o inline:"msg\nmsg\n" -e ignore "${h}" \
+            -s "${srcdir}" -r resdir result_pass result_skip
+    done
+}
+
+atf_test_case cleanup_part
+cleanup_part_head()
+{
+    atf_set "descr" "Tests that cleanup parts can be requested alongside" \
+                    "bodies in a single invocation"
+}
+cleanup_part_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes \
+            cleanup_pass:body cleanup_pass:cleanup
+        atf_check -o inline:"passed\n" cat resdir/cleanup_pass
+        test ! -f tmpfile || atf_fail "Cleanup part was not executed"
+    done
+}
+
+atf_test_case all_part
+all_part_head()
+{
+    atf_set "descr" "Tests that the 'all' part runs the body and then the" \
+                    "cleanup routine of a test case in a single invocation"
+}
+all_part_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes \
+            cleanup_pass:all
+        atf_check -o inline:"passed\n" cat resfile
+        test ! -f tmpfile || atf_fail "Cleanup part was not executed"
+
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes \
+            cleanup_fail:all
+        atf_check -o inline:"failed: On purpose\n" cat resfile
+        test ! -f tmpfile || atf_fail "Cleanup part was not executed"
+
+        atf_check -s signal:sigterm -o ignore -e ignore "${h}" \
+            -s "${srcdir}" -r resfile -v tmpfile="$(pwd)/tmpfile" \
+            cleanup_sigterm:all
+        test ! -f tmpfile || atf_fail "Cleanup part was not executed"
+
+        rm -rf resdir
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes \
+            cleanup_pass:all result_pass
+        atf_check -o inline:"passed\n" cat resdir/cleanup_pass
+        test ! -f tmpfile || atf_fail "Cleanup part was not executed"
+    done
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o inline:"msg\n" -e ignore "${h}" \
+            -s "${srcdir}" -r resfile result_pass:all
+        atf_check -o inline:"passed\n" cat resfile
+    done
+}
+
+atf_test_case full_tcs
+full_tcs_head()
+{
+    atf_set "descr" "Tests that test cases selected with -a or given" \
+                    "without a part run their cleanup routine after the body"
+}
+full_tcs_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -rf resdir
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes \
+            -g cleanup_pass -a
+        atf_check -o inline:"passed\n" cat resdir/cleanup_pass
+        test ! -f tmpfile || atf_fail "Cleanup part was not executed"
+
+        rm -rf resdir
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes \
+            cleanup_pass result_pass
+        atf_check -o inline:"passed\n" cat resdir/cleanup_pass
+        test ! -f tmpfile || atf_fail "Cleanup part was not executed"
+
+        rm -rf resdir
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes \
+            cleanup_pass:body result_pass
+        test -f tmpfile || atf_fail "Cleanup part was executed"
+        rm -f tmpfile
+    done
+}
+
+atf_test_case all_tcs
+all_tcs_head()
+{
+    atf_set "descr" "Tests that -a runs every test case"
+}
+all_tcs_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -rf resdir
+        "${h}" -l | sed -n 's/^ident: //p' | sort >expout
+        "${h}" -s "${srcdir}" -r resdir -v tmpfile="$(pwd)/tmpfile" -a \
+            >/dev/null 2>&1
+        atf_check -o file:expout \
+            -x "ls resdir | grep -v '\.bench\$' | sort"
+    done
+}
+
+atf_test_case parallel_tcs
+parallel_tcs_head()
+{
+    atf_set "descr" "Tests that -j yields the same results as running the" \
+                    "test cases one after the other"
+}
+parallel_tcs_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -rf serial parallel
+        "${h}" -s "${srcdir}" -r serial -v tmpfile="$(pwd)/tmpfile" -a \
+            >/dev/null 2>&1
+        "${h}" -s "${srcdir}" -r parallel -v tmpfile="$(pwd)/tmpfile" -a \
+            -j 4 >/dev/null 2>&1
+        atf_check -o empty diff -r -x '*.bench' serial parallel
+
+        # The parts of a test case run in order in the same worker, even if
+        # they are not given next to each other.
+        rm -rf parallel
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r parallel -v tmpfile="$(pwd)/tmpfile" -v cleanup=yes -j 2 \
+            cleanup_pass:body result_pass cleanup_pass:cleanup
+        atf_check -o inline:"passed\n" cat parallel/cleanup_pass
+        test ! -f tmpfile || atf_fail "Cleanup part did not run last"
+    done
+}
+
+atf_test_case parallel_workdir
+parallel_workdir_head()
+{
+    atf_set "descr" "Tests that -j runs every test case in its own work" \
+                    "directory, shared by all of its parts"
+}
+parallel_workdir_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o match:"Old value: 1234" -e ignore "${h}" \
+            -s "${srcdir}" -r "$(pwd)/resdir" -j 2 \
+            cleanup_curdir cleanup_curdir:cleanup
+        atf_check -o inline:"passed\n" cat resdir/cleanup_curdir
+        test ! -f oldvalue || atf_fail "Test case ran in the current directory"
+    done
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -rf resdir
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -j 1 result_pass
+        atf_check -o inline:"passed\n" cat resdir/result_pass
+    done
+}
+
+atf_test_case durations_history
+durations_history_head()
+{
+    atf_set "descr" "Tests that the durations of the test cases are" \
+                    "recorded and that the longest ones start first"
+}
+durations_history_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -f history
+        atf_check -s eq:1 -o ignore -e ignore -x \
+            "ATF_DURATIONS_FILE=history ${h} -s ${srcdir} -r resdir -j 1 \
+             result_pass result_fail result_skip"
+        atf_check -o inline:"result_pass\nresult_fail\nresult_skip\n" \
+            cut -d ' ' -f 2 history
+        atf_check -o inline:"/${h##*/}\n" -x \
+            "cut -d ' ' -f 3- history | sed 's,.*/,/,' | sort -u"
+
+        # Make result_skip the longest test case and result_pass the
+        # shortest one.
+        awk '{ $1 = NR; print }' history >history.new
+        mv history.new history
+        atf_check -s eq:1 -o ignore -e ignore -x \
+            "ATF_DURATIONS_FILE=history ${h} -s ${srcdir} -r resdir -j 1 \
+             result_pass result_fail result_skip"
+        atf_check -o inline:"result_skip\nresult_fail\nresult_pass\n" \
+            -x "sed -n 4,6p history | cut -d ' ' -f 2"
+    done
+}
+
+atf_test_case selected_tcs
+selected_tcs_head()
+{
+    atf_set "descr" "Tests that -e and -g restrict the listing and the" \
+                    "execution of several test cases to the matching ones"
+}
+selected_tcs_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o inline:"result_fail\nresult_pass\n" -e empty \
+            -x "${h} -s ${srcdir} -g 'result_*' \
+                -e '^result_(pass|fail)\$' -l | sed -n 's/^ident: //p' | sort"
+
+        rm -rf resdir
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -v tmpfile="$(pwd)/tmpfile" -g 'result_*' \
+            -e '^result_(pass|fail)$' -a
+        atf_check -o inline:"result_fail\nresult_pass\n" \
+            -x "ls resdir | sort"
+
+        # The selection also applies to the names given explicitly, even
+        # if there is only one of them.
+        rm -rf resdir
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -e 'pass|skip' result_pass result_fail result_skip
+        atf_check -o inline:"result_pass\nresult_skip\n" \
+            -x "ls resdir | sort"
+        rm -rf resdir
+        atf_check -s eq:0 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -r resdir -g 'result_pass' result_fail
+        test ! -f resdir/result_fail || atf_fail "Selection not applied"
+    done
+}
+
+atf_test_case sharded_tcs
+sharded_tcs_head()
+{
+    atf_set "descr" "Tests that -k splits the test cases into disjoint" \
+                    "shards that cover all of them"
+}
+sharded_tcs_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        "${h}" -l | sed -n 's/^ident: //p' | sort >expout
+        rm -f shards
+        for k in 1 2 3; do
+            "${h}" -s "${srcdir}" -k "${k}/3" -l \
+                | sed -n 's/^ident: //p' >shard${k}
+            test -s shard${k} || atf_fail "Shard ${k}/3 is empty"
+            cat shard${k} >>shards
+        done
+        atf_check -o file:expout sort shards
+
+        # Running a shard runs exactly the test cases it lists.
+        rm -rf resdir
+        "${h}" -s "${srcdir}" -r resdir -v tmpfile="$(pwd)/tmpfile" \
+            -k 2/3 -a >/dev/null 2>&1
+        sort shard2 >expout
+        atf_check -o file:expout \
+            -x "ls resdir | grep -v '\.bench\$' | sort"
+    done
+}
+
+atf_test_case usage_errors
+usage_errors_head()
+{
+    atf_set "descr" "Tests the usage errors of the batch execution mode"
+}
+usage_errors_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:1 -o empty -e match:"results directory with -r" \
+            "${h}" -s "${srcdir}" result_pass result_fail
+        atf_check -s eq:1 -o empty -e match:"results directory with -r" \
+            "${h}" -s "${srcdir}" -a
+        atf_check -s eq:1 -o empty -e match:"test case names with -a" \
+            "${h}" -s "${srcdir}" -r resdir -a result_pass
+        atf_check -s eq:1 -o empty -e match:"-a nor -j with -l" \
+            "${h}" -s "${srcdir}" -a -l
+        atf_check -s eq:1 -o empty -e match:"-a nor -j with -l" \
+            "${h}" -s "${srcdir}" -j 2 -l
+        atf_check -s eq:1 -o empty -e match:"results directory with -r" \
+            "${h}" -s "${srcdir}" -j 2 result_pass
+        for j in 0 -1 foo; do
+            atf_check -s eq:1 -o empty \
+                -e match:"Invalid number of parallel jobs .${j}'" \
+                "${h}" -s "${srcdir}" -r resdir -j "${j}" result_pass
+        done
+        atf_check -s eq:1 -o empty -e match:"Unknown test case .foo'" \
+            "${h}" -s "${srcdir}" -r resdir result_pass foo
+        atf_check -s eq:1 -o empty -e match:"results directory with -r" \
+            "${h}" -s "${srcdir}" -g 'result_*' result_pass
+        atf_check -s eq:1 -o empty \
+            -e match:"Invalid regular expression .\\(foo'" \
+            "${h}" -s "${srcdir}" -e '(foo' -l
+        for k in 0/2 3/2 1/0 1 foo; do
+            atf_check -s eq:1 -o empty -e match:"Invalid shard .${k}'" \
+                "${h}" -s "${srcdir}" -k "${k}" -l
+        done
+        atf_check -s eq:1 -o empty -e match:"-e, -g nor -k with -S" \
+            "${h}" -s "${srcdir}" -k 1/2 -S /dev/null
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case several_tcs
+    atf_add_test_case cleanup_part
+    atf_add_test_case all_part
+    atf_add_test_case full_tcs
+    atf_add_test_case all_tcs
+    atf_add_test_case parallel_tcs
+    atf_add_test_case parallel_workdir
+    atf_add_test_case durations_history
+    atf_add_test_case selected_tcs
+    atf_add_test_case sharded_tcs
+    atf_add_test_case usage_errors
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -0,0 +1,457 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+: ${ATF_BENCH:="__ATF_BENCH__"}
+
+atf_test_case record
+record_head()
+{
+    atf_set "descr" "Checks that the statistics of a benchmark are recorded" \
+                    "next to the results file"
+}
+record_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile bench_loop
+    atf_check -o inline:"passed\n" cat resfile
+
+    atf_check -o inline:"benchmark: bench_loop\n" sed -n 1p resfile.bench
+    atf_check -o match:'^iterations: [1-9][0-9]*$' sed -n 2p resfile.bench
+    atf_check -o inline:"samples: 5\n" sed -n 3p resfile.bench
+    line=4
+    for key in min median p90 p99 mean stddev; do
+        atf_check -o match:"^${key}: [0-9]+\.[0-9]{3}$" \
+            sed -n ${line}p resfile.bench
+        line=$((line + 1))
+    done
+    atf_check -o match:'^values:( [0-9]+\.[0-9]{3}){5}$' \
+        sed -n 10p resfile.bench
+    atf_check -o inline:"10\n" -x "grep -Ev '^(task-clock|page-faults|\
+cycles|instructions):' resfile.bench | wc -l | tr -d ' '"
+}
+
+atf_test_case loops
+loops_head()
+{
+    atf_set "descr" "Checks that every benchmark loop of a body gets its" \
+                    "own record"
+}
+loops_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile -v loops=3 bench_loop
+    cat >expout <<EOF
+benchmark: bench_loop
+benchmark: bench_loop/2
+benchmark: bench_loop/3
+EOF
+    atf_check -o file:expout grep '^benchmark:' resfile.bench
+
+    # Running it again replaces the previous records.
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile bench_loop
+    atf_check -o inline:"benchmark: bench_loop\n" \
+        grep '^benchmark:' resfile.bench
+}
+
+atf_test_case no_loop
+no_loop_head()
+{
+    atf_set "descr" "Checks that a benchmark fails if its body does not" \
+                    "measure anything"
+}
+no_loop_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile bench_loop
+    test -f resfile.bench || atf_fail "No benchmark record"
+
+    atf_check -s eq:1 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile bench_no_loop
+    reason="Benchmark body did not complete any ATF_BENCHMARK_LOOP"
+    atf_check -o inline:"failed: ${reason}\n" cat resfile
+    ! test -f resfile.bench || atf_fail "Stale benchmark record left behind"
+
+    atf_check -s eq:1 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile -v loops=0 bench_loop
+    atf_check -o match:"^failed: Benchmark body did not complete" cat resfile
+}
+
+atf_test_case not_cached
+not_cached_head()
+{
+    atf_set "descr" "Checks that the results of benchmarks are never" \
+                    "taken from the cache"
+}
+not_cached_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    cache="ATF_RESULT_CACHE_DIR=$(pwd)/cache"
+    for i in 1 2; do
+        rm -f resfile.bench
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "${cache} ${srcdir}/c_helpers -s ${srcdir} -r resfile bench_loop"
+        test -f resfile.bench || atf_fail "Benchmark not run"
+    done
+    ! ls cache/*bench_loop* >/dev/null 2>&1 || atf_fail "Benchmark cached"
+}
+
+atf_test_case stderr
+stderr_head()
+{
+    atf_set "descr" "Checks that the statistics of a benchmark go to stderr" \
+                    "if the results do not go to a file"
+}
+stderr_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o inline:"passed\n" \
+        -e match:'^benchmark: bench_loop$' -e match:'^samples: 5$' \
+        "${srcdir}/c_helpers" -s "${srcdir}" -r /dev/stdout bench_loop
+}
+
+atf_test_case meta_data
+meta_data_head()
+{
+    atf_set "descr" "Checks the properties of benchmarks"
+}
+meta_data_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o match:'^X-benchmark: true$' -e ignore \
+        "${srcdir}/c_helpers" -s "${srcdir}" -l
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile -v samples=12 bench_loop
+    atf_check -o inline:"samples: 12\n" grep '^samples:' resfile.bench
+
+    for value in 0 -1 foo; do
+        atf_check -s signal:sigabrt -o ignore -e match:"Invalid value for \
+the X-benchmark.samples property: ${value}" \
+            "${srcdir}/c_helpers" -s "${srcdir}" -r resfile \
+            -v samples="${value}" bench_loop
+    done
+}
+
+atf_test_case sweep
+sweep_head()
+{
+    atf_set "descr" "Checks that C++ benchmarks sweep their parameters and" \
+                    "fit the complexity of the measured code"
+}
+sweep_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/cpp_helpers" \
+        -s "${srcdir}" -r resfile bench_sweep
+    atf_check -o inline:"passed\n" cat resfile
+
+    cat >expout <<EOF
+benchmark: bench_sweep/n=64
+benchmark: bench_sweep/n=256
+benchmark: bench_sweep/n=1024
+benchmark: bench_sweep/n=4096
+benchmark: bench_sweep/n=16384
+EOF
+    atf_check -o file:expout grep '^benchmark:' resfile.bench
+    atf_check -o inline:"complexity: bench_sweep\n" \
+        grep '^complexity:' resfile.bench
+    atf_check -o match:'^big-o: O\((1|n|n log n|n\^2)\)$' \
+        grep '^big-o:' resfile.bench
+    atf_check -o match:'^coefficient: [0-9]+\.[0-9]{3}$' \
+        grep '^coefficient:' resfile.bench
+    atf_check -o match:'^rms: [0-9]+\.[0-9]{3}$' grep '^rms:' resfile.bench
+
+    # Every value of the other parameters gets its own fit.
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/cpp_helpers" \
+        -s "${srcdir}" -r resfile -v threads=yes bench_sweep
+    atf_check -o inline:"10\n" grep -c '^benchmark:' resfile.bench
+    atf_check -o match:'^benchmark: bench_sweep/n=64/threads=2$' \
+        grep '^benchmark:' resfile.bench
+    cat >expout <<EOF
+complexity: bench_sweep/threads=1
+complexity: bench_sweep/threads=2
+EOF
+    atf_check -o file:expout grep '^complexity:' resfile.bench
+}
+
+atf_test_case complexity
+complexity_head()
+{
+    atf_set "descr" "Checks that C++ benchmarks fail if their complexity" \
+                    "is worse than expected"
+}
+complexity_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/cpp_helpers" \
+        -s "${srcdir}" -r resfile -v complexity="O(n^2)" bench_sweep
+
+    atf_check -s eq:1 -o ignore -e match:"Check failed: Measured O\(n.*\) \
+complexity for bench_sweep but expected at most O\(1\)" \
+        "${srcdir}/cpp_helpers" -s "${srcdir}" -r resfile \
+        -v complexity="O(1)" bench_sweep
+    atf_check -o match:"^failed: 1 checks failed" cat resfile
+
+    atf_check -s eq:1 -o ignore -e ignore "${srcdir}/cpp_helpers" \
+        -s "${srcdir}" -r resfile -v complexity="O(n^3)" bench_sweep
+    atf_check -o inline:"failed: Invalid value for the \
+X-benchmark.complexity property: O(n^3)\n" cat resfile
+}
+
+atf_test_case incomplete_loop
+incomplete_loop_head()
+{
+    atf_set "descr" "Checks that C++ benchmarks fail if their body does not" \
+                    "complete the loop for every value of their parameters"
+}
+incomplete_loop_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:1 -o ignore -e ignore "${srcdir}/cpp_helpers" \
+        -s "${srcdir}" -r resfile -v skip=256 bench_sweep
+    atf_check -o inline:"failed: Benchmark body did not complete its loop \
+for n=256\n" cat resfile
+}
+
+atf_test_case baseline
+baseline_head()
+{
+    atf_set "descr" "Checks that benchmarks save their samples as the" \
+                    "baseline and compare later runs against it"
+}
+baseline_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    base="$(pwd)/base"
+
+    atf_check -s eq:0 -o ignore -e ignore env ATF_BENCH_BASELINE="${base}" \
+        "${srcdir}/c_helpers" -s "${srcdir}" -r resfile -v samples=10 \
+        bench_loop
+    atf_check -o inline:"passed\n" cat resfile
+    atf_check -o inline:"baseline: saved\n" grep '^baseline' resfile.bench
+    header='Content-Type: application/X-atf-bench-baseline; version="1"'
+    atf_check -o inline:"${header}\n" sed -n 1p base
+    atf_check -o match:' 10( [0-9]+\.[0-9]{3}){10}$' sed -n 3p base
+    # The test program lives outside of the directory of the baseline.
+    atf_check -o inline:"$(cd "${srcdir}" && pwd -P)/c_helpers:bench_loop\n" \
+        -x "sed -n 3p base | cut -d ' ' -f 1"
+
+    # Without a threshold, regressions are only reported.
+    atf_check -s eq:0 -o ignore -e ignore env ATF_BENCH_BASELINE="${base}" \
+        "${srcdir}/c_helpers" -s "${srcdir}" -r resfile -v samples=10 \
+        -v work=200 bench_loop
+    atf_check -o inline:"passed\n" cat resfile
+    atf_check -o inline:"baseline: compared\n" \
+        grep '^baseline:' resfile.bench
+    atf_check -o match:'^baseline-median: [0-9]+\.[0-9]{3}$' \
+        grep '^baseline-median:' resfile.bench
+    atf_check -o match:'^change: [0-9]+\.[0-9]{3}$' \
+        grep '^change:' resfile.bench
+    atf_check -o match:'^p-value: 0\.00[0-9]{4}$' \
+        grep '^p-value:' resfile.bench
+
+    atf_check -s eq:1 -o ignore -e match:"Check failed: Benchmark \
+bench_loop is [0-9.]+% slower than its baseline \(p-value [0-9.]+\), more \
+than the 10% allowed" env ATF_BENCH_BASELINE="${base}" \
+        "${srcdir}/c_helpers" -s "${srcdir}" -r resfile -v samples=10 \
+        -v work=200 -v max_regression=10 bench_loop
+    atf_check -o match:"^failed: 1 checks failed" cat resfile
+
+    # The baseline does not change with the runs compared against it.
+    atf_check -o inline:"3\n" -x "wc -l <base | tr -d ' '"
+
+    echo "garbage" >base
+    atf_check -s eq:1 -o ignore -e match:"Cannot load the benchmark \
+baseline: .*base is not a version 1 benchmark baseline" \
+        env ATF_BENCH_BASELINE="${base}" "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile bench_loop
+}
+
+atf_test_case baseline_key
+baseline_key_head()
+{
+    atf_set "descr" "Checks that test programs with the same name keep" \
+                    "separate entries in a shared baseline, keyed by their" \
+                    "path relative to it"
+}
+baseline_key_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    mkdir -p tree/a tree/b
+    cp "${srcdir}/c_helpers" tree/a
+    cp "${srcdir}/c_helpers" tree/b
+
+    for dir in a b; do
+        atf_check -s eq:0 -o ignore -e ignore \
+            env ATF_BENCH_BASELINE="$(pwd)/tree/base" \
+            "tree/${dir}/c_helpers" -s "${srcdir}" -r resfile -v samples=10 \
+            bench_loop
+        atf_check -o inline:"baseline: saved\n" grep '^baseline' resfile.bench
+    done
+    cat >expout <<EOF
+a/c_helpers:bench_loop
+b/c_helpers:bench_loop
+EOF
+    atf_check -o file:expout \
+        -x "'${ATF_BENCH}' list tree/base | cut -d ' ' -f 1"
+
+    # The keys do not depend on where the tree is.
+    mv tree moved
+    atf_check -s eq:0 -o ignore -e ignore \
+        env ATF_BENCH_BASELINE="$(pwd)/moved/base" \
+        moved/a/c_helpers -s "${srcdir}" -r resfile -v samples=10 bench_loop
+    atf_check -o inline:"baseline: compared\n" \
+        grep '^baseline:' resfile.bench
+}
+
+atf_test_case counters
+counters_head()
+{
+    atf_set "descr" "Checks that the performance counters of the measured" \
+                    "batches are recorded per iteration"
+}
+counters_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e ignore "${srcdir}/c_helpers" \
+        -s "${srcdir}" -r resfile bench_loop
+    atf_check -o inline:"passed\n" cat resfile
+
+    atf_check -o match:'^task-clock: [0-9]+\.[0-9]{3}$' \
+        grep '^task-clock:' resfile.bench
+    atf_check -o match:'^page-faults: [0-9]+\.[0-9]{3}$' \
+        grep '^page-faults:' resfile.bench
+    atf_check -s eq:1 -o empty grep '^cpus:' resfile.bench
+    atf_check -s eq:1 -o empty grep '^nice:' resfile.bench
+}
+
+atf_test_case pinning
+pinning_head()
+{
+    atf_set "descr" "Checks that benchmarks can be pinned to a set of CPUs" \
+                    "and run with a raised priority"
+}
+pinning_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    cpu="$(awk '/^Cpus_allowed_list:/ { sub(/[-,].*/, "", $2); print $2 }' \
+        /proc/self/status 2>/dev/null)"
+    [ -n "${cpu}" ] || atf_skip "Cannot determine an allowed CPU"
+
+    atf_check -s eq:0 -o ignore -e ignore env ATF_BENCH_CPUS="${cpu}" \
+        ATF_BENCH_PRIORITY=yes "${srcdir}/c_helpers" -s "${srcdir}" \
+        -r resfile bench_loop
+    atf_check -o inline:"passed\n" cat resfile
+    atf_check -o inline:"cpus: ${cpu}\n" grep '^cpus:' resfile.bench
+    atf_check -o match:'^nice: -?[0-9]+$' grep '^nice:' resfile.bench
+
+    atf_check -s eq:1 -o ignore -e match:"Check failed: Cannot pin the \
+benchmark: Invalid CPU list '2-1'" env ATF_BENCH_CPUS=2-1 \
+        "${srcdir}/c_helpers" -s "${srcdir}" -r resfile bench_loop
+    atf_check -o match:"^failed: 1 checks failed" cat resfile
+}
+
+atf_test_case tool
+tool_head()
+{
+    atf_set "descr" "Checks that atf-bench lists, compares and prunes" \
+                    "baselines"
+}
+tool_body()
+{
+    header='Content-Type: application/X-atf-bench-baseline; version="1"'
+    cat >old <<EOF
+${header}
+
+prog:fast 5 10.000 11.000 12.000 13.000 14.000
+prog:gone 1 1.000
+prog:slow 5 10.000 11.000 12.000 13.000 14.000
+EOF
+    cat >new <<EOF
+${header}
+
+prog:added 1 1.000
+prog:fast 5 9.000 10.000 11.000 12.000 13.000
+prog:slow 5 20.000 21.000 22.000 23.000 24.000
+EOF
+
+    cat >expout <<EOF
+prog:fast 5 12.000
+prog:gone 1 1.000
+prog:slow 5 12.000
+EOF
+    atf_check -s eq:0 -o file:expout -e empty "${ATF_BENCH}" list old
+
+    cat >expout <<EOF
+prog:added: only in new
+prog:fast: 12.000 -> 11.000 (-8.3%, p-value 0.8548)
+prog:gone: only in old
+prog:slow: 12.000 -> 22.000 (+83.3%, p-value 0.0061) REGRESSION
+EOF
+    atf_check -s eq:1 -o file:expout -e empty "${ATF_BENCH}" compare old new
+    atf_check -s eq:0 -o not-match:REGRESSION -e empty \
+        "${ATF_BENCH}" compare -t 90 old new
+    atf_check -s eq:0 -o not-match:REGRESSION -e empty \
+        "${ATF_BENCH}" compare -a 0.005 old new
+    atf_check -s eq:1 -o empty -e match:"Invalid significance level" \
+        "${ATF_BENCH}" compare -a 2 old new
+
+    atf_check -s eq:0 -o empty -e empty "${ATF_BENCH}" remove old \
+        'prog:g*' 'prog:slow'
+    cat >expout <<EOF
+${header}
+
+prog:fast 5 10.000 11.000 12.000 13.000 14.000
+EOF
+    atf_check -o file:expout cat old
+
+    echo "garbage" >bad
+    atf_check -s eq:1 -o empty -e match:"bad is not a version 1 benchmark \
+baseline" "${ATF_BENCH}" list bad
+    atf_check -s eq:1 -o empty -e match:"Usage:" "${ATF_BENCH}" foo
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case record
+    atf_add_test_case loops
+    atf_add_test_case no_loop
+    atf_add_test_case not_cached
+    atf_add_test_case stderr
+    atf_add_test_case meta_data
+    atf_add_test_case sweep
+    atf_add_test_case complexity
+    atf_add_test_case incomplete_loop
+    atf_add_test_case baseline
+    atf_add_test_case baseline_key
+    atf_add_test_case counters
+    atf_add_test_case pinning
+    atf_add_test_case tool
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -24,6 +24,8 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
 
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -35,6 +37,7 @@
 
 #include <atf-c.h>
 
+#include "atf-c/check.h"
 #include "atf-c/detail/env.h"
 #include "atf-c/detail/fs.h"
 #include "atf-c/detail/test_helpers.h"
@@ -64,6 +67,49 @@ touch(const char *path)
     close(fd);
 }
 
+/* ---------------------------------------------------------------------
+ * Helper tests for "t_bench".
+ * --------------------------------------------------------------------- */
+
+ATF_TC_BENCHMARK(bench_loop);
+ATF_TC_HEAD(bench_loop, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_bench test "
+                      "program; runs as many benchmark loops as 'loops' "
+                      "says, or one if unset, of 'work' increments each");
+    atf_tc_set_md_var(tc, "X-benchmark.batch_time", "1");
+    atf_tc_set_md_var(tc, "X-benchmark.samples", "%s",
+                      atf_tc_has_config_var(tc, "samples") ?
+                      atf_tc_get_config_var(tc, "samples") : "5");
+    if (atf_tc_has_config_var(tc, "max_regression"))
+        atf_tc_set_md_var(tc, "X-benchmark.max_regression", "%s",
+                          atf_tc_get_config_var(tc, "max_regression"));
+}
+ATF_TC_BODY(bench_loop, tc)
+{
+    volatile unsigned long counter = 0;
+    long i, j, loops, work;
+
+    loops = atf_tc_has_config_var(tc, "loops") ?
+        atf_tc_get_config_var_as_long(tc, "loops") : 1;
+    work = atf_tc_has_config_var(tc, "work") ?
+        atf_tc_get_config_var_as_long(tc, "work") : 1;
+    for (i = 0; i < loops; i++)
+        ATF_BENCHMARK_LOOP(tc)
+            for (j = 0; j < work; j++)
+                counter++;
+}
+
+ATF_TC_BENCHMARK(bench_no_loop);
+ATF_TC_HEAD(bench_no_loop, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_bench test "
+                      "program");
+}
+ATF_TC_BODY(bench_no_loop, tc)
+{
+}
+
 /* ---------------------------------------------------------------------
  * Helper tests for "t_cleanup".
  * --------------------------------------------------------------------- */
@@ -425,6 +471,168 @@ ATF_TC_BODY(result_skip, tc)
     atf_tc_skip("Skipped reason");
 }
 
+ATF_TC_WITHOUT_HEAD(result_stdin);
+ATF_TC_BODY(result_stdin, tc)
+{
+    char buf[64];
+    ssize_t n;
+
+    n = read(STDIN_FILENO, buf, sizeof(buf) - 1);
+    ATF_REQUIRE(n != -1);
+    if (n > 0) {
+        buf[n] = '\0';
+        atf_tc_fail("Read from stdin: %s", buf);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(result_check_fail);
+ATF_TC_BODY(result_check_fail, tc)
+{
+    ATF_CHECK_MSG(false, "First \"check\"");
+    ATF_CHECK_MSG(false, "Second check");
+}
+
+ATF_TC_WITHOUT_HEAD(result_check_stats);
+ATF_TC_BODY(result_check_stats, tc)
+{
+    int i;
+
+    for (i = 0; i < 10; i++)
+        ATF_CHECK(i < 9);
+    ATF_REQUIRE_EQ(1, 1);
+    ATF_CHECK_ERRNO(ENOENT, open("missing", O_RDONLY) == -1);
+}
+
+ATF_TC_WITHOUT_HEAD(result_check_repeat);
+ATF_TC_BODY(result_check_repeat, tc)
+{
+    int i;
+
+    for (i = 0; i < 100; i++)
+        ATF_CHECK_MSG(false, "Repeated check %d", i);
+    ATF_CHECK_MSG(false, "Single check");
+}
+
+ATF_TC(result_collector);
+ATF_TC_HEAD(result_collector, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program; prints what the test cases send to the "
+                      "socket given in 'socket'");
+    atf_tc_set_md_var(tc, "timeout", "30");
+}
+ATF_TC_BODY(result_collector, tc)
+{
+    const char *path = atf_tc_get_config_var(tc, "socket");
+    struct sockaddr_un addr;
+    char buf[1024];
+    long i, connections;
+    ssize_t n;
+    int conn, sock;
+
+    connections = atf_tc_get_config_var_as_long(tc, "connections");
+    ATF_REQUIRE(strlen(path) < sizeof(addr.sun_path));
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    ATF_REQUIRE(sock != -1);
+    ATF_REQUIRE(bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != -1);
+    ATF_REQUIRE(listen(sock, 16) != -1);
+    for (i = 0; i < connections; i++) {
+        conn = accept(sock, NULL, NULL);
+        ATF_REQUIRE(conn != -1);
+        while ((n = read(conn, buf, sizeof(buf))) > 0)
+            ATF_REQUIRE(write(STDOUT_FILENO, buf, n) == n);
+        close(conn);
+    }
+    close(sock);
+}
+
+ATF_TC(result_cache_count);
+ATF_TC_HEAD(result_cache_count, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program; counts its runs in the file given in "
+                      "'counter'");
+    if (atf_tc_has_config_var(tc, "input"))
+        atf_tc_set_md_var(tc, "X-cache.inputs", "%s",
+                          atf_tc_get_config_var(tc, "input"));
+}
+ATF_TC_BODY(result_cache_count, tc)
+{
+    FILE *f;
+
+    f = fopen(atf_tc_get_config_var(tc, "counter"), "a");
+    ATF_REQUIRE(f != NULL);
+    fprintf(f, "run\n");
+    fclose(f);
+}
+
+/* Forks a process that runs until it is killed and stores its PID. */
+static
+void
+leak_process(const char *pidfile)
+{
+    FILE *f;
+    pid_t pid;
+
+    pid = atf_utils_fork();
+    if (pid == 0) {
+        for (;;)
+            pause();
+    }
+
+    f = fopen(pidfile, "w");
+    ATF_REQUIRE(f != NULL);
+    fprintf(f, "%d\n", (int)pid);
+    fclose(f);
+}
+
+ATF_TC(result_leak);
+ATF_TC_HEAD(result_leak, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program; leaves a process behind");
+}
+ATF_TC_BODY(result_leak, tc)
+{
+    leak_process(atf_tc_get_config_var(tc, "pidfile"));
+    ATF_REQUIRE_MSG(false, "Leaked a process on purpose");
+}
+
+ATF_TC_WITH_CLEANUP(result_leak_cleanup);
+ATF_TC_HEAD(result_leak_cleanup, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_result test "
+                      "program; leaves a process behind from its body, "
+                      "which the cleanup routine looks for, and from its "
+                      "cleanup routine");
+}
+ATF_TC_BODY(result_leak_cleanup, tc)
+{
+    leak_process(atf_tc_get_config_var(tc, "pidfile"));
+    ATF_REQUIRE_MSG(false, "Leaked a process on purpose");
+}
+ATF_TC_CLEANUP(result_leak_cleanup, tc)
+{
+    FILE *f;
+    int pid;
+
+    f = fopen(atf_tc_get_config_var(tc, "pidfile"), "r");
+    ATF_REQUIRE(f != NULL);
+    ATF_REQUIRE_EQ(1, fscanf(f, "%d", &pid));
+    fclose(f);
+
+    f = fopen(atf_tc_get_config_var(tc, "cleanup_status"), "w");
+    ATF_REQUIRE(f != NULL);
+    fprintf(f, "%s\n", kill((pid_t)pid, 0) == 0 ? "running" : "gone");
+    fclose(f);
+
+    leak_process(atf_tc_get_config_var(tc, "cleanup_pidfile"));
+}
+
 ATF_TC(result_newlines_fail);
 ATF_TC_HEAD(result_newlines_fail, tc)
 {
@@ -447,12 +655,63 @@ ATF_TC_BODY(result_newlines_skip, tc)
     atf_tc_skip("First line\nSecond line");
 }
 
+/* ---------------------------------------------------------------------
+ * Helper tests for "t_timeout".
+ * --------------------------------------------------------------------- */
+
+ATF_TC(timeout_hang);
+ATF_TC_HEAD(timeout_hang, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_timeout test "
+                      "program");
+    atf_tc_set_md_var(tc, "timeout", "1");
+}
+ATF_TC_BODY(timeout_hang, tc)
+{
+    pid_t pid;
+
+    if (!atf_tc_has_config_var(tc, "hang"))
+        atf_tc_skip("Only hangs if the 'hang' variable is set");
+
+    pid = fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        FILE *f = fopen("grandchild.pid", "w");
+        if (f == NULL)
+            _exit(EXIT_FAILURE);
+        fprintf(f, "%d\n", (int)getpid());
+        fclose(f);
+        sleep(60);
+        _exit(EXIT_SUCCESS);
+    }
+    sleep(10);
+}
+
+/* ---------------------------------------------------------------------
+ * Helper tests for "t_trace".
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(trace_check);
+ATF_TC_BODY(trace_check, tc)
+{
+    const char *argv[] = { "/bin/sh", "-c", "exit 0", NULL };
+    atf_check_result_t result;
+
+    ATF_REQUIRE(!atf_is_error(atf_check_exec_array(argv, &result)));
+    ATF_REQUIRE(atf_check_result_exited(&result));
+    atf_check_result_fini(&result);
+}
+
 /* ---------------------------------------------------------------------
  * Main.
  * --------------------------------------------------------------------- */
 
 ATF_TP_ADD_TCS(tp)
 {
+    /* Add helper tests for t_bench. */
+    ATF_TP_ADD_TC(tp, bench_loop);
+    ATF_TP_ADD_TC(tp, bench_no_loop);
+
     /* Add helper tests for t_cleanup. */
     ATF_TP_ADD_TC(tp, cleanup_pass);
     ATF_TP_ADD_TC(tp, cleanup_fail);
@@ -496,8 +755,22 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, result_pass);
     ATF_TP_ADD_TC(tp, result_fail);
     ATF_TP_ADD_TC(tp, result_skip);
+    ATF_TP_ADD_TC(tp, result_stdin);
+    ATF_TP_ADD_TC(tp, result_check_fail);
+    ATF_TP_ADD_TC(tp, result_check_repeat);
+    ATF_TP_ADD_TC(tp, result_check_stats);
+    ATF_TP_ADD_TC(tp, result_collector);
+    ATF_TP_ADD_TC(tp, result_cache_count);
+    ATF_TP_ADD_TC(tp, result_leak);
+    ATF_TP_ADD_TC(tp, result_leak_cleanup);
     ATF_TP_ADD_TC(tp, result_newlines_fail);
     ATF_TP_ADD_TC(tp, result_newlines_skip);
 
+    /* Add helper tests for t_timeout. */
+    ATF_TP_ADD_TC(tp, timeout_hang);
+
+    /* Add helper tests for t_trace. */
+    ATF_TP_ADD_TC(tp, trace_check);
+
     return atf_no_error();
 }
@@ -24,18 +24,76 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 extern "C" {
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 }
 
+#include <cerrno>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <atf-c++.hpp>
 
 #include "atf-c++/detail/fs.hpp"
 
+// ------------------------------------------------------------------------
+// Helper tests for "t_batch".
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE_WITH_CLEANUP(cleanup_pass);
+ATF_TEST_CASE_HEAD(cleanup_pass)
+{
+    set_md_var("descr", "Helper test case for the t_batch test program");
+}
+ATF_TEST_CASE_BODY(cleanup_pass)
+{
+    std::ofstream os(get_config_var("tmpfile").c_str());
+    ATF_REQUIRE(os);
+}
+ATF_TEST_CASE_CLEANUP(cleanup_pass)
+{
+    if (has_config_var("cleanup") && get_config_var("cleanup") == "yes")
+        ::unlink(get_config_var("tmpfile").c_str());
+}
+
+// ------------------------------------------------------------------------
+// Helper tests for "t_bench".
+// ------------------------------------------------------------------------
+
+ATF_BENCHMARK_CASE(bench_sweep);
+ATF_BENCHMARK_CASE_HEAD(bench_sweep)
+{
+    set_md_var("descr", "Helper test case for the t_bench test program; "
+               "sums n integers, also sweeping 'threads' if set, and "
+               "skips its loop for the n given in 'skip'");
+    set_md_var("X-benchmark.batch_time", "1");
+    set_md_var("X-benchmark.samples", "3");
+    if (has_config_var("complexity"))
+        set_md_var("X-benchmark.complexity", get_config_var("complexity"));
+
+    add_range("n", 64, 16384, 4);
+    if (has_config_var("threads"))
+        add_values("threads", std::vector< long >{1, 2});
+}
+ATF_BENCHMARK_CASE_BODY(bench_sweep, state)
+{
+    if (has_config_var("skip") &&
+        std::to_string(state.arg()) == get_config_var("skip"))
+        return;
+
+    const std::vector< long > values(state.arg("n"), 1);
+    while (state.keep_running()) {
+        long sum = 0;
+        for (const long value : values)
+            sum += value;
+        atf::bench::do_not_optimize(sum);
+    }
+}
+
 // ------------------------------------------------------------------------
 // Helper tests for "t_config".
 // ------------------------------------------------------------------------
@@ -264,6 +322,19 @@ ATF_TEST_CASE_BODY(result_pass)
     std::cout << "msg\n";
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(result_stdin);
+ATF_TEST_CASE_BODY(result_stdin)
+{
+    char buf[64];
+
+    const ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf) - 1);
+    ATF_REQUIRE(n != -1);
+    if (n > 0) {
+        buf[n] = '\0';
+        ATF_FAIL(std::string("Read from stdin: ") + buf);
+    }
+}
+
 ATF_TEST_CASE(result_fail);
 ATF_TEST_CASE_HEAD(result_fail) { }
 ATF_TEST_CASE_BODY(result_fail)
@@ -300,6 +371,52 @@ ATF_TEST_CASE_BODY(result_newlines_skip)
     ATF_SKIP("First line\nSecond line");
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(result_check_stats);
+ATF_TEST_CASE_BODY(result_check_stats)
+{
+    for (int i = 0; i < 10; i++)
+        ATF_REQUIRE(i < 10);
+    ATF_REQUIRE_THROW(std::runtime_error, throw std::runtime_error("x"));
+    ATF_CHECK_ERRNO(ENOENT, ::open("missing", O_RDONLY) == -1);
+}
+
+ATF_TEST_CASE(result_cache_count);
+ATF_TEST_CASE_HEAD(result_cache_count)
+{
+    set_md_var("descr", "Helper test case for the t_result test program; "
+               "counts its runs in the file given in 'counter'");
+    if (has_config_var("input"))
+        set_md_var("X-cache.inputs", get_config_var("input"));
+}
+ATF_TEST_CASE_BODY(result_cache_count)
+{
+    std::ofstream os(get_config_var("counter").c_str(), std::ios::app);
+    ATF_REQUIRE(os);
+    os << "run\n";
+}
+
+ATF_TEST_CASE(result_leak);
+ATF_TEST_CASE_HEAD(result_leak)
+{
+    set_md_var("descr", "Helper test case for the t_result test program; "
+               "leaves a process behind");
+}
+ATF_TEST_CASE_BODY(result_leak)
+{
+    const pid_t pid = ::fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        for (;;)
+            ::pause();
+    }
+
+    std::ofstream os(get_config_var("pidfile").c_str());
+    ATF_REQUIRE(os);
+    os << pid << "\n";
+    os.close();
+    fail("Leaked a process on purpose");
+}
+
 ATF_TEST_CASE(result_exception);
 ATF_TEST_CASE_HEAD(result_exception) { }
 ATF_TEST_CASE_BODY(result_exception)
@@ -307,12 +424,46 @@ ATF_TEST_CASE_BODY(result_exception)
     throw std::runtime_error("This is unhandled");
 }
 
+// ------------------------------------------------------------------------
+// Helper tests for "t_timeout".
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE(timeout_hang);
+ATF_TEST_CASE_HEAD(timeout_hang)
+{
+    set_md_var("descr", "Helper test case for the t_timeout test program");
+    set_md_var("timeout", "1");
+}
+ATF_TEST_CASE_BODY(timeout_hang)
+{
+    if (!has_config_var("hang"))
+        skip("Only hangs if the 'hang' variable is set");
+
+    const pid_t pid = ::fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        {
+            std::ofstream os("grandchild.pid");
+            os << ::getpid() << "\n";
+        }
+        ::sleep(60);
+        std::exit(EXIT_SUCCESS);
+    }
+    ::sleep(10);
+}
+
 // ------------------------------------------------------------------------
 // Main.
 // ------------------------------------------------------------------------
 
 ATF_INIT_TEST_CASES(tcs)
 {
+    // Add helper tests for t_batch.
+    ATF_ADD_TEST_CASE(tcs, cleanup_pass);
+
+    // Add helper tests for t_bench.
+    ATF_ADD_TEST_CASE(tcs, bench_sweep);
+
     // Add helper tests for t_config.
     ATF_ADD_TEST_CASE(tcs, config_unset);
     ATF_ADD_TEST_CASE(tcs, config_empty);
@@ -349,7 +500,14 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, result_pass);
     ATF_ADD_TEST_CASE(tcs, result_fail);
     ATF_ADD_TEST_CASE(tcs, result_skip);
+    ATF_ADD_TEST_CASE(tcs, result_stdin);
     ATF_ADD_TEST_CASE(tcs, result_newlines_fail);
     ATF_ADD_TEST_CASE(tcs, result_newlines_skip);
     ATF_ADD_TEST_CASE(tcs, result_exception);
+    ATF_ADD_TEST_CASE(tcs, result_check_stats);
+    ATF_ADD_TEST_CASE(tcs, result_cache_count);
+    ATF_ADD_TEST_CASE(tcs, result_leak);
+
+    // Add helper tests for t_timeout.
+    ATF_ADD_TEST_CASE(tcs, timeout_hang);
 }
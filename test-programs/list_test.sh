@@ -0,0 +1,177 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+: ${ATF_LIST:="__ATF_LIST__"}
+
+atf_test_case static_list
+static_list_head()
+{
+    atf_set "descr" "Tests that test programs without heads or with" \
+                    "static ones are listed from the records in their" \
+                    "binaries"
+}
+static_list_body()
+{
+    for h in $(get_helpers list_c_helpers list_cpp_helpers); do
+        cat >expout <<EOF2
+Content-Type: application/X-atf-tp; version="1"
+
+ident: first
+
+ident: second
+
+ident: third
+has.cleanup: true
+descr: A test case with static meta-data
+timeout: 10
+EOF2
+        atf_check -s eq:0 -o file:expout -e empty "${ATF_LIST}" -n "${h}"
+        atf_check -s eq:0 -o file:expout -e empty "${ATF_LIST}" "${h}"
+
+        # The C++ test programs list the variables in alphabetical order.
+        "${h}" -l | sort >listing
+        sort expout >expout.sorted
+        atf_check -s eq:0 -o file:expout.sorted -e empty cat listing
+    done
+}
+
+atf_test_case run_fallback
+run_fallback_head()
+{
+    atf_set "descr" "Tests that test programs with heads are run with -l" \
+                    "to list their test cases"
+}
+run_fallback_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers sh_helpers); do
+        "${h}" -l >listing
+        atf_check -s eq:0 -o file:listing -e empty "${ATF_LIST}" "${h}"
+    done
+}
+
+atf_test_case no_exec
+no_exec_head()
+{
+    atf_set "descr" "Tests that -n prevents running the test program"
+}
+no_exec_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers sh_helpers); do
+        atf_check -s eq:1 -o empty \
+            -e match:"Cannot list the test cases of .* without running it" \
+            "${ATF_LIST}" -n "${h}"
+    done
+}
+
+atf_test_case missing_program
+missing_program_head()
+{
+    atf_set "descr" "Tests the error raised for a missing test program"
+}
+missing_program_body()
+{
+    atf_check -s eq:1 -o empty -e match:"Cannot open missing" \
+        "${ATF_LIST}" missing
+}
+
+atf_test_case listing_cache
+listing_cache_head()
+{
+    atf_set "descr" "Tests that -l stores the listing in the cache and" \
+                    "returns it from there on later calls"
+}
+listing_cache_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        "${h}" -l >expout
+        rm -rf cache
+        ATF_LIST_CACHE_DIR="$(pwd)/cache" \
+            atf_check -s eq:0 -o file:expout -e empty "${h}" -l
+        test $(ls cache | wc -l) -eq 1 || atf_fail "Cache entry not created"
+
+        # Tamper with the entry to prove that it is used as is.
+        sed -e 's,^ident: result_pass$,ident: result_cached,' \
+            cache/*.atf-list >tmp
+        mv tmp cache/*.atf-list
+        ATF_LIST_CACHE_DIR="$(pwd)/cache" \
+            atf_check -s eq:0 -o match:"ident: result_cached" -e empty \
+            "${h}" -l
+
+        # A different configuration does not match the entry.
+        ATF_LIST_CACHE_DIR="$(pwd)/cache" \
+            atf_check -s eq:0 -o not-match:"ident: result_cached" -e empty \
+            "${h}" -v var=value -l
+
+        # Neither does a different selection of the test cases.
+        ATF_LIST_CACHE_DIR="$(pwd)/cache" \
+            atf_check -s eq:0 -o not-match:"ident: result_cached" -e empty \
+            "${h}" -g 'result_*' -l
+    done
+}
+
+atf_test_case listing_cache_disabled
+listing_cache_disabled_head()
+{
+    atf_set "descr" "Tests that the listing cache is not used unless" \
+                    "requested"
+}
+listing_cache_disabled_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        HOME="$(pwd)" atf_check -s eq:0 -o ignore -e empty "${h}" -l
+        atf_check -o empty find . "$(atf_get_srcdir)" -name '*.atf-list'
+    done
+}
+
+atf_test_case listing_cache_unwritable
+listing_cache_unwritable_head()
+{
+    atf_set "descr" "Tests that failing to store the listing in the" \
+                    "cache does not prevent listing the test cases"
+}
+listing_cache_unwritable_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        "${h}" -l >expout
+        touch cache
+        ATF_LIST_CACHE_DIR="$(pwd)/cache" \
+            atf_check -s eq:0 -o file:expout \
+            -e match:"WARNING: Cannot use the listing cache" "${h}" -l
+        rm cache
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case static_list
+    atf_add_test_case run_fallback
+    atf_add_test_case no_exec
+    atf_add_test_case missing_program
+
+    atf_add_test_case listing_cache
+    atf_add_test_case listing_cache_disabled
+    atf_add_test_case listing_cache_unwritable
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -110,6 +110,390 @@ result_to_file_fail_body()
     done
 }
 
+atf_test_case result_rusage
+result_rusage_head()
+{
+    atf_set "descr" "Tests that the resources used by the test case are" \
+                    "recorded next to the results file on request"
+}
+result_rusage_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -f resfile.rusage
+        atf_check -s eq:1 -o ignore -e ignore -x \
+            "ATF_RUSAGE=yes ${h} -s ${srcdir} -r resfile result_fail"
+        atf_check -o inline:"failed: Failure reason\n" cat resfile
+        for key in wall-time user-time system-time; do
+            atf_check -o match:"^${key}: [0-9]+\.[0-9]{6}\$" \
+                grep "^${key}:" resfile.rusage
+        done
+        for key in max-rss voluntary-context-switches \
+                   involuntary-context-switches; do
+            atf_check -o match:"^${key}: [0-9]+\$" \
+                grep "^${key}:" resfile.rusage
+        done
+
+        rm -f resfile.rusage
+        atf_check -s eq:0 -o match:"passed" -e ignore -x \
+            "ATF_RUSAGE=yes ${h} -s ${srcdir} result_pass"
+        atf_check -s eq:1 test -f resfile.rusage
+
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_fail
+        atf_check -s eq:1 test -f resfile.rusage
+    done
+}
+
+atf_test_case result_events
+result_events_head()
+{
+    atf_set "descr" "Tests that the events of the test case are recorded" \
+                    "next to the results file when requested"
+}
+result_events_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        rm -f resfile.jsonl
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_check_fail
+        atf_check -s eq:1 test -f resfile.jsonl
+
+        atf_check -s eq:1 -o ignore -e ignore -x \
+            "ATF_RESULT_EVENTS=yes ${h} -s ${srcdir} -r resfile \
+             result_check_fail"
+        atf_check -o inline:"4\n" -x "wc -l <resfile.jsonl | tr -d ' '"
+        atf_check -o match:'^\{"event":"start","time":[0-9]+\.[0-9]{6},' \
+            -o match:'"test_case":"result_check_fail"\}$' \
+            sed -n 1p resfile.jsonl
+        atf_check -o match:'^\{"event":"failure",' \
+            -o match:'"file":"[^"]*c_helpers\.c","line":[0-9]+,' \
+            -o match:'"reason":"First \\"check\\"",' \
+            -o match:'"fatal":false,"expected":false\}$' \
+            sed -n 2p resfile.jsonl
+        atf_check -o match:'^\{"event":"failure",' \
+            -o match:'"reason":"Second check",' \
+            sed -n 3p resfile.jsonl
+        atf_check -o match:'^\{"event":"result",' \
+            -o match:'"result":"failed","reason":"2 checks failed; see' \
+            sed -n 4p resfile.jsonl
+    done
+}
+
+atf_test_case result_check_limit
+result_check_limit_head()
+{
+    atf_set "descr" "Tests that repeated failures of a check are only" \
+                    "reported up to a limit and summarized per site"
+}
+result_check_limit_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:1 -o ignore -e save:stderr -x \
+            "ATF_CHECK_FAILURE_LIMIT=10 ${h} -s ${srcdir} -r resfile \
+             result_check_repeat"
+        atf_check -o inline:"11\n" -x \
+            "grep -c '^\*\*\* Check failed: ' stderr"
+        atf_check -o match:'Repeated check 9$' -x \
+            "grep '^\*\*\* Check failed: ' stderr | sed -n 10p"
+        atf_check -o match:'Single check$' -x \
+            "grep '^\*\*\* Check failed: ' stderr | sed -n 11p"
+        atf_check -o match:'^\*\*\* Not reporting further check failures at' \
+            -x "grep 'Not reporting' stderr"
+        # The notice follows the last failure that is reported.
+        atf_check -o match:'Repeated check 9$' -x \
+            "grep -B1 'Not reporting' stderr | sed -n 1p"
+        atf_check \
+            -o match:'^\*\*\* 90 more check failures at [^ ]*c_helpers\.c:' \
+            -x "grep 'were not reported' stderr"
+        atf_check -o match:'^failed: 101 checks failed: ' \
+            -o match:'c_helpers\.c:[0-9]+ \(100 times\), ' \
+            -o match:'c_helpers\.c:[0-9]+; see output for more details$' \
+            cat resfile
+
+        # There is no limit unless one is set.
+        for limit in "" 0; do
+            atf_check -s eq:1 -o ignore -e save:stderr -x \
+                "${limit:+ATF_CHECK_FAILURE_LIMIT=${limit}} ${h} \
+                 -s ${srcdir} -r resfile result_check_repeat"
+            atf_check -o inline:"101\n" -x \
+                "grep -c '^\*\*\* Check failed: ' stderr"
+            atf_check -s eq:1 grep 'were not reported' stderr
+            atf_check -o inline:"failed: 101 checks failed; see output for \
+more details\n" cat resfile
+        done
+
+        atf_check -s signal -o ignore -e match:"Invalid value" -x \
+            "ATF_CHECK_FAILURE_LIMIT=foo ${h} -s ${srcdir} -r resfile \
+             result_check_repeat"
+    done
+}
+
+atf_test_case result_capture
+result_capture_head()
+{
+    atf_set "descr" "Tests that the output of the test case is captured" \
+                    "and only printed if it does not succeed"
+}
+result_capture_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o empty -e empty -x \
+            "ATF_OUTPUT_CAPTURE=1024 ${h} -s ${srcdir} -r resfile result_pass"
+        atf_check -o inline:"passed\n" cat resfile
+
+        atf_check -s eq:1 -o inline:"msg\n" -e empty -x \
+            "ATF_OUTPUT_CAPTURE=1024 ${h} -s ${srcdir} -r resfile result_fail"
+        atf_check -o inline:"failed: Failure reason\n" cat resfile
+
+        # Without a results file, there is nothing to tell whether the
+        # output is worth keeping.
+        atf_check -s eq:0 -o match:"msg" -e ignore -x \
+            "ATF_OUTPUT_CAPTURE=1024 ${h} -s ${srcdir} result_pass"
+    done
+
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:1 -o empty -e save:stderr -x \
+            "ATF_OUTPUT_CAPTURE=64 ATF_CHECK_FAILURE_LIMIT=0 ${h} \
+             -s ${srcdir} -r resfile result_check_repeat"
+        atf_check -o match:'^\*\*\* Discarded the first [0-9]+ bytes of' \
+            sed -n 1p stderr
+        atf_check -o match:'Single check$' tail -n 1 stderr
+        atf_check -o inline:"64\n" -x "sed 1d stderr | wc -c | tr -d ' '"
+
+        atf_check -s signal -o ignore -e match:"Invalid value" -x \
+            "ATF_OUTPUT_CAPTURE=foo ${h} -s ${srcdir} -r resfile result_pass"
+    done
+}
+
+atf_test_case result_check_stats
+result_check_stats_head()
+{
+    atf_set "descr" "Tests that the statistics of the checks are recorded" \
+                    "next to the results file when requested"
+}
+result_check_stats_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        case "${h}" in
+            *cpp_helpers) evaluated=12 failed=0 ;;
+            *) evaluated=12 failed=1 ;;
+        esac
+
+        rm -f resfile.checks
+        atf_check -s ignore -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_check_stats
+        atf_check -s eq:1 test -f resfile.checks
+
+        atf_check -s ignore -o ignore -e ignore -x \
+            "ATF_CHECK_STATS=yes ${h} -s ${srcdir} -r resfile \
+             result_check_stats"
+        atf_check -o inline:"checks-evaluated: ${evaluated}\n" \
+            grep '^checks-evaluated:' resfile.checks
+        atf_check -o inline:"checks-failed: ${failed}\n" \
+            grep '^checks-failed:' resfile.checks
+        atf_check -o match:'^checks-per-second: [0-9]+$' \
+            grep '^checks-per-second:' resfile.checks
+        atf_check -o inline:"3\n" grep -c '^site: ' resfile.checks
+        atf_check \
+            -o match:"^site: [^ ]*_helpers\.(c|cpp):[0-9]+: 10 evaluated, " \
+            sed -n 5p resfile.checks
+
+        # A test case that runs no checks is easy to spot.
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "ATF_CHECK_STATS=yes ${h} -s ${srcdir} -r resfile result_pass"
+        atf_check -o inline:"checks-evaluated: 0\n" \
+            grep '^checks-evaluated:' resfile.checks
+    done
+}
+
+# Starts the collector helper in the background and waits until it listens
+# on the given socket for the given number of connections.
+start_collector()
+{
+    "$(atf_get_srcdir)/c_helpers" -s "$(atf_get_srcdir)" -r collector.res \
+        -v socket="$(pwd)/${1}" -v connections="${2}" result_collector \
+        >collected &
+    collector=${!}
+    tries=0
+    while [ ! -S "${1}" ]; do
+        [ ${tries} -lt 100 ] || atf_fail "The collector did not start"
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+}
+
+# Waits for the collector started by start_collector to terminate.
+wait_collector()
+{
+    wait ${collector} || atf_fail "The collector failed"
+    rm -f "${1}"
+}
+
+atf_test_case result_socket
+result_socket_head()
+{
+    atf_set "descr" "Tests that the results can be sent to a collector" \
+                    "listening on a Unix socket"
+}
+result_socket_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        start_collector sock 1
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -r unix:sock result_fail
+        wait_collector sock
+        atf_check -o inline:"failed: Failure reason\n" cat collected
+        test ! -f unix:sock || atf_fail "Created a results file"
+
+        start_collector sock 1
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "ATF_RESULT_EVENTS=yes ${h} -s ${srcdir} -r unix:sock result_pass"
+        wait_collector sock
+        atf_check -o match:'^\{"event":"start",.*"test_case":"result_pass"' \
+            -o match:'^\{"event":"result",.*"result":"passed"' \
+            -o match:'^passed$' cat collected
+
+        # The test cases of a batch share the collector, even when they run
+        # in their own work directories.
+        start_collector sock 2
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" -j 2 \
+            -r unix:sock result_pass result_fail
+        wait_collector sock
+        atf_check -o inline:"failed: Failure reason\npassed\n" \
+            sort collected
+
+        atf_check -s signal -o ignore \
+            -e match:"Cannot connect to results socket 'unix:missing'" \
+            "${h}" -s "${srcdir}" -r unix:missing result_pass
+    done
+}
+
+# Runs the result_cache_count helper and checks how many times its body
+# has run so far.
+run_counted()
+{
+    h="${1}"; runs="${2}"; shift 2
+    atf_check -s eq:0 -o ignore -e ignore -x \
+        "${*} ${h} -s $(atf_get_srcdir) -r resfile \
+         -v counter=$(pwd)/counter -v input=$(pwd)/input result_cache_count"
+    atf_check -o inline:"passed\n" cat resfile
+    atf_check -o inline:"${runs}\n" -x "wc -l <counter | tr -d ' '"
+}
+
+atf_test_case result_cache
+result_cache_head()
+{
+    atf_set "descr" "Tests that passing results are taken from the result" \
+                    "cache while the inputs of the test case do not change"
+}
+result_cache_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -rf cache counter
+        echo "first" >input
+
+        run_counted "${h}" 1
+        run_counted "${h}" 2
+        cache="ATF_RESULT_CACHE_DIR=$(pwd)/cache"
+        run_counted "${h}" 3 "${cache}"
+        run_counted "${h}" 3 "${cache}"
+        rm resfile
+        run_counted "${h}" 3 "${cache}"
+
+        echo "second" >input
+        run_counted "${h}" 4 "${cache}"
+        run_counted "${h}" 4 "${cache}"
+        run_counted "${h}" 5 "${cache} FOO=bar"
+        run_counted "${h}" 5 "${cache} FOO=bar"
+
+        # Failures are never cached.
+        atf_check -s eq:1 -o ignore -e ignore -x \
+            "${cache} ${h} -s $(atf_get_srcdir) -r resfile result_fail"
+        echo "passed" >resfile
+        atf_check -s eq:1 -o ignore -e ignore -x \
+            "${cache} ${h} -s $(atf_get_srcdir) -r resfile result_fail"
+        atf_check -o inline:"failed: Failure reason\n" cat resfile
+    done
+}
+
+atf_test_case result_leak
+result_leak_head()
+{
+    atf_set "descr" "Tests that the processes left behind by a test case" \
+                    "are killed and reported"
+}
+result_leak_body()
+{
+    case "$(uname -s)" in
+    FreeBSD)
+        ;;
+    Linux)
+        test -r /proc/$$/task/$$/children || \
+            atf_skip "Cannot list the children of a process"
+        ;;
+    *)
+        atf_skip "Cannot adopt orphaned processes on this platform"
+        ;;
+    esac
+
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -f pidfile resfile.rusage resfile.jsonl
+        atf_check -s eq:1 -o ignore \
+            -e match:"WARNING: The test case left 1 process\(es\) behind" \
+            -x "ATF_RUSAGE=yes ATF_RESULT_EVENTS=yes ${h} -s ${srcdir} \
+                -r resfile -v pidfile=$(pwd)/pidfile result_leak"
+        atf_check -o match:"on purpose \(warning: left 1 process\(es\) behind\)$" \
+            cat resfile
+        atf_check -o inline:"leaked-processes: 1\n" \
+            grep "^leaked-processes:" resfile.rusage
+        atf_check -o match:'"event":"leak".*"processes":1' \
+            tail -n 1 resfile.jsonl
+        ! kill -0 $(cat pidfile) 2>/dev/null || atf_fail "Process not killed"
+    done
+
+    # The cleanup routine may have to stop what the body started, so the
+    # processes left behind by the body are not killed before it runs.
+    for h in $(get_helpers c_helpers); do
+        rm -f pidfile resfile.rusage
+        atf_check -s eq:1 -o ignore -e not-match:"behind" \
+            -x "ATF_RUSAGE=yes ${h} -s ${srcdir} -r resfile \
+                -v pidfile=$(pwd)/pidfile result_leak_cleanup"
+        atf_check -o not-match:"warning" cat resfile
+        atf_check -s eq:1 grep "^leaked-processes:" resfile.rusage
+        kill $(cat pidfile) || atf_fail "Process killed before the cleanup" \
+                                        "routine"
+
+        rm -f pidfile cleanup.pid status
+        atf_check -s eq:1 -o ignore \
+            -e match:"Test case .result_leak_cleanup' left 2 process\(es\)" \
+            "${h}" -s "${srcdir}" -r resfile -v pidfile="$(pwd)/pidfile" \
+            -v cleanup_pidfile="$(pwd)/cleanup.pid" \
+            -v cleanup_status="$(pwd)/status" result_leak_cleanup:all
+        atf_check -o inline:"running\n" cat status
+        atf_check -o match:"\(warning: left 2 process\(es\) behind\)$" \
+            cat resfile
+        ! kill -0 $(cat pidfile) 2>/dev/null || atf_fail "Process not killed"
+        ! kill -0 $(cat cleanup.pid) 2>/dev/null || \
+            atf_fail "Process not killed"
+
+        # Nor are they blamed on the test cases that run after the body.
+        rm -rf pidfile resdir
+        atf_check -s eq:1 -o ignore -e not-match:"behind" \
+            "${h}" -s "${srcdir}" -r resdir -v pidfile="$(pwd)/pidfile" \
+            result_leak_cleanup:body result_pass
+        atf_check -o inline:"passed\n" cat resdir/result_pass
+        kill $(cat pidfile) || atf_fail "Process killed before the cleanup" \
+                                        "routine"
+    done
+}
+
 atf_test_case result_exception
 result_exception_head()
 {
@@ -129,6 +513,14 @@ atf_init_test_cases()
     atf_add_test_case result_on_stdout
     atf_add_test_case result_to_file
     atf_add_test_case result_to_file_fail
+    atf_add_test_case result_rusage
+    atf_add_test_case result_events
+    atf_add_test_case result_check_limit
+    atf_add_test_case result_capture
+    atf_add_test_case result_check_stats
+    atf_add_test_case result_socket
+    atf_add_test_case result_cache
+    atf_add_test_case result_leak
     atf_add_test_case result_exception
 }
 
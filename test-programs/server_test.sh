@@ -0,0 +1,172 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+atf_test_case run_commands
+run_commands_head()
+{
+    atf_set "descr" "Tests that a server executes the test cases it is" \
+                    "asked to and reports their exit status"
+}
+run_commands_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        cat >commands <<EOF2
+run result_pass res1
+run result_fail res2
+run expect_signal_any_and_signal:body res3
+quit
+run result_skip res4
+EOF2
+        cat >expout <<EOF2
+exit 0
+exit 1
+signal 9
+EOF2
+        atf_check -s eq:0 -o file:expout -e ignore \
+            "${h}" -s "${srcdir}" -S - <commands
+        atf_check -o inline:"passed\n" cat res1
+        atf_check -o inline:"failed: Failure reason\n" cat res2
+        test ! -f res4 || atf_fail "Commands after quit were executed"
+        rm -f res*
+    done
+}
+
+atf_test_case eof_terminates
+eof_terminates_head()
+{
+    atf_set "descr" "Tests that a server reading from stdin terminates" \
+                    "when its input is exhausted"
+}
+eof_terminates_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        echo "run result_pass res" >commands
+        atf_check -s eq:0 -o inline:"exit 0\n" -e ignore \
+            "${h}" -s "${srcdir}" -S - <commands
+        atf_check -o inline:"passed\n" cat res
+    done
+}
+
+atf_test_case stdin_isolated
+stdin_isolated_head()
+{
+    atf_set "descr" "Tests that the test cases run by a server reading" \
+                    "from stdin cannot consume its commands"
+}
+stdin_isolated_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        # The second command must not be in the pipe before the test case
+        # runs, or the server would have read it already.
+        atf_check -s eq:0 -o inline:"exit 0\nexit 0\n" -e ignore -x \
+            "{ echo 'run result_stdin res1'; sleep 1; \
+               echo 'run result_pass res2'; } | \
+             '${h}' -s '${srcdir}' -S -"
+        atf_check -o inline:"passed\n" cat res1
+        atf_check -o inline:"passed\n" cat res2
+        rm -f res*
+    done
+}
+
+atf_test_case output_files
+output_files_head()
+{
+    atf_set "descr" "Tests that the output of the test cases is kept out" \
+                    "of the replies and can be sent to files"
+}
+output_files_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        echo "run result_pass res tc.out tc.err" >commands
+        echo "run result_pass res" >>commands
+        atf_check -s eq:0 -o inline:"exit 0\nexit 0\n" -e match:"^msg$" \
+            "${h}" -s "${srcdir}" -S - <commands
+        atf_check -o inline:"msg\n" cat tc.out
+        atf_check -o empty cat tc.err
+    done
+}
+
+atf_test_case bad_commands
+bad_commands_head()
+{
+    atf_set "descr" "Tests that invalid commands are reported but do not" \
+                    "stop the server"
+}
+bad_commands_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        cat >commands <<EOF2
+run foo res
+run result_pass:foo res
+hello world
+run result_pass res
+EOF2
+        cat >expout <<EOF2
+error Unknown test case \`foo'
+error Invalid test case part in \`result_pass:foo'
+error Invalid command \`hello world'
+exit 0
+EOF2
+        atf_check -s eq:0 -o file:expout -e ignore \
+            "${h}" -s "${srcdir}" -S - <commands
+    done
+}
+
+atf_test_case usage_errors
+usage_errors_head()
+{
+    atf_set "descr" "Tests the usage errors of the server mode"
+}
+usage_errors_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:1 -o empty -e match:"test case names with -S" \
+            "${h}" -s "${srcdir}" -S - result_pass
+        atf_check -s eq:1 -o empty -e match:"-a, -j, -l nor -r with -S" \
+            "${h}" -s "${srcdir}" -S - -l
+        atf_check -s eq:1 -o empty -e match:"-a, -j, -l nor -r with -S" \
+            "${h}" -s "${srcdir}" -S - -r resfile
+        atf_check -s eq:1 -o empty -e match:"-a, -j, -l nor -r with -S" \
+            "${h}" -s "${srcdir}" -S - -j 2
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case run_commands
+    atf_add_test_case eof_terminates
+    atf_add_test_case stdin_isolated
+    atf_add_test_case output_files
+    atf_add_test_case bad_commands
+    atf_add_test_case usage_errors
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
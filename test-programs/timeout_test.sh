@@ -0,0 +1,102 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# The test programs only supervise their bodies when they are not run by
+# a test runner, so make sure that the helpers do not think they are.
+run_helper()
+{
+    atf_check "${@}" -x "unset __RUNNING_INSIDE_ATF_RUN; exec ${TP_CMD}"
+}
+
+atf_test_case body_timeout
+body_timeout_head()
+{
+    atf_set "descr" "Checks that a test case whose body overruns its" \
+                    "timeout is killed, together with its children," \
+                    "and reported as broken"
+}
+body_timeout_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -f grandchild.pid result
+        TP_CMD="${h} -r result -v hang=yes timeout_hang" \
+            run_helper -s eq:1 -o ignore -e ignore
+        echo "broken: Test case body timed out after 1 seconds" >expout
+        atf_check -o file:expout cat result
+        atf_check -o ignore test -f grandchild.pid
+        pid=$(cat grandchild.pid)
+        i=0
+        while kill -0 "${pid}" 2>/dev/null; do
+            [ ${i} -lt 50 ] || atf_fail "Grandchild ${pid} survived"
+            sleep 0.1
+            i=$((i + 1))
+        done
+    done
+}
+
+atf_test_case expected_timeout
+expected_timeout_head()
+{
+    atf_set "descr" "Checks that an expected timeout is reported as such"
+}
+expected_timeout_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -f result
+        TP_CMD="${h} -r result expect_timeout_and_hang" \
+            run_helper -s eq:0 -o ignore -e ignore
+        echo "expected_timeout: Will overrun" >expout
+        atf_check -o file:expout cat result
+    done
+}
+
+atf_test_case mirror_status
+mirror_status_head()
+{
+    atf_set "descr" "Checks that the supervisor exits in the same way" \
+                    "as the test case body it runs"
+}
+mirror_status_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        TP_CMD="${h} -r result expect_exit_code_and_exit" \
+            run_helper -s eq:123 -o ignore -e ignore
+        TP_CMD="${h} -r result expect_signal_no_and_signal" \
+            run_helper -s signal:hup -o ignore -e ignore
+        TP_CMD="${h} -r result expect_pass_and_pass" \
+            run_helper -s eq:0 -o ignore -e ignore
+        echo "passed" >expout
+        atf_check -o file:expout cat result
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case body_timeout
+    atf_add_test_case expected_timeout
+    atf_add_test_case mirror_status
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -0,0 +1,174 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Checks the number of trace events of the given phase and type.
+# If given, the fourth argument restricts the check to the events of the
+# phases with that argument.
+check_events()
+{
+    atf_check -o inline:"${3}\n" -x "grep -c \
+        '^{\"name\":\"${1}\",\"cat\":\"atf\",\"ph\":\"${2}\",.*${4}' \
+        trace.json"
+}
+
+atf_test_case phases
+phases_head()
+{
+    atf_set "descr" "Checks that the phases of a test program are recorded" \
+                    "as trace events"
+}
+phases_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        case "${h}" in
+            *cpp_helpers) init=init_tcs ;;
+            *) init=atf_tp_init ;;
+        esac
+
+        rm -f trace.json
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "ATF_RUSAGE=yes ATF_TRACE_FILE=trace.json ${h} -s ${srcdir} \
+             -r resfile result_pass"
+        atf_check -o inline:'[\n' sed -n 1p trace.json
+        for phase in startup handle_srcdir ${init} body write_resfile; do
+            check_events "${phase}" B 1
+            check_events "${phase}" E 1
+        done
+        atf_check -o match:'"ts":[0-9]+\.[0-9]{3},"pid":[0-9]+,' \
+            sed -n 2p trace.json
+        atf_check -o match:'"args":\{"arg":"result_pass"\}\},$' \
+            grep '"name":"body","cat":"atf","ph":"B"' trace.json
+
+        # The body runs in a child of the test program when it is
+        # supervised, as it is to record its resources.
+        main_pid="$(sed -n 's/.*"name":"startup".*"pid":\([0-9]*\),.*/\1/p' \
+            trace.json | sort -u)"
+        body_pid="$(sed -n 's/.*"name":"body".*"pid":\([0-9]*\),.*/\1/p' \
+            trace.json | sort -u)"
+        [ "${main_pid}" != "${body_pid}" ] || atf_fail "Body not in a child"
+
+        # Further processes append to the same trace.
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "ATF_TRACE_FILE=trace.json ${h} -s ${srcdir} -r resfile \
+             result_pass"
+        atf_check -o inline:"1\n" grep -c '^\[$' trace.json
+        check_events startup B 2
+
+        # Listing the test cases runs all of their heads.
+        rm trace.json
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "ATF_TRACE_FILE=trace.json ${h} -s ${srcdir} -l"
+        check_events head B 1 '"arg":"timeout_hang"'
+        check_events head E "$(grep -c '"name":"head","cat":"atf","ph":"B"' \
+            trace.json)"
+    done
+}
+
+atf_test_case listing
+listing_head()
+{
+    atf_set "descr" "Checks that the startup phase of a test program ends" \
+                    "before it lists its test cases"
+}
+listing_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        rm -f trace.json
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "ATF_TRACE_FILE=trace.json ${h} -s ${srcdir} -l"
+        check_events startup B 1
+        check_events startup E 1
+
+        # The heads run right after the end of the startup phase.
+        atf_check -o match:'^\{"name":"startup","cat":"atf","ph":"E",' -x \
+            "grep -B1 -m1 '\"name\":\"head\"' trace.json | sed -n 1p"
+    done
+}
+
+atf_test_case check_exec
+check_exec_head()
+{
+    atf_set "descr" "Checks that the commands run by atf_check_exec_array" \
+                    "are recorded as trace events"
+}
+check_exec_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    atf_check -s eq:0 -o ignore -e ignore -x \
+        "ATF_TRACE_FILE=trace.json ${srcdir}/c_helpers -s ${srcdir} \
+         -r resfile trace_check"
+    check_events check_exec B 1
+    check_events check_exec E 1
+    atf_check -o match:'"args":\{"arg":"/bin/sh"\}\},$' \
+        grep '"name":"check_exec","cat":"atf","ph":"B"' trace.json
+}
+
+atf_test_case disabled
+disabled_head()
+{
+    atf_set "descr" "Checks that no trace is recorded unless requested"
+}
+disabled_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    mkdir work
+    cd work
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o ignore -e ignore -x \
+            "ATF_TRACE_FILE= ${h} -s ${srcdir} -r resfile result_pass"
+        atf_check -o inline:"resfile\n" ls
+    done
+}
+
+atf_test_case unwritable
+unwritable_head()
+{
+    atf_set "descr" "Checks that failing to record the trace does not" \
+                    "affect the test case"
+}
+unwritable_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o ignore \
+            -e match:"WARNING: Disabling tracing: Cannot open trace file" \
+            -x "ATF_TRACE_FILE=missing/trace.json ${h} -s ${srcdir} \
+                -r resfile result_pass"
+        atf_check -o inline:"passed\n" cat resfile
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case phases
+    atf_add_test_case listing
+    atf_add_test_case check_exec
+    atf_add_test_case disabled
+    atf_add_test_case unwritable
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4